@@ -1,8 +1,65 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+
+// Frame timing on the steady high resolution clock. The engine's loop ticks
+// it once per frame; the delta is clamped so a breakpoint or a window drag
+// doesn't hand the game a multi-second step.
 class Time
 {
 public:
 	Time();
+
+	/// <summary>
+	/// Start a new frame, the delta is the time since the previous tick
+	/// </summary>
+	void tick();
+
+	/// <summary>
+	/// Seconds the last frame took, clamped to getMaxDeltaTime
+	/// </summary>
+	double getDeltaTime() const { return m_deltaTime; }
+
+	/// <summary>
+	/// Exponential average of the delta, steadier for display
+	/// </summary>
+	double getSmoothedDeltaTime() const { return m_smoothedDeltaTime; }
+
+	/// <summary>
+	/// Frames per second from the smoothed delta
+	/// </summary>
+	double getFps() const { return m_smoothedDeltaTime > 0.0 ? 1.0 / m_smoothedDeltaTime : 0.0; }
+
+	/// <summary>
+	/// Seconds since construction
+	/// </summary>
+	double getElapsed() const;
+
+	uint64_t getFrameCount() const { return m_frameCount; }
+
+	void setMaxDeltaTime(double seconds) { m_maxDeltaTime = seconds; }
+	double getMaxDeltaTime() const { return m_maxDeltaTime; }
+
+	/// <summary>
+	/// Seconds on the steady clock, only differences mean anything
+	/// </summary>
+	static double now();
+
+	/// <summary>
+	/// Block until a point on the now() clock: sleep while it is far off
+	/// (sleep overshoots by up to a scheduler tick), then spin the rest
+	/// </summary>
+	/// <param name="seconds">Deadline on the now() clock</param>
+	static void waitUntil(double seconds);
+
 private:
-};
\ No newline at end of file
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point m_start;
+	Clock::time_point m_last;
+	double m_deltaTime = 0.0;
+	double m_smoothedDeltaTime = 0.0;
+	double m_maxDeltaTime = 0.25;
+	uint64_t m_frameCount = 0;
+};
@@ -7,6 +7,16 @@
 class Window
 {
 public:
+	/// <summary>
+	/// How buffer swaps wait for the display
+	/// </summary>
+	enum class VSync
+	{
+		Off,		// swap right away, may tear
+		On,			// wait for the vertical blank
+		Adaptive	// wait, but swap right away when a frame is late; On where unsupported
+	};
+
 	/// <summary>
 	/// Window Constructor
 	/// </summary>
@@ -44,12 +54,24 @@ public:
 
 	void getSize(int& width, int& height);
 
+	/// <summary>
+	/// Set the swap interval, the window's context has to be current
+	/// </summary>
+	/// <param name="mode">Vsync mode</param>
+	void setVSync(VSync mode);
+
+	/// <summary>
+	/// Mode in effect, Adaptive falls back to On without EXT_swap_control_tear
+	/// </summary>
+	VSync getVSync() const { return m_vsync; }
+
 	bool isValid();
 
 	~Window();
 private:
 	GLFWwindow* m_window = nullptr;
 	unsigned int m_width, m_height;
+	VSync m_vsync = VSync::On;
 
 	// resize function
 	void resize_callback();
@@ -5,6 +5,7 @@
 #include <iostream>
 
 #include "Renderer/Model.h"
+#include "Core/Time.h"
 #include "Core/Window.h"
 #include "Renderer/Renderer.h"
 #include "World/World.h"
@@ -12,6 +13,16 @@
 class Engine
 {
 public:
+	/// <summary>
+	/// Frame pacing of run()
+	/// </summary>
+	struct FrameSettings
+	{
+		Window::VSync vsync = Window::VSync::On;
+		double maxFps = 0.0;			// 0 leaves the pace to vsync
+		int maxFramesInFlight = 2;		// frames the CPU may queue ahead of the GPU, 0 leaves it to the driver
+	};
+
 	/// <summary>
 	/// Empty constructor for some reason
 	/// </summary>
@@ -34,10 +45,23 @@ public:
 	void setClearColor(float r, float g, float b);
 
 	/// <summary>
-	/// Run the engine
+	/// Run the engine, one swap per frame
 	/// </summary>
 	void run();
 
+	/// <summary>
+	/// Set vsync, the frame rate limit and the frames in flight cap
+	/// </summary>
+	/// <param name="settings">Frame settings</param>
+	void setFrameSettings(const FrameSettings& settings);
+
+	const FrameSettings& getFrameSettings() const { return m_frameSettings; }
+
+	/// <summary>
+	/// Frame timing, ticked at the start of every frame of run()
+	/// </summary>
+	const Time& getTime() const { return m_time; }
+
 	/// <summary>
 	/// Initialize Engine
 	/// </summary>
@@ -52,6 +76,13 @@ private:
 	Renderer*	m_renderer	= nullptr;
 	World*		m_world		= nullptr;
 
+	FrameSettings	m_frameSettings;
+	Time			m_time;
+	double			m_nextFrame = 0.0;	// earliest start of the next frame with a limit, on the Time::now() clock
+
+	// Wait out the frame rate limit
+	void waitForNextFrame();
+
 	std::unordered_map<std::string, std::shared_ptr<Model>> m_loadedModels;
 
 	// Test function
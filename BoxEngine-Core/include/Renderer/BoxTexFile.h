@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Texture.h"
+#include "CompressedImage.h"
+#include "Utils/MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// .boxtex texture cache written by TextureTool: a fixed header, a level table
+// and every mip level, either 8-bit pixels or BC blocks, already in the
+// engine's row order. The file is memory mapped and levels are uploaded
+// straight from the mapping, nothing is decoded or generated at load time.
+//
+// Layout (little endian):
+//   Header, then levelCount x LevelEntry, then level data (16 byte aligned)
+class BoxTexFile {
+public:
+    static const uint32_t MAGIC = 0x54584F42;    // "BOXT"
+    static const uint32_t VERSION = 1;
+    static const uint32_t FLAG_SRGB = 1;        // colour data, mips were filtered in linear space
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t channels;      // 1, 2 or 4 for 8-bit pixels, 0 when block compressed
+        uint32_t blockFormat;   // BlockFormat, 0 for 8-bit pixels
+        uint32_t flags;
+    };
+
+    struct LevelEntry {
+        uint64_t offset;        // from the start of the file
+        uint64_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct Level {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    // True for .boxtex paths
+    static bool canLoad(const std::string& filepath);
+
+    // Map and validate a file
+    bool open(const std::string& filepath);
+    bool isOpen() const { return m_file.isOpen() && !m_levels.empty(); }
+
+    // Read one byte per page so the GL thread doesn't stall on page faults
+    void prefetch() const;
+
+    int getWidth() const { return static_cast<int>(m_header.width); }
+    int getHeight() const { return static_cast<int>(m_header.height); }
+    int getChannels() const { return static_cast<int>(m_header.channels); }
+    BlockFormat getBlockFormat() const { return static_cast<BlockFormat>(m_header.blockFormat); }
+    bool isSRGB() const { return (m_header.flags & FLAG_SRGB) != 0; }
+    const std::vector<Level>& getLevels() const { return m_levels; }
+
+    // Copy out of the mapping, for paths that keep their own source (streaming, arrays)
+    bool toImage(Texture::Image& out) const;
+    bool toCompressed(CompressedImage& out) const;
+
+    // Write an image with its mips (Image::mips must be filled) or a compressed chain
+    static bool write(const std::string& filepath, const Texture::Image& image, bool srgb);
+    static bool write(const std::string& filepath, const CompressedImage& image, bool srgb);
+
+private:
+    MappedFile m_file;
+    Header m_header = {};
+    std::vector<Level> m_levels;
+};
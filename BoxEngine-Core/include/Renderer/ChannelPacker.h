@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Texture.h"
+#include <array>
+#include <string>
+
+// Scalar material maps that share one PACKED texture, in the order they are
+// given channels
+enum class MaterialChannel {
+    Occlusion = 0,
+    Roughness,
+    Metallic,
+    Specular,
+    Height,
+    Count
+};
+
+// Material side descriptor: which channel of the PACKED texture holds each
+// scalar map, -1 when the material doesn't have it
+struct ChannelMap {
+    std::array<int, static_cast<size_t>(MaterialChannel::Count)> channels = { -1, -1, -1, -1, -1 };
+
+    int get(MaterialChannel map) const { return channels[static_cast<size_t>(map)]; }
+    bool has(MaterialChannel map) const { return get(map) >= 0; }
+    bool isEmpty() const;
+
+    // Number of channels the packed image needs (1, 2 or 4)
+    int getChannelCount() const;
+};
+
+// Import-time packing of scalar material maps (occlusion, roughness, metallic,
+// specular, height) into one texture, so a material binds and samples one
+// RGBA image instead of a greyscale image per map.
+class ChannelPacker {
+public:
+    // One scalar map: the image holding it and which of its channels to read
+    struct Source {
+        std::string path;                       // file, or a unique name for embedded bytes
+        const unsigned char* data = nullptr;    // embedded image bytes, decoded instead of the file
+        size_t size = 0;
+        int channel = 0;                        // 0-3, grey images map colour to their grey value
+
+        bool isValid() const { return !path.empty(); }
+    };
+    using Sources = std::array<Source, static_cast<size_t>(MaterialChannel::Count)>;
+
+    // Hand out channels to the present maps in MaterialChannel order. Only four
+    // fit, a height map that doesn't is left at -1 and stays its own texture.
+    static ChannelMap layout(const Sources& sources);
+
+    // Name the packed texture is cached under, equal for equal sources and layout
+    static std::string getName(const Sources& sources, const ChannelMap& map);
+
+    // Decode every source and interleave them, the largest source sets the size.
+    // Thread safe. Maps that fail to decode get their neutral value and false is
+    // returned, out is still usable.
+    static bool pack(const Sources& sources, const ChannelMap& map, Texture::Image& out);
+
+    // Small image holding only neutral values, used until or instead of the real one
+    static Texture::Image createDefaultImage(const ChannelMap& map);
+
+    // Value a missing map reads as (full occlusion visibility, mid roughness, ...)
+    static unsigned char getNeutralValue(MaterialChannel map);
+};
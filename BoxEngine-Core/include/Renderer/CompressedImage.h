@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Block compressed formats we can upload with glCompressedTexImage2D
+enum class BlockFormat {
+    None = 0,
+    BC1,    // RGB, 4 bpp (DXT1)
+    BC3,    // RGBA, 8 bpp (DXT5)
+    BC4,    // single channel, 4 bpp
+    BC5,    // two channels, 8 bpp, used for normal maps (z is rebuilt in the shader)
+    BC7     // RGBA, 8 bpp, best quality
+};
+
+// Pre-compressed texture read from a .dds or .ktx2 file. Levels are stored
+// back to back in data, level 0 first. Rows are uploaded as stored, so files
+// must be written in the engine's row order (TextureTool does this).
+struct CompressedImage {
+    struct Level {
+        size_t offset = 0;
+        size_t size = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    BlockFormat format = BlockFormat::None;
+    int width = 0;
+    int height = 0;
+    std::vector<Level> levels;
+    std::vector<unsigned char> data;
+
+    bool isValid() const { return format != BlockFormat::None && !levels.empty(); }
+
+    // True for .dds and .ktx2 paths
+    static bool canLoad(const std::string& filepath);
+
+    // Read a DDS (legacy FourCC or DX10 header) or an uncompressed-stream KTX2 file
+    static bool load(const std::string& filepath, CompressedImage& out);
+
+    // Write as DDS, BC7 gets a DX10 header, everything else a legacy FourCC
+    bool saveDDS(const std::string& filepath) const;
+
+    // Bytes per 4x4 block
+    static size_t getBlockSize(BlockFormat format);
+
+    // Bytes for one level of the given size
+    static size_t getLevelSize(BlockFormat format, int width, int height);
+
+    // Number of channels the format stores
+    static int getChannelCount(BlockFormat format);
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Renderer/GpuTimer.h"
+#include "Renderer/Shader.h"
+
+// Dynamic resolution. The scene is rendered into an offscreen target at a
+// fraction of the window size and stretched back over the window with a
+// sharpening filter. The fraction follows the measured GPU time of the frame:
+//
+//  - over budget, it drops right away by the square root of the overshoot
+//    (pixel cost goes with the area), at least one step
+//  - under raiseBelow of the budget for raiseFrames frames in a row, it goes
+//    up one step
+//  - after a change it holds for a few frames, the timings still in flight
+//    were measured at the old size
+//
+// The render graph owns the targets. They are sized for maxScale of the window
+// and rendered into from the corner, so the pooled textures are the same every
+// frame and changing the scale never reallocates anything.
+class DynamicResolution
+{
+public:
+	struct Settings {
+		double targetMs = 14.0;			// GPU budget of a frame, a little under the refresh interval
+		float minScale = 0.5f;			// of the window size, per axis
+		float maxScale = 1.0f;
+		float step = 0.05f;				// scales are multiples of this
+		double raiseBelow = 0.85;		// fraction of the budget to stay under before going up
+		int raiseFrames = 30;
+		int settleFrames = 6;			// frames to hold after a change, longer than the timer latency
+		float sharpness = 0.4f;			// 0 plain bilinear, 1 strongest
+	};
+
+	DynamicResolution() = default;
+	~DynamicResolution();
+
+	void setSettings(const Settings& settings);
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Size of the window the result is shown in
+	/// </summary>
+	void resize(int width, int height);
+
+	/// <summary>
+	/// Pick this frame's scale from the latest GPU time and start timing
+	/// </summary>
+	/// <returns>False if there is nothing to render to (minimized window)</returns>
+	bool begin();
+
+	/// <summary>
+	/// Upscale the scene colour into the bound framebuffer and stop timing.
+	/// Leaves depth testing and face culling off and fill mode on.
+	/// </summary>
+	/// <param name="sceneColor">Texture of getTargetWidth x getTargetHeight holding the scene in its corner</param>
+	void upscale(unsigned int sceneColor);
+
+	float getScale() const { return m_scale; }
+
+	/// <summary>
+	/// Size the scene is rendered at this frame
+	/// </summary>
+	int getWidth() const { return m_renderWidth; }
+	int getHeight() const { return m_renderHeight; }
+
+	/// <summary>
+	/// Size of the scene targets, maxScale of the window
+	/// </summary>
+	int getTargetWidth() const { return m_targetWidth; }
+	int getTargetHeight() const { return m_targetHeight; }
+
+	/// <summary>
+	/// GPU time of a whole frame, a few frames old
+	/// </summary>
+	double getGpuMilliseconds() const { return m_timer.getMilliseconds(); }
+
+	/// <summary>
+	/// Delete the timer queries and the upscale vertex array, call before the context goes away
+	/// </summary>
+	void release();
+
+	// Owns GL objects
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+private:
+	void adjust();
+
+	Settings m_settings;
+	float m_scale = 1.0f;
+	int m_framesUnder = 0;
+	int m_framesSettling = 0;
+	unsigned long long m_lastSample = 0;
+
+	int m_windowWidth = 0;
+	int m_windowHeight = 0;
+	int m_targetWidth = 0;
+	int m_targetHeight = 0;
+	int m_renderWidth = 0;
+	int m_renderHeight = 0;
+
+	GpuTimer m_timer;
+	Shader m_upscaleShader;				// upscale.vert/upscale.frag
+	unsigned int m_emptyVAO = 0;		// the fullscreen triangle comes from gl_VertexID
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Vertex.h"
+#include "Utils/Json.h"
+#include "Utils/MappedFile.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Native glTF 2.0 (.gltf + .bin, or .glb) reader. Buffers are memory mapped
+// and accessors are decoded straight into interleaved vertices, so the data
+// is copied once instead of going through assimp's scene graph.
+class GLTFLoader
+{
+public:
+    // Image used by a material, either a file on disk or bytes inside a buffer
+    struct TextureRef {
+        std::string path;                       // resolved file path, or a unique name for embedded images
+        const unsigned char* data = nullptr;    // embedded image bytes, valid while the loader is alive
+        size_t size = 0;
+
+        bool isValid() const { return !path.empty(); }
+    };
+
+    // Material textures mapped onto our TextureType slots the same way assimp maps them
+    struct Material {
+        std::string name;
+        TextureRef diffuse;     // pbrMetallicRoughness.baseColorTexture
+        TextureRef specular;    // KHR_materials_specular or KHR_materials_pbrSpecularGlossiness
+        TextureRef normal;      // normalTexture
+        TextureRef height;      // not part of core glTF
+        TextureRef metallicRoughness;   // pbrMetallicRoughness.metallicRoughnessTexture (G roughness, B metallic)
+        TextureRef occlusion;   // occlusionTexture (R)
+        int specularChannel = 0;    // 3 when specular came from specularTexture, which stores it in alpha
+    };
+
+    // One triangle list per glTF primitive instance
+    struct Primitive {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        int material = -1;
+        glm::mat4 transform = glm::mat4(1.0f); // world transform of the owning node
+        std::string name;
+
+        // Local space bounds from the POSITION accessor, known before decoding
+        glm::vec3 minBounds = glm::vec3(0.0f);
+        glm::vec3 maxBounds = glm::vec3(0.0f);
+        bool hasBounds = false;
+
+        const Json* source = nullptr;   // primitive in the document, valid while the loader is alive
+        bool decoded = false;
+    };
+
+    GLTFLoader() = default;
+
+    // True for .gltf and .glb paths
+    static bool canLoad(const std::string& filepath);
+
+    // Parse the file and decode every primitive in the default scene. Without
+    // decodeGeometry only the hierarchy, materials and bounds are read and the
+    // primitives are left for decodePrimitive.
+    bool load(const std::string& filepath, bool decodeGeometry = true);
+
+    // Decode the vertices of a primitive from a layout-only load. Only reads
+    // loader state, so different primitives can be decoded on different threads.
+    bool decodePrimitive(Primitive& primitive) const;
+
+    // Primitives are handed out mutable so callers can move the vertex data into meshes
+    std::vector<Primitive>& getPrimitives() { return m_primitives; }
+    const std::vector<Material>& getMaterials() const { return m_materials; }
+
+private:
+    struct BufferRange {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct AccessorView {
+        const unsigned char* data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    Json m_document;
+    std::string m_filepath;
+    std::string m_directory;
+
+    // .gltf text or the whole .glb container
+    MappedFile m_file;
+
+    // External .bin files and decoded data: URIs backing m_buffers
+    std::vector<MappedFile> m_bufferFiles;
+    std::vector<std::vector<unsigned char>> m_decodedBuffers;
+    std::vector<BufferRange> m_buffers;
+
+    std::vector<Primitive> m_primitives;
+    std::vector<Material> m_materials;
+    bool m_decodeGeometry = true;
+
+    bool parseGLB(BufferRange& json, BufferRange& binaryChunk);
+    bool loadBuffers(const BufferRange& binaryChunk);
+    void loadMaterials();
+    TextureRef resolveTexture(const Json& textureInfo);
+    bool getBufferView(int index, BufferRange& range, size_t& stride) const;
+    bool getAccessor(int index, AccessorView& view) const;
+
+    void processNode(size_t nodeIndex, const glm::mat4& parentTransform, int depth);
+    void processMesh(size_t meshIndex, const glm::mat4& transform, const std::string& name);
+    bool processPrimitive(const Json& primitive, Primitive& out) const;
+    bool readBounds(const Json& primitive, Primitive& out) const;
+
+    static glm::mat4 getNodeTransform(const Json& node);
+    static void generateNormals(Primitive& primitive);
+    static void generateTangents(Primitive& primitive);
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+// GPU time of a stretch of GL commands, measured with a pair of GL_TIMESTAMP
+// queries, so timers can nest and overlap (a whole frame around its passes).
+// Results arrive a few frames late, so the pairs rotate through a small ring
+// and are only read once the driver says they are available; timing never
+// stalls the CPU. If every pair is still in flight a frame goes untimed.
+class GpuTimer
+{
+public:
+	GpuTimer() = default;
+	~GpuTimer();
+
+	/// <summary>
+	/// Start timing
+	/// </summary>
+	void begin();
+
+	/// <summary>
+	/// Stop timing what was issued since begin
+	/// </summary>
+	void end();
+
+	/// <summary>
+	/// Most recent finished measurement in milliseconds, 0 until one arrives
+	/// </summary>
+	double getMilliseconds() const { return m_milliseconds; }
+
+	/// <summary>
+	/// Grows each time a newer measurement arrives, to tell fresh results from repeats
+	/// </summary>
+	unsigned long long getLatestSample() const { return m_latest; }
+
+	/// <summary>
+	/// Delete the queries, call before the context goes away
+	/// </summary>
+	void release();
+
+	// Owns GL queries
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+private:
+	static const int QUERY_COUNT = 4;
+
+	void collect();
+
+	unsigned int m_queries[QUERY_COUNT][2] = {};	// start, end
+	bool m_pending[QUERY_COUNT] = {};
+	unsigned long long m_issued[QUERY_COUNT] = {};	// order the queries were started in
+	unsigned long long m_serial = 0;
+	unsigned long long m_latest = 0;				// serial of m_milliseconds
+	int m_active = -1;
+	double m_milliseconds = 0.0;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Shader;
+class ThreadPool;
+
+// Point light, the contribution fades to zero at radius
+struct PointLight {
+	glm::vec3 position = glm::vec3(0.0f);
+	float radius = 10.0f;
+	glm::vec3 color = glm::vec3(1.0f);
+	float intensity = 1.0f;
+};
+
+// Clustered light assignment. The view frustum is cut into a grid of froxels
+// (screen tiles times depth slices, spaced logarithmically so near slices stay
+// thin) and every light is listed in the froxels its sphere touches. Fragments
+// look up their froxel and only shade with the lights listed there, so the
+// cost follows how many lights overlap a pixel, not how many exist.
+//
+// Binning runs on the CPU, a group of depth slices per job. The results go to
+// three texture buffers: light data (RGBA32F, position + radius and colour per
+// light), per-froxel offset and count (RG32UI) and the light index list (R32UI).
+class LightClusters
+{
+public:
+	struct Settings {
+		int tilesX = 16;
+		int tilesY = 9;
+		int slices = 24;
+	};
+
+	/// <summary>
+	/// Units the three buffer textures are bound to, after ObjectBuffer
+	/// </summary>
+	static const unsigned int LIGHT_UNIT = 13;
+	static const unsigned int CLUSTER_UNIT = 14;
+	static const unsigned int INDEX_UNIT = 15;
+
+	LightClusters() = default;
+	~LightClusters();
+
+	void setSettings(const Settings& settings) { m_settings = settings; m_froxels.clear(); }
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Bin the frame's lights and upload the results, call on the GL thread
+	/// </summary>
+	/// <param name="lights">Lights in world space</param>
+	/// <param name="view">View matrix of the frame</param>
+	/// <param name="projection">Perspective projection of the frame</param>
+	/// <param name="viewportWidth">Viewport size in pixels, tiles split it evenly</param>
+	/// <param name="viewportHeight"></param>
+	/// <param name="pool">Workers for the binning jobs, waited on before returning</param>
+	void update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+		int viewportWidth, int viewportHeight, ThreadPool& pool);
+
+	/// <summary>
+	/// Bind the buffer textures to their units
+	/// </summary>
+	void bind() const;
+
+	/// <summary>
+	/// Set the samplers and the froxel lookup uniforms on a shader in use
+	/// </summary>
+	void setUniforms(const Shader& shader) const;
+
+	size_t getLightCount() const { return m_lightCount; }
+
+	/// <summary>
+	/// Light references over all froxels, a light touching n froxels counts n times
+	/// </summary>
+	size_t getIndexCount() const { return m_indices.size(); }
+
+	/// <summary>
+	/// Delete the GL objects, call before the context goes away
+	/// </summary>
+	void release();
+
+	// Owns GL objects
+	LightClusters(const LightClusters&) = delete;
+	LightClusters& operator=(const LightClusters&) = delete;
+
+private:
+	// View space box of one froxel
+	struct Froxel {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	// A GL buffer with a buffer texture over it
+	struct TextureBuffer {
+		unsigned int buffer = 0;
+		unsigned int texture = 0;
+		size_t capacity = 0;	// bytes
+	};
+
+	void buildFroxels(const glm::mat4& projection);
+	void upload(TextureBuffer& target, unsigned int format, const void* data, size_t bytes, const char* name);
+
+	Settings m_settings;
+
+	// Rebuilt when the projection or the grid changes
+	std::vector<Froxel> m_froxels;
+	glm::mat4 m_froxelProjection = glm::mat4(0.0f);
+	float m_near = 0.1f;
+	float m_far = 100.0f;
+
+	std::vector<glm::vec4> m_lightTexels;			// 2 per light
+	std::vector<uint32_t> m_clusterTexels;			// offset, count per froxel
+	std::vector<uint32_t> m_indices;
+	std::vector<std::vector<uint32_t>> m_sliceIndices;	// binning output, one list per slice
+	size_t m_lightCount = 0;
+	glm::vec2 m_tileSize = glm::vec2(1.0f);
+
+	TextureBuffer m_lightBuffer;
+	TextureBuffer m_clusterBuffer;
+	TextureBuffer m_indexBuffer;
+};
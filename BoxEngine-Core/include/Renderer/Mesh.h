@@ -3,6 +3,7 @@
 #include "Shader.h"
 #include "Vertex.h"
 #include "Texture.h"
+#include "ChannelPacker.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,6 +13,15 @@
 class Mesh
 {
 public:
+    // Index range of one source part inside a merged (statically batched) mesh,
+    // kept with its own bounds so parts can still be culled individually
+    struct SubMesh {
+        unsigned int indexOffset = 0;
+        unsigned int indexCount = 0;
+        glm::vec3 minBounds = glm::vec3(0.0f);
+        glm::vec3 maxBounds = glm::vec3(0.0f);
+    };
+
     Mesh() = default;
     Mesh(const std::vector<Vertex>& vertices,
         const std::vector<unsigned int>& indices,
@@ -43,6 +53,13 @@ public:
     const glm::vec3& getSpecular() const { return m_specular; }
     float getShininess() const { return m_shininess; }
 
+    // Smallest ShaderFeature mask that covers this mesh's textures
+    uint32_t getShaderFeatures() const;
+
+    // Where the scalar maps sit inside the PACKED texture
+    void setChannelMap(const ChannelMap& channels) { m_channelMap = channels; }
+    const ChannelMap& getChannelMap() const { return m_channelMap; }
+
     // data accessors - make them const!
     const std::vector<Vertex>& getVertices() const { return m_vertices; }
     const std::vector<unsigned int>& getIndices() const { return m_indices; }
@@ -62,7 +79,7 @@ public:
     // Check if mesh is valid
     bool isEmpty() const { return m_vertices.empty(); }
 
-    // memory usage
+    // RAM held by the vertex and index data, the GPU copies are tracked by ResourceRegistry
     size_t getMemoryUsage() const {
         return m_vertices.size() * sizeof(Vertex) +
             m_indices.size() * sizeof(unsigned int);
@@ -70,6 +87,35 @@ public:
 
     void draw(const Shader& shader);
 
+    // Geometry only, no material bound, for depth-only passes
+    void drawDepth();
+
+    // Bind textures and set material uniforms, what draw does before drawing
+    void bindMaterial(const Shader& shader);
+
+    // Textures that live in a TextureArray are bound to ARRAY_TEXTURE_UNIT + slot
+    // (diffuse, packed, normal, height) and picked through the ivec4 layer
+    // attribute, -1 meaning the regular sampler2D. The attribute is a constant
+    // set per draw; instanced draws can feed it from a buffer with a divisor.
+    static const unsigned int LAYER_ATTRIBUTE = 5;
+    static const unsigned int ARRAY_TEXTURE_UNIT = 8;
+
+    // Point the array samplers at their units. Program state, so once when a
+    // program is made current for a run of meshes rather than per draw.
+    static void setArraySamplers(const Shader& shader);
+
+    // Sub-ranges of a merged mesh (empty for regular meshes)
+    void setSubMeshes(std::vector<SubMesh>&& subMeshes) { m_subMeshes = std::move(subMeshes); }
+    const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+
+    // Draw only the sub-meshes flagged visible, adjacent ranges are coalesced
+    // and issued as a single multi-draw. Returns the triangles submitted.
+    size_t drawSubMeshes(const Shader& shader, const std::vector<bool>& visible);
+
+    // drawSubMeshes without the material, for drawing one mesh several times
+    // after a single bindMaterial. Meshes without sub-meshes draw whole.
+    size_t drawRanges(const std::vector<bool>& visible);
+
     // Transform mesh (for instancing support)
     void transform(const glm::mat4& transform);
 
@@ -101,6 +147,10 @@ private:
     void updateBuffers();
     void cleanupBuffers();
 
+    // Report the GL buffers to ResourceRegistry, and mark them used by a draw
+    void trackBuffers();
+    void touchBuffers() const;
+
     // bounds
     glm::vec3 m_minBounds;
     glm::vec3 m_maxBounds;
@@ -108,5 +158,9 @@ private:
     float m_boundingSphereRadius;
 
     // material info
+    ChannelMap m_channelMap;
     std::string m_materialName;
+
+    // batched parts
+    std::vector<SubMesh> m_subMeshes;
 };
\ No newline at end of file
@@ -8,17 +8,43 @@
 #include <assimp/scene.h>
 #include <unordered_map>
 
+namespace Assimp { class Importer; }
+
 class Model
 {
 public:
     Model() = default;
 
-    // load model from file with assimp
+    // load model from file, .gltf/.glb use the native loader and fall back to assimp
     bool loadFromFile(const std::string& filepath);
 
-    // Load with custom flags
+    // Load with custom flags (always goes through assimp)
     bool loadFromFile(const std::string& filepath, unsigned int assimpFlags);
 
+    // Static batching (set before loading): bakes node transforms into the
+    // vertices and merges every mesh that shares a material into one Mesh,
+    // so a static set piece costs one draw call per material
+    void setStaticBatching(bool enable) { m_staticBatching = enable; }
+    bool getStaticBatching() const { return m_staticBatching; }
+
+    // Texture arrays (set before loading): textures with the same size, format
+    // and mip count go into shared GL_TEXTURE_2D_ARRAY pools and meshes pick
+    // their layer per draw, so differently textured meshes keep the same bindings
+    void setTextureArrays(bool enable) { m_textureArrays = enable; }
+    bool getTextureArrays() const { return m_textureArrays; }
+
+    // Texture streaming (set before loading): textures start with only their
+    // coarse mips on the GPU and TextureStreamer loads finer ones as they get
+    // closer on screen. Textures pooled into arrays are not streamed.
+    void setTextureStreaming(bool enable) { m_textureStreaming = enable; }
+    bool getTextureStreaming() const { return m_textureStreaming; }
+
+    // Occluder: the renderer rasterizes this model's meshes into the software
+    // occlusion buffer every frame it is drawn. Meant for large, simple shapes
+    // (buildings, walls, terrain), every triangle costs CPU time.
+    void setOccluder(bool enable) { m_occluder = enable; }
+    bool isOccluder() const { return m_occluder; }
+
     // Model information
     const std::string& getFilePath() const { return m_filepath; }
     const std::vector<std::shared_ptr<Mesh>>& getMeshes() const { return m_meshes; }
@@ -49,17 +75,88 @@ public:
     // Check if model is valid
     bool isValid() const { return !m_meshes.empty(); }
 
+    // True while a ModelStreamer is still adding or refining meshes, the model
+    // can already be drawn with whatever has arrived
+    bool isStreaming() const { return m_streaming; }
+
     ~Model();
 
 private:
+    friend class ModelStreamer;
+
+    // Native glTF path, returns false so the caller can fall back to assimp
+    bool loadGLTF(const std::string& filepath);
+
+    // Post-processing used when no flags are given
+    static unsigned int getDefaultAssimpFlags();
+
+    // assimp parse + post-processing, safe to run off the main thread
+    static const aiScene* importScene(Assimp::Importer& importer, const std::string& filepath, unsigned int assimpFlags);
+
+    // Build meshes from an imported scene
+    bool loadFromScene(const aiScene* scene, const std::string& filepath);
+
+    // Reset state before an import
+    void beginLoad(const std::string& filepath);
+
+    // Build meshes from the pending list, then bounds and debug summary
+    bool finishLoad();
+
+    // Mesh data collected by the importers before GL buffers are created
+    struct PendingMesh {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<std::shared_ptr<Texture>> textures;
+        int materialIndex = -1;
+        glm::mat4 transform = glm::mat4(1.0f); // node world transform
+        std::vector<Mesh::SubMesh> subMeshes;   // parts of a merged batch
+        ChannelMap channels;                    // layout of the packed texture
+    };
+
+    // Bake transforms and merge pending meshes by material
+    void batchPendingMeshes();
+
+    // Texture referenced during import, decoded on the worker pool in finishLoad
+    struct PendingTexture {
+        std::shared_ptr<Texture> texture;
+        std::string path;
+        TextureType type = DIFFUSE;
+        const unsigned char* data = nullptr;   // embedded image bytes, decoded instead of the file
+        size_t size = 0;
+        ChannelPacker::Sources pack;            // PACKED textures are built from these
+        ChannelMap channels;
+    };
+    struct TextureDecodes;
+
+    // Create an empty texture that finishLoad fills in
+    std::shared_ptr<Texture> queueTexture(const std::string& path, TextureType type,
+        const unsigned char* data = nullptr, size_t size = 0);
+
+    // Start decoding every queued texture, then upload them as they finish
+    std::shared_ptr<TextureDecodes> decodePendingTextures();
+    void uploadDecodedTextures(TextureDecodes& decodes);
+
+    // Group decoded textures (indexed like m_pendingTextures) into arrays,
+    // formats with a single texture are uploaded on their own
+    void uploadTextureArrays(std::vector<Texture::Image>& images, std::vector<CompressedImage>& compressed);
+
     // Process Assimp data
-    void processNode(aiNode* node, const aiScene* scene);
-    std::shared_ptr<Mesh> processMesh(aiMesh* mesh, const aiScene* scene);
+    void processNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform);
+    void processMesh(aiMesh* mesh, const aiScene* scene, PendingMesh& out);
 
     // Calculate model bounds
     void calculateModelBounds();
 
     std::vector<std::shared_ptr<Mesh>> m_meshes;
+    std::vector<PendingMesh> m_pendingMeshes;
+    std::vector<PendingTexture> m_pendingTextures;
+
+    // import options
+    bool m_staticBatching = false;
+    bool m_textureArrays = false;
+    bool m_textureStreaming = false;
+    bool m_streaming = false;
+    bool m_occluder = false;
 
     // for culling and spatial queries
     glm::vec3 m_center;
@@ -85,5 +182,20 @@ private:
         aiTextureType type,
         TextureType textureType);
 
+    // Load resolved texture paths, reusing loaded ones and falling back to defaults
+    std::vector<std::shared_ptr<Texture>> loadTextures(const std::vector<std::string>& paths,
+        TextureType textureType);
+    std::shared_ptr<Texture> findLoadedTexture(const std::string& path) const;
+
+    // Texture path from a material, relative to the model directory unless absolute
+    std::string resolveTexturePath(const std::string& texturePath) const;
+
+    // First texture of an assimp type as a packing source (invalid if the material has none)
+    ChannelPacker::Source findPackSource(aiMaterial* material, aiTextureType type, int channel) const;
+
+    // Queue (or reuse) the packed texture for a material's scalar maps and fill
+    // in its channel layout, null when the material has none of them
+    std::shared_ptr<Texture> loadPackedTexture(const ChannelPacker::Sources& sources, ChannelMap& channels);
+
     std::shared_ptr<Texture> Model::createDefaultTexture(TextureType type);
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Renderer/Model.h"
+#include "Utils/ThreadPool.h"
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Progressive loading for very large models. The hierarchy and bounds are read
+// up front, then meshes and textures are decoded on worker threads and handed to
+// the model by priority (closest / largest on screen first). Large meshes first
+// arrive as a coarse clustered LOD and textures as a small preview mip, so the
+// model draws early and sharpens as full data comes in.
+//
+// glTF streams per primitive. Other formats are imported by assimp on a worker
+// and then built in one step once the import is done.
+class ModelStreamer
+{
+public:
+	struct Settings {
+		float uploadBudgetMs = 2.0f;		// main thread time for GL uploads per update
+		int previewTextureSize = 64;		// longest edge of the first texture upload
+		size_t coarseMinTriangles = 8192;	// smaller meshes skip the coarse LOD
+		int coarseGridSize = 32;			// clustering cells along the longest axis
+		size_t maxJobsInFlight = 0;			// 0 picks twice the worker count
+	};
+
+	/// <summary>
+	/// Create the streamer and its worker threads
+	/// </summary>
+	/// <param name="workerCount">Worker threads, 0 picks hardware threads - 1</param>
+	explicit ModelStreamer(size_t workerCount = 0);
+
+	~ModelStreamer();
+
+	void setSettings(const Settings& settings) { m_settings = settings; }
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Start streaming a model. Returns once the layout is known, the model has
+	/// its bounds but no meshes until update() uploads them.
+	/// </summary>
+	/// <param name="filepath">Model file</param>
+	/// <param name="transform">World transform used for prioritising parts</param>
+	/// <returns>The model being filled in, nullptr if the file can't be read</returns>
+	std::shared_ptr<Model> load(const std::string& filepath, const glm::mat4& transform = glm::mat4(1.0f));
+
+	/// <summary>
+	/// Update the world transform of a streaming model
+	/// </summary>
+	void setTransform(const std::shared_ptr<Model>& model, const glm::mat4& transform);
+
+	/// <summary>
+	/// Call once per frame on the GL thread. Re-prioritises pending parts,
+	/// starts decode jobs and uploads finished parts within the upload budget.
+	/// </summary>
+	/// <param name="cameraPosition">World space camera position</param>
+	void update(const glm::vec3& cameraPosition);
+
+	/// <summary>
+	/// True when nothing is loading or waiting for upload
+	/// </summary>
+	bool isIdle() const { return m_streams.empty(); }
+
+	ModelStreamer(const ModelStreamer&) = delete;
+	ModelStreamer& operator=(const ModelStreamer&) = delete;
+
+private:
+	struct Stream;
+
+	// Hand worker results to their parts and textures
+	void collect(Stream& stream);
+
+	// Start the highest priority queued jobs across all streams
+	void dispatch();
+
+	// Upload finished work within the budget, cheap previews before full data
+	void upload();
+
+	Settings m_settings;
+	std::vector<std::shared_ptr<Stream>> m_streams;
+
+	// Declared last so it is destroyed first, queued jobs finish before the streams go away
+	ThreadPool m_pool;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Per-object matrices for one frame. Objects are added with their model
+// matrix while the frame is recorded, then update() works out the
+// model-view-projection and normal matrices for all of them in one pass and
+// uploads the lot to a texture buffer. Shaders fetch an object's matrices
+// with the object index instead of getting them as uniforms per draw, and the
+// vertex shader no longer inverts the model matrix per vertex.
+//
+// Layout per object, RGBA32F texels: model (4 columns), model-view-projection
+// (4 columns), normal matrix (3 columns, w unused). Shaders get it through
+// getShaderDefines rather than their own copy.
+class ObjectBuffer
+{
+public:
+	static const int TEXELS_PER_OBJECT = 11;
+	static const int MODEL_TEXEL = 0;
+	static const int MVP_TEXEL = 4;
+	static const int NORMAL_TEXEL = 8;
+
+	/// <summary>
+	/// The layout as defines for Shader::InjectDefines: OBJECT_TEXELS,
+	/// OBJECT_MODEL_TEXEL, OBJECT_MVP_TEXEL and OBJECT_NORMAL_TEXEL
+	/// </summary>
+	static std::vector<std::string> getShaderDefines();
+
+	/// <summary>
+	/// Unit the buffer texture is bound to, after the array units Mesh uses
+	/// </summary>
+	static const unsigned int TEXTURE_UNIT = 12;
+
+	ObjectBuffer() = default;
+	~ObjectBuffer();
+
+	/// <summary>
+	/// Add an object for this frame
+	/// </summary>
+	/// <param name="model">Its world transform</param>
+	/// <returns>Index the shader reads the object with</returns>
+	uint32_t add(const glm::mat4& model);
+
+	/// <summary>
+	/// Forget this frame's objects, the GL buffer is kept
+	/// </summary>
+	void clear() { m_models.clear(); }
+
+	size_t getCount() const { return m_models.size(); }
+	const glm::mat4& getModel(uint32_t object) const { return m_models[object]; }
+
+	/// <summary>
+	/// Compute the derived matrices of every object and upload them, call
+	/// once per frame after the last add and before the first draw
+	/// </summary>
+	/// <param name="viewProjection">Projection * view of the frame</param>
+	void update(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Bind the buffer texture to TEXTURE_UNIT
+	/// </summary>
+	void bind() const;
+
+	/// <summary>
+	/// Largest object count a single frame can upload, from GL_MAX_TEXTURE_BUFFER_SIZE
+	/// </summary>
+	size_t getMaxObjects() const;
+
+	/// <summary>
+	/// Delete the GL objects, call before the context goes away
+	/// </summary>
+	void release();
+
+	// Owns GL objects
+	ObjectBuffer(const ObjectBuffer&) = delete;
+	ObjectBuffer& operator=(const ObjectBuffer&) = delete;
+
+private:
+	std::vector<glm::mat4> m_models;
+	std::vector<glm::vec4> m_texels;	// TEXELS_PER_OBJECT per object, what gets uploaded
+
+	unsigned int m_buffer = 0;
+	unsigned int m_texture = 0;
+	size_t m_capacity = 0;				// objects the GL buffer has room for
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Mesh;
+class ThreadPool;
+
+// Software occlusion culling. A handful of occluder meshes (building shells,
+// terrain, simplified proxies) are rasterized on the CPU into a small depth
+// buffer, and bounding boxes are tested against a max-depth pyramid built
+// from it before anything is submitted. No GPU readback, so the result is
+// for this frame, not the last.
+//
+// Triangles are binned into screen tiles and each tile is rasterized by its
+// own job, four pixels at a time with SSE where available. Everything is
+// conservative: triangles crossing the near plane are left out and pixels
+// only count as covered at their centre, so a missing occluder can hide
+// nothing that should be seen.
+class OcclusionCuller
+{
+public:
+	struct Settings {
+		int width = 256;	// depth buffer size, powers of two
+		int height = 128;
+		int tilesX = 4;		// tiles rasterized in parallel, width is rounded up to 4 pixels per tile
+		int tilesY = 4;
+	};
+
+	void setSettings(const Settings& settings);
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Drop last frame's occluders
+	/// </summary>
+	void clear();
+
+	/// <summary>
+	/// Add an occluder for this frame, the mesh has to stay alive until rasterize.
+	/// Only its CPU side vertices and indices are read.
+	/// </summary>
+	void addOccluder(const Mesh& mesh, const glm::mat4& transform);
+
+	/// <summary>
+	/// Rasterize the occluders and build the depth pyramid
+	/// </summary>
+	/// <param name="viewProjection">Projection * view of the frame, also used by isVisible</param>
+	/// <param name="pool">Workers for the tile jobs, waited on before returning</param>
+	void rasterize(const glm::mat4& viewProjection, ThreadPool& pool);
+
+	/// <summary>
+	/// Whether a box may be visible: false when it is outside the frustum or
+	/// behind the occluders everywhere it covers
+	/// </summary>
+	/// <param name="minBounds">Local space box</param>
+	/// <param name="maxBounds"></param>
+	/// <param name="transform">Its world transform</param>
+	bool isVisible(const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::mat4& transform) const;
+
+	size_t getOccluderCount() const { return m_occluders.size(); }
+	size_t getTriangleCount() const { return m_triangles.size(); }
+
+	/// <summary>
+	/// Pyramid level, 0 is the full buffer. Depth is 0 at the near plane and 1 at the far plane.
+	/// </summary>
+	const std::vector<float>& getDepth(int level = 0) const { return m_levels[level]; }
+
+private:
+	// Screen space triangle, x and y in pixels, z window depth
+	struct ScreenTriangle {
+		glm::vec3 v[3];
+	};
+
+	struct Occluder {
+		const Mesh* mesh;
+		glm::mat4 transform;
+	};
+
+	void setupTriangles();
+	void rasterizeTile(int tile);
+	void buildPyramid();
+
+	Settings m_settings;
+	glm::mat4 m_viewProjection = glm::mat4(1.0f);
+
+	std::vector<Occluder> m_occluders;
+	std::vector<ScreenTriangle> m_triangles;
+	std::vector<std::vector<uint32_t>> m_tileTriangles;	// triangles overlapping each tile
+
+	// Level 0 is the rasterized depth, each level above keeps the farthest of 2x2
+	std::vector<std::vector<float>> m_levels;
+	std::vector<glm::ivec2> m_levelSizes;
+	bool m_hasDepth = false;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Renderer/Shader.h"
+
+// Hardware occlusion queries with temporal coherence, the GPU side
+// alternative to OcclusionCuller. Objects are tracked across frames by a key
+// unique to each instance (the renderer combines the Model or Mesh it was
+// queued from with how many times that one was queued before it this frame):
+//
+//  - visible objects draw normally and wrap their real draws in a
+//    GL_ANY_SAMPLES_PASSED query every requeryInterval frames, staggered so
+//    they don't all come due on the same frame
+//  - hidden objects are drawn last: their bounding box is queried against the
+//    finished depth buffer and the meshes are drawn under
+//    glBeginConditionalRender(GL_QUERY_NO_WAIT), so the GPU skips them when it
+//    already knows and draws them when it doesn't
+//
+// Results are read back a frame late and only when available, the CPU never
+// waits on the GPU. Query objects come from a pool that grows on demand.
+class OcclusionQueries
+{
+public:
+	struct Settings {
+		size_t minTriangles = 2000;		// lighter objects aren't worth a query
+		int requeryInterval = 8;		// frames a visible object goes unqueried
+		int evictFrames = 120;			// entries unused this long give their query back
+	};
+
+	// What to do with an object this frame
+	enum class Mode {
+		Draw,			// visible, no query this frame
+		QueryDraw,		// visible, wrap its draws in a query
+		QueryBox,		// hidden, query the box and draw conditionally
+		Conditional		// hidden with last frame's query in flight, draw conditionally on it
+	};
+
+	OcclusionQueries() = default;
+	~OcclusionQueries();
+
+	void setSettings(const Settings& settings) { m_settings = settings; }
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Read back the results that have arrived and drop stale entries, once per frame
+	/// </summary>
+	void beginFrame(uint64_t frame);
+
+	/// <summary>
+	/// Decide how to draw an object
+	/// </summary>
+	/// <param name="key">Stable identity of the object instance across frames</param>
+	/// <param name="cameraInside">The camera is inside the box, it is always visible then</param>
+	Mode classify(uint64_t key, bool cameraInside);
+
+	/// <summary>
+	/// Start a GL_ANY_SAMPLES_PASSED query for an object, only one at a time
+	/// </summary>
+	void beginQuery(uint64_t key);
+	void endQuery();
+
+	/// <summary>
+	/// Draw a box as a query target. Colour, depth writes and face culling
+	/// should be off (camera facing sides are enough, but the far sides keep
+	/// the query right when the near ones are clipped).
+	/// </summary>
+	/// <param name="mvp">Projection * view * model of the object</param>
+	/// <param name="minBounds">Its local bounds</param>
+	/// <param name="maxBounds"></param>
+	void drawBox(const glm::mat4& mvp, const glm::vec3& minBounds, const glm::vec3& maxBounds);
+
+	/// <summary>
+	/// Draw conditionally on an object's latest query, false if it has none
+	/// </summary>
+	bool beginConditional(uint64_t key);
+	void endConditional();
+
+	size_t getQueriesIssued() const { return m_queriesIssued; }
+	size_t getHiddenCount() const;
+	size_t getPoolSize() const { return m_allQueries.size(); }
+
+	/// <summary>
+	/// Delete the queries and the box geometry, call before the context goes away
+	/// </summary>
+	void release();
+
+	// Owns GL objects
+	OcclusionQueries(const OcclusionQueries&) = delete;
+	OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+private:
+	struct Entry {
+		unsigned int query = 0;
+		bool pending = false;			// issued, result not read yet
+		bool issued = false;			// holds a result or a query in flight
+		bool visible = true;
+		uint64_t nextQueryFrame = 0;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	unsigned int acquireQuery();
+	void setupBox();
+
+	Settings m_settings;
+	std::unordered_map<uint64_t, Entry> m_entries;
+	std::vector<unsigned int> m_freeQueries;
+	std::vector<unsigned int> m_allQueries;
+	uint64_t m_frame = 0;
+	size_t m_queriesIssued = 0;
+
+	Shader m_boxShader;
+	unsigned int m_boxVAO = 0;
+	unsigned int m_boxVBO = 0;
+	unsigned int m_boxEBO = 0;
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Frame graph over the renderer's passes. Every frame the passes are declared
+// again with what they sample, what they render into and what else they
+// write, then compile():
+//
+//  - culls passes nothing needs. Passes that render to the backbuffer or are
+//    marked with sideEffect are kept, and so is everything whose output they
+//    use; the rest never run.
+//  - orders the passes that are left. Dependencies come first, after that a
+//    pass rendering into the same attachments as the one before it goes next,
+//    so the framebuffer changes as rarely as possible.
+//  - works out where each transient texture is first and last used and hands
+//    them out from a pool kept across frames. A texture goes back to the pool
+//    after its last user, and a later transient with the same description
+//    takes it over in the same frame. GL 3.3 can't place resources in shared
+//    memory, so sharing whole textures is how non-overlapping lifetimes alias.
+//
+// execute() binds a cached framebuffer for each pass's attachments, sets the
+// viewport and runs it.
+class RenderGraph
+{
+public:
+	enum class Format {
+		RGBA8,
+		RGBA16F,
+		Depth24Stencil8
+	};
+
+	struct TextureDesc {
+		int width = 0;
+		int height = 0;
+		Format format = Format::RGBA8;
+	};
+
+	// A resource of this frame's graph
+	using Resource = uint32_t;
+
+	// Declares what a pass uses, handed to its setup function
+	class PassBuilder
+	{
+	public:
+		/// <summary>
+		/// The pass samples the resource
+		/// </summary>
+		void read(Resource resource);
+
+		/// <summary>
+		/// The pass renders into the texture, as colour or depth by its format.
+		/// Contents are kept from the previous writer, clear in the pass if needed.
+		/// </summary>
+		void attach(Resource resource);
+
+		/// <summary>
+		/// The pass changes the resource some other way (its own framebuffer, a buffer)
+		/// </summary>
+		void write(Resource resource);
+
+		/// <summary>
+		/// Never cull the pass, its results are used outside the graph
+		/// </summary>
+		void sideEffect();
+
+		/// <summary>
+		/// Render into the corner of the attachments, defaults to their full size
+		/// </summary>
+		void setViewport(int width, int height);
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+		RenderGraph& m_graph;
+		uint32_t m_pass;
+	};
+
+	using Setup = std::function<void(PassBuilder&)>;
+
+	// Issues the pass's GL commands. Passes without attachments must leave the
+	// framebuffer binding as they found it.
+	using Execute = std::function<void()>;
+
+	RenderGraph() = default;
+	~RenderGraph();
+
+	/// <summary>
+	/// Forget last frame's passes and resources, pooled textures stay
+	/// </summary>
+	void reset();
+
+	/// <summary>
+	/// Texture that only lives within this frame, taken from the pool
+	/// </summary>
+	Resource createTexture(const std::string& name, const TextureDesc& desc);
+
+	/// <summary>
+	/// The default framebuffer, rendering into it is a side effect
+	/// </summary>
+	Resource importBackbuffer(const std::string& name, int width, int height);
+
+	/// <summary>
+	/// Something the graph doesn't manage (a shadow map with its own
+	/// framebuffer, a buffer), only used to order and cull the passes
+	/// </summary>
+	Resource importExternal(const std::string& name);
+
+	/// <summary>
+	/// Declare a pass, setup runs right away and execute in execute()
+	/// </summary>
+	/// <param name="name">String literal, the profiler keeps the pointer as the stage name</param>
+	void addPass(const char* name, const Setup& setup, const Execute& execute);
+
+	/// <summary>
+	/// Cull, order and assign textures to the passes
+	/// </summary>
+	void compile();
+
+	/// <summary>
+	/// Run the passes compile kept, in its order
+	/// </summary>
+	void execute();
+
+	/// <summary>
+	/// GL texture of a transient, valid from compile until reset
+	/// </summary>
+	unsigned int getTexture(Resource resource) const;
+
+	size_t getPassCount() const { return m_passes.size(); }
+	size_t getCulledCount() const { return m_passes.size() - m_order.size(); }
+	int getFramebufferSwitches() const { return m_framebufferSwitches; }
+	size_t getPoolSize() const { return m_pool.size(); }
+
+	/// <summary>
+	/// Names of the passes in the order they run, after compile
+	/// </summary>
+	std::vector<std::string> getPassOrder() const;
+
+	/// <summary>
+	/// Delete the pooled textures and framebuffers, call before the context goes away
+	/// </summary>
+	void release();
+
+	// Owns GL objects
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+private:
+	enum class Kind {
+		Transient,
+		Backbuffer,
+		External
+	};
+
+	struct ResourceNode {
+		std::string name;
+		Kind kind;
+		TextureDesc desc;
+		unsigned int texture = 0;	// GL texture once compiled, 0 for the others
+		int firstUse = -1;			// positions in m_order
+		int lastUse = -1;
+	};
+
+	struct Dependency {
+		uint32_t pass;
+		bool data;					// uses what the pass wrote, rather than just having to come after it
+	};
+
+	struct PassNode {
+		const char* name;
+		Execute execute;
+		std::vector<Resource> reads;
+		std::vector<Resource> attachments;
+		std::vector<Resource> writes;
+		std::vector<Dependency> dependencies;
+		int viewportWidth = 0;
+		int viewportHeight = 0;
+		bool sideEffect = false;
+		bool live = false;
+	};
+
+	struct PooledTexture {
+		unsigned int texture;
+		TextureDesc desc;
+		bool inUse;
+		uint64_t lastUsedFrame;
+	};
+
+	void buildDependencies();
+	void cull();
+	void schedule();
+	void assignTextures();
+	unsigned int acquireTexture(const TextureDesc& desc);
+	void releaseTexture(unsigned int texture);
+	unsigned int getFramebuffer(const PassNode& pass);
+	void evictTextures();
+
+	std::vector<ResourceNode> m_resources;
+	std::vector<PassNode> m_passes;
+	std::vector<uint32_t> m_order;			// live passes, in execution order
+
+	std::vector<PooledTexture> m_pool;
+	std::map<std::vector<unsigned int>, unsigned int> m_framebuffers;	// attachment textures to FBO
+	uint64_t m_frame = 0;
+	int m_framebufferSwitches = 0;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Small GL queries and helpers shared by the renderer's modules
+
+/// <summary>
+/// Texels a buffer texture may hold, queried once. GL 3.3 only promises
+/// 65536, most drivers allow far more.
+/// </summary>
+size_t getMaxBufferTexels();
+
+/// <summary>
+/// Near and far plane distances of a GL perspective projection
+/// </summary>
+inline void getPerspectiveClip(const glm::mat4& projection, float& nearPlane, float& farPlane)
+{
+	nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+	farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+}
@@ -1,11 +1,22 @@
 #pragma once
 
 #include <cerrno>
+#include <deque>
 #include <glm/glm.hpp>
 
 #include "Core/Window.h"
+#include "Renderer/DynamicResolution.h"
+#include "Renderer/GpuTimer.h"
+#include "Renderer/LightClusters.h"
 #include "Renderer/Model.h"
+#include "Renderer/ObjectBuffer.h"
+#include "Renderer/OcclusionCuller.h"
+#include "Renderer/OcclusionQueries.h"
+#include "Renderer/RenderGraph.h"
 #include "Renderer/Shader.h"
+#include "Renderer/ShadowCascades.h"
+#include "Renderer/ViewCuller.h"
+#include "Utils/ThreadPool.h"
 
 class Renderer
 {
@@ -47,6 +58,31 @@ public:
 		int drawCalls = 0;
 		int trianglesDrawn = 0;
 		int verticesDrawn = 0;
+		int prepassDrawCalls = 0;
+		int objectsCulled = 0;		// outside the frustum or hidden by occluders
+		int occlusionQueries = 0;	// GPU queries issued this frame
+		int objectsHidden = 0;		// drawn conditionally after their last query came back empty
+		double prepassGpuMs = 0.0;	// a few frames old, GPU timings arrive late
+		double shadingGpuMs = 0.0;
+		int shadowDrawCalls = 0;
+		int shadowCascadesRendered = 0;	// cached cascades only count when they were redrawn
+		double shadowGpuMs = 0.0;
+		float renderScale = 1.0f;	// of the window size, below 1 with dynamic resolution
+		double frameGpuMs = 0.0;	// whole frame, only measured with dynamic resolution
+		double fenceWaitMs = 0.0;	// CPU time beginFrame waited for the GPU to catch up
+		int passesCulled = 0;		// frame graph passes nothing used
+		int framebufferSwitches = 0;
+		int renderTargets = 0;		// textures in the frame graph's pool
+		int extraViews = 0;
+		int viewDrawCalls = 0;		// draws of the extra views, also in drawCalls
+	};
+
+	// A camera rendered besides the main one: split-screen, a minimap, a reflection
+	struct View {
+		glm::mat4 view = glm::mat4(1.0f);
+		glm::mat4 projection = glm::mat4(1.0f);
+		glm::vec4 viewport = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);	// x, y, width, height as fractions of the frame
+		bool clearColor = true;		// depth is always cleared inside the viewport
 	};
 
 	/// <summary>
@@ -55,24 +91,99 @@ public:
 	void beginFrame();
 
 	/// <summary>
-	/// 
+	/// Draw everything queued this frame and present it
 	/// </summary>
 	void endFrame();
 
 	/// <summary>
-	/// 
+	/// Queue a model for this frame, it is drawn in endFrame and has to stay alive until then
 	/// </summary>
 	/// <param name="model"></param>
 	/// <param name="transform"></param>
 	void renderModel(const Model& model, const glm::mat4& transform);
 
 	/// <summary>
-	/// 
+	/// Queue a mesh for this frame, same as renderModel
 	/// </summary>
 	/// <param name="mesh"></param>
 	/// <param name="transform"></param>
 	void renderMesh(Mesh& mesh, const glm::mat4& transform);
 
+	/// <summary>
+	/// Submits the shader variants a model's materials need in one batch, so they
+	/// compile in parallel (where the driver can) instead of one by one on first draw
+	/// </summary>
+	/// <param name="model">Model about to be rendered</param>
+	void prepareShaders(const Model& model);
+
+	/// <summary>
+	/// Add a point light to this frame, lights are cleared by beginFrame
+	/// </summary>
+	/// <param name="light">Light in world space</param>
+	void addLight(const PointLight& light);
+
+	/// <summary>
+	/// Render this frame's queue from one more camera, over the main view inside
+	/// its viewport. The main view and all extra ones are culled in one pass and
+	/// the extra views share one sorted draw list, so each only adds its own
+	/// draws. Point lights are binned for the main view alone, extra views get
+	/// the sun and ambient. Views are cleared by beginFrame, past
+	/// ViewCuller::MAX_VIEWS - 1 they are dropped.
+	/// </summary>
+	/// <param name="view">Camera and where it goes in the frame</param>
+	void addView(const View& view);
+
+	/// <summary>
+	/// This frame's lights
+	/// </summary>
+	const std::vector<PointLight>& getLights() const { return m_lights; }
+
+	/// <summary>
+	/// Froxel grid the lights are sorted into
+	/// </summary>
+	LightClusters& getLightClusters() { return m_lightClusters; }
+
+	/// <summary>
+	/// Set the sun, it stays until changed. Off until given an intensity.
+	/// </summary>
+	/// <param name="light"></param>
+	void setDirectionalLight(const DirectionalLight& light);
+
+	const DirectionalLight& getDirectionalLight() const { return m_sun; }
+
+	/// <summary>
+	/// Cascaded shadow maps of the sun, rendered from every queued object
+	/// </summary>
+	ShadowCascades& getShadowCascades() { return m_shadows; }
+
+	/// <summary>
+	/// Test every queued model's bounding box against the frustum and a CPU
+	/// rasterized depth buffer of this frame's occluders, and skip the hidden ones
+	/// </summary>
+	/// <param name="enable"></param>
+	void setOcclusionCulling(bool enable);
+
+	/// <summary>
+	/// Add occluder-only geometry for this frame (a simplified stand-in for
+	/// something drawn with renderModel), it is rasterized but not drawn.
+	/// Models flagged with Model::setOccluder are added by renderModel.
+	/// </summary>
+	/// <param name="mesh">Mesh with CPU side vertices, kept alive until endFrame</param>
+	/// <param name="transform">Its world transform</param>
+	void addOccluder(const Mesh& mesh, const glm::mat4& transform);
+
+	OcclusionCuller& getOcclusionCuller() { return m_occlusionCuller; }
+
+	/// <summary>
+	/// Hardware occlusion queries on heavy models: the ones whose last query
+	/// found them hidden are drawn after everything else, behind a bounding
+	/// box query and conditional rendering. Works with or without setOcclusionCulling.
+	/// </summary>
+	/// <param name="enable"></param>
+	void setOcclusionQueries(bool enable);
+
+	OcclusionQueries& getOcclusionQueries() { return m_occlusionQueries; }
+
 	/// <summary>
 	/// 
 	/// </summary>
@@ -99,7 +210,34 @@ public:
 	void Renderer::setBackfaceCulling(bool enable);
 
 	/// <summary>
-	/// 
+	/// Lay down depth for all opaque geometry with a position-only program
+	/// first, then shade with depth writes off and GL_EQUAL so every pixel
+	/// runs the full fragment shader once. Pays off once fragments are costly
+	/// (many lights, normal maps). Needs depth testing, skipped in wireframe.
+	/// </summary>
+	/// <param name="enable"></param>
+	void setDepthPrepass(bool enable);
+
+	/// <summary>
+	/// Render the scene offscreen at a scale that follows the GPU frame time
+	/// against a budget (see DynamicResolution::Settings), then upscale it to
+	/// the window with a sharpening filter in endFrame
+	/// </summary>
+	/// <param name="enable"></param>
+	void setDynamicResolution(bool enable);
+
+	DynamicResolution& getDynamicResolution() { return m_dynamicResolution; }
+
+	/// <summary>
+	/// Cap how many frames the CPU may queue ahead of the GPU: endFrame fences
+	/// each frame and beginFrame waits on the one this many frames back. Lower
+	/// means less input latency and less overlap. 0 leaves it to the driver.
+	/// </summary>
+	/// <param name="frames"></param>
+	void setMaxFramesInFlight(int frames);
+
+	/// <summary>
+	/// Size of the window, the scene is rendered smaller with dynamic resolution
 	/// </summary>
 	/// <param name="width"></param>
 	/// <param name="height"></param>
@@ -136,19 +274,157 @@ private:
 	/// </summary>
 	void setupOpenGLState();
 
+	/// <summary>
+	/// Tell the texture streamer how large a mesh's textures appear on screen
+	/// </summary>
+	/// <param name="mesh">Mesh about to be drawn</param>
+	/// <param name="transform">Its world transform</param>
+	void requestTextureDetail(const Mesh& mesh, const glm::mat4& transform);
+
+	/// <summary>
+	/// Bind the default shader variant for a mesh and set the per-frame
+	/// uniforms, unless it is already the current one
+	/// </summary>
+	/// <param name="mesh">Mesh about to be drawn</param>
+	/// <param name="current">Variant bound by the previous call, updated</param>
+	/// <returns>The variant to draw with, null if it failed to build</returns>
+	Shader* useDefaultShader(const Mesh& mesh, Shader*& current);
+
+	/// <summary>
+	/// CPU side of the frame's passes: upload the object matrices, gather the
+	/// shadow casters, cull, sort the lights and pick the query modes
+	/// </summary>
+	void prepareDraws();
+
+	/// <summary>
+	/// Declare this frame's passes and targets in m_frameGraph
+	/// </summary>
+	void buildFrameGraph();
+
+	/// <summary>
+	/// Depth prepass: clear the scene targets and lay down depth for the visible draws
+	/// </summary>
+	void drawDepth();
+
+	/// <summary>
+	/// Shade the queue into the scene targets, hidden objects last
+	/// </summary>
+	/// <param name="prepass">The depth prepass ran and already cleared the targets</param>
+	void drawScene(bool prepass);
+
+	/// <summary>
+	/// Fill m_casters from the draw queue, before culling drops anything
+	/// </summary>
+	void collectCasters();
+
+	/// <summary>
+	/// Render the sun's shadow cascades and restore the frame's state
+	/// </summary>
+	void renderShadows();
+
+	/// <summary>
+	/// Cull every object against the main camera and the extra views at once,
+	/// build the extra views' draw lists and drop what the main view can't see
+	/// </summary>
+	void cullViews();
+
+	/// <summary>
+	/// Draw the extra views, each mesh's material bound once for all of them
+	/// </summary>
+	void drawViews();
+
+	/// <summary>
+	/// Drop queued draws whose object fails the occlusion test
+	/// </summary>
+	void cullDraws();
+
+	/// <summary>
+	/// Pick an occlusion query mode for every object in m_objects
+	/// </summary>
+	void classifyQueries();
+
+	/// <summary>
+	/// Box queries for the hidden objects, then their draws under conditional rendering
+	/// </summary>
+	void drawHidden(Shader*& current);
+
+	bool isHidden(uint32_t object) const;
+
+	// One queued draw, object indexes m_objects
+	struct DrawItem {
+		Mesh* mesh;
+		uint32_t object;
+	};
+
+	/// <summary>
+	/// Shade one queued draw with its default shader variant
+	/// </summary>
+	void shadeItem(const DrawItem& item, Shader*& current);
+
+	/// <summary>
+	/// Fill m_subMeshVisible with the parts of a batched draw that a view may see
+	/// </summary>
+	/// <param name="view">Index in m_viewCuller, 0 for the main view</param>
+	void cullSubMeshes(const DrawItem& item, int view);
+
+	// Local bounds of each object in m_objects, for culling
+	struct ObjectBounds {
+		glm::vec3 min;
+		glm::vec3 max;
+		bool occluder;		// never culled, it is what hides the rest
+		const void* key;	// Model or Mesh it was queued from, stable across frames
+		size_t triangles;
+	};
+
 	// Render statistics
 	RenderStats m_stats;
 
 	// Render settings
 	glm::vec4 m_clearColor = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
 	bool m_depthTesting = true;
+	bool m_depthPrepass = false;
 	bool m_backfaceCulling = true;
 	bool m_wireframeMode = false;
 
 	Window* m_target = nullptr;
-	Shader m_defaultShader;
+	ShaderVariants m_defaultShaders;	// main.vert/main.frag, one variant per material feature set
+	Shader m_depthShader;				// depth.vert/depth.frag, position only
+	GpuTimer m_prepassTimer;
+	GpuTimer m_shadingTimer;
+	ObjectBuffer m_objects;				// matrices of this frame's objects
+	std::vector<DrawItem> m_drawQueue;
+	std::vector<ObjectBounds> m_objectBounds;
+	OcclusionCuller m_occlusionCuller;
+	bool m_occlusionCulling = false;
+	OcclusionQueries m_occlusionQueries;
+	std::vector<OcclusionQueries::Mode> m_queryModes;	// per object, when queries are on
+	std::vector<uint64_t> m_queryKeys;	// per object, Model or Mesh and its instance number
+	bool m_useQueries = false;
+	bool m_frameQueries = false;		// queries are on this frame, they also need depth testing
+	std::vector<PointLight> m_lights;
+	LightClusters m_lightClusters;
+	DirectionalLight m_sun;
+	ShadowCascades m_shadows;
+	std::vector<ShadowCascades::Caster> m_casters;
+	std::vector<Mesh*> m_casterMeshes;
+	std::vector<View> m_views;			// extra views of this frame
+	ViewCuller m_viewCuller;			// bit 0 the main view, bit v + 1 m_views[v]
+	std::vector<DrawItem> m_viewItems;	// draws some extra view sees, by shader variant then mesh
+	std::vector<std::vector<uint32_t>> m_viewDraws;	// per extra view, ascending indices into m_viewItems
+	std::vector<bool> m_subMeshVisible;	// scratch for cullSubMeshes
+	ThreadPool m_framePool;				// per-frame jobs, waited on before the frame ends
 	glm::mat4 m_viewMatrix;
 	glm::mat4 m_projectionMatrix;
+	int m_viewportWidth = 0;			// what the scene is rendered at
+	int m_viewportHeight = 0;
+	int m_windowWidth = 0;
+	int m_windowHeight = 0;
+	DynamicResolution m_dynamicResolution;
+	bool m_useDynamicResolution = false;
+	bool m_scaledFrame = false;			// this frame renders offscreen at the dynamic resolution scale
+	RenderGraph m_frameGraph;			// rebuilt every endFrame, its texture pool persists
+	int m_maxFramesInFlight = 0;
+	std::deque<void*> m_frameFences;	// GLsync after each frame's swap, oldest first
 	bool m_initialized = false;
 
 	// For error checking
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Renderer/CompressedImage.h"
+
+// What a tracked GL object is used for, the summary is grouped by this
+enum class ResourceCategory {
+	Texture = 0,
+	StreamingTexture,	// mips come and go with TextureStreamer
+	DefaultTexture,		// 4x4 stand-ins for missing material maps
+	TextureArray,
+	VertexBuffer,
+	IndexBuffer,
+	StagingBuffer,		// TextureUploader ring
+	FrameData,			// rewritten every frame, like per-object matrices
+	RenderTarget,		// framebuffer attachments, like shadow maps
+	Count
+};
+
+// Central list of every GL texture and buffer the engine creates, with its
+// GPU size (all mips, real format), the RAM kept next to it, the asset that
+// created it and the last frame it was bound. Used to plan memory budgets and
+// to find textures and buffers nothing draws with any more.
+//
+// Only touched from the GL thread, like the GL calls it mirrors.
+class ResourceRegistry
+{
+public:
+	enum class Kind {
+		Texture,
+		Buffer
+	};
+
+	struct Resource {
+		Kind kind = Kind::Texture;
+		unsigned int id = 0;				// GL name
+		ResourceCategory category = ResourceCategory::Texture;
+		std::string name;					// texture path, material name...
+		std::string owner;					// asset being loaded when it was created
+		std::string format;					// "RGBA8", "BC7"..., empty for buffers
+		int width = 0;
+		int height = 0;
+		int levels = 0;						// resident mip levels
+		int layers = 0;						// array layers
+		size_t gpuBytes = 0;
+		size_t cpuBytes = 0;				// copy kept in RAM (mesh data, streaming source)
+		uint64_t createdFrame = 0;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	struct CategoryStats {
+		size_t count = 0;
+		size_t gpuBytes = 0;
+		size_t cpuBytes = 0;
+	};
+	using Summary = std::array<CategoryStats, static_cast<size_t>(ResourceCategory::Count)>;
+
+	/// <summary>
+	/// Global registry
+	/// </summary>
+	static ResourceRegistry& get();
+
+	/// <summary>
+	/// Start tracking a GL object, or refresh the entry of one already tracked
+	/// (which keeps its owner and creation frame). An empty owner is filled in
+	/// from the asset the profiler attributes work to.
+	/// </summary>
+	void add(Resource resource);
+
+	/// <summary>
+	/// Stop tracking a GL object, call right before deleting it
+	/// </summary>
+	void remove(Kind kind, unsigned int id);
+
+	/// <summary>
+	/// New sizes after storage changed (a buffer re-filled, mips streamed in or out)
+	/// </summary>
+	void resize(Kind kind, unsigned int id, size_t gpuBytes, size_t cpuBytes, int levels = -1);
+
+	/// <summary>
+	/// Move an entry to another category
+	/// </summary>
+	void setCategory(Kind kind, unsigned int id, ResourceCategory category);
+
+	/// <summary>
+	/// Mark an object as used this frame
+	/// </summary>
+	void touch(Kind kind, unsigned int id)
+	{
+		auto found = m_resources.find(makeKey(kind, id));
+		if (found != m_resources.end()) {
+			found->second.lastUsedFrame = m_frame;
+		}
+	}
+
+	/// <summary>
+	/// Advance the frame counter, call once per frame
+	/// </summary>
+	void beginFrame() { m_frame++; }
+	uint64_t getFrame() const { return m_frame; }
+
+	/// <summary>
+	/// Copy of every tracked object, largest first
+	/// </summary>
+	std::vector<Resource> getResources() const;
+
+	/// <summary>
+	/// Count and bytes per category
+	/// </summary>
+	Summary getSummary() const;
+
+	size_t getTotalGPUBytes() const;
+	size_t getTotalCPUBytes() const;
+
+	/// <summary>
+	/// Print the per-category table, then the objects not used for unusedFrames
+	/// frames (0 skips the list)
+	/// </summary>
+	void printSummary(std::ostream& out, uint64_t unusedFrames = 0) const;
+
+	/// <summary>
+	/// Write the summary and every object as JSON
+	/// </summary>
+	/// <param name="filepath">Output .json path</param>
+	/// <returns>true if the file was written</returns>
+	bool writeJson(const std::string& filepath) const;
+
+	static const char* getCategoryName(ResourceCategory category);
+
+	/// <summary>
+	/// Name of a texture format, channels are used for uncompressed pixels
+	/// </summary>
+	static const char* getFormatName(BlockFormat format, int channels);
+
+private:
+	ResourceRegistry() = default;
+
+	static uint64_t makeKey(Kind kind, unsigned int id)
+	{
+		return (static_cast<uint64_t>(kind) << 32) | id;
+	}
+
+	std::unordered_map<uint64_t, Resource> m_resources;
+	uint64_t m_frame = 0;
+};
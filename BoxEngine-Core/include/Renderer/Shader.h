@@ -1,10 +1,24 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Optional parts of a shader, each set bit becomes a #define in both stages
+// so a variant only pays for the features its material uses
+enum ShaderFeature : uint32_t {
+    SHADER_FEATURE_DIFFUSE          = 1 << 0,   // HAS_DIFFUSE: diffuse texture instead of material colours
+    SHADER_FEATURE_DIFFUSE_BLEND    = 1 << 1,   // HAS_DIFFUSE2: blend a second diffuse texture over it
+    SHADER_FEATURE_PACKED           = 1 << 2,   // HAS_PACKED: scalar maps from the packed texture
+    SHADER_FEATURE_NORMAL_MAP       = 1 << 3,   // HAS_NORMAL_MAP: tangent space lighting from a normal map
+    SHADER_FEATURE_TEXTURE_ARRAYS   = 1 << 4,   // TEXTURE_ARRAYS: layers from the per-draw layer attribute
+    SHADER_FEATURE_COUNT            = 5
+};
+
 class Shader {
 public:
     Shader();
@@ -13,11 +27,47 @@ public:
     // Create shader from source files
     bool LoadFromFile(const std::string& vertexPath, const std::string& fragmentPath);
 
-    // Create shader from source code
+    // Same, with "#define NAME" lines inserted after the #version line of both stages
+    bool LoadFromFile(const std::string& vertexPath, const std::string& fragmentPath,
+        const std::vector<std::string>& defines);
+
+    // Create shader from source code, waits for the driver to finish
     bool LoadFromSource(const std::string& vertexSource, const std::string& fragmentSource);
 
-    // Use the shader
-    void Use() const;
+    // Same, with "#define NAME" lines inserted after the #version line of both stages
+    bool LoadFromSource(const std::string& vertexSource, const std::string& fragmentSource,
+        const std::vector<std::string>& defines);
+
+    // Hand the sources to the driver without asking for any status, so several
+    // programs can compile at once. Errors are only reported by Finish, which
+    // Use calls on first use. False if nothing could be submitted.
+    bool Submit(const std::string& vertexSource, const std::string& fragmentSource);
+    bool Submit(const std::string& vertexSource, const std::string& fragmentSource,
+        const std::vector<std::string>& defines);
+
+    // Whether a submitted build is done, never blocks. Without parallel
+    // compile support this is always true and Finish does the waiting.
+    bool IsReady() const;
+
+    // Wait for a submitted build, report errors and save the binary cache.
+    // True if the program linked, cheap once done.
+    bool Finish();
+
+    // GL_KHR_parallel_shader_compile or the ARB version, needs a current context.
+    // The first call lets the driver use as many compiler threads as it likes.
+    static bool HasParallelCompile();
+
+    // Defines for a ShaderFeature mask
+    static std::vector<std::string> GetFeatureDefines(uint32_t features);
+
+    // Source with the defines inserted, #line keeps error line numbers matching the file
+    static std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines);
+
+    // Whole file as a string, empty on failure
+    static std::string ReadFile(const std::string& filepath);
+
+    // Use the shader, finishes a submitted build first
+    void Use();
 
     // Utility uniform functions
     void SetBool(const std::string& name, bool value) const;
@@ -30,15 +80,86 @@ public:
     void SetMat3(const std::string& name, const glm::mat3& mat) const;
     void SetMat4(const std::string& name, const glm::mat4& mat) const;
 
+    // Whether the program has an active uniform of that name. Cached with the
+    // locations the setters use, so per-draw checks don't go to the driver.
+    bool HasUniform(const std::string& name) const;
+
     // Get shader ID
     unsigned int GetID() const { return m_ID; }
 
+    // Linked programs are saved with glGetProgramBinary and loaded back with
+    // glProgramBinary when the sources and the driver match, skipping the
+    // compile. Empty disables the cache. Defaults to "cache/shaders".
+    static void SetBinaryCacheDirectory(const std::string& directory);
+    static const std::string& GetBinaryCacheDirectory();
+
+    // Whether the driver can hand out program binaries (GL 4.1 or
+    // ARB_get_program_binary with at least one format), needs a current context
+    static bool HasProgramBinary();
+
+    // Owns a GL program
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
 private:
     unsigned int m_ID;
     mutable std::unordered_map<std::string, int> m_UniformLocationCache;
 
+    // Stages of a submitted link whose status hasn't been read yet
+    bool m_pending = false;
+    unsigned int m_pendingVertex = 0;
+    unsigned int m_pendingFragment = 0;
+    bool m_saveBinary = false;
+    uint64_t m_cacheKey = 0;
+
+    void Release();
     unsigned int CompileShader(unsigned int type, const std::string& source);
-    unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
+    bool CheckShader(unsigned int id, unsigned int type);
+    unsigned int CreateShader(unsigned int vs, unsigned int fs, bool retrievable);
+
+    // Program binary cache, keyed by the sources and the driver strings
+    static uint64_t ComputeCacheKey(const std::string& vertexSource, const std::string& fragmentSource);
+    static std::string GetCachePath(uint64_t key);
+    unsigned int LoadProgramBinary(uint64_t key);
+    void SaveProgramBinary(uint64_t key) const;
+
     int GetUniformLocation(const std::string& name) const;
-    std::string ReadFile(const std::string& filepath);
+};
+
+// A shader source compiled once per ShaderFeature combination, on first use.
+// Materials ask for the smallest mask that covers their textures.
+class ShaderVariants {
+public:
+    // Read both stages, variants already built are dropped. The defines go
+    // into every variant ahead of its feature defines.
+    bool LoadFromFile(const std::string& vertexPath, const std::string& fragmentPath,
+        const std::vector<std::string>& defines = {});
+
+    // Submit every variant in the list that isn't built yet and return right
+    // away, so the driver compiles them side by side instead of one per Get
+    void Prepare(const std::vector<uint32_t>& featureMasks);
+
+    // Finish the prepared variants the driver is done with, returns how many are still compiling
+    size_t Poll();
+
+    // Whether Get would return without waiting for the driver
+    bool IsReady(uint32_t features) const;
+
+    // Variant for a feature mask, compiled (or loaded from the binary cache)
+    // the first time it is asked for, waiting for it if it was only prepared.
+    // Null if it failed to build.
+    Shader* Get(uint32_t features);
+
+    size_t GetVariantCount() const { return m_variants.size(); }
+
+private:
+    std::string m_vertexSource;
+    std::string m_fragmentSource;
+    std::vector<std::string> m_defines;
+
+    // Failed variants stay in the table as null so they aren't rebuilt every draw
+    std::unordered_map<uint32_t, std::unique_ptr<Shader>> m_variants;
+
+    Shader* Finish(std::unique_ptr<Shader>& shader, uint32_t features);
+    std::vector<std::string> GetDefines(uint32_t features) const;
 };
\ No newline at end of file
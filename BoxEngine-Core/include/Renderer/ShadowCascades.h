@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Renderer/GpuTimer.h"
+#include "Renderer/Shader.h"
+
+class Mesh;
+
+// Sun or moon, lights everything from one direction
+struct DirectionalLight {
+	glm::vec3 direction = glm::vec3(-0.4f, -1.0f, -0.3f);	// the way the light travels, normalized on use
+	glm::vec3 color = glm::vec3(1.0f);
+	float intensity = 0.0f;		// 0 turns the light off
+	bool castShadows = true;
+};
+
+// Cascaded shadow maps for a DirectionalLight. The view frustum up to
+// maxDistance is split into slices (a blend of uniform and logarithmic
+// spacing) and each slice gets an orthographic depth map, one layer of a
+// depth texture array. Fragments use the first cascade whose map covers them.
+//
+// Each cascade is fitted to the bounding sphere of its slice, so its size
+// does not change as the camera turns, and its centre is snapped to whole
+// texels in light space, so the map does not shimmer as the camera moves.
+// Casters are culled per cascade from their bounds and drawn position only;
+// ones in front of a cascade are flattened onto its near plane by depth clamping.
+//
+// The nearest liveCascades are rendered every frame. The rest are cached:
+// their centre snaps to a coarse grid with a margin around the slice, and they
+// are rendered again only when that centre, the light or the set of casters
+// in them (key and transform) changes, at most cachedUpdatesPerFrame a frame,
+// the longest waiting first. Until then fragments keep using the old map with
+// the matrix it was rendered with, or fall through to the next cascade.
+class ShadowCascades
+{
+public:
+	static const int MAX_CASCADES = 4;
+
+	/// <summary>
+	/// Unit the depth array is bound to, the last one below the mesh's array textures
+	/// </summary>
+	static const unsigned int TEXTURE_UNIT = 7;
+
+	struct Settings {
+		int cascades = 4;				// 1 to MAX_CASCADES
+		int resolution = 2048;			// of each cascade
+		float maxDistance = 150.0f;		// view depth shadows end at
+		float splitLambda = 0.75f;		// 0 uniform splits, 1 logarithmic
+		float casterDistance = 100.0f;	// extra depth range towards the light for casters outside the slice
+		int liveCascades = 2;			// the nearest ones render every frame
+		int cachedUpdatesPerFrame = 1;	// re-render budget for the others
+		float minCasterTexels = 1.0f;	// casters smaller than this in a cascade are skipped
+		float slopeBias = 2.0f;			// glPolygonOffset while rendering casters
+		float constantBias = 2.0f;
+		float normalOffset = 1.5f;		// receivers are pushed along their normal this many texels
+	};
+
+	// An object that may cast a shadow, its meshes are meshes[firstMesh, firstMesh + meshCount)
+	struct Caster {
+		glm::vec3 min;			// local bounds
+		glm::vec3 max;
+		glm::mat4 transform;
+		const void* key;		// Model or Mesh it comes from, stable across frames
+		uint32_t object;		// index into the bound ObjectBuffer
+		uint32_t firstMesh;
+		uint32_t meshCount;
+	};
+
+	ShadowCascades() = default;
+	~ShadowCascades();
+
+	void setSettings(const Settings& settings);
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Fit the cascades to the view and render the ones due this frame. Needs the
+	/// ObjectBuffer bound. The framebuffer binding is restored; the viewport,
+	/// depth test and polygon mode are changed and up to the caller to restore.
+	/// Does nothing when the light is off or casts no shadows.
+	/// </summary>
+	/// <param name="light">The shadowing light</param>
+	/// <param name="view">View matrix of the frame</param>
+	/// <param name="projection">Perspective projection of the frame</param>
+	/// <param name="casters">Every object that may cast this frame, whether the camera sees it or not</param>
+	/// <param name="meshes">Meshes the casters point into</param>
+	void render(const DirectionalLight& light, const glm::mat4& view, const glm::mat4& projection,
+		const std::vector<Caster>& casters, const std::vector<Mesh*>& meshes);
+
+	/// <summary>
+	/// Re-render the cached cascades as soon as the budget allows, for changes
+	/// the caster keys and transforms can't show (a mesh edited in place)
+	/// </summary>
+	void invalidate();
+
+	/// <summary>
+	/// Bind the depth array to TEXTURE_UNIT
+	/// </summary>
+	void bind() const;
+
+	/// <summary>
+	/// Set the shadow sampler and cascade uniforms on a shader in use
+	/// </summary>
+	void setUniforms(const Shader& shader) const;
+
+	bool isActive() const { return m_active; }
+	int getCascadeCount() const { return m_cascadeCount; }
+
+	/// <summary>
+	/// View depth where a cascade ends
+	/// </summary>
+	float getSplit(int cascade) const { return m_splits[cascade + 1]; }
+
+	int getCascadesRendered() const { return m_cascadesRendered; }
+	int getDrawCalls() const { return m_drawCalls; }
+	double getGpuMilliseconds() const { return m_timer.getMilliseconds(); }
+
+	/// <summary>
+	/// Delete the GL objects, call before the context goes away
+	/// </summary>
+	void release();
+
+	// Owns GL objects
+	ShadowCascades(const ShadowCascades&) = delete;
+	ShadowCascades& operator=(const ShadowCascades&) = delete;
+
+private:
+	// Light space placement of a cascade
+	struct Fit {
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+		glm::vec2 center = glm::vec2(0.0f);		// light space x, y
+		float halfSize = 0.0f;
+		float nearDepth = 0.0f;					// along the light direction
+		float farDepth = 0.0f;
+		float texelSize = 0.0f;					// world units
+	};
+
+	struct Cascade {
+		Fit rendered;				// what the map holds, the shader uses this one
+		uint64_t signature = 0;		// casters it was rendered with
+		uint64_t renderedFrame = 0;
+		bool valid = false;
+		bool dirty = false;
+	};
+
+	// Caster bounds in light view space
+	struct LightBounds {
+		glm::vec3 center;
+		glm::vec3 extents;
+	};
+
+	void createTargets();
+	void computeSplits(float nearPlane, float farPlane);
+	Fit fitCascade(int cascade, const glm::mat4& lightView, const glm::vec3* frustumCorners, float nearPlane, float farPlane) const;
+	bool castsInto(const LightBounds& bounds, const Fit& fit) const;
+	uint64_t computeSignature(const Fit& fit, const std::vector<Caster>& casters) const;
+	void renderCascade(int cascade, const Fit& fit, const std::vector<Caster>& casters, const std::vector<Mesh*>& meshes);
+
+	Settings m_settings;
+	int m_cascadeCount = 0;
+	Cascade m_cascades[MAX_CASCADES];
+	float m_splits[MAX_CASCADES + 1] = {};
+	std::vector<LightBounds> m_lightBounds;		// one per caster, this frame
+	uint64_t m_frame = 0;
+	bool m_active = false;
+
+	int m_cascadesRendered = 0;
+	int m_drawCalls = 0;
+	GpuTimer m_timer;
+
+	Shader m_shader;					// shadow.vert/depth.frag
+	unsigned int m_texture = 0;			// GL_TEXTURE_2D_ARRAY, one depth layer per cascade
+	unsigned int m_framebuffer = 0;
+};
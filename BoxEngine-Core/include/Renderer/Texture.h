@@ -1,5 +1,12 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
+#include "CompressedImage.h"
+
+class TextureArray;
+class BoxTexFile;
 
 
 enum TextureType {
@@ -7,17 +14,91 @@ enum TextureType {
     SPECULAR,
     NORMAL,
     HEIGHT,
-    AMBIENT
+    AMBIENT,
+    PACKED      // scalar material maps in one image, see ChannelPacker
 };
 
 class Texture {
 public:
+    // Decoded 8-bit pixels, rows already in upload order. Decoding touches no
+    // GL or global stb state so it can run on any thread.
+    struct Image {
+        struct MipLevel {
+            std::vector<unsigned char> pixels;
+            int width = 0;
+            int height = 0;
+        };
+
+        std::vector<unsigned char> pixels;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+
+        // Levels 1..n built on the CPU, empty means the driver generates them
+        std::vector<MipLevel> mips;
+
+        bool isValid() const { return !pixels.empty(); }
+    };
+
     Texture();
     ~Texture();
     
     // Load texture from file
     bool loadFromFile(const std::string& filepath, TextureType type);
     
+    // Load texture from an encoded image in memory (e.g. embedded in a .glb)
+    bool loadFromMemory(const unsigned char* encoded, size_t size, const std::string& name, TextureType type);
+
+    // Upload an already decoded image, replacing any previous contents
+    bool loadFromImage(const Image& image, const std::string& name, TextureType type);
+
+    // Upload pre-compressed blocks (.dds/.ktx2) as stored, no decode or driver conversion
+    bool loadFromCompressed(const CompressedImage& image, const std::string& name, TextureType type);
+
+    // Upload every level of a mapped .boxtex straight from the mapping
+    bool loadFromBoxTex(const BoxTexFile& file, const std::string& name, TextureType type);
+
+    // Streaming: keep the decoded source in RAM and upload only the mip tail up
+    // to residentSize, TextureStreamer adds and drops finer levels at runtime.
+    // Images without CPU mips are uploaded in full instead.
+    bool loadStreaming(Image&& image, const std::string& name, TextureType type, int residentSize);
+    bool loadStreaming(CompressedImage&& image, const std::string& name, TextureType type, int residentSize);
+    bool isStreaming() const { return m_streaming; }
+
+    // Mip chain, the base level is the finest one on the GPU (0 unless streaming)
+    int getLevelCount() const { return m_levelCount; }
+    int getBaseLevel() const { return m_baseLevel; }
+
+    // GPU bytes of one level, and of every level from the base down
+    size_t getLevelSize(int level) const;
+    size_t getResidentSize() const;
+
+    // RAM held for streaming (the decoded or compressed source), 0 otherwise
+    size_t getSourceSize() const;
+
+    // Whether the last staged upload into this texture has finished on the GPU
+    bool isUploadComplete() const;
+
+    // Whether the current context can sample a block format (needs a current GL context)
+    static bool isFormatSupported(BlockFormat format);
+
+    // GL internal format for a block format
+    static unsigned int getGLFormat(BlockFormat format);
+
+    // Point this texture at a layer of a shared array, dropping its own GL texture
+    void setArrayLayer(const std::shared_ptr<TextureArray>& array, int layer,
+        int width, int height, const std::string& name, TextureType type);
+
+    // Decode an image file or encoded bytes, flipping diffuse maps like loadFromFile does
+    static bool decodeFile(const std::string& filepath, TextureType type, Image& out);
+    static bool decodeMemory(const unsigned char* encoded, size_t size, TextureType type, Image& out);
+
+    // Box-filtered copy whose longest edge is at most maxSize (used as a low mip preview)
+    static Image downsample(const Image& image, int maxSize);
+
+    // Fill image.mips down to 1x1 with a 2x2 box filter, so the upload needs no glGenerateMipmap
+    static void generateMips(Image& image);
+
     // Load texture from memory (for procedural textures)
     bool loadFromData(unsigned char* data, int width, int height, TextureType type);
     
@@ -43,8 +124,16 @@ public:
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
     
+    // Array the texture lives in, null for a regular GL_TEXTURE_2D
+    const std::shared_ptr<TextureArray>& getArray() const { return m_array; }
+    int getLayer() const { return m_layer; }
+
     // Check if texture is valid
-    bool isValid() const { return m_id != 0; }
+    bool isValid() const { return m_id != 0 || m_array; }
+
+    // Stand-in for a map the material doesn't have (flat normal, grey diffuse)
+    void setPlaceholder(bool placeholder) { m_placeholder = placeholder; }
+    bool isPlaceholder() const { return m_placeholder; }
     
 private:
     unsigned int m_id = 0;
@@ -53,12 +142,59 @@ private:
     int m_width = 0;
     int m_height = 0;
     int m_channels = 0;
+    bool m_placeholder = false;
+
+    // Set when the pixels live in a texture array layer instead of m_id
+    std::shared_ptr<TextureArray> m_array;
+    int m_layer = -1;
+
+    // Mip chain and streaming state
+    BlockFormat m_blockFormat = BlockFormat::None;
+    int m_levelCount = 1;
+    int m_baseLevel = 0;
+    int m_tailLevel = 0;        // coarsest level that always stays resident
+    float m_minLod = 0.0f;
+    bool m_streaming = false;
+    std::unique_ptr<Image> m_streamImage;
+    std::unique_ptr<CompressedImage> m_streamCompressed;
+
+    // TextureUploader serial of the newest upload
+    uint64_t m_uploadSerial = 0;
+
+    friend class TextureStreamer;
+
+    // Upload the level above the base and make it the new base
+    bool streamIn();
+
+    // Release the base level, the next coarser one becomes the base
+    bool streamOut();
+
+    // Clamp sampling to coarser levels, used to fade in a new level
+    void setMinLod(float lod);
+
+    // Create the GL texture for a streaming source and upload its tail
+    void beginStreaming(int residentSize);
+
+    // Upload one level of the streaming source into the bound texture
+    void uploadStreamLevel(int level);
+
+    // Forget any streaming source and unregister from the streamer
+    void releaseStreaming();
     
+    // Register the GL texture with ResourceRegistry, after its storage is defined
+    void track();
+
+    // Delete the GL texture (if any) and drop it from ResourceRegistry
+    void deleteTexture();
+
     // Generate OpenGL texture
     void generateTexture();
     
     // Set texture parameters
     void setTextureParameters();
 
+    // Create the GL texture from decoded pixels, using the image's mips or building them
+    void uploadPixels(const Image& image);
+
     bool Texture::fileExists(const std::string& filepath);
 };
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Texture.h"
+#include "CompressedImage.h"
+
+// One GL_TEXTURE_2D_ARRAY holding textures of the same size, format and mip
+// count. Meshes whose textures live in arrays select a layer per draw instead
+// of binding their own textures, so runs of them share one set of bindings.
+class TextureArray {
+public:
+    // Textures can share an array only when all of this matches
+    struct Format {
+        int width = 0;
+        int height = 0;
+        int channels = 0;                        // uncompressed only
+        BlockFormat block = BlockFormat::None;   // None for 8-bit pixels
+        int levels = 1;
+
+        bool operator==(const Format& other) const;
+        bool operator<(const Format& other) const;
+    };
+
+    static Format getFormat(const Texture::Image& image);
+    static Format getFormat(const CompressedImage& image);
+
+    // Largest layer count the driver allows (at least 256 on GL 3.3)
+    static int getMaxLayers();
+
+    // Allocates storage for every layer up front, GL 3.3 arrays can't grow in place
+    TextureArray(const Format& format, int layerCount);
+    ~TextureArray();
+
+    // Upload into the next free layer, returns the layer or -1 if full or mismatched
+    int addLayer(const Texture::Image& image);
+    int addLayer(const CompressedImage& image);
+
+    // Binds are skipped when the array is already on that unit
+    void bind(unsigned int unit) const;
+
+    unsigned int getID() const { return m_id; }
+    const Format& getFormat() const { return m_format; }
+    int getLayerCount() const { return m_layerCount; }
+    int getUsedLayers() const { return m_usedLayers; }
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+private:
+    unsigned int m_id = 0;
+    Format m_format;
+    int m_layerCount = 0;
+    int m_usedLayers = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+
+class Texture;
+
+// Mip residency for streaming textures. Textures loaded with
+// Texture::loadStreaming start with only their coarse mip tail on the GPU. The
+// renderer reports how many pixels each texture covers on screen, and update()
+// moves every texture's GL_TEXTURE_BASE_LEVEL towards the detail that size
+// needs, uploading finer levels or dropping them to stay inside the VRAM budget.
+class TextureStreamer
+{
+public:
+	struct Settings {
+		size_t budgetBytes = 512ull << 20;		// streamed textures never exceed this together
+		size_t uploadBytesPerUpdate = 8 << 20;	// level uploads per update, the first one always goes
+		int residentSize = 128;					// levels up to this size stay loaded
+		float lodBias = 0.0f;					// positive drops detail, negative keeps more
+		int idleUpdates = 120;					// updates without a request before falling back to the tail
+		float fadeRate = 0.125f;				// GL_TEXTURE_MIN_LOD change per update after a new level
+	};
+
+	/// <summary>
+	/// Global streamer, textures register themselves when loaded for streaming
+	/// </summary>
+	static TextureStreamer& get();
+
+	void setSettings(const Settings& settings) { m_settings = settings; }
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Report that a texture was drawn covering about this many pixels across
+	/// (the largest request per update wins)
+	/// </summary>
+	/// <param name="texture">Texture drawn, ignored unless it is streaming</param>
+	/// <param name="screenSize">Projected size of the mesh using it, in pixels</param>
+	void requestSize(const Texture* texture, float screenSize);
+
+	/// <summary>
+	/// Call once per frame on the GL thread. Picks target levels for all
+	/// textures within the budget, drops unneeded levels, then uploads finer
+	/// ones within the per update limit.
+	/// </summary>
+	void update();
+
+	/// <summary>
+	/// GPU bytes used by streaming textures right now
+	/// </summary>
+	size_t getResidentBytes() const;
+
+	size_t getTextureCount() const { return m_entries.size(); }
+
+private:
+	friend class Texture;
+
+	struct Entry {
+		Texture* texture = nullptr;
+		float requestedSize = 0.0f;		// largest request since the last update
+		float lastSize = 0.0f;			// last non-zero request
+		int idleUpdates = 0;
+		int targetLevel = 0;
+	};
+
+	void add(Texture* texture);
+	void remove(Texture* texture);
+
+	// Finest level a texture needs for a screen size
+	int levelForSize(const Texture& texture, float screenSize) const;
+
+	Settings m_settings;
+	std::unordered_map<const Texture*, Entry> m_entries;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Renderer/CompressedImage.h"
+
+// Staging ring for texture uploads. Pixel data is copied into one of a few
+// pixel buffer objects that are reused for the whole run, and the texture is
+// filled with glTexSubImage2D from the buffer, so the driver copies from GPU
+// visible memory asynchronously instead of blocking on client memory. A fence
+// per frame tells when a buffer may be written again and when an upload has
+// landed.
+class TextureUploader
+{
+public:
+	struct Settings {
+		size_t bufferBytes = 8 << 20;	// size of each staging buffer, larger levels go in row chunks
+		int bufferCount = 3;			// buffers in the ring, one frame in flight each
+		bool enabled = true;			// false uploads straight from client memory like before
+	};
+
+	/// <summary>
+	/// Global uploader, buffers are created on the first upload
+	/// </summary>
+	static TextureUploader& get();
+
+	/// <summary>
+	/// Change settings, takes effect after the current buffers are released
+	/// </summary>
+	void setSettings(const Settings& settings) { m_settings = settings; }
+	const Settings& getSettings() const { return m_settings; }
+
+	/// <summary>
+	/// Whether glTexStorage2D was found (GL 4.2 or ARB_texture_storage), needs a current context
+	/// </summary>
+	static bool hasTextureStorage();
+
+	/// <summary>
+	/// Define storage for levels [firstLevel, firstLevel + levelCount) of the
+	/// texture bound to GL_TEXTURE_2D. Immutable storage is used when asked
+	/// for and supported, it can't be used for textures that later drop levels.
+	/// </summary>
+	/// <param name="format">Block format, None for 8-bit pixels</param>
+	/// <param name="channels">Channels of 8-bit pixels</param>
+	/// <param name="width">Level 0 width</param>
+	/// <param name="height">Level 0 height</param>
+	/// <param name="firstLevel">First level to define</param>
+	/// <param name="levelCount">Number of levels</param>
+	/// <param name="immutable">Allocate all levels at once with glTexStorage2D (firstLevel must be 0)</param>
+	void allocate(BlockFormat format, int channels, int width, int height, int firstLevel, int levelCount, bool immutable);
+
+	/// <summary>
+	/// Fill one already allocated level of the texture bound to GL_TEXTURE_2D
+	/// through the staging ring
+	/// </summary>
+	/// <returns>Serial to pass to isComplete</returns>
+	uint64_t upload(BlockFormat format, int channels, int level, int width, int height, const unsigned char* data);
+
+	/// <summary>
+	/// Whether everything submitted up to a serial has finished on the GPU
+	/// </summary>
+	bool isComplete(uint64_t serial) const { return serial <= m_completed; }
+
+	/// <summary>
+	/// Call once per frame on the GL thread. Fences this frame's uploads and
+	/// retires the fences that have signalled.
+	/// </summary>
+	void update();
+
+	/// <summary>
+	/// Wait for pending uploads and delete the buffers, call before the context goes away
+	/// </summary>
+	void shutdown();
+
+	/// <summary>
+	/// Bytes copied into staging buffers since startup
+	/// </summary>
+	size_t getUploadedBytes() const { return m_uploadedBytes; }
+
+private:
+	struct Fence {
+		void* sync = nullptr;
+		uint64_t serial = 0;
+	};
+
+	struct Buffer {
+		unsigned int id = 0;
+		uint64_t lastSerial = 0;		// newest serial that reads from this buffer
+	};
+
+	TextureUploader() = default;
+
+	// Reserve size bytes in the current buffer, moving on to the next one
+	// (waiting for its last reader) when it doesn't fit
+	bool reserve(size_t size, size_t& offset);
+
+	// Fence everything written under the open serial
+	void fence();
+
+	// Block until a serial is complete
+	void waitFor(uint64_t serial);
+
+	// Pop the oldest fence once it has signalled, blocking for it when wait is set
+	bool retireFront(bool wait);
+
+	Settings m_settings;
+	std::vector<Buffer> m_buffers;
+	size_t m_current = 0;
+	size_t m_offset = 0;
+	std::deque<Fence> m_fences;
+
+	uint64_t m_serial = 1;			// serial of uploads not fenced yet
+	uint64_t m_completed = 0;
+	bool m_pending = false;			// something was written under m_serial
+	size_t m_uploadedBytes = 0;
+};
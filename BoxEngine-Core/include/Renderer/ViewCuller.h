@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+// Frustum culling of every object against several views in one pass. Object
+// boxes are kept in world space as centres and half extents, one array per
+// component, and four of them at a time are tested against the planes of all
+// views with SSE where available. A box is loaded once whatever the number of
+// views, so each extra view only adds its six plane tests.
+//
+// The result is a bitmask per object with bit v set when view v may see it.
+// Conservative like any box test: a box crossing a frustum corner can pass
+// without being in view.
+class ViewCuller
+{
+public:
+	static const int MAX_VIEWS = 32;	// bits of a mask
+
+	/// <summary>
+	/// Drop last frame's views and objects
+	/// </summary>
+	void clear();
+
+	/// <summary>
+	/// Add a view, its index is the bit it gets in the masks
+	/// </summary>
+	/// <param name="viewProjection">Projection * view, GL clip space</param>
+	/// <returns>The view's index, -1 once MAX_VIEWS are in</returns>
+	int addView(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Add an object, indices follow the order of the calls
+	/// </summary>
+	/// <param name="minBounds">Local space box</param>
+	/// <param name="maxBounds"></param>
+	/// <param name="transform">Its world transform</param>
+	void addObject(const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::mat4& transform);
+
+	/// <summary>
+	/// Test every object against every view
+	/// </summary>
+	/// <param name="pool">Workers for large object counts, waited on before returning</param>
+	void cull(ThreadPool& pool);
+
+	/// <summary>
+	/// Views that may see the object, valid after cull
+	/// </summary>
+	uint32_t getMask(uint32_t object) const { return m_masks[object]; }
+
+	/// <summary>
+	/// Test a single box against one view, for finer parts of an object that passed
+	/// </summary>
+	/// <param name="view">Index addView returned</param>
+	/// <param name="minBounds">Local space box</param>
+	/// <param name="maxBounds"></param>
+	/// <param name="transform">Its world transform</param>
+	bool isVisible(int view, const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::mat4& transform) const;
+
+	size_t getViewCount() const { return m_planes.size() / 6; }
+	size_t getObjectCount() const { return m_objectCount; }
+
+private:
+	// Plane n.x + w >= 0 inside, with |n| ready for the box radius
+	struct Plane {
+		glm::vec4 equation;
+		glm::vec3 absNormal;
+	};
+
+	void cullRange(size_t begin, size_t end);
+
+	std::vector<Plane> m_planes;		// 6 per view
+	size_t m_objectCount = 0;
+
+	// Padded to a multiple of four with empty boxes
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+	std::vector<uint32_t> m_masks;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <utility>
+
+// Minimal read-only JSON document, enough for asset headers like glTF. Writers
+// (traces, dumps) stream their own JSON and only share the string escaping.
+class Json
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Json() = default;
+
+	/// <summary>
+	/// Parse a JSON document
+	/// </summary>
+	/// <param name="begin">Start of the text</param>
+	/// <param name="end">One past the end of the text</param>
+	/// <param name="out">Parsed document</param>
+	/// <param name="error">Optional error message on failure</param>
+	/// <returns>true if the whole document parsed</returns>
+	static bool parse(const char* begin, const char* end, Json& out, std::string* error = nullptr);
+
+	/// <summary>
+	/// Write value as a quoted JSON string, escaping quotes, backslashes and control characters
+	/// </summary>
+	static void writeString(std::ostream& out, const std::string& value);
+
+	Type getType() const { return m_type; }
+	bool isNull() const { return m_type == Type::Null; }
+	bool isNumber() const { return m_type == Type::Number; }
+	bool isString() const { return m_type == Type::String; }
+	bool isArray() const { return m_type == Type::Array; }
+	bool isObject() const { return m_type == Type::Object; }
+
+	/// <summary>
+	/// Object member lookup, returns a null value if the key is missing
+	/// </summary>
+	const Json& operator[](const char* key) const;
+
+	/// <summary>
+	/// Array element lookup, returns a null value if out of range
+	/// </summary>
+	const Json& operator[](size_t index) const;
+	const Json& operator[](int index) const { return index < 0 ? (*this)[static_cast<size_t>(-1)] : (*this)[static_cast<size_t>(index)]; }
+
+	bool has(const char* key) const { return !(*this)[key].isNull(); }
+
+	// Number of array elements or object members
+	size_t size() const;
+
+	bool asBool(bool fallback = false) const;
+	double asNumber(double fallback = 0.0) const;
+	int asInt(int fallback = 0) const { return isNumber() ? static_cast<int>(m_number) : fallback; }
+	float asFloat(float fallback = 0.0f) const { return isNumber() ? static_cast<float>(m_number) : fallback; }
+	const std::string& asString() const { return m_string; }
+
+	const std::vector<Json>& getElements() const { return m_elements; }
+	const std::vector<std::pair<std::string, Json>>& getMembers() const { return m_members; }
+
+private:
+	Type m_type = Type::Null;
+	bool m_bool = false;
+	double m_number = 0.0;
+	std::string m_string;
+	std::vector<Json> m_elements;
+	std::vector<std::pair<std::string, Json>> m_members;
+
+	friend class JsonParser;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapped file, the OS pages data in on demand
+class MappedFile
+{
+public:
+	MappedFile() = default;
+
+	/// <summary>
+	/// Map a whole file into memory
+	/// </summary>
+	/// <param name="filepath">File to map</param>
+	/// <returns>true on success</returns>
+	bool open(const std::string& filepath);
+
+	/// <summary>
+	/// Unmap the file
+	/// </summary>
+	void close();
+
+	const unsigned char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+	bool isOpen() const { return m_data != nullptr; }
+
+	// A mapping owns OS handles so it can only be moved
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	~MappedFile();
+private:
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+
+	// Windows file and mapping handles
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+};
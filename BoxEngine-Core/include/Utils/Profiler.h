@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Collects timed stages (asset import, texture decode, uploads...) grouped by
+// the asset being loaded. Disabled by default, a disabled scope costs one branch.
+class Profiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Event
+	{
+		const char* name;	// stage name, must be a string literal
+		std::string asset;	// asset the stage worked on
+		double startUs;		// microseconds since the profiler epoch
+		double durationUs;
+		uint32_t threadId;
+	};
+
+	/// <summary>
+	/// Global profiler instance
+	/// </summary>
+	static Profiler& get();
+
+	void setEnabled(bool enable) { m_enabled = enable; }
+	bool isEnabled() const { return m_enabled; }
+
+	/// <summary>
+	/// Record a finished stage for the current thread's asset
+	/// </summary>
+	void record(const char* name, Clock::time_point start, Clock::time_point end);
+
+	/// <summary>
+	/// Drop every recorded event
+	/// </summary>
+	void clear();
+
+	/// <summary>
+	/// Copy of all events recorded so far
+	/// </summary>
+	std::vector<Event> getEvents() const;
+
+	/// <summary>
+	/// Write events in the Chrome trace format (chrome://tracing, Perfetto)
+	/// </summary>
+	/// <param name="filepath">Output .json path</param>
+	/// <returns>true if the file was written</returns>
+	bool writeChromeTrace(const std::string& filepath) const;
+
+	/// <summary>
+	/// Print a per-asset table of stage call counts and times
+	/// </summary>
+	void printSummary(std::ostream& out) const;
+
+	/// <summary>
+	/// Asset the current thread's work is attributed to, empty outside an AssetScope
+	/// </summary>
+	static const std::string& getCurrentAsset();
+
+	/// <summary>
+	/// Sets the asset that stages on this thread are attributed to, nested
+	/// scopes keep the outermost asset (a model owns its texture loads)
+	/// </summary>
+	class AssetScope
+	{
+	public:
+		explicit AssetScope(const std::string& asset);
+		~AssetScope();
+	private:
+		bool m_owner;
+	};
+
+	/// <summary>
+	/// Times the enclosing scope. GL calls only show the CPU submission cost.
+	/// </summary>
+	class ScopedTimer
+	{
+	public:
+		explicit ScopedTimer(const char* name);
+		~ScopedTimer();
+
+		// End the stage early, the destructor then does nothing
+		void stop();
+	private:
+		const char* m_name;
+		Clock::time_point m_start;
+		bool m_active;
+	};
+
+private:
+	Profiler();
+
+	std::atomic<bool> m_enabled{ false };
+	Clock::time_point m_epoch;
+
+	mutable std::mutex m_mutex;
+	std::vector<Event> m_events;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Time the rest of the current scope as stage `name`
+#define PROFILE_SCOPE(name) Profiler::ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+// Attribute stages in the rest of the current scope to `asset`
+#define PROFILE_ASSET(asset) Profiler::AssetScope PROFILE_CONCAT(profileAsset, __LINE__)(asset)
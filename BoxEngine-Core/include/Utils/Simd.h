@@ -0,0 +1,8 @@
+#pragma once
+
+// BOX_SSE is defined where SSE2 can be used without a runtime check: x64, or
+// 32-bit builds that target it. Code using it keeps a scalar path for the rest.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOX_SSE 1
+#include <emmintrin.h>
+#endif
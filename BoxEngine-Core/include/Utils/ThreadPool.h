@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running queued jobs in FIFO order. Callers that
+// need priorities keep their own ordered list and only hand over what should
+// run next.
+class ThreadPool
+{
+public:
+	/// <summary>
+	/// Start the workers
+	/// </summary>
+	/// <param name="threadCount">Number of workers, 0 picks hardware threads - 1</param>
+	explicit ThreadPool(size_t threadCount = 0);
+
+	/// <summary>
+	/// Engine wide pool for short jobs like texture decoding, started on first use
+	/// </summary>
+	static ThreadPool& get();
+
+	/// <summary>
+	/// Finishes queued jobs, then joins the workers
+	/// </summary>
+	~ThreadPool();
+
+	/// <summary>
+	/// Queue a job, it runs on one of the workers
+	/// </summary>
+	void enqueue(std::function<void()> job);
+
+	/// <summary>
+	/// Block until the queue is empty and no job is running
+	/// </summary>
+	void waitIdle();
+
+	size_t getThreadCount() const { return m_workers.size(); }
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_jobs;
+
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	std::condition_variable m_idle;
+	size_t m_running = 0;
+	bool m_stopping = false;
+};
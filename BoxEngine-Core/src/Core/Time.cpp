@@ -0,0 +1,54 @@
+#include "Core/Time.h"
+
+#include <algorithm>
+#include <thread>
+
+// Sleeping closer than this to a deadline risks waking up after it
+static const double SPIN_THRESHOLD = 0.002;
+
+// Weight of the newest delta in the smoothed one
+static const double SMOOTHING = 0.1;
+
+Time::Time() :
+	m_start(Clock::now()), m_last(m_start)
+{
+}
+
+void Time::tick()
+{
+	Clock::time_point current = Clock::now();
+	double delta = std::chrono::duration<double>(current - m_last).count();
+	m_last = current;
+
+	m_deltaTime = std::min(delta, m_maxDeltaTime);
+	m_smoothedDeltaTime = m_frameCount == 0 ? m_deltaTime :
+		m_smoothedDeltaTime + (m_deltaTime - m_smoothedDeltaTime) * SMOOTHING;
+	m_frameCount++;
+}
+
+double Time::getElapsed() const
+{
+	return std::chrono::duration<double>(Clock::now() - m_start).count();
+}
+
+double Time::now()
+{
+	return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+void Time::waitUntil(double seconds)
+{
+	// Coarse part, a millisecond at a time so one late wake-up costs little
+	double remaining = seconds - now();
+	while (remaining > SPIN_THRESHOLD)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		remaining = seconds - now();
+	}
+
+	// Fine part, yield so a busy core still gets shared
+	while (now() < seconds)
+	{
+		std::this_thread::yield();
+	}
+}
@@ -36,6 +36,9 @@ Window::Window(unsigned int width, unsigned int height, const string& title) :
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		exit(-1);
 	}
+
+	// GLFW leaves the interval to the driver's default
+	setVSync(VSync::On);
 }
 
 GLFWwindow* Window::getWindow()
@@ -69,6 +72,27 @@ void Window::getSize(int& width, int& height)
 	height = m_height;
 }
 
+void Window::setVSync(VSync mode)
+{
+	int interval = mode == VSync::Off ? 0 : 1;
+
+	// Negative intervals tear late frames instead of waiting a whole refresh
+	if (mode == VSync::Adaptive)
+	{
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			interval = -1;
+		}
+		else
+		{
+			mode = VSync::On;
+		}
+	}
+
+	glfwSwapInterval(interval);
+	m_vsync = mode;
+}
+
 bool Window::isValid()
 {
 	return m_window != nullptr;
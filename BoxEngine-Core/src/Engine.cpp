@@ -10,6 +10,8 @@ Engine::Engine(unsigned int width, unsigned int height, const std::string& title
 	m_window = (Window*)new Window(width, height, title);
 	m_renderer = (Renderer*)new Renderer(m_window);
 	m_world = (World*)new World();
+
+	setFrameSettings(m_frameSettings);
 }
 
 Engine::~Engine()
@@ -30,12 +32,56 @@ void Engine::init()
 #endif // !NDEBUG
 }
 
+void Engine::setFrameSettings(const FrameSettings& settings)
+{
+	m_frameSettings = settings;
+	m_nextFrame = 0.0;
+
+	m_window->makeContextCurrent();
+	m_window->setVSync(settings.vsync);
+	if (m_renderer)
+	{
+		m_renderer->setMaxFramesInFlight(settings.maxFramesInFlight);
+	}
+}
+
+void Engine::waitForNextFrame()
+{
+	if (m_frameSettings.maxFps <= 0.0) return;
+
+	double interval = 1.0 / m_frameSettings.maxFps;
+	double now = Time::now();
+	if (m_nextFrame > now)
+	{
+		Time::waitUntil(m_nextFrame);
+		now = m_nextFrame;
+	}
+
+	// Small delays are made up on the next frame to keep the average, a frame
+	// that ran long restarts the schedule instead of rushing to catch up
+	if (now - m_nextFrame > interval)
+	{
+		m_nextFrame = now + interval;
+	}
+	else
+	{
+		m_nextFrame += interval;
+	}
+}
+
 void Engine::run()
 {
+	if (!m_renderer) return;
+
 	while (!m_window->shouldClose())
 	{
+		// Wait before reading input, so what the frame shows is as fresh as possible
+		waitForNextFrame();
+		m_time.tick();
+
 		m_window->pollEvents();
+
+		// endFrame swaps, once
 		m_renderer->render();
-		m_window->swapBuffers();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "Renderer/BoxTexFile.h"
+#include "Utils/Profiler.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const size_t LEVEL_ALIGNMENT = 16;
+static const size_t PREFETCH_STRIDE = 4096;
+
+bool BoxTexFile::canLoad(const std::string& filepath)
+{
+    const std::string extension = ".boxtex";
+    if (filepath.size() < extension.size()) return false;
+
+    return std::equal(extension.begin(), extension.end(), filepath.end() - extension.size(),
+        [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+}
+
+bool BoxTexFile::open(const std::string& filepath)
+{
+    PROFILE_SCOPE("BoxTexFile::open");
+
+    m_levels.clear();
+    if (!m_file.open(filepath)) {
+        return false;
+    }
+
+    const unsigned char* data = m_file.data();
+    size_t size = m_file.size();
+    if (size < sizeof(Header)) {
+        std::cerr << "Truncated boxtex file: " << filepath << std::endl;
+        m_file.close();
+        return false;
+    }
+
+    memcpy(&m_header, data, sizeof(Header));
+    bool validFormat = m_header.blockFormat != 0
+        ? m_header.blockFormat <= static_cast<uint32_t>(BlockFormat::BC7)
+        : (m_header.channels >= 1 && m_header.channels <= 4);
+    if (m_header.magic != MAGIC || m_header.version != VERSION || !validFormat ||
+        m_header.width == 0 || m_header.height == 0 || m_header.levelCount == 0 || m_header.levelCount > 32 ||
+        sizeof(Header) + m_header.levelCount * sizeof(LevelEntry) > size) {
+        std::cerr << "Unsupported boxtex file: " << filepath << std::endl;
+        m_file.close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_header.levelCount; i++) {
+        LevelEntry entry;
+        memcpy(&entry, data + sizeof(Header) + i * sizeof(LevelEntry), sizeof(LevelEntry));
+
+        size_t expected = m_header.blockFormat != 0
+            ? CompressedImage::getLevelSize(getBlockFormat(), entry.width, entry.height)
+            : static_cast<size_t>(entry.width) * entry.height * m_header.channels;
+        if (entry.offset > size || entry.size > size - entry.offset || entry.size < expected) {
+            std::cerr << "Corrupt level " << i << " in boxtex file: " << filepath << std::endl;
+            m_levels.clear();
+            m_file.close();
+            return false;
+        }
+
+        Level level;
+        level.data = data + entry.offset;
+        level.size = static_cast<size_t>(entry.size);
+        level.width = static_cast<int>(entry.width);
+        level.height = static_cast<int>(entry.height);
+        m_levels.push_back(level);
+    }
+
+    return true;
+}
+
+void BoxTexFile::prefetch() const
+{
+    PROFILE_SCOPE("BoxTexFile::prefetch");
+
+    volatile unsigned char sink = 0;
+    const unsigned char* data = m_file.data();
+    for (size_t offset = 0; offset < m_file.size(); offset += PREFETCH_STRIDE) {
+        sink ^= data[offset];
+    }
+    (void)sink;
+}
+
+bool BoxTexFile::toImage(Texture::Image& out) const
+{
+    if (!isOpen() || m_header.blockFormat != 0) return false;
+
+    out = Texture::Image();
+    out.width = m_levels[0].width;
+    out.height = m_levels[0].height;
+    out.channels = getChannels();
+    out.pixels.assign(m_levels[0].data, m_levels[0].data + m_levels[0].size);
+
+    for (size_t i = 1; i < m_levels.size(); i++) {
+        Texture::Image::MipLevel mip;
+        mip.width = m_levels[i].width;
+        mip.height = m_levels[i].height;
+        mip.pixels.assign(m_levels[i].data, m_levels[i].data + m_levels[i].size);
+        out.mips.push_back(std::move(mip));
+    }
+    return true;
+}
+
+bool BoxTexFile::toCompressed(CompressedImage& out) const
+{
+    if (!isOpen() || m_header.blockFormat == 0) return false;
+
+    out = CompressedImage();
+    out.format = getBlockFormat();
+    out.width = getWidth();
+    out.height = getHeight();
+
+    for (const Level& level : m_levels) {
+        out.levels.push_back({ out.data.size(), level.size, level.width, level.height });
+        out.data.insert(out.data.end(), level.data, level.data + level.size);
+    }
+    return true;
+}
+
+// Shared writer, levels are given as pointer / size / dimensions
+static bool writeFile(const std::string& filepath, BoxTexFile::Header header,
+    const std::vector<BoxTexFile::Level>& levels)
+{
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not write " << filepath << std::endl;
+        return false;
+    }
+
+    header.levelCount = static_cast<uint32_t>(levels.size());
+
+    std::vector<BoxTexFile::LevelEntry> entries(levels.size());
+    size_t offset = sizeof(BoxTexFile::Header) + entries.size() * sizeof(BoxTexFile::LevelEntry);
+    for (size_t i = 0; i < levels.size(); i++) {
+        offset = (offset + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+        entries[i].offset = offset;
+        entries[i].size = levels[i].size;
+        entries[i].width = static_cast<uint32_t>(levels[i].width);
+        entries[i].height = static_cast<uint32_t>(levels[i].height);
+        offset += levels[i].size;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(BoxTexFile::LevelEntry)));
+
+    static const char padding[LEVEL_ALIGNMENT] = {};
+    size_t position = sizeof(BoxTexFile::Header) + entries.size() * sizeof(BoxTexFile::LevelEntry);
+    for (size_t i = 0; i < levels.size(); i++) {
+        file.write(padding, static_cast<std::streamsize>(entries[i].offset - position));
+        file.write(reinterpret_cast<const char*>(levels[i].data), static_cast<std::streamsize>(levels[i].size));
+        position = entries[i].offset + levels[i].size;
+    }
+    return file.good();
+}
+
+bool BoxTexFile::write(const std::string& filepath, const Texture::Image& image, bool srgb)
+{
+    if (!image.isValid() || image.channels == 3) return false;
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.width = static_cast<uint32_t>(image.width);
+    header.height = static_cast<uint32_t>(image.height);
+    header.channels = static_cast<uint32_t>(image.channels);
+    header.flags = srgb ? FLAG_SRGB : 0;
+
+    std::vector<Level> levels;
+    levels.push_back({ image.pixels.data(), image.pixels.size(), image.width, image.height });
+    for (const auto& mip : image.mips) {
+        levels.push_back({ mip.pixels.data(), mip.pixels.size(), mip.width, mip.height });
+    }
+    return writeFile(filepath, header, levels);
+}
+
+bool BoxTexFile::write(const std::string& filepath, const CompressedImage& image, bool srgb)
+{
+    if (!image.isValid()) return false;
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.width = static_cast<uint32_t>(image.width);
+    header.height = static_cast<uint32_t>(image.height);
+    header.blockFormat = static_cast<uint32_t>(image.format);
+    header.flags = srgb ? FLAG_SRGB : 0;
+
+    std::vector<Level> levels;
+    for (const auto& level : image.levels) {
+        levels.push_back({ image.data.data() + level.offset, level.size, level.width, level.height });
+    }
+    return writeFile(filepath, header, levels);
+}
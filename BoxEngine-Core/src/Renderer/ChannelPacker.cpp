@@ -0,0 +1,156 @@
+#include "Renderer/ChannelPacker.h"
+#include "Utils/Profiler.h"
+#include <algorithm>
+#include <iostream>
+
+static const size_t MAP_COUNT = static_cast<size_t>(MaterialChannel::Count);
+
+bool ChannelMap::isEmpty() const
+{
+    return std::all_of(channels.begin(), channels.end(), [](int channel) { return channel < 0; });
+}
+
+int ChannelMap::getChannelCount() const
+{
+    int highest = *std::max_element(channels.begin(), channels.end());
+
+    // No RGB8 textures, they get padded by the driver anyway
+    return highest < 0 ? 0 : highest < 2 ? highest + 1 : 4;
+}
+
+unsigned char ChannelPacker::getNeutralValue(MaterialChannel map)
+{
+    switch (map) {
+    case MaterialChannel::Occlusion: return 255;    // fully lit
+    case MaterialChannel::Roughness: return 128;    // matches the old fixed shininess
+    case MaterialChannel::Specular:  return 255;    // specularStrength unscaled
+    default:                         return 0;      // not metallic, flat
+    }
+}
+
+ChannelMap ChannelPacker::layout(const Sources& sources)
+{
+    ChannelMap map;
+    int next = 0;
+    for (size_t i = 0; i < MAP_COUNT && next < 4; i++) {
+        if (sources[i].isValid()) {
+            map.channels[i] = next++;
+        }
+    }
+    return map;
+}
+
+std::string ChannelPacker::getName(const Sources& sources, const ChannelMap& map)
+{
+    std::string name = "packed:";
+    for (size_t i = 0; i < MAP_COUNT; i++) {
+        if (map.channels[i] < 0) continue;
+        name += sources[i].path + "#" + std::to_string(sources[i].channel) + "->" + std::to_string(map.channels[i]) + ";";
+    }
+    return name;
+}
+
+Texture::Image ChannelPacker::createDefaultImage(const ChannelMap& map)
+{
+    Texture::Image image;
+    image.width = 4;
+    image.height = 4;
+    image.channels = std::max(1, map.getChannelCount());
+    image.pixels.assign(static_cast<size_t>(image.width) * image.height * image.channels, 0);
+
+    for (size_t i = 0; i < MAP_COUNT; i++) {
+        int channel = map.channels[i];
+        if (channel < 0) continue;
+        unsigned char value = getNeutralValue(static_cast<MaterialChannel>(i));
+        for (size_t p = channel; p < image.pixels.size(); p += image.channels) {
+            image.pixels[p] = value;
+        }
+    }
+    return image;
+}
+
+bool ChannelPacker::pack(const Sources& sources, const ChannelMap& map, Texture::Image& out)
+{
+    PROFILE_SCOPE("ChannelPacker::pack");
+
+    // Several maps often come from the same image (glTF metallicRoughness), decode it once
+    std::array<Texture::Image, MAP_COUNT> images;
+    std::array<int, MAP_COUNT> imageFor;
+    bool ok = true;
+
+    for (size_t i = 0; i < MAP_COUNT; i++) {
+        imageFor[i] = -1;
+        if (map.channels[i] < 0) continue;
+
+        const Source& source = sources[i];
+        for (size_t j = 0; j < i; j++) {
+            if (imageFor[j] >= 0 && sources[j].path == source.path) {
+                imageFor[i] = imageFor[j];
+                break;
+            }
+        }
+        if (imageFor[i] >= 0) continue;
+
+        // Decoded like any non-colour map, so rows line up with the separate textures they replace
+        bool decoded = source.data
+            ? Texture::decodeMemory(source.data, source.size, SPECULAR, images[i])
+            : Texture::decodeFile(source.path, SPECULAR, images[i]);
+        if (decoded) {
+            imageFor[i] = static_cast<int>(i);
+        }
+        else {
+            std::cerr << "Failed to load packed material map: " << source.path << std::endl;
+            ok = false;
+        }
+    }
+
+    int width = 0, height = 0;
+    for (const auto& image : images) {
+        width = std::max(width, image.width);
+        height = std::max(height, image.height);
+    }
+    if (width == 0 || height == 0) {
+        out = createDefaultImage(map);
+        return false;
+    }
+
+    out = Texture::Image();
+    out.width = width;
+    out.height = height;
+    out.channels = map.getChannelCount();
+    out.pixels.assign(static_cast<size_t>(width) * height * out.channels, 0);
+
+    for (size_t i = 0; i < MAP_COUNT; i++) {
+        int channel = map.channels[i];
+        if (channel < 0) continue;
+
+        unsigned char* dest = out.pixels.data() + channel;
+        if (imageFor[i] < 0) {
+            unsigned char value = getNeutralValue(static_cast<MaterialChannel>(i));
+            for (size_t p = 0; p < static_cast<size_t>(width) * height; p++) {
+                dest[p * out.channels] = value;
+            }
+            continue;
+        }
+
+        // Grey images carry every colour channel in their first one, alpha
+        // in their second
+        const Texture::Image& image = images[imageFor[i]];
+        int sourceChannel = std::min(sources[i].channel, image.channels - 1);
+        if (image.channels < 3) {
+            sourceChannel = (sources[i].channel == 3 && image.channels == 2) ? 1 : 0;
+        }
+
+        // Smaller maps are stretched with nearest sampling, they rarely differ in size
+        for (int y = 0; y < height; y++) {
+            int sy = static_cast<int>(static_cast<long long>(y) * image.height / height);
+            const unsigned char* row = image.pixels.data() + static_cast<size_t>(sy) * image.width * image.channels;
+            unsigned char* destRow = dest + static_cast<size_t>(y) * width * out.channels;
+            for (int x = 0; x < width; x++) {
+                int sx = static_cast<int>(static_cast<long long>(x) * image.width / width);
+                destRow[x * out.channels] = row[sx * image.channels + sourceChannel];
+            }
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,339 @@
+#include "Renderer/CompressedImage.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const uint32_t DDS_MAGIC = 0x20534444;   // "DDS "
+static const size_t DDS_HEADER_SIZE = 124;
+static const size_t DDS_DX10_HEADER_SIZE = 20;
+
+// DDS header flags
+static const uint32_t DDSD_CAPS = 0x1;
+static const uint32_t DDSD_HEIGHT = 0x2;
+static const uint32_t DDSD_WIDTH = 0x4;
+static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8;
+static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+// DXGI_FORMAT values for the DX10 header
+static const uint32_t DXGI_BC1_UNORM = 71, DXGI_BC1_SRGB = 72;
+static const uint32_t DXGI_BC3_UNORM = 77, DXGI_BC3_SRGB = 78;
+static const uint32_t DXGI_BC4_UNORM = 80;
+static const uint32_t DXGI_BC5_UNORM = 83;
+static const uint32_t DXGI_BC7_UNORM = 98, DXGI_BC7_SRGB = 99;
+static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+// VkFormat values used by KTX2
+static const uint32_t VK_BC1_RGB_UNORM = 131, VK_BC1_RGB_SRGB = 132;
+static const uint32_t VK_BC1_RGBA_UNORM = 133, VK_BC1_RGBA_SRGB = 134;
+static const uint32_t VK_BC3_UNORM = 137, VK_BC3_SRGB = 138;
+static const uint32_t VK_BC4_UNORM = 139;
+static const uint32_t VK_BC5_UNORM = 141;
+static const uint32_t VK_BC7_UNORM = 145, VK_BC7_SRGB = 146;
+
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const size_t KTX2_HEADER_SIZE = 80;
+static const size_t KTX2_LEVEL_ENTRY_SIZE = 24;
+static const uint32_t KTX2_MAX_LEVELS = 32;     // a full chain for 2^31 texels
+
+static uint32_t fourCC(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+        (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+static uint32_t readU32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t readU64(const unsigned char* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static bool hasExtension(const std::string& filepath, const char* extension)
+{
+    size_t dot = filepath.find_last_of('.');
+    if (dot == std::string::npos) return false;
+
+    std::string ext = filepath.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == extension;
+}
+
+static bool readFile(const std::string& filepath, std::vector<unsigned char>& out)
+{
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+
+    std::streamsize size = file.tellg();
+    if (size <= 0) return false;
+
+    out.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(out.data()), size));
+}
+
+// Fill in the level table for a full or partial mip chain stored back to back
+static bool buildLevels(CompressedImage& image, size_t dataOffset, size_t levelCount)
+{
+    size_t offset = dataOffset;
+    int width = image.width;
+    int height = image.height;
+
+    for (size_t i = 0; i < levelCount; i++) {
+        size_t size = CompressedImage::getLevelSize(image.format, width, height);
+        if (offset + size > image.data.size()) {
+            // Truncated files still work with the levels that are there
+            break;
+        }
+        image.levels.push_back({ offset, size, width, height });
+
+        offset += size;
+        if (width == 1 && height == 1) break;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return !image.levels.empty();
+}
+
+static bool loadDDS(const std::string& filepath, CompressedImage& out)
+{
+    const auto& data = out.data;
+    if (data.size() < 4 + DDS_HEADER_SIZE || readU32(data.data()) != DDS_MAGIC) {
+        std::cerr << "DDS error: not a DDS file: " << filepath << std::endl;
+        return false;
+    }
+
+    const unsigned char* header = data.data() + 4;
+    out.height = static_cast<int>(readU32(header + 8));
+    out.width = static_cast<int>(readU32(header + 12));
+    uint32_t mipCount = std::max<uint32_t>(1, readU32(header + 24));
+    uint32_t pixelFlags = readU32(header + 76);
+    uint32_t code = readU32(header + 80);
+
+    size_t dataOffset = 4 + DDS_HEADER_SIZE;
+    if (!(pixelFlags & DDPF_FOURCC)) {
+        std::cerr << "DDS error: uncompressed DDS is not supported: " << filepath << std::endl;
+        return false;
+    }
+
+    if (code == fourCC('D', 'X', '1', '0')) {
+        if (data.size() < dataOffset + DDS_DX10_HEADER_SIZE) return false;
+
+        const unsigned char* dx10 = data.data() + dataOffset;
+        uint32_t dxgiFormat = readU32(dx10);
+        uint32_t dimension = readU32(dx10 + 4);
+        uint32_t arraySize = readU32(dx10 + 12);
+        dataOffset += DDS_DX10_HEADER_SIZE;
+
+        if (dimension != DDS_DIMENSION_TEXTURE2D || arraySize > 1) {
+            std::cerr << "DDS error: only single 2D textures are supported: " << filepath << std::endl;
+            return false;
+        }
+
+        switch (dxgiFormat) {
+        case DXGI_BC1_UNORM: case DXGI_BC1_SRGB: out.format = BlockFormat::BC1; break;
+        case DXGI_BC3_UNORM: case DXGI_BC3_SRGB: out.format = BlockFormat::BC3; break;
+        case DXGI_BC4_UNORM: out.format = BlockFormat::BC4; break;
+        case DXGI_BC5_UNORM: out.format = BlockFormat::BC5; break;
+        case DXGI_BC7_UNORM: case DXGI_BC7_SRGB: out.format = BlockFormat::BC7; break;
+        default: break;
+        }
+    }
+    else if (code == fourCC('D', 'X', 'T', '1')) out.format = BlockFormat::BC1;
+    else if (code == fourCC('D', 'X', 'T', '5')) out.format = BlockFormat::BC3;
+    else if (code == fourCC('A', 'T', 'I', '1') || code == fourCC('B', 'C', '4', 'U')) out.format = BlockFormat::BC4;
+    else if (code == fourCC('A', 'T', 'I', '2') || code == fourCC('B', 'C', '5', 'U')) out.format = BlockFormat::BC5;
+
+    if (out.format == BlockFormat::None) {
+        std::cerr << "DDS error: unsupported format in " << filepath << std::endl;
+        return false;
+    }
+
+    return buildLevels(out, dataOffset, mipCount);
+}
+
+static bool loadKTX2(const std::string& filepath, CompressedImage& out)
+{
+    const auto& data = out.data;
+    if (data.size() < KTX2_HEADER_SIZE || memcmp(data.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        std::cerr << "KTX2 error: not a KTX2 file: " << filepath << std::endl;
+        return false;
+    }
+
+    const unsigned char* header = data.data();
+    uint32_t vkFormat = readU32(header + 12);
+    out.width = static_cast<int>(readU32(header + 20));
+    out.height = static_cast<int>(readU32(header + 24));
+    uint32_t depth = readU32(header + 28);
+    uint32_t layers = readU32(header + 32);
+    uint32_t faces = readU32(header + 36);
+    uint32_t levelCount = std::max<uint32_t>(1, readU32(header + 40));
+    uint32_t supercompression = readU32(header + 44);
+
+    if (depth > 0 || layers > 1 || faces != 1) {
+        std::cerr << "KTX2 error: only single 2D textures are supported: " << filepath << std::endl;
+        return false;
+    }
+    if (supercompression != 0) {
+        std::cerr << "KTX2 error: supercompressed (Basis/zstd) files are not supported: " << filepath << std::endl;
+        return false;
+    }
+
+    switch (vkFormat) {
+    case VK_BC1_RGB_UNORM: case VK_BC1_RGB_SRGB:
+    case VK_BC1_RGBA_UNORM: case VK_BC1_RGBA_SRGB: out.format = BlockFormat::BC1; break;
+    case VK_BC3_UNORM: case VK_BC3_SRGB: out.format = BlockFormat::BC3; break;
+    case VK_BC4_UNORM: out.format = BlockFormat::BC4; break;
+    case VK_BC5_UNORM: out.format = BlockFormat::BC5; break;
+    case VK_BC7_UNORM: case VK_BC7_SRGB: out.format = BlockFormat::BC7; break;
+    default:
+        std::cerr << "KTX2 error: unsupported vkFormat " << vkFormat << " in " << filepath << std::endl;
+        return false;
+    }
+
+    // The level index lists each level's own offset, smallest levels usually come first in the file
+    if (levelCount > KTX2_MAX_LEVELS || data.size() < KTX2_HEADER_SIZE + static_cast<size_t>(levelCount) * KTX2_LEVEL_ENTRY_SIZE) {
+        std::cerr << "KTX2 error: bad level index in " << filepath << std::endl;
+        return false;
+    }
+
+    int width = out.width;
+    int height = out.height;
+    for (uint32_t i = 0; i < levelCount; i++) {
+        const unsigned char* entry = header + KTX2_HEADER_SIZE + i * KTX2_LEVEL_ENTRY_SIZE;
+        uint64_t offset = readU64(entry);
+        uint64_t length = readU64(entry + 8);
+
+        size_t expected = CompressedImage::getLevelSize(out.format, width, height);
+        // No addition, a crafted offset would wrap past the check
+        if (offset > data.size() || length > data.size() - offset || length < expected) break;
+
+        out.levels.push_back({ static_cast<size_t>(offset), expected, width, height });
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return !out.levels.empty();
+}
+
+bool CompressedImage::canLoad(const std::string& filepath)
+{
+    return hasExtension(filepath, ".dds") || hasExtension(filepath, ".ktx2");
+}
+
+bool CompressedImage::load(const std::string& filepath, CompressedImage& out)
+{
+    out = CompressedImage();
+    if (!readFile(filepath, out.data)) {
+        std::cerr << "Could not read compressed texture: " << filepath << std::endl;
+        return false;
+    }
+
+    bool loaded = memcmp(out.data.data(), KTX2_IDENTIFIER, std::min(out.data.size(), sizeof(KTX2_IDENTIFIER))) == 0
+        ? loadKTX2(filepath, out)
+        : loadDDS(filepath, out);
+
+    if (!loaded || out.width <= 0 || out.height <= 0) {
+        out = CompressedImage();
+        return false;
+    }
+    return true;
+}
+
+bool CompressedImage::saveDDS(const std::string& filepath) const
+{
+    if (!isValid()) return false;
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not write " << filepath << std::endl;
+        return false;
+    }
+
+    unsigned char header[4 + DDS_HEADER_SIZE] = {};
+    auto writeU32 = [&](size_t offset, uint32_t value) { memcpy(header + offset, &value, sizeof(value)); };
+
+    writeU32(0, DDS_MAGIC);
+    writeU32(4, static_cast<uint32_t>(DDS_HEADER_SIZE));
+    writeU32(8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE |
+        (levels.size() > 1 ? DDSD_MIPMAPCOUNT : 0));
+    writeU32(12, static_cast<uint32_t>(height));
+    writeU32(16, static_cast<uint32_t>(width));
+    writeU32(20, static_cast<uint32_t>(levels[0].size));
+    writeU32(28, static_cast<uint32_t>(levels.size()));
+    writeU32(76, 32);               // pixel format size
+    writeU32(80, DDPF_FOURCC);
+    writeU32(108, DDSCAPS_TEXTURE | (levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+
+    uint32_t dxgiFormat = 0;
+    switch (format) {
+    case BlockFormat::BC1: writeU32(84, fourCC('D', 'X', 'T', '1')); break;
+    case BlockFormat::BC3: writeU32(84, fourCC('D', 'X', 'T', '5')); break;
+    case BlockFormat::BC4: writeU32(84, fourCC('A', 'T', 'I', '1')); break;
+    case BlockFormat::BC5: writeU32(84, fourCC('A', 'T', 'I', '2')); break;
+    case BlockFormat::BC7:
+        writeU32(84, fourCC('D', 'X', '1', '0'));
+        dxgiFormat = DXGI_BC7_UNORM;
+        break;
+    default:
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    if (dxgiFormat != 0) {
+        uint32_t dx10[5] = { dxgiFormat, DDS_DIMENSION_TEXTURE2D, 0, 1, 0 };
+        file.write(reinterpret_cast<const char*>(dx10), sizeof(dx10));
+    }
+
+    for (const auto& level : levels) {
+        file.write(reinterpret_cast<const char*>(data.data() + level.offset), static_cast<std::streamsize>(level.size));
+    }
+    return file.good();
+}
+
+size_t CompressedImage::getBlockSize(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC4:
+        return 8;
+    case BlockFormat::BC3:
+    case BlockFormat::BC5:
+    case BlockFormat::BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+size_t CompressedImage::getLevelSize(BlockFormat format, int width, int height)
+{
+    size_t blocksX = static_cast<size_t>(std::max(1, (width + 3) / 4));
+    size_t blocksY = static_cast<size_t>(std::max(1, (height + 3) / 4));
+    return blocksX * blocksY * getBlockSize(format);
+}
+
+int CompressedImage::getChannelCount(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return 3;
+    case BlockFormat::BC4: return 1;
+    case BlockFormat::BC5: return 2;
+    case BlockFormat::BC3:
+    case BlockFormat::BC7: return 4;
+    default: return 0;
+    }
+}
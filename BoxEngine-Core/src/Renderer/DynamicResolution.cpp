@@ -0,0 +1,117 @@
+#include "Renderer/DynamicResolution.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::~DynamicResolution()
+{
+    release();
+}
+
+void DynamicResolution::setSettings(const Settings& settings)
+{
+    m_settings = settings;
+    m_scale = std::max(m_settings.minScale, std::min(m_scale, m_settings.maxScale));
+    m_framesUnder = 0;
+}
+
+void DynamicResolution::resize(int width, int height)
+{
+    m_windowWidth = width;
+    m_windowHeight = height;
+}
+
+void DynamicResolution::adjust()
+{
+    if (m_framesSettling > 0) {
+        m_framesSettling--;
+        return;
+    }
+
+    // Only react to fresh measurements, the timer repeats its last one meanwhile
+    if (m_timer.getLatestSample() == m_lastSample) return;
+    m_lastSample = m_timer.getLatestSample();
+
+    double milliseconds = m_timer.getMilliseconds();
+    if (milliseconds <= 0.0) return;
+
+    const float step = m_settings.step;
+    float scale = m_scale;
+    if (milliseconds > m_settings.targetMs) {
+        // Cost follows the pixel count, the square of the scale
+        float wanted = m_scale * static_cast<float>(std::sqrt(m_settings.targetMs / milliseconds));
+        scale = std::min(std::floor(wanted / step + 1e-3f) * step, m_scale - step);
+        m_framesUnder = 0;
+    }
+    else if (milliseconds < m_settings.targetMs * m_settings.raiseBelow) {
+        if (++m_framesUnder >= m_settings.raiseFrames) {
+            scale = m_scale + step;
+            m_framesUnder = 0;
+        }
+    }
+    else {
+        m_framesUnder = 0;
+    }
+
+    scale = std::max(m_settings.minScale, std::min(scale, m_settings.maxScale));
+    if (scale != m_scale) {
+        m_scale = scale;
+        m_framesSettling = m_settings.settleFrames;
+    }
+}
+
+bool DynamicResolution::begin()
+{
+    if (m_windowWidth <= 0 || m_windowHeight <= 0) return false;
+
+    adjust();
+
+    // The targets are sized for maxScale, so a scale change keeps the same pooled textures
+    m_targetWidth = std::max(1, static_cast<int>(std::ceil(m_windowWidth * m_settings.maxScale)));
+    m_targetHeight = std::max(1, static_cast<int>(std::ceil(m_windowHeight * m_settings.maxScale)));
+    m_renderWidth = std::max(1, std::min(m_targetWidth, static_cast<int>(m_windowWidth * m_scale + 0.5f)));
+    m_renderHeight = std::max(1, std::min(m_targetHeight, static_cast<int>(m_windowHeight * m_scale + 0.5f)));
+
+    if (m_upscaleShader.GetID() == 0) {
+        m_upscaleShader.LoadFromFile("assets/Shaders/upscale.vert", "assets/Shaders/upscale.frag");
+    }
+    if (m_emptyVAO == 0) {
+        glGenVertexArrays(1, &m_emptyVAO);
+    }
+
+    m_timer.begin();
+    return true;
+}
+
+void DynamicResolution::upscale(unsigned int sceneColor)
+{
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    // Every window pixel is written, no clear needed
+    m_upscaleShader.Use();
+    m_upscaleShader.SetInt("sceneColor", 0);
+    m_upscaleShader.SetVec2("uvScale", glm::vec2(static_cast<float>(m_renderWidth) / m_targetWidth,
+        static_cast<float>(m_renderHeight) / m_targetHeight));
+    m_upscaleShader.SetVec2("texelSize", glm::vec2(1.0f / m_targetWidth, 1.0f / m_targetHeight));
+    m_upscaleShader.SetFloat("sharpness", m_settings.sharpness);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sceneColor);
+    glBindVertexArray(m_emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    // The upscale is part of the frame's cost too
+    m_timer.end();
+}
+
+void DynamicResolution::release()
+{
+    if (m_emptyVAO != 0) {
+        glDeleteVertexArrays(1, &m_emptyVAO);
+        m_emptyVAO = 0;
+    }
+    m_timer.release();
+}
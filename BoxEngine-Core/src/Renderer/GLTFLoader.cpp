@@ -0,0 +1,759 @@
+#include "Renderer/GLTFLoader.h"
+#include "Utils/Profiler.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// glTF component types (same values as the GL enums)
+static const int COMPONENT_BYTE = 5120;
+static const int COMPONENT_UNSIGNED_BYTE = 5121;
+static const int COMPONENT_SHORT = 5122;
+static const int COMPONENT_UNSIGNED_SHORT = 5123;
+static const int COMPONENT_UNSIGNED_INT = 5125;
+static const int COMPONENT_FLOAT = 5126;
+
+// Primitive modes we can turn into triangle lists
+static const int MODE_TRIANGLES = 4;
+static const int MODE_TRIANGLE_STRIP = 5;
+static const int MODE_TRIANGLE_FAN = 6;
+
+// .glb container
+static const uint32_t GLB_MAGIC = 0x46546C67;       // "glTF"
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;  // "JSON"
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;   // "BIN\0"
+
+static const int MAX_NODE_DEPTH = 64;
+
+static size_t componentSize(int componentType)
+{
+    switch (componentType) {
+    case COMPONENT_BYTE:
+    case COMPONENT_UNSIGNED_BYTE:  return 1;
+    case COMPONENT_SHORT:
+    case COMPONENT_UNSIGNED_SHORT: return 2;
+    case COMPONENT_UNSIGNED_INT:
+    case COMPONENT_FLOAT:          return 4;
+    default:                       return 0;
+    }
+}
+
+static int componentCount(const std::string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT4") return 16;
+    return 0;
+}
+
+static uint32_t readU32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Decode one component to float, applying glTF normalization rules
+static float readComponent(const unsigned char* p, int componentType, bool normalized)
+{
+    switch (componentType) {
+    case COMPONENT_FLOAT: {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case COMPONENT_UNSIGNED_BYTE:
+        return normalized ? *p / 255.0f : static_cast<float>(*p);
+    case COMPONENT_BYTE: {
+        int8_t value = static_cast<int8_t>(*p);
+        return normalized ? std::max(value / 127.0f, -1.0f) : static_cast<float>(value);
+    }
+    case COMPONENT_UNSIGNED_SHORT: {
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return normalized ? value / 65535.0f : static_cast<float>(value);
+    }
+    case COMPONENT_SHORT: {
+        int16_t value;
+        memcpy(&value, p, sizeof(value));
+        return normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+    }
+    case COMPONENT_UNSIGNED_INT:
+        return static_cast<float>(readU32(p));
+    default:
+        return 0.0f;
+    }
+}
+
+// Write up to `components` floats of every element into a strided destination.
+// Float data is copied per element, everything else goes through readComponent.
+static void readFloats(const unsigned char* src, size_t count, size_t srcStride,
+    int componentType, int srcComponents, bool normalized,
+    unsigned char* dst, size_t dstStride, int components)
+{
+    int n = std::min(components, srcComponents);
+
+    if (componentType == COMPONENT_FLOAT) {
+        for (size_t i = 0; i < count; i++) {
+            memcpy(dst + i * dstStride, src + i * srcStride, n * sizeof(float));
+        }
+        return;
+    }
+
+    size_t size = componentSize(componentType);
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < n; c++) {
+            float value = readComponent(src + i * srcStride + c * size, componentType, normalized);
+            memcpy(dst + i * dstStride + c * sizeof(float), &value, sizeof(float));
+        }
+    }
+}
+
+static bool decodeBase64(const std::string& input, size_t start, std::vector<unsigned char>& out)
+{
+    static const auto decodeChar = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+' || c == '-') return 62;
+        if (c == '/' || c == '_') return 63;
+        return -1;
+    };
+
+    out.clear();
+    out.reserve((input.size() - start) * 3 / 4);
+
+    unsigned int bits = 0;
+    int bitCount = 0;
+    for (size_t i = start; i < input.size(); i++) {
+        char c = input[i];
+        if (c == '=') break;
+        int value = decodeChar(c);
+        if (value < 0) return false;
+
+        bits = (bits << 6) | static_cast<unsigned int>(value);
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            out.push_back(static_cast<unsigned char>((bits >> bitCount) & 0xFF));
+        }
+    }
+    return true;
+}
+
+// Value of a hex digit, -1 for anything else
+static int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// URIs are relative and may be percent-encoded ("my%20texture.png"). A '%'
+// without two hex digits after it is kept as it is.
+static std::string decodeUri(const std::string& uri)
+{
+    std::string result;
+    result.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); i++) {
+        int high = uri[i] == '%' && i + 2 < uri.size() ? hexDigit(uri[i + 1]) : -1;
+        int low = high >= 0 ? hexDigit(uri[i + 2]) : -1;
+        if (low >= 0) {
+            result += static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+        else {
+            result += uri[i];
+        }
+    }
+    return result;
+}
+
+static bool hasExtension(const std::string& filepath, const char* extension)
+{
+    size_t dot = filepath.find_last_of('.');
+    if (dot == std::string::npos) return false;
+
+    std::string ext = filepath.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return ext == extension;
+}
+
+bool GLTFLoader::canLoad(const std::string& filepath)
+{
+    return hasExtension(filepath, ".gltf") || hasExtension(filepath, ".glb");
+}
+
+bool GLTFLoader::load(const std::string& filepath, bool decodeGeometry)
+{
+    m_filepath = filepath;
+    m_decodeGeometry = decodeGeometry;
+    size_t slash = filepath.find_last_of("/\\");
+    m_directory = slash == std::string::npos ? "." : filepath.substr(0, slash);
+    m_primitives.clear();
+    m_materials.clear();
+
+    if (!m_file.open(filepath)) {
+        std::cerr << "glTF error: could not open " << filepath << std::endl;
+        return false;
+    }
+
+    BufferRange json{ m_file.data(), m_file.size() };
+    BufferRange binaryChunk;
+    if (m_file.size() >= 4 && readU32(m_file.data()) == GLB_MAGIC) {
+        if (!parseGLB(json, binaryChunk)) return false;
+    }
+
+    std::string error;
+    const char* text = reinterpret_cast<const char*>(json.data);
+    Profiler::ScopedTimer parseTimer("Json::parse");
+    bool parsed = Json::parse(text, text + json.size, m_document, &error);
+    parseTimer.stop();
+    if (!parsed) {
+        std::cerr << "glTF error: invalid JSON in " << filepath << ": " << error << std::endl;
+        return false;
+    }
+
+    const Json& asset = m_document["asset"];
+    if (asset["version"].asString().compare(0, 1, "2") != 0) {
+        std::cerr << "glTF error: only glTF 2.0 is supported (" << filepath << ")" << std::endl;
+        return false;
+    }
+
+    // Material extensions only change shading, anything else (compression,
+    // quantization) changes how geometry is stored and is left to assimp
+    for (const auto& required : m_document["extensionsRequired"].getElements()) {
+        if (required.asString().compare(0, 14, "KHR_materials_") != 0) {
+            std::cerr << "glTF error: unsupported required extension " << required.asString() << std::endl;
+            return false;
+        }
+    }
+
+    if (!loadBuffers(binaryChunk)) return false;
+    loadMaterials();
+
+    const Json& scenes = m_document["scenes"];
+    if (scenes.size() > 0) {
+        const Json& scene = scenes[static_cast<size_t>(m_document["scene"].asInt(0))];
+        for (const auto& node : scene["nodes"].getElements()) {
+            processNode(static_cast<size_t>(node.asInt()), glm::mat4(1.0f), 0);
+        }
+    }
+    else {
+        // No scene graph, take every mesh as is
+        for (size_t i = 0; i < m_document["meshes"].size(); i++) {
+            processMesh(i, glm::mat4(1.0f), "");
+        }
+    }
+
+    return !m_primitives.empty();
+}
+
+bool GLTFLoader::parseGLB(BufferRange& json, BufferRange& binaryChunk)
+{
+    const unsigned char* data = m_file.data();
+    size_t size = m_file.size();
+
+    // 12 byte header: magic, version, length
+    if (size < 20 || readU32(data + 4) != 2 || readU32(data + 8) > size) {
+        std::cerr << "glTF error: invalid GLB header in " << m_filepath << std::endl;
+        return false;
+    }
+
+    size_t length = readU32(data + 8);
+    size_t offset = 12;
+    json = BufferRange();
+
+    while (offset + 8 <= length) {
+        size_t chunkLength = readU32(data + offset);
+        uint32_t chunkType = readU32(data + offset + 4);
+        offset += 8;
+
+        if (chunkLength > length - offset) {
+            std::cerr << "glTF error: truncated GLB chunk in " << m_filepath << std::endl;
+            return false;
+        }
+
+        if (chunkType == GLB_CHUNK_JSON && !json.data) {
+            json = { data + offset, chunkLength };
+        }
+        else if (chunkType == GLB_CHUNK_BIN && !binaryChunk.data) {
+            binaryChunk = { data + offset, chunkLength };
+        }
+
+        // Chunks are padded to 4 bytes
+        offset += (chunkLength + 3) & ~size_t(3);
+    }
+
+    if (!json.data) {
+        std::cerr << "glTF error: GLB has no JSON chunk " << m_filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool GLTFLoader::loadBuffers(const BufferRange& binaryChunk)
+{
+    const Json& buffers = m_document["buffers"];
+    m_buffers.assign(buffers.size(), BufferRange());
+    m_bufferFiles.clear();
+    m_decodedBuffers.clear();
+
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const Json& buffer = buffers[i];
+        size_t byteLength = static_cast<size_t>(buffer["byteLength"].asNumber());
+
+        if (!buffer.has("uri")) {
+            // The first buffer of a .glb lives in the BIN chunk
+            if (i != 0 || !binaryChunk.data || binaryChunk.size < byteLength) {
+                std::cerr << "glTF error: buffer " << i << " has no data" << std::endl;
+                return false;
+            }
+            m_buffers[i] = { binaryChunk.data, byteLength };
+            continue;
+        }
+
+        const std::string& uri = buffer["uri"].asString();
+        if (uri.compare(0, 5, "data:") == 0) {
+            size_t comma = uri.find(";base64,");
+            m_decodedBuffers.emplace_back();
+            if (comma == std::string::npos || !decodeBase64(uri, comma + 8, m_decodedBuffers.back())) {
+                std::cerr << "glTF error: unsupported data URI in buffer " << i << std::endl;
+                return false;
+            }
+            auto& decoded = m_decodedBuffers.back();
+            m_buffers[i] = { decoded.data(), std::min(decoded.size(), byteLength) };
+        }
+        else {
+            MappedFile file;
+            std::string path = m_directory + "/" + decodeUri(uri);
+            if (!file.open(path) || file.size() < byteLength) {
+                std::cerr << "glTF error: could not map buffer " << path << std::endl;
+                return false;
+            }
+            m_buffers[i] = { file.data(), byteLength };
+            m_bufferFiles.push_back(std::move(file));
+        }
+    }
+    return true;
+}
+
+GLTFLoader::TextureRef GLTFLoader::resolveTexture(const Json& textureInfo)
+{
+    TextureRef ref;
+    if (!textureInfo.isObject()) return ref;
+
+    const Json& texture = m_document["textures"][static_cast<size_t>(textureInfo["index"].asInt(-1))];
+    const Json& image = m_document["images"][static_cast<size_t>(texture["source"].asInt(-1))];
+    if (!image.isObject()) return ref;
+
+    if (image.has("uri")) {
+        const std::string& uri = image["uri"].asString();
+        if (uri.compare(0, 5, "data:") == 0) {
+            std::cerr << "glTF warning: data URI images are not supported" << std::endl;
+            return ref;
+        }
+        ref.path = m_directory + "/" + decodeUri(uri);
+        return ref;
+    }
+
+    // Image stored in a buffer view (typical for .glb)
+    BufferRange range;
+    size_t stride;
+    int viewIndex = image["bufferView"].asInt(-1);
+    if (getBufferView(viewIndex, range, stride)) {
+        ref.path = m_filepath + "#image" + std::to_string(texture["source"].asInt());
+        ref.data = range.data;
+        ref.size = range.size;
+    }
+    return ref;
+}
+
+void GLTFLoader::loadMaterials()
+{
+    const Json& materials = m_document["materials"];
+    m_materials.resize(materials.size());
+
+    for (size_t i = 0; i < materials.size(); i++) {
+        const Json& material = materials[i];
+        Material& out = m_materials[i];
+
+        out.name = material["name"].asString();
+        out.diffuse = resolveTexture(material["pbrMetallicRoughness"]["baseColorTexture"]);
+        out.normal = resolveTexture(material["normalTexture"]);
+        out.metallicRoughness = resolveTexture(material["pbrMetallicRoughness"]["metallicRoughnessTexture"]);
+        out.occlusion = resolveTexture(material["occlusionTexture"]);
+
+        const Json& extensions = material["extensions"];
+        const Json& specular = extensions["KHR_materials_specular"];
+        out.specular = resolveTexture(specular["specularColorTexture"]);
+        if (!out.specular.isValid()) {
+            out.specular = resolveTexture(specular["specularTexture"]);
+            out.specularChannel = 3;
+        }
+        if (!out.specular.isValid()) {
+            out.specular = resolveTexture(extensions["KHR_materials_pbrSpecularGlossiness"]["specularGlossinessTexture"]);
+            out.specularChannel = 0;
+        }
+        if (!out.diffuse.isValid()) {
+            out.diffuse = resolveTexture(extensions["KHR_materials_pbrSpecularGlossiness"]["diffuseTexture"]);
+        }
+    }
+}
+
+bool GLTFLoader::getBufferView(int index, BufferRange& range, size_t& stride) const
+{
+    const Json& view = m_document["bufferViews"][static_cast<size_t>(index)];
+    if (!view.isObject()) return false;
+
+    size_t bufferIndex = static_cast<size_t>(view["buffer"].asInt(-1));
+    if (bufferIndex >= m_buffers.size()) return false;
+
+    const BufferRange& buffer = m_buffers[bufferIndex];
+    size_t offset = static_cast<size_t>(view["byteOffset"].asNumber(0));
+    size_t length = static_cast<size_t>(view["byteLength"].asNumber(0));
+    if (offset > buffer.size || length > buffer.size - offset) return false;
+
+    range = { buffer.data + offset, length };
+    stride = static_cast<size_t>(view["byteStride"].asInt(0));
+    return true;
+}
+
+bool GLTFLoader::getAccessor(int index, AccessorView& view) const
+{
+    const Json& accessor = m_document["accessors"][static_cast<size_t>(index)];
+    if (!accessor.isObject()) return false;
+
+    if (accessor.has("sparse")) {
+        std::cerr << "glTF error: sparse accessors are not supported" << std::endl;
+        return false;
+    }
+
+    view.count = static_cast<size_t>(accessor["count"].asNumber(0));
+    view.componentType = accessor["componentType"].asInt();
+    view.components = componentCount(accessor["type"].asString());
+    view.normalized = accessor["normalized"].asBool(false);
+
+    size_t elementSize = componentSize(view.componentType) * view.components;
+    if (elementSize == 0 || view.count == 0) return false;
+
+    BufferRange range;
+    size_t stride;
+    if (!getBufferView(accessor["bufferView"].asInt(-1), range, stride)) return false;
+
+    size_t offset = static_cast<size_t>(accessor["byteOffset"].asNumber(0));
+    view.stride = stride ? stride : elementSize;
+
+    // Last element must fit inside the buffer view. Count and stride come
+    // from the file, so the bounds are checked before anything is multiplied.
+    if (offset > range.size || elementSize > range.size - offset ||
+        view.count - 1 > (range.size - offset - elementSize) / view.stride) {
+        std::cerr << "glTF error: accessor " << index << " is out of bounds" << std::endl;
+        return false;
+    }
+
+    view.data = range.data + offset;
+    return true;
+}
+
+glm::mat4 GLTFLoader::getNodeTransform(const Json& node)
+{
+    const Json& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        float values[16];
+        for (size_t i = 0; i < 16; i++) {
+            values[i] = matrix[i].asFloat();
+        }
+        return glm::make_mat4(values); // glTF is column-major like glm
+    }
+
+    glm::mat4 transform(1.0f);
+    const Json& translation = node["translation"];
+    if (translation.size() == 3) {
+        transform = glm::translate(transform,
+            glm::vec3(translation[0].asFloat(), translation[1].asFloat(), translation[2].asFloat()));
+    }
+
+    const Json& rotation = node["rotation"];
+    if (rotation.size() == 4) {
+        // glTF stores x, y, z, w
+        glm::quat q(rotation[3].asFloat(), rotation[0].asFloat(), rotation[1].asFloat(), rotation[2].asFloat());
+        transform = transform * glm::mat4_cast(q);
+    }
+
+    const Json& scale = node["scale"];
+    if (scale.size() == 3) {
+        transform = glm::scale(transform, glm::vec3(scale[0].asFloat(), scale[1].asFloat(), scale[2].asFloat()));
+    }
+    return transform;
+}
+
+void GLTFLoader::processNode(size_t nodeIndex, const glm::mat4& parentTransform, int depth)
+{
+    const Json& node = m_document["nodes"][nodeIndex];
+    if (!node.isObject() || depth > MAX_NODE_DEPTH) return;
+
+    glm::mat4 transform = parentTransform * getNodeTransform(node);
+
+    if (node.has("mesh")) {
+        processMesh(static_cast<size_t>(node["mesh"].asInt()), transform, node["name"].asString());
+    }
+
+    for (const auto& child : node["children"].getElements()) {
+        processNode(static_cast<size_t>(child.asInt()), transform, depth + 1);
+    }
+}
+
+void GLTFLoader::processMesh(size_t meshIndex, const glm::mat4& transform, const std::string& name)
+{
+    const Json& mesh = m_document["meshes"][meshIndex];
+
+    for (const auto& primitive : mesh["primitives"].getElements()) {
+        int mode = primitive["mode"].asInt(MODE_TRIANGLES);
+        if (mode != MODE_TRIANGLES && mode != MODE_TRIANGLE_STRIP && mode != MODE_TRIANGLE_FAN) {
+            // Points and lines are dropped, like aiProcess_SortByPType does for us
+            continue;
+        }
+
+        Primitive out;
+        out.transform = transform;
+        out.name = name.empty() ? mesh["name"].asString() : name;
+        out.material = primitive["material"].asInt(-1);
+        out.source = &primitive;
+
+        if (!readBounds(primitive, out)) {
+            std::cerr << "glTF error: primitive without valid POSITION in " << m_filepath << std::endl;
+            continue;
+        }
+
+        if (!m_decodeGeometry || decodePrimitive(out)) {
+            m_primitives.push_back(std::move(out));
+        }
+    }
+}
+
+bool GLTFLoader::readBounds(const Json& primitive, Primitive& out) const
+{
+    const Json& accessor = m_document["accessors"][primitive["attributes"]["POSITION"].asInt(-1)];
+    if (!accessor.isObject()) return false;
+
+    // min/max are required on POSITION by the spec, but not every exporter writes them
+    const Json& min = accessor["min"];
+    const Json& max = accessor["max"];
+    if (min.size() == 3 && max.size() == 3) {
+        out.minBounds = glm::vec3(min[0].asFloat(), min[1].asFloat(), min[2].asFloat());
+        out.maxBounds = glm::vec3(max[0].asFloat(), max[1].asFloat(), max[2].asFloat());
+        out.hasBounds = true;
+    }
+    return true;
+}
+
+bool GLTFLoader::decodePrimitive(Primitive& primitive) const
+{
+    if (primitive.decoded) return true;
+    if (!primitive.source || !processPrimitive(*primitive.source, primitive)) return false;
+
+    primitive.decoded = true;
+    return true;
+}
+
+bool GLTFLoader::processPrimitive(const Json& primitive, Primitive& out) const
+{
+    PROFILE_SCOPE("GLTFLoader::processPrimitive");
+
+    int mode = primitive["mode"].asInt(MODE_TRIANGLES);
+
+    const Json& attributes = primitive["attributes"];
+
+    AccessorView positions;
+    if (!getAccessor(attributes["POSITION"].asInt(-1), positions) || positions.components != 3) {
+        std::cerr << "glTF error: primitive without valid POSITION in " << m_filepath << std::endl;
+        return false;
+    }
+
+    // Decode every attribute directly into the interleaved vertex array
+    out.vertices.resize(positions.count, Vertex(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f)));
+    unsigned char* base = reinterpret_cast<unsigned char*>(out.vertices.data());
+    const size_t count = positions.count;
+
+    readFloats(positions.data, count, positions.stride, positions.componentType, 3, positions.normalized,
+        base + offsetof(Vertex, position), sizeof(Vertex), 3);
+
+    AccessorView normals;
+    bool hasNormals = getAccessor(attributes["NORMAL"].asInt(-1), normals) && normals.count == count;
+    if (hasNormals) {
+        readFloats(normals.data, count, normals.stride, normals.componentType, normals.components, normals.normalized,
+            base + offsetof(Vertex, normal), sizeof(Vertex), 3);
+    }
+
+    AccessorView texCoords;
+    if (getAccessor(attributes["TEXCOORD_0"].asInt(-1), texCoords) && texCoords.count == count) {
+        readFloats(texCoords.data, count, texCoords.stride, texCoords.componentType, texCoords.components, texCoords.normalized,
+            base + offsetof(Vertex, texCoords), sizeof(Vertex), 2);
+
+        // assimp flips V on glTF import, match it so both paths render the same
+        for (auto& vertex : out.vertices) {
+            vertex.texCoords.y = 1.0f - vertex.texCoords.y;
+        }
+    }
+
+    // Indices, or an implicit 0..n-1 list
+    std::vector<unsigned int> source;
+    AccessorView indices;
+    if (primitive.has("indices")) {
+        if (!getAccessor(primitive["indices"].asInt(-1), indices) || indices.components != 1) {
+            std::cerr << "glTF error: invalid index accessor in " << m_filepath << std::endl;
+            return false;
+        }
+
+        source.resize(indices.count);
+        size_t size = componentSize(indices.componentType);
+        for (size_t i = 0; i < indices.count; i++) {
+            const unsigned char* p = indices.data + i * indices.stride;
+            switch (indices.componentType) {
+            case COMPONENT_UNSIGNED_BYTE:  source[i] = *p; break;
+            case COMPONENT_UNSIGNED_SHORT: { uint16_t v; memcpy(&v, p, size); source[i] = v; break; }
+            case COMPONENT_UNSIGNED_INT:   source[i] = readU32(p); break;
+            default:
+                std::cerr << "glTF error: invalid index type in " << m_filepath << std::endl;
+                return false;
+            }
+            if (source[i] >= count) {
+                std::cerr << "glTF error: index out of range in " << m_filepath << std::endl;
+                return false;
+            }
+        }
+    }
+    else {
+        source.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            source[i] = static_cast<unsigned int>(i);
+        }
+    }
+
+    if (mode == MODE_TRIANGLES) {
+        source.resize(source.size() - source.size() % 3);
+        out.indices = std::move(source);
+    }
+    else if (source.size() >= 3) {
+        out.indices.reserve((source.size() - 2) * 3);
+        for (size_t i = 2; i < source.size(); i++) {
+            if (mode == MODE_TRIANGLE_STRIP) {
+                // Keep winding consistent on odd triangles
+                bool odd = (i % 2) == 1;
+                out.indices.push_back(source[i - 2]);
+                out.indices.push_back(odd ? source[i] : source[i - 1]);
+                out.indices.push_back(odd ? source[i - 1] : source[i]);
+            }
+            else {
+                out.indices.push_back(source[0]);
+                out.indices.push_back(source[i - 1]);
+                out.indices.push_back(source[i]);
+            }
+        }
+    }
+
+    if (!hasNormals) {
+        generateNormals(out);
+    }
+
+    AccessorView tangents;
+    if (getAccessor(attributes["TANGENT"].asInt(-1), tangents) && tangents.count == count && tangents.components == 4) {
+        // xyz is the tangent, w the handedness of the bitangent
+        for (size_t i = 0; i < count; i++) {
+            float t[4];
+            readFloats(tangents.data + i * tangents.stride, 1, tangents.stride, tangents.componentType, 4,
+                tangents.normalized, reinterpret_cast<unsigned char*>(t), sizeof(t), 4);
+
+            Vertex& vertex = out.vertices[i];
+            vertex.tangent = glm::vec3(t[0], t[1], t[2]);
+            vertex.bitangent = glm::cross(vertex.normal, vertex.tangent) * t[3];
+        }
+    }
+    else {
+        generateTangents(out);
+    }
+
+    return !out.indices.empty();
+}
+
+void GLTFLoader::generateNormals(Primitive& primitive)
+{
+    auto& vertices = primitive.vertices;
+    for (auto& vertex : vertices) {
+        vertex.normal = glm::vec3(0.0f);
+    }
+
+    // Area weighted face normals
+    const auto& indices = primitive.indices;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        Vertex& a = vertices[indices[i]];
+        Vertex& b = vertices[indices[i + 1]];
+        Vertex& c = vertices[indices[i + 2]];
+
+        glm::vec3 faceNormal = glm::cross(b.position - a.position, c.position - a.position);
+        a.normal += faceNormal;
+        b.normal += faceNormal;
+        c.normal += faceNormal;
+    }
+
+    for (auto& vertex : vertices) {
+        float length = glm::length(vertex.normal);
+        vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+}
+
+void GLTFLoader::generateTangents(Primitive& primitive)
+{
+    auto& vertices = primitive.vertices;
+    std::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
+
+    const auto& indices = primitive.indices;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+        const Vertex& a = vertices[i0];
+        const Vertex& b = vertices[i1];
+        const Vertex& c = vertices[i2];
+
+        glm::vec3 edge1 = b.position - a.position;
+        glm::vec3 edge2 = c.position - a.position;
+        glm::vec2 uv1 = b.texCoords - a.texCoords;
+        glm::vec2 uv2 = c.texCoords - a.texCoords;
+
+        float det = uv1.x * uv2.y - uv2.x * uv1.y;
+        if (std::abs(det) < 1e-12f) continue;
+        float r = 1.0f / det;
+
+        glm::vec3 tangent = (edge1 * uv2.y - edge2 * uv1.y) * r;
+        glm::vec3 bitangent = (edge2 * uv1.x - edge1 * uv2.x) * r;
+
+        tangents[i0] += tangent; tangents[i1] += tangent; tangents[i2] += tangent;
+        bitangents[i0] += bitangent; bitangents[i1] += bitangent; bitangents[i2] += bitangent;
+    }
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        Vertex& vertex = vertices[i];
+        const glm::vec3& n = vertex.normal;
+
+        // Gram-Schmidt against the normal
+        glm::vec3 t = tangents[i] - n * glm::dot(n, tangents[i]);
+        if (glm::dot(t, t) < 1e-12f) {
+            vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+            vertex.bitangent = glm::vec3(0.0f, 0.0f, 1.0f);
+            continue;
+        }
+        vertex.tangent = glm::normalize(t);
+
+        float handedness = glm::dot(glm::cross(n, vertex.tangent), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+        vertex.bitangent = glm::cross(n, vertex.tangent) * handedness;
+    }
+}
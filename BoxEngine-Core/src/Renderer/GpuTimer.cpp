@@ -0,0 +1,74 @@
+#include "Renderer/GpuTimer.h"
+#include <glad/glad.h>
+
+GpuTimer::~GpuTimer()
+{
+    release();
+}
+
+void GpuTimer::collect()
+{
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        if (!m_pending[i]) continue;
+
+        // The end stamp lands last, the start one is there once it is
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[i][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(m_queries[i][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(m_queries[i][1], GL_QUERY_RESULT, &end);
+        GLuint64 nanoseconds = end > start ? end - start : 0;
+        m_pending[i] = false;
+
+        // Queries can finish out of order between polls, keep the newest
+        if (m_issued[i] > m_latest) {
+            m_latest = m_issued[i];
+            m_milliseconds = static_cast<double>(nanoseconds) / 1.0e6;
+        }
+    }
+}
+
+void GpuTimer::begin()
+{
+    if (m_queries[0][0] == 0) {
+        glGenQueries(QUERY_COUNT * 2, &m_queries[0][0]);
+    }
+    collect();
+
+    // A free slot, or skip this frame rather than wait for one
+    m_active = -1;
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        if (!m_pending[i]) {
+            m_active = i;
+            break;
+        }
+    }
+    if (m_active < 0) return;
+
+    m_issued[m_active] = ++m_serial;
+    glQueryCounter(m_queries[m_active][0], GL_TIMESTAMP);
+}
+
+void GpuTimer::end()
+{
+    if (m_active < 0) return;
+
+    glQueryCounter(m_queries[m_active][1], GL_TIMESTAMP);
+    m_pending[m_active] = true;
+    m_active = -1;
+}
+
+void GpuTimer::release()
+{
+    if (m_queries[0][0] != 0) {
+        glDeleteQueries(QUERY_COUNT * 2, &m_queries[0][0]);
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            m_queries[i][0] = 0;
+            m_queries[i][1] = 0;
+            m_pending[i] = false;
+        }
+    }
+}
@@ -0,0 +1,333 @@
+#include "Renderer/LightClusters.h"
+#include "Renderer/RenderUtils.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Renderer/Shader.h"
+#include "Utils/Profiler.h"
+#include "Utils/ThreadPool.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+static const int SLICES_PER_JOB = 2;
+
+// Lights sorted into froxels hold a view space copy next to the world space one
+struct ViewLight {
+    glm::vec3 center;   // view space, looking down -z
+    float radius;
+    int firstSlice;
+    int lastSlice;
+};
+
+LightClusters::~LightClusters()
+{
+    release();
+}
+
+// Slice of a positive view depth, log spaced between near and far
+static int depthSlice(float depth, float nearPlane, float farPlane, int slices)
+{
+    if (depth <= nearPlane) return 0;
+    float slice = std::log(depth / nearPlane) / std::log(farPlane / nearPlane) * slices;
+    return std::min(slices - 1, static_cast<int>(slice));
+}
+
+static float sliceDepth(int slice, float nearPlane, float farPlane, int slices)
+{
+    return nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / slices);
+}
+
+void LightClusters::buildFroxels(const glm::mat4& projection)
+{
+    const int tilesX = m_settings.tilesX;
+    const int tilesY = m_settings.tilesY;
+    const int slices = m_settings.slices;
+
+    getPerspectiveClip(projection, m_near, m_far);
+    m_froxelProjection = projection;
+
+    // Tile corners on the near plane, pushed along their rays to each slice depth
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    std::vector<glm::vec3> rays((tilesX + 1) * (tilesY + 1));
+    for (int y = 0; y <= tilesY; y++) {
+        for (int x = 0; x <= tilesX; x++) {
+            glm::vec4 ndc(-1.0f + 2.0f * x / tilesX, -1.0f + 2.0f * y / tilesY, -1.0f, 1.0f);
+            glm::vec4 point = inverseProjection * ndc;
+            glm::vec3 onNear = glm::vec3(point) / point.w;
+            rays[y * (tilesX + 1) + x] = onNear / -onNear.z;   // at depth 1
+        }
+    }
+
+    m_froxels.resize(static_cast<size_t>(tilesX) * tilesY * slices);
+    for (int z = 0; z < slices; z++) {
+        float depths[2] = { sliceDepth(z, m_near, m_far, slices), sliceDepth(z + 1, m_near, m_far, slices) };
+        for (int y = 0; y < tilesY; y++) {
+            for (int x = 0; x < tilesX; x++) {
+                Froxel& froxel = m_froxels[(z * tilesY + y) * tilesX + x];
+                froxel.min = glm::vec3(std::numeric_limits<float>::max());
+                froxel.max = glm::vec3(-std::numeric_limits<float>::max());
+                for (int corner = 0; corner < 8; corner++) {
+                    const glm::vec3& ray = rays[(y + ((corner >> 1) & 1)) * (tilesX + 1) + x + (corner & 1)];
+                    glm::vec3 point = ray * depths[corner >> 2];
+                    froxel.min = glm::min(froxel.min, point);
+                    froxel.max = glm::max(froxel.max, point);
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+    int viewportWidth, int viewportHeight, ThreadPool& pool)
+{
+    PROFILE_SCOPE("LightClusters::update");
+
+    const int tilesX = m_settings.tilesX;
+    const int tilesY = m_settings.tilesY;
+    const int slices = m_settings.slices;
+    const size_t tileCount = static_cast<size_t>(tilesX) * tilesY;
+
+    if (m_froxels.empty() || projection != m_froxelProjection) {
+        buildFroxels(projection);
+    }
+    m_tileSize = glm::vec2(std::max(1, viewportWidth) / static_cast<float>(tilesX),
+        std::max(1, viewportHeight) / static_cast<float>(tilesY));
+
+    // Light data in world space for shading, and the view space spheres for binning
+    m_lightCount = lights.size();
+    m_lightTexels.resize(lights.size() * 2);
+    std::vector<ViewLight> viewLights;
+    viewLights.reserve(lights.size());
+    for (size_t i = 0; i < lights.size(); i++) {
+        const PointLight& light = lights[i];
+        m_lightTexels[i * 2] = glm::vec4(light.position, light.radius);
+        m_lightTexels[i * 2 + 1] = glm::vec4(light.color * light.intensity, 0.0f);
+
+        ViewLight viewLight;
+        viewLight.center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        viewLight.radius = light.radius;
+        float nearest = -viewLight.center.z - light.radius;
+        float farthest = -viewLight.center.z + light.radius;
+        if (farthest <= m_near || nearest >= m_far || light.radius <= 0.0f) {
+            // Behind the camera or past the far plane, listed nowhere
+            viewLight.firstSlice = 1;
+            viewLight.lastSlice = 0;
+        }
+        else {
+            viewLight.firstSlice = depthSlice(nearest, m_near, m_far, slices);
+            viewLight.lastSlice = depthSlice(farthest, m_near, m_far, slices);
+        }
+        viewLights.push_back(viewLight);
+    }
+
+    // Each job owns whole slices, so the lists it writes are its own and come
+    // out in froxel order without any locking
+    m_clusterTexels.resize(static_cast<size_t>(tilesX) * tilesY * slices * 2);
+    m_sliceIndices.resize(slices);
+    const Froxel* froxels = m_froxels.data();
+    const ViewLight* viewLightData = viewLights.data();
+    const size_t viewLightCount = viewLights.size();
+    const glm::mat4 proj = projection;
+    uint32_t* clusterTexels = m_clusterTexels.data();
+    std::vector<uint32_t>* sliceIndices = m_sliceIndices.data();
+    const float nearPlane = m_near;
+    const float farPlane = m_far;
+
+    auto binSlice = [=](int z) {
+        std::vector<uint32_t>& indices = sliceIndices[z];
+        indices.clear();
+
+        float sliceNear = sliceDepth(z, nearPlane, farPlane, slices);
+        float sliceFar = sliceDepth(z + 1, nearPlane, farPlane, slices);
+
+        // Tile range of every light reaching this slice, from the extent of its
+        // box over the slice's depth range. x / depth is monotonic in depth, so
+        // the extremes are at the ends of the range.
+        struct Candidate { uint32_t light; int x0, x1, y0, y1; };
+        std::vector<Candidate> candidates;
+        for (size_t i = 0; i < viewLightCount; i++) {
+            const ViewLight& light = viewLightData[i];
+            if (z < light.firstSlice || z > light.lastSlice) continue;
+
+            float depthNear = std::max(sliceNear, -light.center.z - light.radius);
+            float depthFar = std::min(sliceFar, -light.center.z + light.radius);
+            if (depthNear > depthFar) continue;
+
+            float ndcMin[2] = { 1.0f, 1.0f };
+            float ndcMax[2] = { -1.0f, -1.0f };
+            for (int axis = 0; axis < 2; axis++) {
+                float scale = proj[axis][axis];
+                float offset = -proj[2][axis];  // off-centre frusta, zero for glm::perspective
+                for (float depth : { depthNear, depthFar }) {
+                    for (float value : { light.center[axis] - light.radius, light.center[axis] + light.radius }) {
+                        float ndc = value * scale / depth + offset;
+                        ndcMin[axis] = std::min(ndcMin[axis], ndc);
+                        ndcMax[axis] = std::max(ndcMax[axis], ndc);
+                    }
+                }
+            }
+
+            Candidate candidate;
+            candidate.light = static_cast<uint32_t>(i);
+            candidate.x0 = std::max(0, static_cast<int>(std::floor((ndcMin[0] * 0.5f + 0.5f) * tilesX)));
+            candidate.x1 = std::min(tilesX - 1, static_cast<int>(std::floor((ndcMax[0] * 0.5f + 0.5f) * tilesX)));
+            candidate.y0 = std::max(0, static_cast<int>(std::floor((ndcMin[1] * 0.5f + 0.5f) * tilesY)));
+            candidate.y1 = std::min(tilesY - 1, static_cast<int>(std::floor((ndcMax[1] * 0.5f + 0.5f) * tilesY)));
+            if (candidate.x0 <= candidate.x1 && candidate.y0 <= candidate.y1) {
+                candidates.push_back(candidate);
+            }
+        }
+
+        // Offsets are relative to the slice until the lists are joined
+        for (int y = 0; y < tilesY; y++) {
+            for (int x = 0; x < tilesX; x++) {
+                size_t cluster = (static_cast<size_t>(z) * tilesY + y) * tilesX + x;
+                const Froxel& froxel = froxels[cluster];
+                uint32_t offset = static_cast<uint32_t>(indices.size());
+
+                for (const Candidate& candidate : candidates) {
+                    if (x < candidate.x0 || x > candidate.x1 || y < candidate.y0 || y > candidate.y1) continue;
+
+                    // Sphere against the froxel box trims the corners of the tile range
+                    const ViewLight& light = viewLightData[candidate.light];
+                    glm::vec3 closest = glm::clamp(light.center, froxel.min, froxel.max);
+                    glm::vec3 delta = closest - light.center;
+                    if (glm::dot(delta, delta) <= light.radius * light.radius) {
+                        indices.push_back(candidate.light);
+                    }
+                }
+
+                clusterTexels[cluster * 2] = offset;
+                clusterTexels[cluster * 2 + 1] = static_cast<uint32_t>(indices.size()) - offset;
+            }
+        }
+    };
+
+    {
+        PROFILE_SCOPE("LightClusters::bin");
+        if (lights.empty()) {
+            std::fill(m_clusterTexels.begin(), m_clusterTexels.end(), 0u);
+            for (auto& indices : m_sliceIndices) {
+                indices.clear();
+            }
+        }
+        else {
+            for (int first = 0; first < slices; first += SLICES_PER_JOB) {
+                int last = std::min(slices, first + SLICES_PER_JOB);
+                pool.enqueue([=]() {
+                    for (int z = first; z < last; z++) {
+                        binSlice(z);
+                    }
+                });
+            }
+            pool.waitIdle();
+        }
+    }
+
+    // Join the slice lists and make the offsets absolute. Lists past the
+    // buffer texture limit are cut short rather than read out of range.
+    const size_t maxIndices = getMaxBufferTexels();
+    m_indices.clear();
+    for (int z = 0; z < slices; z++) {
+        uint32_t base = static_cast<uint32_t>(m_indices.size());
+        for (size_t tile = 0; tile < tileCount; tile++) {
+            uint32_t* texel = &m_clusterTexels[(z * tileCount + tile) * 2];
+            texel[0] += base;
+            texel[1] = static_cast<uint32_t>(std::min<size_t>(texel[1], maxIndices - std::min<size_t>(maxIndices, texel[0])));
+        }
+        size_t room = maxIndices - m_indices.size();
+        if (m_sliceIndices[z].size() > room) {
+            std::cerr << "LightClusters: light lists exceed " << maxIndices << " entries, lights are dropped" << std::endl;
+        }
+        m_indices.insert(m_indices.end(), m_sliceIndices[z].begin(),
+            m_sliceIndices[z].begin() + std::min(room, m_sliceIndices[z].size()));
+    }
+
+    // Buffer textures can't be empty, a single zero keeps the samplers valid
+    static const glm::vec4 EMPTY_LIGHT[2] = { glm::vec4(0.0f), glm::vec4(0.0f) };
+    static const uint32_t EMPTY_INDEX = 0;
+    upload(m_lightBuffer, GL_RGBA32F,
+        m_lightTexels.empty() ? static_cast<const void*>(EMPTY_LIGHT) : m_lightTexels.data(),
+        m_lightTexels.empty() ? sizeof(EMPTY_LIGHT) : m_lightTexels.size() * sizeof(glm::vec4), "light data");
+    upload(m_clusterBuffer, GL_RG32UI, m_clusterTexels.data(), m_clusterTexels.size() * sizeof(uint32_t), "light clusters");
+    upload(m_indexBuffer, GL_R32UI,
+        m_indices.empty() ? &EMPTY_INDEX : m_indices.data(),
+        std::max<size_t>(1, m_indices.size()) * sizeof(uint32_t), "light indices");
+}
+
+void LightClusters::upload(TextureBuffer& target, unsigned int format, const void* data, size_t bytes, const char* name)
+{
+    if (target.buffer == 0) {
+        glGenBuffers(1, &target.buffer);
+        glGenTextures(1, &target.texture);
+    }
+
+    // Grown in powers of two and orphaned each frame, like the object buffer
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    if (bytes > target.capacity) {
+        target.capacity = std::max<size_t>(target.capacity, 4096);
+        while (target.capacity < bytes) {
+            target.capacity *= 2;
+        }
+    }
+    glBufferData(GL_TEXTURE_BUFFER, target.capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, target.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    ResourceRegistry::Resource resource;
+    resource.kind = ResourceRegistry::Kind::Buffer;
+    resource.id = target.buffer;
+    resource.category = ResourceCategory::FrameData;
+    resource.name = name;
+    resource.owner = "engine";
+    resource.gpuBytes = target.capacity;
+    ResourceRegistry::get().add(std::move(resource));
+}
+
+void LightClusters::bind() const
+{
+    const TextureBuffer* buffers[3] = { &m_lightBuffer, &m_clusterBuffer, &m_indexBuffer };
+    const unsigned int units[3] = { LIGHT_UNIT, CLUSTER_UNIT, INDEX_UNIT };
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + units[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, buffers[i]->texture);
+        ResourceRegistry::get().touch(ResourceRegistry::Kind::Buffer, buffers[i]->buffer);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void LightClusters::setUniforms(const Shader& shader) const
+{
+    // Variants without lighting inputs drop these, only set what's there
+    auto has = [&](const char* name) { return glGetUniformLocation(shader.GetID(), name) != -1; };
+    if (!has("clusterGrid")) return;
+
+    shader.SetInt("lightData", LIGHT_UNIT);
+    shader.SetInt("clusterGrid", CLUSTER_UNIT);
+    shader.SetInt("lightIndices", INDEX_UNIT);
+    glUniform3i(glGetUniformLocation(shader.GetID(), "clusterCount"),
+        m_settings.tilesX, m_settings.tilesY, m_settings.slices);
+    shader.SetVec2("clusterTileSize", m_tileSize);
+
+    // slice = log(depth) * scale + bias
+    float scale = m_settings.slices / std::log(m_far / m_near);
+    shader.SetVec2("clusterSlice", glm::vec2(scale, -std::log(m_near) * scale));
+    shader.SetVec2("depthRange", glm::vec2(m_near, m_far));
+}
+
+void LightClusters::release()
+{
+    for (TextureBuffer* target : { &m_lightBuffer, &m_clusterBuffer, &m_indexBuffer }) {
+        if (target->buffer != 0) {
+            ResourceRegistry::get().remove(ResourceRegistry::Kind::Buffer, target->buffer);
+            glDeleteTextures(1, &target->texture);
+            glDeleteBuffers(1, &target->buffer);
+            *target = TextureBuffer();
+        }
+    }
+}
@@ -1,4 +1,6 @@
 #include "Renderer/Mesh.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Renderer/TextureArray.h"
 #include <glad/glad.h>
 #include <algorithm>
 #include <limits>
@@ -34,7 +36,8 @@ Mesh::Mesh(const Mesh& other)
     : m_vertices(other.m_vertices), m_indices(other.m_indices),
     m_minBounds(other.m_minBounds), m_maxBounds(other.m_maxBounds),
     m_center(other.m_center), m_boundingSphereRadius(other.m_boundingSphereRadius),
-    m_materialName(other.m_materialName)
+    m_channelMap(other.m_channelMap),
+    m_materialName(other.m_materialName), m_subMeshes(other.m_subMeshes)
 {
     setupBuffers(); // Create new OpenGL buffers ig
 }
@@ -50,6 +53,8 @@ Mesh& Mesh::operator=(const Mesh& other)
         m_center = other.m_center;
         m_boundingSphereRadius = other.m_boundingSphereRadius;
         m_materialName = other.m_materialName;
+        m_subMeshes = other.m_subMeshes;
+        m_channelMap = other.m_channelMap;
         setupBuffers();
     }
     return *this;
@@ -63,7 +68,9 @@ Mesh::Mesh(Mesh&& other) noexcept
     m_maxBounds(other.m_maxBounds),
     m_center(other.m_center),
     m_boundingSphereRadius(other.m_boundingSphereRadius),
+    m_channelMap(other.m_channelMap),
     m_materialName(std::move(other.m_materialName)),
+    m_subMeshes(std::move(other.m_subMeshes)),
     m_VAO(other.m_VAO),
     m_VBO(other.m_VBO),
     m_EBO(other.m_EBO)
@@ -85,6 +92,8 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
         m_center = other.m_center;
         m_boundingSphereRadius = other.m_boundingSphereRadius;
         m_materialName = std::move(other.m_materialName);
+        m_subMeshes = std::move(other.m_subMeshes);
+        m_channelMap = other.m_channelMap;
 
         m_VAO = other.m_VAO;
         m_VBO = other.m_VBO;
@@ -151,6 +160,8 @@ void Mesh::setupBuffers()
 
     // Unbind VAO
     glBindVertexArray(0);
+
+    trackBuffers();
 }
 
 void Mesh::updateBuffers()
@@ -171,6 +182,28 @@ void Mesh::updateBuffers()
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int),
             m_indices.data(), GL_STATIC_DRAW);
     }
+
+    trackBuffers();
+}
+
+void Mesh::trackBuffers()
+{
+    // The vertices and indices stay in RAM next to their GPU copies
+    ResourceRegistry::Resource vertices;
+    vertices.kind = ResourceRegistry::Kind::Buffer;
+    vertices.id = m_VBO;
+    vertices.category = ResourceCategory::VertexBuffer;
+    vertices.gpuBytes = m_vertices.size() * sizeof(Vertex);
+    vertices.cpuBytes = m_vertices.size() * sizeof(Vertex);
+    ResourceRegistry::get().add(std::move(vertices));
+
+    ResourceRegistry::Resource indices;
+    indices.kind = ResourceRegistry::Kind::Buffer;
+    indices.id = m_EBO;
+    indices.category = ResourceCategory::IndexBuffer;
+    indices.gpuBytes = m_indices.size() * sizeof(unsigned int);
+    indices.cpuBytes = m_indices.size() * sizeof(unsigned int);
+    ResourceRegistry::get().add(std::move(indices));
 }
 
 void Mesh::cleanupBuffers()
@@ -180,10 +213,12 @@ void Mesh::cleanupBuffers()
         m_VAO = 0;
     }
     if (m_VBO != 0) {
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Buffer, m_VBO);
         glDeleteBuffers(1, &m_VBO);
         m_VBO = 0;
     }
     if (m_EBO != 0) {
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Buffer, m_EBO);
         glDeleteBuffers(1, &m_EBO);
         m_EBO = 0;
     }
@@ -301,18 +336,205 @@ void Mesh::draw(const Shader& shader)
 {
     if (m_vertices.empty() || m_VAO == 0) return;
 
+    bindMaterial(shader);
+    touchBuffers();
+
+    // Bind VAO
+    glBindVertexArray(m_VAO);
+
+    // Draw based on whether we have indices or not
+    if (!m_indices.empty()) {
+        glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+    }
+    else {
+        // Draw vertices as triangles (assuming they're triangle lists)
+        glDrawArrays(GL_TRIANGLES, 0, m_vertices.size());
+    }
+
+    // Unbind VAO
+    glBindVertexArray(0);
+
+    // Unbind textures
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::drawDepth()
+{
+    if (m_vertices.empty() || m_VAO == 0) return;
+
+    touchBuffers();
+    glBindVertexArray(m_VAO);
+    if (!m_indices.empty()) {
+        glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+    }
+    else {
+        glDrawArrays(GL_TRIANGLES, 0, m_vertices.size());
+    }
+    glBindVertexArray(0);
+}
+
+size_t Mesh::drawSubMeshes(const Shader& shader, const std::vector<bool>& visible)
+{
+    if (m_subMeshes.empty()) {
+        draw(shader);
+        return m_indices.empty() ? m_vertices.size() / 3 : m_indices.size() / 3;
+    }
+
+    bindMaterial(shader);
+    size_t triangles = drawRanges(visible);
+    glActiveTexture(GL_TEXTURE0);
+    return triangles;
+}
+
+size_t Mesh::drawRanges(const std::vector<bool>& visible)
+{
+    if (m_subMeshes.empty()) {
+        drawDepth();
+        return m_indices.empty() ? m_vertices.size() / 3 : m_indices.size() / 3;
+    }
+    if (m_indices.empty() || m_VAO == 0) return 0;
+
+    // Build the list of visible ranges, merging neighbours
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    unsigned int rangeStart = 0;
+    unsigned int rangeEnd = 0;
+    size_t indices = 0;
+
+    for (size_t i = 0; i < m_subMeshes.size(); i++) {
+        if (i < visible.size() && !visible[i]) continue;
+
+        const SubMesh& sub = m_subMeshes[i];
+        indices += sub.indexCount;
+        if (rangeEnd != rangeStart && sub.indexOffset == rangeEnd) {
+            rangeEnd += sub.indexCount;
+            continue;
+        }
+        if (rangeEnd != rangeStart) {
+            counts.push_back(static_cast<GLsizei>(rangeEnd - rangeStart));
+            offsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(rangeStart) * sizeof(unsigned int)));
+        }
+        rangeStart = sub.indexOffset;
+        rangeEnd = sub.indexOffset + sub.indexCount;
+    }
+    if (rangeEnd != rangeStart) {
+        counts.push_back(static_cast<GLsizei>(rangeEnd - rangeStart));
+        offsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(rangeStart) * sizeof(unsigned int)));
+    }
+
+    if (counts.empty()) return 0;
+
+    touchBuffers();
+    glBindVertexArray(m_VAO);
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), static_cast<GLsizei>(counts.size()));
+    glBindVertexArray(0);
+    return indices / 3;
+}
+
+uint32_t Mesh::getShaderFeatures() const
+{
+    uint32_t features = 0;
+    int diffuseTextures = 0;
+
+    for (const auto& texture : m_textures) {
+        bool arrayed = texture->getArray() != nullptr;
+        if (arrayed) {
+            features |= SHADER_FEATURE_TEXTURE_ARRAYS;
+        }
+
+        switch (texture->getType()) {
+        case DIFFUSE:
+        case AMBIENT:
+            features |= SHADER_FEATURE_DIFFUSE;
+            // Only regular textures blend, the array path samples one layer
+            if (!arrayed && ++diffuseTextures == 2) {
+                features |= SHADER_FEATURE_DIFFUSE_BLEND;
+            }
+            break;
+        case PACKED:
+            features |= SHADER_FEATURE_PACKED;
+            break;
+        case NORMAL:
+            // A flat placeholder lights the same as the vertex normal
+            if (!texture->isPlaceholder()) {
+                features |= SHADER_FEATURE_NORMAL_MAP;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return features;
+}
+
+void Mesh::touchBuffers() const
+{
+    ResourceRegistry& registry = ResourceRegistry::get();
+    registry.touch(ResourceRegistry::Kind::Buffer, m_VBO);
+    if (m_EBO != 0) {
+        registry.touch(ResourceRegistry::Kind::Buffer, m_EBO);
+    }
+}
+
+// Array sampler slot per texture type, ambient is treated as diffuse and a
+// lone specular map takes the packed slot it would otherwise be packed into
+static int arraySlot(TextureType type)
+{
+    switch (type) {
+    case SPECULAR:
+    case PACKED: return 1;
+    case NORMAL: return 2;
+    case HEIGHT: return 3;
+    default: return 0;
+    }
+}
+
+static const char* ARRAY_SAMPLERS[4] = {
+    "material.array_diffuse",
+    "material.array_packed",
+    "material.array_normal",
+    "material.array_height"
+};
+
+void Mesh::setArraySamplers(const Shader& shader)
+{
+    // Always their own units, a sampler2DArray left on unit 0 next to a
+    // sampler2D would make the draw invalid
+    for (int slot = 0; slot < 4; slot++) {
+        if (shader.HasUniform(ARRAY_SAMPLERS[slot])) {
+            shader.SetInt(ARRAY_SAMPLERS[slot], ARRAY_TEXTURE_UNIT + slot);
+        }
+    }
+}
+
+void Mesh::bindMaterial(const Shader& shader)
+{
     // Bind textures if available
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
     unsigned int normalNr = 1;
     unsigned int heightNr = 1;
 
+    // Layer of the first arrayed texture of each type, -1 samples the sampler2D
+    GLint layers[4] = { -1, -1, -1, -1 };
+
     for (unsigned int i = 0; i < m_textures.size(); i++) {
+        // Retrieve texture info
+        const auto& texture = m_textures[i];
+
+        // Arrays stay bound across meshes that share them
+        if (texture->getArray()) {
+            int slot = arraySlot(texture->getType());
+            if (layers[slot] < 0) {
+                layers[slot] = texture->getLayer();
+                texture->getArray()->bind(ARRAY_TEXTURE_UNIT + slot);
+            }
+            continue;
+        }
+
         // Activate proper texture unit before binding
         glActiveTexture(GL_TEXTURE0 + i);
 
-        // Retrieve texture info
-        const auto& texture = m_textures[i];
         std::string uniformName;
         std::string number;
 
@@ -338,19 +560,20 @@ void Mesh::draw(const Shader& shader)
             number = std::to_string(diffuseNr++);
             uniformName = "material.texture_diffuse" + number;
             break;
+        case PACKED:
+            uniformName = "material.texture_packed";
+            break;
         }
 
         // Only set the uniform if it exists in the shader
-        int uniformLocation = glGetUniformLocation(shader.GetID(), uniformName.c_str());
-        if (uniformLocation != -1) {
+        if (shader.HasUniform(uniformName)) {
             shader.SetInt(uniformName, i);
             texture->bind(i);
         }
         else {
             // If the specific uniform doesn't exist, try to use texture_diffuse1
             if (texture->getType() == DIFFUSE) {
-                int fallbackLocation = glGetUniformLocation(shader.GetID(), "material.texture_diffuse1");
-                if (fallbackLocation != -1) {
+                if (shader.HasUniform("material.texture_diffuse1")) {
                     shader.SetInt("material.texture_diffuse1", i);
                     texture->bind(i);
                 }
@@ -358,50 +581,42 @@ void Mesh::draw(const Shader& shader)
         }
     }
 
-    // Set material properties
-    int useTexturesLoc = glGetUniformLocation(shader.GetID(), "material.useTextures");
-    if (useTexturesLoc != -1) {
-        shader.SetBool("material.useTextures", !m_textures.empty());
+    // The array samplers' units come from setArraySamplers
+    glVertexAttribI4i(LAYER_ATTRIBUTE, layers[0], layers[1], layers[2], layers[3]);
+
+    // One-hot masks that pick each scalar map out of the packed texel, all
+    // zero makes the shader use its neutral value
+    static const char* CHANNEL_MASKS[static_cast<size_t>(MaterialChannel::Count)] = {
+        "material.occlusionMask",
+        "material.roughnessMask",
+        "material.metallicMask",
+        "material.specularMask",
+        "material.heightMask"
+    };
+    for (size_t i = 0; i < m_channelMap.channels.size(); i++) {
+        if (!shader.HasUniform(CHANNEL_MASKS[i])) continue;
+
+        glm::vec4 mask(0.0f);
+        if (m_channelMap.channels[i] >= 0) {
+            mask[m_channelMap.channels[i]] = 1.0f;
+        }
+        shader.SetVec4(CHANNEL_MASKS[i], mask);
     }
 
-    // Only set material colors if the shader has these uniforms
-    int ambientLoc = glGetUniformLocation(shader.GetID(), "material.ambient");
-    if (ambientLoc != -1) {
+    // Only set material colors if the shader has these uniforms (variants
+    // without HAS_DIFFUSE)
+    if (shader.HasUniform("material.ambient")) {
         shader.SetVec3("material.ambient", m_ambient);
     }
-
-    int diffuseLoc = glGetUniformLocation(shader.GetID(), "material.diffuse");
-    if (diffuseLoc != -1) {
+    if (shader.HasUniform("material.diffuse")) {
         shader.SetVec3("material.diffuse", m_diffuse);
     }
-
-    int specularLoc = glGetUniformLocation(shader.GetID(), "material.specular");
-    if (specularLoc != -1) {
+    if (shader.HasUniform("material.specular")) {
         shader.SetVec3("material.specular", m_specular);
     }
-
-    int shininessLoc = glGetUniformLocation(shader.GetID(), "material.shininess");
-    if (shininessLoc != -1) {
+    if (shader.HasUniform("material.shininess")) {
         shader.SetFloat("material.shininess", m_shininess);
     }
-
-    // Bind VAO
-    glBindVertexArray(m_VAO);
-
-    // Draw based on whether we have indices or not
-    if (!m_indices.empty()) {
-        glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
-    }
-    else {
-        // Draw vertices as triangles (assuming they're triangle lists)
-        glDrawArrays(GL_TRIANGLES, 0, m_vertices.size());
-    }
-
-    // Unbind VAO
-    glBindVertexArray(0);
-
-    // Unbind textures
-    glActiveTexture(GL_TEXTURE0);
 }
 
 void Mesh::transform(const glm::mat4& transform)
@@ -1,9 +1,21 @@
 #include "Renderer/Model.h"
+#include "Renderer/BoxTexFile.h"
+#include "Renderer/GLTFLoader.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Renderer/TextureArray.h"
+#include "Renderer/TextureStreamer.h"
+#include "Utils/Profiler.h"
+#include "Utils/ThreadPool.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <iostream>
 #include <algorithm>
 #include <filesystem>
+#include <limits>
+#include <array>
+#include <map>
+#include <mutex>
+#include <condition_variable>
 
 // Default Assimp flags for game assets
 static const unsigned int DEFAULT_ASSIMP_FLAGS =
@@ -18,38 +30,218 @@ static const unsigned int DEFAULT_ASSIMP_FLAGS =
 
 bool Model::loadFromFile(const std::string& filepath)
 {
+    PROFILE_ASSET(filepath);
+    PROFILE_SCOPE("Model::loadFromFile");
+
+    // glTF is parsed directly, no need to go through assimp's scene graph
+    if (GLTFLoader::canLoad(filepath)) {
+        if (loadGLTF(filepath)) {
+            return true;
+        }
+        std::cerr << "Native glTF load failed, falling back to assimp: " << filepath << std::endl;
+    }
     return loadFromFile(filepath, DEFAULT_ASSIMP_FLAGS);
 }
 
 bool Model::loadFromFile(const std::string& filepath, unsigned int assimpFlags)
 {
+    PROFILE_ASSET(filepath);
+    PROFILE_SCOPE("Model::loadFromFile (assimp)");
+
     Assimp::Importer importer;
     m_filepath = filepath;
 
-    const aiScene* scene = importer.ReadFile(filepath, assimpFlags);
+    const aiScene* scene = importScene(importer, filepath, assimpFlags);
+    if (!scene) {
+        return false;
+    }
+
+    return loadFromScene(scene, filepath);
+}
+
+unsigned int Model::getDefaultAssimpFlags()
+{
+    return DEFAULT_ASSIMP_FLAGS;
+}
+
+const aiScene* Model::importScene(Assimp::Importer& importer, const std::string& filepath, unsigned int assimpFlags)
+{
+    // Parse and post-process separately so the profiler can tell them apart,
+    // this is what ReadFile does internally when given flags
+    Profiler::ScopedTimer parseTimer("assimp::ReadFile");
+    const aiScene* scene = importer.ReadFile(filepath, 0);
+    parseTimer.stop();
+
+    if (scene && assimpFlags != 0) {
+        PROFILE_SCOPE("assimp::ApplyPostProcessing");
+        scene = importer.ApplyPostProcessing(assimpFlags);
+    }
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cerr << "Assimp error: " << importer.GetErrorString() << std::endl;
+        return nullptr;
+    }
+    return scene;
+}
+
+bool Model::loadFromScene(const aiScene* scene, const std::string& filepath)
+{
+    beginLoad(filepath);
+
+    // Process all meshes
+    {
+        PROFILE_SCOPE("Model::processNode");
+        processNode(scene->mRootNode, scene, glm::mat4(1.0f));
+    }
+
+    return finishLoad();
+}
+
+// Packing source for a glTF texture, embedded bytes are read from the loader's mapping
+static ChannelPacker::Source toPackSource(const GLTFLoader::TextureRef& ref, int channel)
+{
+    ChannelPacker::Source source;
+    source.path = ref.path;
+    source.data = ref.data;
+    source.size = ref.size;
+    source.channel = channel;
+    return source;
+}
+
+bool Model::loadGLTF(const std::string& filepath)
+{
+    GLTFLoader loader;
+    Profiler::ScopedTimer parseTimer("GLTFLoader::load");
+    if (!loader.load(filepath)) {
         return false;
     }
+    parseTimer.stop();
+
+    beginLoad(filepath);
+
+    const auto& materials = loader.getMaterials();
+    for (auto& primitive : loader.getPrimitives()) {
+        std::vector<std::shared_ptr<Texture>> textures;
+
+        const GLTFLoader::Material* material = nullptr;
+        if (primitive.material >= 0 && primitive.material < static_cast<int>(materials.size())) {
+            material = &materials[primitive.material];
+        }
+
+        // Scalar maps go into one packed texture, height only stays separate
+        // when the other four already fill it
+        ChannelPacker::Sources sources;
+        if (material) {
+            sources[static_cast<size_t>(MaterialChannel::Occlusion)] = toPackSource(material->occlusion, 0);
+            sources[static_cast<size_t>(MaterialChannel::Roughness)] = toPackSource(material->metallicRoughness, 1);
+            sources[static_cast<size_t>(MaterialChannel::Metallic)] = toPackSource(material->metallicRoughness, 2);
+            sources[static_cast<size_t>(MaterialChannel::Specular)] = toPackSource(material->specular, material->specularChannel);
+            sources[static_cast<size_t>(MaterialChannel::Height)] = toPackSource(material->height, 0);
+        }
+        ChannelMap channels;
+
+        Profiler::ScopedTimer textureTimer("Model::loadMaterialTextures");
+        std::shared_ptr<Texture> packed = loadPackedTexture(sources, channels);
+        bool separateHeight = material && material->height.isValid() && !channels.has(MaterialChannel::Height);
+
+        // Same slots and order as processMesh uses for assimp materials
+        const std::pair<TextureType, const GLTFLoader::TextureRef*> slots[] = {
+            { DIFFUSE,  material ? &material->diffuse : nullptr },
+            { NORMAL,   material ? &material->normal : nullptr },
+            { HEIGHT,   separateHeight ? &material->height : nullptr },
+        };
+
+        for (const auto& slot : slots) {
+            const GLTFLoader::TextureRef* ref = slot.second;
+            std::vector<std::string> paths;
+
+            // No placeholder for a missing height map, the shader doesn't need one
+            if (slot.first == HEIGHT && !ref) {
+                continue;
+            }
+
+            if (ref && ref->isValid() && ref->data) {
+                // Embedded image, decoded straight from the mapped buffer (the
+                // loader outlives finishLoad below)
+                if (!findLoadedTexture(ref->path)) {
+                    queueTexture(ref->path, slot.first, ref->data, ref->size);
+                }
+                paths.push_back(ref->path);
+            }
+            else if (ref && ref->isValid()) {
+                paths.push_back(ref->path);
+            }
+
+            auto loaded = loadTextures(paths, slot.first);
+            textures.insert(textures.end(), loaded.begin(), loaded.end());
+        }
+        if (packed) {
+            textures.push_back(packed);
+        }
+        textureTimer.stop();
+
+        PendingMesh pending;
+        pending.vertices = std::move(primitive.vertices);
+        pending.indices = std::move(primitive.indices);
+        pending.textures = std::move(textures);
+        pending.channels = channels;
+        pending.materialIndex = primitive.material;
+        pending.transform = primitive.transform;
+        m_pendingMeshes.push_back(std::move(pending));
+    }
 
+    return finishLoad();
+}
+
+void Model::beginLoad(const std::string& filepath)
+{
+    m_filepath = filepath;
     m_directory = filepath.substr(0, filepath.find_last_of("/\\"));
     m_meshes.clear();
+    m_pendingMeshes.clear();
+    m_pendingTextures.clear();
     m_totalVertexCount = 0;
     m_totalTriangleCount = 0;
+}
 
-    // Process all meshes
-    processNode(scene->mRootNode, scene);
+bool Model::finishLoad()
+{
+    // Textures decode on the workers while the meshes are built and uploaded here
+    auto textureDecodes = decodePendingTextures();
+
+    // Node transforms are only baked when batching, otherwise meshes keep
+    // their local space like they always have
+    if (m_staticBatching) {
+        PROFILE_SCOPE("Model::batchPendingMeshes");
+        batchPendingMeshes();
+    }
+
+    // Mesh construction uploads vertex and index buffers
+    Profiler::ScopedTimer uploadTimer("Mesh GPU upload");
+    for (auto& pending : m_pendingMeshes) {
+        auto mesh = std::make_shared<Mesh>(std::move(pending.vertices), std::move(pending.indices), std::move(pending.textures));
+        if (pending.subMeshes.size() > 1) {
+            mesh->setSubMeshes(std::move(pending.subMeshes));
+        }
+        mesh->setChannelMap(pending.channels);
+        m_meshes.push_back(mesh);
+        m_totalVertexCount += mesh->getVertices().size();
+        m_totalTriangleCount += mesh->getIndices().size() / 3;
+    }
+    m_pendingMeshes.clear();
+    uploadTimer.stop();
+
+    uploadDecodedTextures(*textureDecodes);
 
     if (m_meshes.empty()) {
-        std::cerr << "Warning: No meshes found in " << filepath << std::endl;
+        std::cerr << "Warning: No meshes found in " << m_filepath << std::endl;
         return false;
     }
 
     // Calculate overall model bounds
     calculateModelBounds();
 #ifndef NDEBUG
-    std::cout << "Loaded model: " << filepath
+    std::cout << "Loaded model: " << m_filepath
         << "\n  Meshes: " << m_meshes.size()
         << "\n  Vertices: " << m_totalVertexCount
         << "\n  Triangles: " << m_totalTriangleCount
@@ -62,30 +254,44 @@ bool Model::loadFromFile(const std::string& filepath, unsigned int assimpFlags)
     return true;
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+// assimp matrices are row-major, glm is column-major
+static glm::mat4 toGlm(const aiMatrix4x4& m)
+{
+    return glm::mat4(
+        m.a1, m.b1, m.c1, m.d1,
+        m.a2, m.b2, m.c2, m.d2,
+        m.a3, m.b3, m.c3, m.d3,
+        m.a4, m.b4, m.c4, m.d4);
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform)
 {
+    glm::mat4 transform = parentTransform * toGlm(node->mTransformation);
+
     // Process all the node's meshes
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        auto processedMesh = processMesh(mesh, scene);
-        if (processedMesh) {
-            m_meshes.push_back(processedMesh);
-            m_totalVertexCount += processedMesh->getVertices().size();
-            m_totalTriangleCount += processedMesh->getIndices().size() / 3;
-        }
+        PendingMesh pending;
+        processMesh(mesh, scene, pending);
+        pending.transform = transform;
+        m_pendingMeshes.push_back(std::move(pending));
     }
 
     // Process children
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, transform);
     }
 }
 
-std::shared_ptr<Mesh> Model::processMesh(aiMesh* mesh, const aiScene* scene)
+void Model::processMesh(aiMesh* mesh, const aiScene* scene, PendingMesh& out)
 {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<std::shared_ptr<Texture>> textures;
+    std::vector<Vertex>& vertices = out.vertices;
+    std::vector<unsigned int>& indices = out.indices;
+    std::vector<std::shared_ptr<Texture>>& textures = out.textures;
+    out.materialIndex = static_cast<int>(mesh->mMaterialIndex);
+
+    // Vertex conversion only, texture loading is timed on its own
+    Profiler::ScopedTimer convertTimer("Model::processMesh");
 
     // Pre-allocate memory for efficiency
     vertices.reserve(mesh->mNumVertices);
@@ -153,6 +359,7 @@ std::shared_ptr<Mesh> Model::processMesh(aiMesh* mesh, const aiScene* scene)
             indices.push_back(face.mIndices[j]);
         }
     }
+    convertTimer.stop();
 
     // Process material/textures
     if (mesh->mMaterialIndex >= 0) {
@@ -163,25 +370,93 @@ std::shared_ptr<Mesh> Model::processMesh(aiMesh* mesh, const aiScene* scene)
             material, aiTextureType_DIFFUSE, DIFFUSE);
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 
-        // Load specular textures
-        std::vector<std::shared_ptr<Texture>> specularMaps = loadMaterialTextures(
-            material, aiTextureType_SPECULAR, SPECULAR);
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-
         // Load normal maps
         std::vector<std::shared_ptr<Texture>> normalMaps = loadMaterialTextures(
             material, aiTextureType_NORMALS, NORMAL);
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 
-        // Load height maps
-        std::vector<std::shared_ptr<Texture>> heightMaps = loadMaterialTextures(
-            material, aiTextureType_HEIGHT, HEIGHT);
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        // Scalar maps are packed, assimp reports glTF metallicRoughness as both
+        // metalness (blue) and roughness (green); other formats use grey images
+        ChannelPacker::Sources sources;
+        sources[static_cast<size_t>(MaterialChannel::Occlusion)] = findPackSource(material, aiTextureType_AMBIENT_OCCLUSION, 0);
+        sources[static_cast<size_t>(MaterialChannel::Roughness)] = findPackSource(material, aiTextureType_DIFFUSE_ROUGHNESS, 1);
+        sources[static_cast<size_t>(MaterialChannel::Metallic)] = findPackSource(material, aiTextureType_METALNESS, 2);
+        sources[static_cast<size_t>(MaterialChannel::Specular)] = findPackSource(material, aiTextureType_SPECULAR, 0);
+        sources[static_cast<size_t>(MaterialChannel::Height)] = findPackSource(material, aiTextureType_HEIGHT, 0);
+
+        if (auto packed = loadPackedTexture(sources, out.channels)) {
+            textures.push_back(packed);
+        }
+
+        // Height that didn't fit keeps its own texture
+        if (sources[static_cast<size_t>(MaterialChannel::Height)].isValid() && !out.channels.has(MaterialChannel::Height)) {
+            std::vector<std::shared_ptr<Texture>> heightMaps = loadMaterialTextures(
+                material, aiTextureType_HEIGHT, HEIGHT);
+            textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        }
+    }
+
+}
+
+void Model::batchPendingMeshes()
+{
+    std::vector<PendingMesh> batches;
+    std::unordered_map<int, size_t> batchForMaterial;
+
+    for (auto& part : m_pendingMeshes) {
+        if (part.vertices.empty()) continue;
+
+        // Bake the node transform, same math as Mesh::transform
+        glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(part.transform)));
+        for (auto& vertex : part.vertices) {
+            vertex.position = glm::vec3(part.transform * glm::vec4(vertex.position, 1.0f));
+            vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+            vertex.tangent = glm::normalize(normalMatrix * vertex.tangent);
+            vertex.bitangent = glm::normalize(normalMatrix * vertex.bitangent);
+        }
+
+        // Mirroring transforms flip the winding order
+        if (glm::determinant(glm::mat3(part.transform)) < 0.0f) {
+            for (size_t i = 0; i + 2 < part.indices.size(); i += 3) {
+                std::swap(part.indices[i + 1], part.indices[i + 2]);
+            }
+        }
+
+        // Materials keep the order they first appear in
+        auto found = batchForMaterial.find(part.materialIndex);
+        if (found == batchForMaterial.end()) {
+            found = batchForMaterial.emplace(part.materialIndex, batches.size()).first;
+            batches.emplace_back();
+            batches.back().materialIndex = part.materialIndex;
+            batches.back().textures = part.textures;
+            batches.back().channels = part.channels;
+        }
+        PendingMesh& batch = batches[found->second];
+
+        Mesh::SubMesh sub;
+        sub.indexOffset = static_cast<unsigned int>(batch.indices.size());
+        sub.indexCount = static_cast<unsigned int>(part.indices.size());
+        sub.minBounds = glm::vec3(std::numeric_limits<float>::max());
+        sub.maxBounds = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const auto& vertex : part.vertices) {
+            sub.minBounds = glm::min(sub.minBounds, vertex.position);
+            sub.maxBounds = glm::max(sub.maxBounds, vertex.position);
+        }
+        batch.subMeshes.push_back(sub);
+
+        unsigned int baseVertex = static_cast<unsigned int>(batch.vertices.size());
+        batch.indices.reserve(batch.indices.size() + part.indices.size());
+        for (unsigned int index : part.indices) {
+            batch.indices.push_back(baseVertex + index);
+        }
+        batch.vertices.insert(batch.vertices.end(), part.vertices.begin(), part.vertices.end());
     }
 
-    // Create and return mesh
-    auto result = std::make_shared<Mesh>(std::move(vertices), std::move(indices), std::move(textures));
-    return result;
+#ifndef NDEBUG
+    std::cout << "Static batching: " << m_pendingMeshes.size() << " meshes merged into "
+        << batches.size() << " batches" << std::endl;
+#endif
+    m_pendingMeshes = std::move(batches);
 }
 
 void Model::calculateModelBounds()
@@ -232,7 +507,9 @@ std::vector<std::shared_ptr<Texture>> Model::loadMaterialTextures(
     aiTextureType aiType,
     TextureType textureType)
 {
-    std::vector<std::shared_ptr<Texture>> textures;
+    PROFILE_SCOPE("Model::loadMaterialTextures");
+
+    std::vector<std::string> paths;
 
     unsigned int textureCount = mat->GetTextureCount(aiType);
 
@@ -253,87 +530,477 @@ std::vector<std::shared_ptr<Texture>> Model::loadMaterialTextures(
 #ifndef NDEBUG
         std::cout << "Found texture: " << texturePath << std::endl;
 #endif
-        // Try different path strategies
-        std::string fullPath;
+        paths.push_back(resolveTexturePath(texturePath));
+    }
+
+    return loadTextures(paths, textureType);
+}
+
+std::string Model::resolveTexturePath(const std::string& texturePath) const
+{
+    // Strategy 1: Check if it's an absolute path
+    if (texturePath.find(':') != std::string::npos ||
+        texturePath[0] == '/' || texturePath[0] == '\\') {
+        return texturePath;
+    }
+
+    // Strategy 2: Relative to model directory
+    std::string fullPath = m_directory + "/" + texturePath;
+
+    // Try with just the filename if the above doesn't work
+    if (!std::filesystem::exists(fullPath)) {
+        std::filesystem::path p(texturePath);
+        fullPath = m_directory + "/" + p.filename().string();
+    }
+    return fullPath;
+}
 
-        // Strategy 1: Check if it's an absolute path
-        if (texturePath.find(':') != std::string::npos ||
-            texturePath[0] == '/' || texturePath[0] == '\\') {
-            fullPath = texturePath;
+ChannelPacker::Source Model::findPackSource(aiMaterial* material, aiTextureType type, int channel) const
+{
+    ChannelPacker::Source source;
+    aiString path;
+    if (material->GetTextureCount(type) > 0 && material->GetTexture(type, 0, &path) == AI_SUCCESS && path.length > 0) {
+        source.path = resolveTexturePath(path.C_Str());
+        source.channel = channel;
+    }
+    return source;
+}
+
+std::shared_ptr<Texture> Model::loadPackedTexture(const ChannelPacker::Sources& sources, ChannelMap& channels)
+{
+    channels = ChannelPacker::layout(sources);
+    if (channels.isEmpty()) {
+        return nullptr;
+    }
+
+    // Materials sharing the same maps share the packed texture too
+    std::string name = ChannelPacker::getName(sources, channels);
+    if (auto texture = findLoadedTexture(name)) {
+        return texture;
+    }
+
+    auto texture = queueTexture(name, PACKED);
+    m_pendingTextures.back().pack = sources;
+    m_pendingTextures.back().channels = channels;
+    return texture;
+}
+
+std::shared_ptr<Texture> Model::findLoadedTexture(const std::string& path) const
+{
+    for (const auto& tex : m_loadedTextures) {
+        if (tex->getPath() == path) {
+            return tex;
         }
-        // Strategy 2: Relative to model directory
-        else {
-            fullPath = m_directory + "/" + texturePath;
+    }
+
+    // Queued textures get their path when they are uploaded
+    for (const auto& pending : m_pendingTextures) {
+        if (pending.path == path) {
+            return pending.texture;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Texture> Model::queueTexture(const std::string& path, TextureType type,
+    const unsigned char* data, size_t size)
+{
+    auto texture = std::make_shared<Texture>();
+    m_loadedTextures.push_back(texture);
+    PendingTexture pending;
+    pending.texture = texture;
+    pending.path = path;
+    pending.type = type;
+    pending.data = data;
+    pending.size = size;
+    m_pendingTextures.push_back(std::move(pending));
+    return texture;
+}
+
+// Fallback images for files that fail to load
+static const char* fallbackTexturePath(TextureType type)
+{
+    switch (type) {
+    case DIFFUSE:  return "textures/default_diffuse.jpg";
+    case SPECULAR: return "textures/default_specular.jpg";
+    case NORMAL:   return "textures/default_normal.jpg";
+    default:       return "textures/default.jpg";
+    }
+}
+
+// Small flat image used when a material has no texture for a slot
+static Texture::Image createDefaultImage(TextureType type)
+{
+    glm::vec3 color;
+
+    // Choose color based on texture type
+    switch (type) {
+    case DIFFUSE:
+        color = glm::vec3(0.8f, 0.8f, 0.8f); // Gray
+        break;
+    case SPECULAR:
+        color = glm::vec3(0.5f, 0.5f, 0.5f); // Dark gray
+        break;
+    case NORMAL:
+        color = glm::vec3(0.5f, 0.5f, 1.0f); // Blueish (normal map default)
+        break;
+    default:
+        color = glm::vec3(1.0f, 0.0f, 1.0f); // Magenta (error color)
+    }
+
+    // Create a small procedural texture (4x4 pixels)
+    Texture::Image image;
+    image.width = 4;
+    image.height = 4;
+    image.channels = 3;
+    image.pixels.resize(image.width * image.height * image.channels);
+    for (size_t i = 0; i < image.pixels.size(); i += 3) {
+        image.pixels[i] = static_cast<unsigned char>(color.r * 255);
+        image.pixels[i + 1] = static_cast<unsigned char>(color.g * 255);
+        image.pixels[i + 2] = static_cast<unsigned char>(color.b * 255);
+    }
+    return image;
+}
+
+// Pre-compressed copy of a source image, either the path itself or a .ktx2/.dds
+// next to it with the same name (written by TextureTool)
+static std::string findCompressedVariant(const std::string& path)
+{
+    if (BoxTexFile::canLoad(path) || CompressedImage::canLoad(path)) {
+        return path;
+    }
+
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    std::string stem = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? path : path.substr(0, dot);
+
+    // TextureTool's own cache first, it carries offline filtered mips
+    for (const char* extension : { ".boxtex", ".ktx2", ".dds" }) {
+        std::error_code error;
+        if (std::filesystem::exists(stem + extension, error)) {
+            return stem + extension;
+        }
+    }
+    return std::string();
+}
+
+struct Model::TextureDecodes
+{
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<size_t> ready;              // indices into m_pendingTextures, in completion order
+    std::vector<Texture::Image> images;
+    std::vector<CompressedImage> compressed;
+    std::vector<std::shared_ptr<BoxTexFile>> cached;  // mapped .boxtex, uploaded straight from the mapping
+    std::vector<bool> decoded;
+};
+
+std::shared_ptr<Model::TextureDecodes> Model::decodePendingTextures()
+{
+    auto decodes = std::make_shared<TextureDecodes>();
+    decodes->images.resize(m_pendingTextures.size());
+    decodes->compressed.resize(m_pendingTextures.size());
+    decodes->cached.resize(m_pendingTextures.size());
+    decodes->decoded.resize(m_pendingTextures.size(), false);
+
+    // Asked here, extension queries need the GL context
+    std::array<bool, 6> blockSupport = {};
+    if (!m_pendingTextures.empty()) {
+        for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 }) {
+            blockSupport[static_cast<size_t>(format)] = Texture::isFormatSupported(format);
+        }
+    }
+
+    for (size_t i = 0; i < m_pendingTextures.size(); i++) {
+        const PendingTexture& pending = m_pendingTextures[i];
+        std::string path = pending.path;
+        TextureType type = pending.type;
+        const unsigned char* data = pending.data;
+        size_t size = pending.size;
+        std::string asset = m_filepath;
+        bool keepSource = m_textureArrays || m_textureStreaming;
+        ChannelPacker::Sources pack = pending.pack;
+        ChannelMap channels = pending.channels;
+
+        // Decode, channel conversion, flip and mips all happen on the worker
+        ThreadPool::get().enqueue([decodes, i, path, type, data, size, asset, blockSupport, keepSource, pack, channels]() {
+            PROFILE_ASSET(asset);
+
+            // The loading thread waits for every index, a throwing decode still reports one
+            try {
+                // Packed textures are built from their sources, there is no file to
+                // look for variants of. Failed maps read as neutral values.
+                if (type == PACKED) {
+                    Texture::Image image;
+                    ChannelPacker::pack(pack, channels, image);
+                    Texture::generateMips(image);
+
+                    std::lock_guard<std::mutex> lock(decodes->mutex);
+                    decodes->images[i] = std::move(image);
+                    decodes->decoded[i] = true;
+                    decodes->ready.push_back(i);
+                    decodes->finished.notify_one();
+                    return;
+                }
+
+                // Block compressed files skip decoding entirely, falling back to
+                // the source image when the GPU can't sample the format
+                if (!data) {
+                    std::string variant = findCompressedVariant(path);
+
+                    // .boxtex is mapped and paged in here, arrays and streaming
+                    // keep their own copy of the levels
+                    if (!variant.empty() && BoxTexFile::canLoad(variant)) {
+                        auto file = std::make_shared<BoxTexFile>();
+                        if (file->open(variant) &&
+                            (file->getBlockFormat() == BlockFormat::None || blockSupport[static_cast<size_t>(file->getBlockFormat())])) {
+                            file->prefetch();
+
+                            Texture::Image image;
+                            CompressedImage compressed;
+                            if (keepSource) {
+                                if (file->getBlockFormat() != BlockFormat::None) {
+                                    file->toCompressed(compressed);
+                                }
+                                else {
+                                    file->toImage(image);
+                                }
+                                file.reset();
+                            }
+
+                            std::lock_guard<std::mutex> lock(decodes->mutex);
+                            decodes->images[i] = std::move(image);
+                            decodes->compressed[i] = std::move(compressed);
+                            decodes->cached[i] = std::move(file);
+                            decodes->decoded[i] = true;
+                            decodes->ready.push_back(i);
+                            decodes->finished.notify_one();
+                            return;
+                        }
+                    }
+
+                    CompressedImage compressed;
+                    if (!variant.empty() && CompressedImage::load(variant, compressed) &&
+                        blockSupport[static_cast<size_t>(compressed.format)]) {
+                        std::lock_guard<std::mutex> lock(decodes->mutex);
+                        decodes->compressed[i] = std::move(compressed);
+                        decodes->decoded[i] = true;
+                        decodes->ready.push_back(i);
+                        decodes->finished.notify_one();
+                        return;
+                    }
+                }
+
+                Texture::Image image;
+                bool ok = data
+                    ? Texture::decodeMemory(data, size, type, image)
+                    : Texture::decodeFile(path, type, image);
+                if (!ok && !data) {
+                    ok = Texture::decodeFile(fallbackTexturePath(type), type, image);
+                }
+                if (ok) {
+                    Texture::generateMips(image);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(decodes->mutex);
+                    decodes->images[i] = std::move(image);
+                    decodes->decoded[i] = ok;
+                    decodes->ready.push_back(i);
+                }
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Failed to decode texture " << path << ": " << e.what() << std::endl;
+                std::lock_guard<std::mutex> lock(decodes->mutex);
+                decodes->decoded[i] = false;
+                decodes->ready.push_back(i);
+            }
+            decodes->finished.notify_one();
+        });
+    }
 
-            // Try with just the filename if the above doesn't work
-            if (!std::filesystem::exists(fullPath)) {
-                std::filesystem::path p(texturePath);
-                fullPath = m_directory + "/" + p.filename().string();
+    return decodes;
+}
+
+void Model::uploadDecodedTextures(TextureDecodes& decodes)
+{
+    PROFILE_SCOPE("Model::uploadDecodedTextures");
+
+    // With texture arrays on, everything is held until the last decode so
+    // textures can be grouped by format
+    std::vector<Texture::Image> arrayImages;
+    std::vector<CompressedImage> arrayCompressed;
+    if (m_textureArrays) {
+        arrayImages.resize(m_pendingTextures.size());
+        arrayCompressed.resize(m_pendingTextures.size());
+    }
+
+    // Streaming textures keep their source and upload only mips up to this size
+    const int residentSize = TextureStreamer::get().getSettings().residentSize;
+
+    size_t uploaded = 0;
+    while (uploaded < m_pendingTextures.size()) {
+        std::vector<size_t> ready;
+        std::vector<Texture::Image> images;
+        std::vector<CompressedImage> compressed;
+        std::vector<std::shared_ptr<BoxTexFile>> cached;
+        std::vector<bool> decoded;
+        {
+            std::unique_lock<std::mutex> lock(decodes.mutex);
+            decodes.finished.wait(lock, [&] { return !decodes.ready.empty(); });
+            ready.swap(decodes.ready);
+            for (size_t index : ready) {
+                images.push_back(std::move(decodes.images[index]));
+                compressed.push_back(std::move(decodes.compressed[index]));
+                cached.push_back(std::move(decodes.cached[index]));
+                decoded.push_back(decodes.decoded[index]);
             }
         }
+
+        // Upload in completion order so GL work overlaps the remaining decodes
+        for (size_t i = 0; i < ready.size(); i++) {
+            const PendingTexture& pending = m_pendingTextures[ready[i]];
+            const Texture::Image& image = images[i];
+
+            if (cached[i]) {
 #ifndef NDEBUG
-        std::cout << "Trying to load texture from: " << fullPath << std::endl;
+                std::cout << "Loaded cached texture: " << pending.path
+                    << " (" << cached[i]->getWidth() << "x" << cached[i]->getHeight()
+                    << ", levels: " << cached[i]->getLevels().size() << ")" << std::endl;
 #endif
-        // Check if texture was already loaded
-        bool skip = false;
-        for (const auto& tex : m_loadedTextures) {
-            if (tex->getPath() == fullPath) {
+                if (!pending.texture->loadFromBoxTex(*cached[i], pending.path, pending.type)) {
+                    pending.texture->loadFromImage(createDefaultImage(pending.type), pending.path, pending.type);
+                }
+            }
+            else if (m_textureArrays && (compressed[i].isValid() || decoded[i])) {
+                arrayImages[ready[i]] = std::move(images[i]);
+                arrayCompressed[ready[i]] = std::move(compressed[i]);
+            }
+            else if (compressed[i].isValid()) {
 #ifndef NDEBUG
-                std::cout << "Texture already loaded, reusing: " << fullPath << std::endl;
+                std::cout << "Loaded compressed texture: " << pending.path
+                    << " (" << compressed[i].width << "x" << compressed[i].height
+                    << ", levels: " << compressed[i].levels.size() << ")" << std::endl;
 #endif
-                textures.push_back(tex);
-                skip = true;
-                break;
+                if (m_textureStreaming) {
+                    pending.texture->loadStreaming(std::move(compressed[i]), pending.path, pending.type, residentSize);
+                }
+                else {
+                    pending.texture->loadFromCompressed(compressed[i], pending.path, pending.type);
+                }
             }
+            else if (decoded[i]) {
+#ifndef NDEBUG
+                std::cout << "Loaded texture: " << pending.path
+                    << " (" << image.width << "x" << image.height
+                    << ", channels: " << image.channels << ")" << std::endl;
+#endif
+                if (m_textureStreaming) {
+                    pending.texture->loadStreaming(std::move(images[i]), pending.path, pending.type, residentSize);
+                }
+                else {
+                    pending.texture->loadFromImage(image, pending.path, pending.type);
+                }
+            }
+            else {
+                // Keep the slot filled so meshes don't sample whatever is bound
+                std::cerr << "Failed to load texture: " << pending.path << std::endl;
+                pending.texture->loadFromImage(createDefaultImage(pending.type), pending.path, pending.type);
+            }
+            uploaded++;
         }
+    }
 
-        if (!skip) {
-            try {
-                // Load new texture
-                auto texture = std::make_shared<Texture>();
+    if (m_textureArrays) {
+        uploadTextureArrays(arrayImages, arrayCompressed);
+    }
+
+    m_pendingTextures.clear();
+}
+
+void Model::uploadTextureArrays(std::vector<Texture::Image>& images, std::vector<CompressedImage>& compressed)
+{
+    PROFILE_SCOPE("Model::uploadTextureArrays");
+
+    std::map<TextureArray::Format, std::vector<size_t>> groups;
+    for (size_t i = 0; i < m_pendingTextures.size(); i++) {
+        if (compressed[i].isValid()) {
+            groups[TextureArray::getFormat(compressed[i])].push_back(i);
+        }
+        else if (images[i].isValid()) {
+            groups[TextureArray::getFormat(images[i])].push_back(i);
+        }
+    }
+
+    const size_t maxLayers = static_cast<size_t>(TextureArray::getMaxLayers());
+    size_t arrayCount = 0;
+    size_t layerCount = 0;
+
+    for (const auto& group : groups) {
+        const TextureArray::Format& format = group.first;
+        const std::vector<size_t>& members = group.second;
+
+        // A lone texture gains nothing from an array
+        if (members.size() == 1) {
+            const PendingTexture& pending = m_pendingTextures[members[0]];
+            if (compressed[members[0]].isValid()) {
+                pending.texture->loadFromCompressed(compressed[members[0]], pending.path, pending.type);
+            }
+            else {
+                pending.texture->loadFromImage(images[members[0]], pending.path, pending.type);
+            }
+            continue;
+        }
+
+        for (size_t first = 0; first < members.size(); first += maxLayers) {
+            size_t count = std::min(maxLayers, members.size() - first);
+            auto array = std::make_shared<TextureArray>(format, static_cast<int>(count));
+
+            for (size_t j = first; j < first + count; j++) {
+                size_t index = members[j];
+                const PendingTexture& pending = m_pendingTextures[index];
+                int layer = compressed[index].isValid()
+                    ? array->addLayer(compressed[index])
+                    : array->addLayer(images[index]);
+                pending.texture->setArrayLayer(array, layer, format.width, format.height, pending.path, pending.type);
+
+                // Free each image as soon as it is on the GPU
+                images[index] = Texture::Image();
+                compressed[index] = CompressedImage();
+            }
+
+            arrayCount++;
+            layerCount += count;
+        }
+    }
 
-                // Special handling for different texture types
-                if (texture->loadFromFile(fullPath, textureType)) {
 #ifndef NDEBUG
-                    std::cout << "Successfully loaded texture: " << fullPath << std::endl;
+    std::cout << "Texture arrays: " << layerCount << " textures in " << arrayCount << " arrays, "
+        << m_pendingTextures.size() - layerCount << " standalone" << std::endl;
 #endif
-                    textures.push_back(texture);
-                    m_loadedTextures.push_back(texture);
-                }
-                else {
-                    std::cerr << "Failed to load texture: " << fullPath << std::endl;
-
-                    // Try to load a fallback texture
-                    std::string fallbackPath;
-
-                    // Different fallbacks based on texture type
-                    switch (textureType) {
-                    case DIFFUSE:
-                        fallbackPath = "textures/default_diffuse.jpg";
-                        break;
-                    case SPECULAR:
-                        fallbackPath = "textures/default_specular.jpg";
-                        break;
-                    case NORMAL:
-                        fallbackPath = "textures/default_normal.jpg";
-                        break;
-                    default:
-                        fallbackPath = "textures/default.jpg";
-                    }
+}
 
-                    if (texture->loadFromFile(fallbackPath, textureType)) {
+std::vector<std::shared_ptr<Texture>> Model::loadTextures(
+    const std::vector<std::string>& paths,
+    TextureType textureType)
+{
+    std::vector<std::shared_ptr<Texture>> textures;
+
+    for (const auto& fullPath : paths) {
 #ifndef NDEBUG
-                        std::cout << "Using fallback texture: " << fallbackPath << std::endl;
+        std::cout << "Trying to load texture from: " << fullPath << std::endl;
 #endif
-                        textures.push_back(texture);
-                        m_loadedTextures.push_back(texture);
-                    }
-                }
-            }
-            catch (const std::exception& e) {
-                std::cerr << "Exception loading texture: " << e.what() << std::endl;
-            }
+        // Check if texture was already loaded
+        if (auto tex = findLoadedTexture(fullPath)) {
+#ifndef NDEBUG
+            std::cout << "Texture already loaded, reusing: " << fullPath << std::endl;
+#endif
+            textures.push_back(tex);
+            continue;
         }
+
+        // Decoded in parallel once the whole model has been walked
+        textures.push_back(queueTexture(fullPath, textureType));
     }
 
     // If no textures were found for this type, create a default one
@@ -359,36 +1026,10 @@ std::shared_ptr<Texture> Model::createDefaultTexture(TextureType type)
 {
     auto texture = std::make_shared<Texture>();
 
-    // Create a small procedural texture (4x4 pixels)
-    const int width = 4;
-    const int height = 4;
-    unsigned char data[width * height * 3]; // RGB
-
-    glm::vec3 color;
-
-    // Choose color based on texture type
-    switch (type) {
-    case DIFFUSE:
-        color = glm::vec3(0.8f, 0.8f, 0.8f); // Gray
-        break;
-    case SPECULAR:
-        color = glm::vec3(0.5f, 0.5f, 0.5f); // Dark gray
-        break;
-    case NORMAL:
-        color = glm::vec3(0.5f, 0.5f, 1.0f); // Blueish (normal map default)
-        break;
-    default:
-        color = glm::vec3(1.0f, 0.0f, 1.0f); // Magenta (error color)
-    }
-
-    // Fill the texture data
-    for (int i = 0; i < width * height * 3; i += 3) {
-        data[i] = static_cast<unsigned char>(color.r * 255);
-        data[i + 1] = static_cast<unsigned char>(color.g * 255);
-        data[i + 2] = static_cast<unsigned char>(color.b * 255);
-    }
-
-    if (texture->loadFromData(data, width, height, type)) {
+    if (texture->loadFromImage(createDefaultImage(type), "procedural", type)) {
+        texture->setPlaceholder(true);
+        ResourceRegistry::get().setCategory(ResourceRegistry::Kind::Texture, texture->getID(),
+            ResourceCategory::DefaultTexture);
 #ifndef NDEBUG
         std::cout << "Created default procedural texture for type: " << type << std::endl;
 #endif
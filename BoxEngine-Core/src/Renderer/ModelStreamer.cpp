@@ -0,0 +1,711 @@
+#include "Renderer/ModelStreamer.h"
+#include "Renderer/GLTFLoader.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Utils/Profiler.h"
+#include <assimp/Importer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+// Parts without bounds in the file go first, they are needed to know where they are
+static const float UNKNOWN_BOUNDS_PRIORITY = std::numeric_limits<float>::max();
+
+struct ModelStreamer::Stream
+{
+    enum class State { Queued, Loading, Ready, Done, Failed };
+
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+
+    // One glTF primitive
+    struct Part {
+        size_t primitive = 0;
+        glm::vec3 center = glm::vec3(0.0f);    // local space, same space the mesh is drawn in
+        float radius = 0.0f;
+        bool hasBounds = false;
+
+        std::vector<std::shared_ptr<Texture>> textures;   // mesh textures in slot order
+        std::vector<size_t> streamedTextures;             // indices into Stream::textures
+        ChannelMap channels;                              // layout of the packed texture
+
+        State state = State::Queued;
+        float priority = 0.0f;
+        int meshSlot = -1;  // index in the model's meshes once something was uploaded
+
+        MeshData coarse;    // uploaded first when present
+        MeshData full;
+    };
+
+    // One image, shared by every part whose material references it
+    struct StreamedTexture {
+        GLTFLoader::TextureRef ref;
+        TextureType type = DIFFUSE;
+        std::shared_ptr<Texture> texture;   // starts out as the default texture
+        ChannelPacker::Sources pack;        // PACKED textures are built from these
+        ChannelMap channels;
+
+        State state = State::Queued;
+        float priority = 0.0f;
+
+        Texture::Image preview;
+        Texture::Image full;
+    };
+
+    // Filled by the workers. Jobs only hold this and the loader, never the
+    // model, so GL objects are always released on the main thread.
+    struct Inbox {
+        struct MeshResult {
+            size_t part = 0;
+            bool ok = false;
+            MeshData coarse;
+            MeshData full;
+        };
+        struct TextureResult {
+            size_t texture = 0;
+            bool ok = false;
+            Texture::Image preview;
+            Texture::Image full;
+        };
+
+        std::mutex mutex;
+        std::vector<MeshResult> meshes;
+        std::vector<TextureResult> textures;
+
+        // assimp fallback
+        std::unique_ptr<Assimp::Importer> importer;
+        const aiScene* scene = nullptr;
+        bool importDone = false;
+    };
+
+    std::shared_ptr<Model> model;
+    std::string filepath;
+    glm::mat4 transform = glm::mat4(1.0f);
+
+    std::shared_ptr<GLTFLoader> loader;
+    std::shared_ptr<Inbox> inbox;
+    bool importing = false;
+
+    std::vector<Part> parts;
+    std::vector<StreamedTexture> textures;
+    size_t remaining = 0;   // parts and textures not yet done or failed
+    size_t loading = 0;     // jobs on the workers
+
+    Clock::time_point started;
+    double firstMeshMs = -1.0;
+};
+
+// Vertex clustering: snap vertices to a grid, merge each cell into one vertex
+// and drop the triangles that collapse. Cheap enough to run on every large
+// mesh and good enough for something that is replaced a moment later.
+static bool buildCoarseLOD(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    int gridSize, std::vector<Vertex>& outVertices, std::vector<unsigned int>& outIndices)
+{
+    PROFILE_SCOPE("ModelStreamer::buildCoarseLOD");
+
+    glm::vec3 minBounds(std::numeric_limits<float>::max());
+    glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : vertices) {
+        minBounds = glm::min(minBounds, vertex.position);
+        maxBounds = glm::max(maxBounds, vertex.position);
+    }
+
+    glm::vec3 extent = maxBounds - minBounds;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    if (longest <= 0.0f || gridSize <= 0) return false;
+
+    const float cellSize = longest / static_cast<float>(gridSize);
+    const uint64_t maxCell = (1u << 21) - 1;
+    auto cellOf = [&](float value, float origin) {
+        uint64_t cell = static_cast<uint64_t>(std::max(0.0f, (value - origin) / cellSize));
+        return std::min(cell, maxCell);
+    };
+
+    std::unordered_map<uint64_t, unsigned int> vertexForCell;
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<unsigned int> counts;
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        uint64_t key = cellOf(vertex.position.x, minBounds.x)
+            | (cellOf(vertex.position.y, minBounds.y) << 21)
+            | (cellOf(vertex.position.z, minBounds.z) << 42);
+
+        auto found = vertexForCell.find(key);
+        if (found == vertexForCell.end()) {
+            found = vertexForCell.emplace(key, static_cast<unsigned int>(outVertices.size())).first;
+            outVertices.push_back(vertex);
+            counts.push_back(1);
+        }
+        else {
+            // Average positions and normals, the rest comes from the first vertex
+            Vertex& merged = outVertices[found->second];
+            merged.position += vertex.position;
+            merged.normal += vertex.normal;
+            counts[found->second]++;
+        }
+        remap[i] = found->second;
+    }
+
+    for (size_t i = 0; i < outVertices.size(); i++) {
+        Vertex& vertex = outVertices[i];
+        vertex.position /= static_cast<float>(counts[i]);
+        float length = glm::length(vertex.normal);
+        if (length > 0.0f) {
+            vertex.normal /= length;
+        }
+    }
+
+    outIndices.reserve(indices.size() / 4);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int a = remap[indices[i]];
+        unsigned int b = remap[indices[i + 1]];
+        unsigned int c = remap[indices[i + 2]];
+        if (a != b && b != c && a != c) {
+            outIndices.push_back(a);
+            outIndices.push_back(b);
+            outIndices.push_back(c);
+        }
+    }
+
+    // Not worth an extra upload unless it at least halves the triangle count
+    if (outIndices.empty() || outIndices.size() * 2 > indices.size()) {
+        outVertices.clear();
+        outIndices.clear();
+        return false;
+    }
+    return true;
+}
+
+// Rough screen size: bounding radius over distance to the camera
+static float computePriority(const glm::vec3& center, float radius, const glm::mat4& transform, const glm::vec3& cameraPosition)
+{
+    glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(transform[0])),
+        std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    float worldRadius = radius * scale;
+
+    float distance = glm::length(worldCenter - cameraPosition) - worldRadius;
+    return worldRadius / std::max(distance, 0.01f);
+}
+
+// Packing source for a glTF texture, same as in Model.cpp
+static ChannelPacker::Source toPackSource(const GLTFLoader::TextureRef& ref, int channel)
+{
+    ChannelPacker::Source source;
+    source.path = ref.path;
+    source.data = ref.data;
+    source.size = ref.size;
+    source.channel = channel;
+    return source;
+}
+
+ModelStreamer::ModelStreamer(size_t workerCount)
+    : m_pool(workerCount)
+{
+}
+
+ModelStreamer::~ModelStreamer()
+{
+    for (auto& stream : m_streams) {
+        stream->model->m_streaming = false;
+    }
+}
+
+std::shared_ptr<Model> ModelStreamer::load(const std::string& filepath, const glm::mat4& transform)
+{
+    PROFILE_ASSET(filepath);
+    PROFILE_SCOPE("ModelStreamer::load");
+
+    auto stream = std::make_shared<Stream>();
+    stream->model = std::make_shared<Model>();
+    stream->filepath = filepath;
+    stream->transform = transform;
+    stream->inbox = std::make_shared<Stream::Inbox>();
+    stream->started = Clock::now();
+
+    Model& model = *stream->model;
+    model.beginLoad(filepath);
+    model.m_streaming = true;
+
+    if (GLTFLoader::canLoad(filepath)) {
+        // Layout only: hierarchy, materials and accessor bounds, no vertex data yet
+        auto loader = std::make_shared<GLTFLoader>();
+        if (loader->load(filepath, false)) {
+            stream->loader = loader;
+        }
+        else {
+            std::cerr << "Native glTF load failed, streaming through assimp: " << filepath << std::endl;
+        }
+    }
+
+    if (stream->loader) {
+        const auto& materials = stream->loader->getMaterials();
+        std::unordered_map<std::string, size_t> textureForPath;
+        std::shared_ptr<Texture> defaults[HEIGHT + 1];
+
+        glm::vec3 minBounds(std::numeric_limits<float>::max());
+        glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
+
+        const auto& primitives = stream->loader->getPrimitives();
+        for (size_t i = 0; i < primitives.size(); i++) {
+            const GLTFLoader::Primitive& primitive = primitives[i];
+
+            Stream::Part part;
+            part.primitive = i;
+            part.hasBounds = primitive.hasBounds;
+            if (primitive.hasBounds) {
+                part.center = (primitive.minBounds + primitive.maxBounds) * 0.5f;
+                part.radius = glm::length(primitive.maxBounds - primitive.minBounds) * 0.5f;
+                minBounds = glm::min(minBounds, primitive.minBounds);
+                maxBounds = glm::max(maxBounds, primitive.maxBounds);
+            }
+
+            const GLTFLoader::Material* material = nullptr;
+            if (primitive.material >= 0 && primitive.material < static_cast<int>(materials.size())) {
+                material = &materials[primitive.material];
+            }
+
+            // Same packing as Model::loadGLTF
+            ChannelPacker::Sources sources;
+            if (material) {
+                sources[static_cast<size_t>(MaterialChannel::Occlusion)] = toPackSource(material->occlusion, 0);
+                sources[static_cast<size_t>(MaterialChannel::Roughness)] = toPackSource(material->metallicRoughness, 1);
+                sources[static_cast<size_t>(MaterialChannel::Metallic)] = toPackSource(material->metallicRoughness, 2);
+                sources[static_cast<size_t>(MaterialChannel::Specular)] = toPackSource(material->specular, material->specularChannel);
+                sources[static_cast<size_t>(MaterialChannel::Height)] = toPackSource(material->height, 0);
+            }
+            part.channels = ChannelPacker::layout(sources);
+            bool separateHeight = material && material->height.isValid() && !part.channels.has(MaterialChannel::Height);
+
+            // Same slots and order as Model::loadGLTF
+            const std::pair<TextureType, const GLTFLoader::TextureRef*> slots[] = {
+                { DIFFUSE,  material ? &material->diffuse : nullptr },
+                { NORMAL,   material ? &material->normal : nullptr },
+                { HEIGHT,   separateHeight ? &material->height : nullptr },
+            };
+
+            for (const auto& slot : slots) {
+                const GLTFLoader::TextureRef* ref = slot.second;
+                if (slot.first == HEIGHT && !ref) {
+                    continue;
+                }
+                if (!ref || !ref->isValid()) {
+                    if (!defaults[slot.first]) {
+                        defaults[slot.first] = model.createDefaultTexture(slot.first);
+                        if (defaults[slot.first]) {
+                            model.m_loadedTextures.push_back(defaults[slot.first]);
+                        }
+                    }
+                    if (defaults[slot.first]) {
+                        part.textures.push_back(defaults[slot.first]);
+                    }
+                    continue;
+                }
+
+                // The placeholder object is kept and refilled, so meshes never need rebinding
+                auto found = textureForPath.find(ref->path);
+                if (found == textureForPath.end()) {
+                    Stream::StreamedTexture texture;
+                    texture.ref = *ref;
+                    texture.type = slot.first;
+                    texture.texture = model.createDefaultTexture(slot.first);
+                    if (!texture.texture) continue;
+
+                    model.m_loadedTextures.push_back(texture.texture);
+                    found = textureForPath.emplace(ref->path, stream->textures.size()).first;
+                    stream->textures.push_back(std::move(texture));
+                }
+                part.textures.push_back(stream->textures[found->second].texture);
+                part.streamedTextures.push_back(found->second);
+            }
+
+            // The packed texture streams like any other, its placeholder holds neutral values
+            if (!part.channels.isEmpty()) {
+                std::string name = ChannelPacker::getName(sources, part.channels);
+                auto found = textureForPath.find(name);
+                if (found == textureForPath.end()) {
+                    Stream::StreamedTexture texture;
+                    texture.ref.path = name;
+                    texture.type = PACKED;
+                    texture.pack = sources;
+                    texture.channels = part.channels;
+                    texture.texture = std::make_shared<Texture>();
+                    if (!texture.texture->loadFromImage(ChannelPacker::createDefaultImage(part.channels), name, PACKED)) continue;
+                    ResourceRegistry::get().setCategory(ResourceRegistry::Kind::Texture, texture.texture->getID(),
+                        ResourceCategory::DefaultTexture);
+
+                    model.m_loadedTextures.push_back(texture.texture);
+                    found = textureForPath.emplace(name, stream->textures.size()).first;
+                    stream->textures.push_back(std::move(texture));
+                }
+                part.textures.push_back(stream->textures[found->second].texture);
+                part.streamedTextures.push_back(found->second);
+            }
+
+            stream->parts.push_back(std::move(part));
+        }
+
+        // Bounds are usable for culling before any mesh arrives
+        if (minBounds.x <= maxBounds.x) {
+            model.m_minBounds = minBounds;
+            model.m_maxBounds = maxBounds;
+            model.m_center = (minBounds + maxBounds) * 0.5f;
+            model.m_boundingRadius = glm::length(maxBounds - minBounds) * 0.5f;
+        }
+
+        stream->remaining = stream->parts.size() + stream->textures.size();
+    }
+    else {
+        // assimp has no layout-only mode, so import the whole scene off the main thread
+        if (!std::filesystem::exists(filepath)) {
+            std::cerr << "Model file does not exist: " << filepath << std::endl;
+            return nullptr;
+        }
+
+        stream->importing = true;
+        auto inbox = stream->inbox;
+        m_pool.enqueue([inbox, filepath]() {
+            PROFILE_ASSET(filepath);
+
+            auto importer = std::make_unique<Assimp::Importer>();
+            const aiScene* scene = Model::importScene(*importer, filepath, Model::getDefaultAssimpFlags());
+
+            std::lock_guard<std::mutex> lock(inbox->mutex);
+            inbox->importer = std::move(importer);
+            inbox->scene = scene;
+            inbox->importDone = true;
+        });
+    }
+
+    m_streams.push_back(stream);
+    return stream->model;
+}
+
+void ModelStreamer::setTransform(const std::shared_ptr<Model>& model, const glm::mat4& transform)
+{
+    for (auto& stream : m_streams) {
+        if (stream->model == model) {
+            stream->transform = transform;
+            return;
+        }
+    }
+}
+
+void ModelStreamer::update(const glm::vec3& cameraPosition)
+{
+    PROFILE_SCOPE("ModelStreamer::update");
+
+    for (auto& stream : m_streams) {
+        collect(*stream);
+
+        for (auto& texture : stream->textures) {
+            texture.priority = 0.0f;
+        }
+
+        // Textures follow the most important part that uses them
+        for (auto& part : stream->parts) {
+            part.priority = part.hasBounds
+                ? computePriority(part.center, part.radius, stream->transform, cameraPosition)
+                : UNKNOWN_BOUNDS_PRIORITY;
+
+            for (size_t index : part.streamedTextures) {
+                stream->textures[index].priority = std::max(stream->textures[index].priority, part.priority);
+            }
+        }
+    }
+
+    dispatch();
+    upload();
+
+    // Retire finished streams, and ones whose model nobody holds anymore
+    for (size_t i = 0; i < m_streams.size();) {
+        Stream& stream = *m_streams[i];
+        bool finished = !stream.importing && stream.remaining == 0 && stream.loading == 0;
+        bool abandoned = stream.model.use_count() == 1;
+
+        if (!finished && !abandoned) {
+            i++;
+            continue;
+        }
+
+        Model& model = *stream.model;
+        model.m_streaming = false;
+        if (finished && stream.loader) {
+            model.calculateModelBounds();
+#ifndef NDEBUG
+            double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - stream.started).count();
+            std::cout << "Streamed model: " << stream.filepath
+                << "\n  First mesh after: " << stream.firstMeshMs << " ms"
+                << "\n  Complete after: " << totalMs << " ms"
+                << "\n  Meshes: " << model.m_meshes.size()
+                << "\n  Vertices: " << model.m_totalVertexCount
+                << "\n  Triangles: " << model.m_totalTriangleCount
+                << std::endl;
+#endif
+        }
+        m_streams.erase(m_streams.begin() + i);
+    }
+}
+
+void ModelStreamer::collect(Stream& stream)
+{
+    std::vector<Stream::Inbox::MeshResult> meshes;
+    std::vector<Stream::Inbox::TextureResult> textures;
+    std::unique_ptr<Assimp::Importer> importer;
+    const aiScene* scene = nullptr;
+    bool importDone = false;
+    {
+        std::lock_guard<std::mutex> lock(stream.inbox->mutex);
+        meshes.swap(stream.inbox->meshes);
+        textures.swap(stream.inbox->textures);
+        if (stream.importing && stream.inbox->importDone) {
+            importer = std::move(stream.inbox->importer);
+            scene = stream.inbox->scene;
+            importDone = true;
+        }
+    }
+
+    for (auto& result : meshes) {
+        Stream::Part& part = stream.parts[result.part];
+        part.state = result.ok ? Stream::State::Ready : Stream::State::Failed;
+        part.coarse = std::move(result.coarse);
+        part.full = std::move(result.full);
+        stream.loading--;
+        if (!result.ok) stream.remaining--;
+    }
+
+    for (auto& result : textures) {
+        Stream::StreamedTexture& texture = stream.textures[result.texture];
+        texture.state = result.ok ? Stream::State::Ready : Stream::State::Failed;
+        texture.preview = std::move(result.preview);
+        texture.full = std::move(result.full);
+        stream.loading--;
+        if (!result.ok) {
+            // The default texture stays in place
+            std::cerr << "Failed to stream texture: " << texture.ref.path << std::endl;
+            stream.remaining--;
+        }
+    }
+
+    if (importDone) {
+        // Mesh and texture creation needs the GL context, build it all here in one go
+        if (scene) {
+            stream.model->loadFromScene(scene, stream.filepath);
+            stream.firstMeshMs = std::chrono::duration<double, std::milli>(Clock::now() - stream.started).count();
+        }
+        stream.importing = false;
+    }
+}
+
+void ModelStreamer::dispatch()
+{
+    struct Candidate {
+        Stream* stream;
+        bool texture;
+        size_t index;
+        float priority;
+    };
+
+    size_t maxInFlight = m_settings.maxJobsInFlight ? m_settings.maxJobsInFlight : m_pool.getThreadCount() * 2;
+    size_t inFlight = 0;
+    std::vector<Candidate> candidates;
+
+    for (auto& stream : m_streams) {
+        inFlight += stream->loading;
+        for (size_t i = 0; i < stream->parts.size(); i++) {
+            if (stream->parts[i].state == Stream::State::Queued) {
+                candidates.push_back({ stream.get(), false, i, stream->parts[i].priority });
+            }
+        }
+        for (size_t i = 0; i < stream->textures.size(); i++) {
+            if (stream->textures[i].state == Stream::State::Queued) {
+                candidates.push_back({ stream.get(), true, i, stream->textures[i].priority });
+            }
+        }
+    }
+
+    if (inFlight >= maxInFlight || candidates.empty()) return;
+
+    // Only the jobs that start now need to be in order, geometry wins ties
+    size_t count = std::min(maxInFlight - inFlight, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+        [](const Candidate& a, const Candidate& b) {
+            if (a.priority != b.priority) return a.priority > b.priority;
+            return !a.texture && b.texture;
+        });
+
+    const size_t coarseMinTriangles = m_settings.coarseMinTriangles;
+    const int coarseGridSize = m_settings.coarseGridSize;
+    const int previewSize = m_settings.previewTextureSize;
+
+    for (size_t i = 0; i < count; i++) {
+        Stream& stream = *candidates[i].stream;
+        size_t index = candidates[i].index;
+        auto loader = stream.loader;
+        auto inbox = stream.inbox;
+        std::string asset = stream.filepath;
+        stream.loading++;
+
+        if (!candidates[i].texture) {
+            Stream::Part& part = stream.parts[index];
+            part.state = Stream::State::Loading;
+            size_t primitiveIndex = part.primitive;
+
+            m_pool.enqueue([loader, inbox, index, primitiveIndex, coarseMinTriangles, coarseGridSize, asset]() {
+                PROFILE_ASSET(asset);
+
+                // Decode into a copy, the loader's own list is shared by all workers
+                GLTFLoader::Primitive primitive = loader->getPrimitives()[primitiveIndex];
+
+                Stream::Inbox::MeshResult result;
+                result.part = index;
+                result.ok = loader->decodePrimitive(primitive);
+                if (result.ok) {
+                    if (primitive.indices.size() / 3 >= coarseMinTriangles) {
+                        buildCoarseLOD(primitive.vertices, primitive.indices, coarseGridSize,
+                            result.coarse.vertices, result.coarse.indices);
+                    }
+                    result.full.vertices = std::move(primitive.vertices);
+                    result.full.indices = std::move(primitive.indices);
+                }
+
+                std::lock_guard<std::mutex> lock(inbox->mutex);
+                inbox->meshes.push_back(std::move(result));
+            });
+        }
+        else {
+            Stream::StreamedTexture& texture = stream.textures[index];
+            texture.state = Stream::State::Loading;
+            GLTFLoader::TextureRef ref = texture.ref;
+            TextureType type = texture.type;
+            ChannelPacker::Sources pack = texture.pack;
+            ChannelMap channels = texture.channels;
+
+            // The loader is captured to keep embedded image bytes mapped
+            m_pool.enqueue([loader, inbox, index, ref, type, pack, channels, previewSize, asset]() {
+                PROFILE_ASSET(asset);
+
+                Stream::Inbox::TextureResult result;
+                result.texture = index;
+                if (type == PACKED) {
+                    // Maps that fail read as neutral, the packed image is always usable
+                    ChannelPacker::pack(pack, channels, result.full);
+                    result.ok = true;
+                }
+                else {
+                    result.ok = ref.data
+                        ? Texture::decodeMemory(ref.data, ref.size, type, result.full)
+                        : Texture::decodeFile(ref.path, type, result.full);
+                }
+
+                // Small images go straight to full resolution
+                if (result.ok && std::max(result.full.width, result.full.height) > previewSize * 2) {
+                    result.preview = Texture::downsample(result.full, previewSize);
+                }
+
+                std::lock_guard<std::mutex> lock(inbox->mutex);
+                inbox->textures.push_back(std::move(result));
+            });
+        }
+    }
+}
+
+void ModelStreamer::upload()
+{
+    struct Upload {
+        Stream* stream;
+        bool texture;
+        size_t index;
+        bool preview;
+        float priority;
+    };
+
+    std::vector<Upload> uploads;
+    for (auto& stream : m_streams) {
+        for (size_t i = 0; i < stream->parts.size(); i++) {
+            const Stream::Part& part = stream->parts[i];
+            if (part.state == Stream::State::Ready) {
+                uploads.push_back({ stream.get(), false, i, !part.coarse.indices.empty(), part.priority });
+            }
+        }
+        for (size_t i = 0; i < stream->textures.size(); i++) {
+            const Stream::StreamedTexture& texture = stream->textures[i];
+            if (texture.state == Stream::State::Ready) {
+                uploads.push_back({ stream.get(), true, i, texture.preview.isValid(), texture.priority });
+            }
+        }
+    }
+    if (uploads.empty()) return;
+
+    // Every preview goes up before any full data, each group by priority
+    std::sort(uploads.begin(), uploads.end(), [](const Upload& a, const Upload& b) {
+        if (a.preview != b.preview) return a.preview;
+        return a.priority > b.priority;
+    });
+
+    PROFILE_SCOPE("ModelStreamer::upload");
+    const Clock::time_point start = Clock::now();
+
+    for (size_t i = 0; i < uploads.size(); i++) {
+        // Always make progress, even when a single upload is over budget
+        double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (i > 0 && elapsedMs >= m_settings.uploadBudgetMs) break;
+
+        Stream& stream = *uploads[i].stream;
+        Model& model = *stream.model;
+        PROFILE_ASSET(stream.filepath);
+
+        if (uploads[i].texture) {
+            Stream::StreamedTexture& texture = stream.textures[uploads[i].index];
+            if (uploads[i].preview) {
+                texture.texture->loadFromImage(texture.preview, texture.ref.path, texture.type);
+                texture.preview = Texture::Image();
+            }
+            else {
+                texture.texture->loadFromImage(texture.full, texture.ref.path, texture.type);
+                texture.full = Texture::Image();
+                texture.state = Stream::State::Done;
+                stream.remaining--;
+            }
+            continue;
+        }
+
+        Stream::Part& part = stream.parts[uploads[i].index];
+        Stream::MeshData& data = uploads[i].preview ? part.coarse : part.full;
+        auto mesh = std::make_shared<Mesh>(std::move(data.vertices), std::move(data.indices),
+            std::vector<std::shared_ptr<Texture>>(part.textures));
+        mesh->setChannelMap(part.channels);
+        data = Stream::MeshData();
+
+        if (part.meshSlot < 0) {
+            part.meshSlot = static_cast<int>(model.m_meshes.size());
+            model.m_meshes.push_back(mesh);
+        }
+        else {
+            // Replace the coarse mesh in place
+            const auto& previous = model.m_meshes[part.meshSlot];
+            model.m_totalVertexCount -= previous->getVertices().size();
+            model.m_totalTriangleCount -= previous->getIndices().size() / 3;
+            model.m_meshes[part.meshSlot] = mesh;
+        }
+        model.m_totalVertexCount += mesh->getVertices().size();
+        model.m_totalTriangleCount += mesh->getIndices().size() / 3;
+
+        if (stream.firstMeshMs < 0.0) {
+            stream.firstMeshMs = std::chrono::duration<double, std::milli>(Clock::now() - stream.started).count();
+        }
+
+        if (!uploads[i].preview) {
+            part.state = Stream::State::Done;
+            stream.remaining--;
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#include "Renderer/ObjectBuffer.h"
+#include "Renderer/RenderUtils.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Utils/Profiler.h"
+#include "Utils/Simd.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const size_t TEXEL_BYTES = sizeof(glm::vec4);
+static const size_t MIN_CAPACITY = 256;
+
+ObjectBuffer::~ObjectBuffer()
+{
+    release();
+}
+
+uint32_t ObjectBuffer::add(const glm::mat4& model)
+{
+    m_models.push_back(model);
+    return static_cast<uint32_t>(m_models.size() - 1);
+}
+
+// out = viewProjection * model, four columns of four floats each
+static void multiply(const float* viewProjection, const float* model, float* out)
+{
+#ifdef BOX_SSE
+    __m128 vp0 = _mm_loadu_ps(viewProjection);
+    __m128 vp1 = _mm_loadu_ps(viewProjection + 4);
+    __m128 vp2 = _mm_loadu_ps(viewProjection + 8);
+    __m128 vp3 = _mm_loadu_ps(viewProjection + 12);
+    for (int column = 0; column < 4; column++) {
+        const float* m = model + column * 4;
+        __m128 sum = _mm_mul_ps(vp0, _mm_set1_ps(m[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(vp1, _mm_set1_ps(m[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(vp2, _mm_set1_ps(m[2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(vp3, _mm_set1_ps(m[3])));
+        _mm_storeu_ps(out + column * 4, sum);
+    }
+#else
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            out[column * 4 + row] =
+                viewProjection[row] * model[column * 4] +
+                viewProjection[4 + row] * model[column * 4 + 1] +
+                viewProjection[8 + row] * model[column * 4 + 2] +
+                viewProjection[12 + row] * model[column * 4 + 3];
+        }
+    }
+#endif
+}
+
+void ObjectBuffer::update(const glm::mat4& viewProjection)
+{
+    PROFILE_SCOPE("ObjectBuffer::update");
+
+    size_t count = m_models.size();
+    size_t maxObjects = getMaxObjects();
+    if (count > maxObjects) {
+        std::cerr << "ObjectBuffer: " << count << " objects, only the first " << maxObjects << " fit" << std::endl;
+        count = maxObjects;
+    }
+    if (count == 0) return;
+
+    m_texels.resize(count * TEXELS_PER_OBJECT);
+    const float* vp = &viewProjection[0][0];
+
+    for (size_t i = 0; i < count; i++) {
+        const glm::mat4& model = m_models[i];
+        glm::vec4* texels = &m_texels[i * TEXELS_PER_OBJECT];
+
+        texels[MODEL_TEXEL] = model[0];
+        texels[MODEL_TEXEL + 1] = model[1];
+        texels[MODEL_TEXEL + 2] = model[2];
+        texels[MODEL_TEXEL + 3] = model[3];
+        multiply(vp, &model[0][0], &texels[MVP_TEXEL].x);
+
+        // The inverse transpose of the upper 3x3 is its cofactor matrix over
+        // the determinant, and the cofactor columns are cross products of the
+        // other two columns. A degenerate matrix keeps the cofactors, the
+        // shader normalizes anyway.
+        glm::vec3 c0(model[0]), c1(model[1]), c2(model[2]);
+        glm::vec3 n0 = glm::cross(c1, c2);
+        glm::vec3 n1 = glm::cross(c2, c0);
+        glm::vec3 n2 = glm::cross(c0, c1);
+        float det = glm::dot(c0, n0);
+        float scale = std::abs(det) > 1e-12f ? 1.0f / det : 1.0f;
+        texels[NORMAL_TEXEL] = glm::vec4(n0 * scale, 0.0f);
+        texels[NORMAL_TEXEL + 1] = glm::vec4(n1 * scale, 0.0f);
+        texels[NORMAL_TEXEL + 2] = glm::vec4(n2 * scale, 0.0f);
+    }
+
+    if (m_buffer == 0) {
+        glGenBuffers(1, &m_buffer);
+        glGenTextures(1, &m_texture);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+    if (count > m_capacity) {
+        // Grow in powers of two so a slowly rising count doesn't reallocate every frame
+        m_capacity = std::max(m_capacity, MIN_CAPACITY);
+        while (m_capacity < count) {
+            m_capacity *= 2;
+        }
+        m_capacity = std::min(m_capacity, maxObjects);
+    }
+
+    // Orphan last frame's storage instead of waiting for the draws still reading it
+    size_t bytes = m_capacity * TEXELS_PER_OBJECT * TEXEL_BYTES;
+    glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, count * TEXELS_PER_OBJECT * TEXEL_BYTES, m_texels.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    ResourceRegistry::Resource resource;
+    resource.kind = ResourceRegistry::Kind::Buffer;
+    resource.id = m_buffer;
+    resource.category = ResourceCategory::FrameData;
+    resource.name = "object matrices";
+    resource.owner = "engine";
+    resource.gpuBytes = bytes;
+    resource.cpuBytes = m_texels.capacity() * TEXEL_BYTES + m_models.capacity() * sizeof(glm::mat4);
+    ResourceRegistry::get().add(std::move(resource));
+}
+
+void ObjectBuffer::bind() const
+{
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+    ResourceRegistry::get().touch(ResourceRegistry::Kind::Buffer, m_buffer);
+}
+
+std::vector<std::string> ObjectBuffer::getShaderDefines()
+{
+    return {
+        "OBJECT_TEXELS " + std::to_string(TEXELS_PER_OBJECT),
+        "OBJECT_MODEL_TEXEL " + std::to_string(MODEL_TEXEL),
+        "OBJECT_MVP_TEXEL " + std::to_string(MVP_TEXEL),
+        "OBJECT_NORMAL_TEXEL " + std::to_string(NORMAL_TEXEL)
+    };
+}
+
+size_t ObjectBuffer::getMaxObjects() const
+{
+    // 65536 texels is the minimum GL 3.3 guarantees, about 5900 objects
+    return getMaxBufferTexels() / TEXELS_PER_OBJECT;
+}
+
+void ObjectBuffer::release()
+{
+    if (m_buffer != 0) {
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Buffer, m_buffer);
+        glDeleteTextures(1, &m_texture);
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        m_texture = 0;
+        m_capacity = 0;
+    }
+}
@@ -0,0 +1,303 @@
+#include "Renderer/OcclusionCuller.h"
+#include "Renderer/Mesh.h"
+#include "Utils/Profiler.h"
+#include "Utils/Simd.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+static const float MIN_CLIP_W = 1e-4f;
+
+// Boxes are tested at the pyramid level where they cover at most this many texels across
+static const int TEST_TEXELS = 4;
+
+void OcclusionCuller::setSettings(const Settings& settings)
+{
+    m_settings = settings;
+    m_settings.tilesX = std::max(1, m_settings.tilesX);
+    m_settings.tilesY = std::max(1, m_settings.tilesY);
+
+    // The tile loop writes four pixels at a time, a narrower tile would spill
+    // into its neighbour while another job rasterizes it
+    const int step = 4 * m_settings.tilesX;
+    m_settings.width = std::max(step, (m_settings.width + step - 1) / step * step);
+}
+
+void OcclusionCuller::clear()
+{
+    m_occluders.clear();
+    m_triangles.clear();
+    m_hasDepth = false;
+}
+
+void OcclusionCuller::addOccluder(const Mesh& mesh, const glm::mat4& transform)
+{
+    m_occluders.push_back({ &mesh, transform });
+}
+
+void OcclusionCuller::setupTriangles()
+{
+    const float width = static_cast<float>(m_settings.width);
+    const float height = static_cast<float>(m_settings.height);
+    const int tileWidth = m_settings.width / m_settings.tilesX;
+    const int tileHeight = m_settings.height / m_settings.tilesY;
+
+    m_tileTriangles.resize(static_cast<size_t>(m_settings.tilesX) * m_settings.tilesY);
+    for (auto& triangles : m_tileTriangles) {
+        triangles.clear();
+    }
+
+    std::vector<glm::vec4> clip;
+    for (const Occluder& occluder : m_occluders) {
+        const auto& vertices = occluder.mesh->getVertices();
+        const auto& indices = occluder.mesh->getIndices();
+        glm::mat4 mvp = m_viewProjection * occluder.transform;
+
+        clip.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            clip[i] = mvp * glm::vec4(vertices[i].position, 1.0f);
+        }
+
+        size_t count = indices.empty() ? vertices.size() : indices.size();
+        for (size_t i = 0; i + 2 < count; i += 3) {
+            const glm::vec4* corners[3];
+            bool nearClipped = false;
+            for (int c = 0; c < 3; c++) {
+                size_t index = indices.empty() ? i + c : indices[i + c];
+                corners[c] = &clip[index];
+                nearClipped |= corners[c]->w < MIN_CLIP_W;
+            }
+
+            // Left out instead of clipped, fewer occluders only means less culling
+            if (nearClipped) continue;
+
+            ScreenTriangle triangle;
+            glm::vec2 low(width, height);
+            glm::vec2 high(0.0f);
+            for (int c = 0; c < 3; c++) {
+                glm::vec3 ndc = glm::vec3(*corners[c]) / corners[c]->w;
+                triangle.v[c] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+                low = glm::min(low, glm::vec2(triangle.v[c]));
+                high = glm::max(high, glm::vec2(triangle.v[c]));
+            }
+            if (high.x < 0.0f || high.y < 0.0f || low.x >= width || low.y >= height) continue;
+
+            // Degenerate or too thin to cover a pixel centre
+            glm::vec3 e1 = triangle.v[1] - triangle.v[0];
+            glm::vec3 e2 = triangle.v[2] - triangle.v[0];
+            if (std::abs(e1.x * e2.y - e2.x * e1.y) < 1e-6f) continue;
+
+            uint32_t index = static_cast<uint32_t>(m_triangles.size());
+            m_triangles.push_back(triangle);
+
+            int tx0 = std::max(0, static_cast<int>(low.x) / tileWidth);
+            int tx1 = std::min(m_settings.tilesX - 1, static_cast<int>(high.x) / tileWidth);
+            int ty0 = std::max(0, static_cast<int>(low.y) / tileHeight);
+            int ty1 = std::min(m_settings.tilesY - 1, static_cast<int>(high.y) / tileHeight);
+            for (int ty = ty0; ty <= ty1; ty++) {
+                for (int tx = tx0; tx <= tx1; tx++) {
+                    m_tileTriangles[ty * m_settings.tilesX + tx].push_back(index);
+                }
+            }
+        }
+    }
+}
+
+void OcclusionCuller::rasterize(const glm::mat4& viewProjection, ThreadPool& pool)
+{
+    PROFILE_SCOPE("OcclusionCuller::rasterize");
+
+    m_viewProjection = viewProjection;
+    m_triangles.clear();
+
+    const size_t pixels = static_cast<size_t>(m_settings.width) * m_settings.height;
+    if (m_levels.empty() || m_levels[0].size() != pixels) {
+        m_levels.clear();
+        m_levelSizes.clear();
+        glm::ivec2 size(m_settings.width, m_settings.height);
+        while (true) {
+            m_levelSizes.push_back(size);
+            m_levels.emplace_back(static_cast<size_t>(size.x) * size.y);
+            if (size.x == 1 && size.y == 1) break;
+            size = glm::max(size / 2, glm::ivec2(1));
+        }
+    }
+    std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+
+    m_hasDepth = !m_occluders.empty();
+    if (!m_hasDepth) return;
+
+    setupTriangles();
+
+    // Tiles write disjoint parts of level 0
+    for (int tile = 0; tile < static_cast<int>(m_tileTriangles.size()); tile++) {
+        if (m_tileTriangles[tile].empty()) continue;
+        pool.enqueue([this, tile]() {
+            rasterizeTile(tile);
+        });
+    }
+    pool.waitIdle();
+
+    buildPyramid();
+}
+
+void OcclusionCuller::rasterizeTile(int tile)
+{
+    const int tileWidth = m_settings.width / m_settings.tilesX;
+    const int tileHeight = m_settings.height / m_settings.tilesY;
+    const int tileX0 = (tile % m_settings.tilesX) * tileWidth;
+    const int tileY0 = (tile / m_settings.tilesX) * tileHeight;
+    const int tileX1 = tileX0 + tileWidth;
+    const int tileY1 = tileY0 + tileHeight;
+    float* depth = m_levels[0].data();
+    const int stride = m_settings.width;
+
+    for (uint32_t index : m_tileTriangles[tile]) {
+        glm::vec3 v0 = m_triangles[index].v[0];
+        glm::vec3 v1 = m_triangles[index].v[1];
+        glm::vec3 v2 = m_triangles[index].v[2];
+
+        // Counter-clockwise so inside is where every edge function is positive,
+        // back faces are kept since they still hide what is behind them
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        // Edge functions E(x, y) = a * x + b * y + c, edge i is opposite vertex i
+        float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v2.x * v1.y;
+        float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v0.x * v2.y;
+        float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v1.x * v0.y;
+
+        // Depth is linear in screen space: z = dzdx * x + dzdy * y + z0
+        float invArea = 1.0f / area;
+        float dzdx = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+        float dzdy = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+        float dz0 = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+        // Pixel centres inside the bounding box, rows start on a multiple of 4
+        int x0 = std::max(tileX0, static_cast<int>(std::floor(std::min(v0.x, std::min(v1.x, v2.x)) - 0.5f)) & ~3);
+        int x1 = std::min(tileX1 - 1, static_cast<int>(std::ceil(std::max(v0.x, std::max(v1.x, v2.x)))));
+        int y0 = std::max(tileY0, static_cast<int>(std::floor(std::min(v0.y, std::min(v1.y, v2.y)) - 0.5f)));
+        int y1 = std::min(tileY1 - 1, static_cast<int>(std::ceil(std::max(v0.y, std::max(v1.y, v2.y)))));
+        if (x0 > x1 || y0 > y1) continue;
+
+#ifdef BOX_SSE
+        const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 a0v = _mm_set1_ps(a0), a1v = _mm_set1_ps(a1), a2v = _mm_set1_ps(a2);
+        const __m128 dzdxv = _mm_set1_ps(dzdx);
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            __m128 row0 = _mm_set1_ps(b0 * py + c0);
+            __m128 row1 = _mm_set1_ps(b1 * py + c1);
+            __m128 row2 = _mm_set1_ps(b2 * py + c2);
+            __m128 rowZ = _mm_set1_ps(dzdy * py + dz0);
+            float* line = depth + static_cast<size_t>(y) * stride;
+
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0v, px), row0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1v, px), row1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2v, px), row2);
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(dzdxv, px), rowZ);
+                __m128 stored = _mm_loadu_ps(line + x);
+                __m128 nearer = _mm_min_ps(stored, z);
+                _mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+            }
+        }
+#else
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            float* line = depth + static_cast<size_t>(y) * stride;
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+                if (a0 * px + b0 * py + c0 < 0.0f || a1 * px + b1 * py + c1 < 0.0f || a2 * px + b2 * py + c2 < 0.0f) continue;
+                line[x] = std::min(line[x], dzdx * px + dzdy * py + dz0);
+            }
+        }
+#endif
+    }
+}
+
+void OcclusionCuller::buildPyramid()
+{
+    for (size_t level = 1; level < m_levels.size(); level++) {
+        const std::vector<float>& source = m_levels[level - 1];
+        std::vector<float>& target = m_levels[level];
+        glm::ivec2 sourceSize = m_levelSizes[level - 1];
+        glm::ivec2 size = m_levelSizes[level];
+
+        for (int y = 0; y < size.y; y++) {
+            int sy0 = std::min(y * 2, sourceSize.y - 1);
+            int sy1 = std::min(y * 2 + 1, sourceSize.y - 1);
+            for (int x = 0; x < size.x; x++) {
+                int sx0 = std::min(x * 2, sourceSize.x - 1);
+                int sx1 = std::min(x * 2 + 1, sourceSize.x - 1);
+                target[y * size.x + x] = std::max(
+                    std::max(source[sy0 * sourceSize.x + sx0], source[sy0 * sourceSize.x + sx1]),
+                    std::max(source[sy1 * sourceSize.x + sx0], source[sy1 * sourceSize.x + sx1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::mat4& transform) const
+{
+    glm::mat4 mvp = m_viewProjection * transform;
+
+    glm::vec3 low(1.0f);
+    glm::vec3 high(-1.0f);
+    bool first = true;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point((corner & 1) ? maxBounds.x : minBounds.x,
+            (corner & 2) ? maxBounds.y : minBounds.y,
+            (corner & 4) ? maxBounds.z : minBounds.z);
+        glm::vec4 clip = mvp * glm::vec4(point, 1.0f);
+
+        // Reaches behind the near plane, no useful screen rect
+        if (clip.w < MIN_CLIP_W) return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        low = first ? ndc : glm::min(low, ndc);
+        high = first ? ndc : glm::max(high, ndc);
+        first = false;
+    }
+
+    // Frustum
+    if (high.x < -1.0f || low.x > 1.0f || high.y < -1.0f || low.y > 1.0f || low.z > 1.0f) {
+        return false;
+    }
+    if (!m_hasDepth) return true;
+
+    // Pixel rect, outward so every pixel the box touches is included
+    const float width = static_cast<float>(m_settings.width);
+    const float height = static_cast<float>(m_settings.height);
+    int x0 = std::max(0, static_cast<int>(std::floor((low.x * 0.5f + 0.5f) * width)));
+    int x1 = std::min(m_settings.width - 1, static_cast<int>(std::floor((high.x * 0.5f + 0.5f) * width)));
+    int y0 = std::max(0, static_cast<int>(std::floor((low.y * 0.5f + 0.5f) * height)));
+    int y1 = std::min(m_settings.height - 1, static_cast<int>(std::floor((high.y * 0.5f + 0.5f) * height)));
+    float nearest = low.z * 0.5f + 0.5f;
+
+    int level = 0;
+    while (level + 1 < static_cast<int>(m_levels.size()) &&
+        ((x1 >> level) - (x0 >> level) >= TEST_TEXELS || (y1 >> level) - (y0 >> level) >= TEST_TEXELS)) {
+        level++;
+    }
+
+    // Hidden only if the occluders are nearer than the box's nearest point everywhere
+    const std::vector<float>& depth = m_levels[level];
+    int levelWidth = m_levelSizes[level].x;
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            if (nearest <= depth[y * levelWidth + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
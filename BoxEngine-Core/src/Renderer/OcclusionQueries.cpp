@@ -0,0 +1,193 @@
+#include "Renderer/OcclusionQueries.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+static const int QUERY_BATCH = 32;
+
+OcclusionQueries::~OcclusionQueries()
+{
+    release();
+}
+
+void OcclusionQueries::beginFrame(uint64_t frame)
+{
+    m_frame = frame;
+    m_queriesIssued = 0;
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        Entry& entry = it->second;
+
+        if (entry.pending) {
+            GLint available = 0;
+            glGetQueryObjectiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint passed = 0;
+                glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT, &passed);
+                entry.pending = false;
+                entry.visible = passed != 0;
+
+                // Spread requeries of visible objects over the interval. Keys
+                // are the Model pointer over the instance's occurrence, hash
+                // both so instances of one Model don't all land together.
+                if (entry.visible) {
+                    uint64_t hash = ((it->first >> 16) ^ it->first) * 0x9E3779B97F4A7C15ull;
+                    size_t stagger = static_cast<size_t>(hash >> 32) % static_cast<size_t>(m_settings.requeryInterval);
+                    entry.nextQueryFrame = frame + 1 + stagger;
+                }
+            }
+        }
+
+        if (frame - entry.lastUsedFrame > static_cast<uint64_t>(m_settings.evictFrames)) {
+            if (entry.query != 0) {
+                m_freeQueries.push_back(entry.query);
+            }
+            it = m_entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+OcclusionQueries::Mode OcclusionQueries::classify(uint64_t key, bool cameraInside)
+{
+    Entry& entry = m_entries[key];
+    entry.lastUsedFrame = m_frame;
+
+    if (cameraInside) {
+        entry.visible = true;
+        return Mode::Draw;
+    }
+
+    // Nothing new to ask while the last answer is still on its way
+    if (entry.pending) {
+        return entry.visible ? Mode::Draw : Mode::Conditional;
+    }
+    if (!entry.visible) {
+        return Mode::QueryBox;
+    }
+    return m_frame >= entry.nextQueryFrame ? Mode::QueryDraw : Mode::Draw;
+}
+
+unsigned int OcclusionQueries::acquireQuery()
+{
+    if (m_freeQueries.empty()) {
+        unsigned int queries[QUERY_BATCH];
+        glGenQueries(QUERY_BATCH, queries);
+        m_freeQueries.insert(m_freeQueries.end(), queries, queries + QUERY_BATCH);
+        m_allQueries.insert(m_allQueries.end(), queries, queries + QUERY_BATCH);
+    }
+    unsigned int query = m_freeQueries.back();
+    m_freeQueries.pop_back();
+    return query;
+}
+
+void OcclusionQueries::beginQuery(uint64_t key)
+{
+    Entry& entry = m_entries[key];
+    if (entry.query == 0) {
+        entry.query = acquireQuery();
+    }
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, entry.query);
+    entry.pending = true;
+    entry.issued = true;
+    entry.lastUsedFrame = m_frame;
+    m_queriesIssued++;
+}
+
+void OcclusionQueries::endQuery()
+{
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
+
+bool OcclusionQueries::beginConditional(uint64_t key)
+{
+    auto found = m_entries.find(key);
+    if (found == m_entries.end() || !found->second.issued) {
+        return false;
+    }
+    glBeginConditionalRender(found->second.query, GL_QUERY_NO_WAIT);
+    return true;
+}
+
+void OcclusionQueries::endConditional()
+{
+    glEndConditionalRender();
+}
+
+size_t OcclusionQueries::getHiddenCount() const
+{
+    size_t hidden = 0;
+    for (const auto& entry : m_entries) {
+        if (!entry.second.visible && entry.second.lastUsedFrame == m_frame) {
+            hidden++;
+        }
+    }
+    return hidden;
+}
+
+void OcclusionQueries::setupBox()
+{
+    // Unit cube, stretched over the bounds in the vertex shader's matrix
+    const float vertices[] = {
+        0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+        0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1
+    };
+    const unsigned int indices[] = {
+        0, 2, 1, 0, 3, 2,   // -z
+        4, 5, 6, 4, 6, 7,   // +z
+        0, 1, 5, 0, 5, 4,   // -y
+        3, 7, 6, 3, 6, 2,   // +y
+        0, 4, 7, 0, 7, 3,   // -x
+        1, 2, 6, 1, 6, 5    // +x
+    };
+
+    glGenVertexArrays(1, &m_boxVAO);
+    glGenBuffers(1, &m_boxVBO);
+    glGenBuffers(1, &m_boxEBO);
+
+    glBindVertexArray(m_boxVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_boxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_boxEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+
+    m_boxShader.LoadFromFile("assets/Shaders/box.vert", "assets/Shaders/depth.frag");
+}
+
+void OcclusionQueries::drawBox(const glm::mat4& mvp, const glm::vec3& minBounds, const glm::vec3& maxBounds)
+{
+    if (m_boxVAO == 0) {
+        setupBox();
+    }
+
+    glm::mat4 box = glm::translate(glm::mat4(1.0f), minBounds) * glm::scale(glm::mat4(1.0f), maxBounds - minBounds);
+    m_boxShader.Use();
+    m_boxShader.SetMat4("mvp", mvp * box);
+
+    glBindVertexArray(m_boxVAO);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void OcclusionQueries::release()
+{
+    if (!m_allQueries.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(m_allQueries.size()), m_allQueries.data());
+        m_allQueries.clear();
+        m_freeQueries.clear();
+    }
+    m_entries.clear();
+
+    if (m_boxVAO != 0) {
+        glDeleteVertexArrays(1, &m_boxVAO);
+        glDeleteBuffers(1, &m_boxVBO);
+        glDeleteBuffers(1, &m_boxEBO);
+        m_boxVAO = 0;
+        m_boxVBO = 0;
+        m_boxEBO = 0;
+    }
+}
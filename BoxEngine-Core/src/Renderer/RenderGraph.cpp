@@ -0,0 +1,477 @@
+#include "Renderer/RenderGraph.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Utils/Profiler.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+// Pooled textures unused this many frames are deleted (a resize leaves the old sizes behind)
+static const uint64_t EVICT_FRAMES = 60;
+
+static bool isDepthFormat(RenderGraph::Format format)
+{
+    return format == RenderGraph::Format::Depth24Stencil8;
+}
+
+static bool sameDesc(const RenderGraph::TextureDesc& a, const RenderGraph::TextureDesc& b)
+{
+    return a.width == b.width && a.height == b.height && a.format == b.format;
+}
+
+void RenderGraph::PassBuilder::read(Resource resource)
+{
+    m_graph.m_passes[m_pass].reads.push_back(resource);
+}
+
+void RenderGraph::PassBuilder::attach(Resource resource)
+{
+    std::vector<Resource>& attachments = m_graph.m_passes[m_pass].attachments;
+    if (std::find(attachments.begin(), attachments.end(), resource) == attachments.end()) {
+        attachments.push_back(resource);
+    }
+}
+
+void RenderGraph::PassBuilder::write(Resource resource)
+{
+    m_graph.m_passes[m_pass].writes.push_back(resource);
+}
+
+void RenderGraph::PassBuilder::sideEffect()
+{
+    m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+void RenderGraph::PassBuilder::setViewport(int width, int height)
+{
+    m_graph.m_passes[m_pass].viewportWidth = width;
+    m_graph.m_passes[m_pass].viewportHeight = height;
+}
+
+RenderGraph::~RenderGraph()
+{
+    release();
+}
+
+void RenderGraph::reset()
+{
+    m_resources.clear();
+    m_passes.clear();
+    m_order.clear();
+    m_framebufferSwitches = 0;
+    m_frame++;
+    evictTextures();
+}
+
+RenderGraph::Resource RenderGraph::createTexture(const std::string& name, const TextureDesc& desc)
+{
+    ResourceNode node;
+    node.name = name;
+    node.kind = Kind::Transient;
+    node.desc = desc;
+    m_resources.push_back(node);
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importBackbuffer(const std::string& name, int width, int height)
+{
+    ResourceNode node;
+    node.name = name;
+    node.kind = Kind::Backbuffer;
+    node.desc.width = width;
+    node.desc.height = height;
+    m_resources.push_back(node);
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importExternal(const std::string& name)
+{
+    ResourceNode node;
+    node.name = name;
+    node.kind = Kind::External;
+    m_resources.push_back(node);
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+void RenderGraph::addPass(const char* name, const Setup& setup, const Execute& execute)
+{
+    PassNode pass;
+    pass.name = name;
+    pass.execute = execute;
+    m_passes.push_back(std::move(pass));
+
+    PassBuilder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+    setup(builder);
+}
+
+void RenderGraph::buildDependencies()
+{
+    // Walk the passes in declaration order: reads and attachments depend on
+    // the last writer, writes also wait for the readers of the old contents
+    std::vector<int> lastWriter(m_resources.size(), -1);
+    std::vector<std::vector<uint32_t>> readers(m_resources.size());
+
+    auto depend = [&](uint32_t pass, int other, bool data) {
+        if (other < 0 || static_cast<uint32_t>(other) == pass) return;
+        for (Dependency& dependency : m_passes[pass].dependencies) {
+            if (dependency.pass == static_cast<uint32_t>(other)) {
+                dependency.data = dependency.data || data;
+                return;
+            }
+        }
+        m_passes[pass].dependencies.push_back({ static_cast<uint32_t>(other), data });
+    };
+
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        PassNode& pass = m_passes[p];
+
+        for (Resource resource : pass.reads) {
+            depend(p, lastWriter[resource], true);
+            readers[resource].push_back(p);
+        }
+
+        std::vector<Resource> outputs = pass.attachments;
+        outputs.insert(outputs.end(), pass.writes.begin(), pass.writes.end());
+        for (Resource resource : outputs) {
+            depend(p, lastWriter[resource], true);
+            for (uint32_t reader : readers[resource]) {
+                depend(p, static_cast<int>(reader), false);
+            }
+        }
+        for (Resource resource : outputs) {
+            lastWriter[resource] = static_cast<int>(p);
+            readers[resource].clear();
+            if (m_resources[resource].kind == Kind::Backbuffer) {
+                pass.sideEffect = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::cull()
+{
+    // Live from the side effects back through the data they use
+    std::vector<uint32_t> stack;
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        m_passes[p].live = m_passes[p].sideEffect;
+        if (m_passes[p].live) {
+            stack.push_back(p);
+        }
+    }
+    while (!stack.empty()) {
+        uint32_t p = stack.back();
+        stack.pop_back();
+        for (const Dependency& dependency : m_passes[p].dependencies) {
+            if (dependency.data && !m_passes[dependency.pass].live) {
+                m_passes[dependency.pass].live = true;
+                stack.push_back(dependency.pass);
+            }
+        }
+    }
+}
+
+void RenderGraph::schedule()
+{
+    std::vector<int> waiting(m_passes.size(), 0);
+    std::vector<std::vector<uint32_t>> dependents(m_passes.size());
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        if (!m_passes[p].live) continue;
+        for (const Dependency& dependency : m_passes[p].dependencies) {
+            if (m_passes[dependency.pass].live) {
+                waiting[p]++;
+                dependents[dependency.pass].push_back(p);
+            }
+        }
+    }
+
+    std::vector<uint32_t> ready;
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        if (m_passes[p].live && waiting[p] == 0) {
+            ready.push_back(p);
+        }
+    }
+
+    // Of the passes that may run next: one rendering into the current
+    // attachments, then one that doesn't render into any, then the first declared
+    const std::vector<Resource>* current = nullptr;
+    while (!ready.empty()) {
+        std::sort(ready.begin(), ready.end());
+        size_t pick = 0;
+        bool found = false;
+        if (current) {
+            for (size_t i = 0; i < ready.size() && !found; i++) {
+                if (m_passes[ready[i]].attachments == *current) {
+                    pick = i;
+                    found = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < ready.size() && !found; i++) {
+            if (m_passes[ready[i]].attachments.empty()) {
+                pick = i;
+                found = true;
+            }
+        }
+
+        uint32_t p = ready[pick];
+        ready.erase(ready.begin() + pick);
+        m_order.push_back(p);
+        if (!m_passes[p].attachments.empty()) {
+            current = &m_passes[p].attachments;
+        }
+
+        for (uint32_t dependent : dependents[p]) {
+            if (--waiting[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+}
+
+void RenderGraph::assignTextures()
+{
+    // Lifetimes as positions in the execution order
+    for (size_t i = 0; i < m_order.size(); i++) {
+        const PassNode& pass = m_passes[m_order[i]];
+        for (const std::vector<Resource>* list : { &pass.reads, &pass.attachments, &pass.writes }) {
+            for (Resource resource : *list) {
+                ResourceNode& node = m_resources[resource];
+                if (node.kind != Kind::Transient) continue;
+                if (node.firstUse < 0) {
+                    node.firstUse = static_cast<int>(i);
+                }
+                node.lastUse = static_cast<int>(i);
+            }
+        }
+    }
+
+    // Textures come out of the pool at the first use and go back after the last,
+    // so a later transient of the same description can take one over
+    for (PooledTexture& pooled : m_pool) {
+        pooled.inUse = false;
+    }
+    for (int i = 0; i < static_cast<int>(m_order.size()); i++) {
+        for (ResourceNode& node : m_resources) {
+            if (node.firstUse == i) {
+                node.texture = acquireTexture(node.desc);
+            }
+        }
+        for (ResourceNode& node : m_resources) {
+            if (node.lastUse == i) {
+                releaseTexture(node.texture);
+            }
+        }
+    }
+}
+
+void RenderGraph::compile()
+{
+    PROFILE_SCOPE("RenderGraph::compile");
+
+    buildDependencies();
+    cull();
+    schedule();
+    assignTextures();
+}
+
+unsigned int RenderGraph::acquireTexture(const TextureDesc& desc)
+{
+    for (PooledTexture& pooled : m_pool) {
+        if (!pooled.inUse && sameDesc(pooled.desc, desc)) {
+            pooled.inUse = true;
+            pooled.lastUsedFrame = m_frame;
+            return pooled.texture;
+        }
+    }
+
+    GLenum internalFormat = GL_RGBA8;
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    size_t bytesPerPixel = 4;
+    const char* formatName = "RGBA8";
+    if (desc.format == Format::RGBA16F) {
+        internalFormat = GL_RGBA16F;
+        type = GL_HALF_FLOAT;
+        bytesPerPixel = 8;
+        formatName = "RGBA16F";
+    }
+    else if (desc.format == Format::Depth24Stencil8) {
+        internalFormat = GL_DEPTH24_STENCIL8;
+        format = GL_DEPTH_STENCIL;
+        type = GL_UNSIGNED_INT_24_8;
+        formatName = "D24S8";
+    }
+
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, desc.width, desc.height, 0, format, type, nullptr);
+    GLint filter = isDepthFormat(desc.format) ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    ResourceRegistry::Resource resource;
+    resource.kind = ResourceRegistry::Kind::Texture;
+    resource.id = texture;
+    resource.category = ResourceCategory::RenderTarget;
+    resource.name = "render graph pool";
+    resource.owner = "engine";
+    resource.format = formatName;
+    resource.width = desc.width;
+    resource.height = desc.height;
+    resource.levels = 1;
+    resource.layers = 1;
+    resource.gpuBytes = static_cast<size_t>(desc.width) * desc.height * bytesPerPixel;
+    ResourceRegistry::get().add(std::move(resource));
+
+    m_pool.push_back({ texture, desc, true, m_frame });
+    return texture;
+}
+
+void RenderGraph::releaseTexture(unsigned int texture)
+{
+    for (PooledTexture& pooled : m_pool) {
+        if (pooled.texture == texture) {
+            pooled.inUse = false;
+            return;
+        }
+    }
+}
+
+void RenderGraph::evictTextures()
+{
+    for (size_t i = 0; i < m_pool.size();) {
+        if (m_frame - m_pool[i].lastUsedFrame <= EVICT_FRAMES) {
+            i++;
+            continue;
+        }
+
+        // Framebuffers built on it go too
+        unsigned int texture = m_pool[i].texture;
+        for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+            if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+                glDeleteFramebuffers(1, &it->second);
+                it = m_framebuffers.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Texture, texture);
+        glDeleteTextures(1, &texture);
+        m_pool.erase(m_pool.begin() + i);
+    }
+}
+
+unsigned int RenderGraph::getFramebuffer(const PassNode& pass)
+{
+    // The backbuffer can't be combined with textures
+    std::vector<unsigned int> key;
+    for (Resource resource : pass.attachments) {
+        const ResourceNode& node = m_resources[resource];
+        if (node.kind == Kind::Backbuffer) {
+            if (pass.attachments.size() > 1) {
+                std::cerr << "Render pass " << pass.name << " mixes the backbuffer with textures" << std::endl;
+            }
+            return 0;
+        }
+        key.push_back(node.texture);
+    }
+
+    auto found = m_framebuffers.find(key);
+    if (found != m_framebuffers.end()) {
+        return found->second;
+    }
+
+    unsigned int framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    std::vector<GLenum> drawBuffers;
+    for (Resource resource : pass.attachments) {
+        const ResourceNode& node = m_resources[resource];
+        if (isDepthFormat(node.desc.format)) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, node.texture, 0);
+        }
+        else {
+            GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, node.texture, 0);
+            drawBuffers.push_back(attachment);
+        }
+    }
+    if (drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else {
+        glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Framebuffer for render pass " << pass.name << " is incomplete" << std::endl;
+    }
+
+    m_framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
+void RenderGraph::execute()
+{
+    PROFILE_SCOPE("RenderGraph::execute");
+
+    // Nothing is known to be bound going in
+    bool bound = false;
+    unsigned int current = 0;
+    for (uint32_t index : m_order) {
+        const PassNode& pass = m_passes[index];
+
+        if (!pass.attachments.empty()) {
+            // Creating a framebuffer binds it, so look it up before comparing
+            unsigned int framebuffer = getFramebuffer(pass);
+            if (!bound || framebuffer != current) {
+                glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+                current = framebuffer;
+                bound = true;
+                m_framebufferSwitches++;
+            }
+
+            const TextureDesc& size = m_resources[pass.attachments[0]].desc;
+            glViewport(0, 0, pass.viewportWidth > 0 ? pass.viewportWidth : size.width,
+                pass.viewportHeight > 0 ? pass.viewportHeight : size.height);
+        }
+
+        PROFILE_SCOPE(pass.name);
+        pass.execute();
+    }
+}
+
+unsigned int RenderGraph::getTexture(Resource resource) const
+{
+    return resource < m_resources.size() ? m_resources[resource].texture : 0;
+}
+
+std::vector<std::string> RenderGraph::getPassOrder() const
+{
+    std::vector<std::string> names;
+    for (uint32_t index : m_order) {
+        names.push_back(m_passes[index].name);
+    }
+    return names;
+}
+
+void RenderGraph::release()
+{
+    for (auto& framebuffer : m_framebuffers) {
+        glDeleteFramebuffers(1, &framebuffer.second);
+    }
+    m_framebuffers.clear();
+
+    for (PooledTexture& pooled : m_pool) {
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Texture, pooled.texture);
+        glDeleteTextures(1, &pooled.texture);
+    }
+    m_pool.clear();
+}
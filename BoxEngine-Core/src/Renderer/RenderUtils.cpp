@@ -0,0 +1,13 @@
+#include "Renderer/RenderUtils.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+size_t getMaxBufferTexels()
+{
+    static GLint texels = 0;
+    if (texels == 0) {
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &texels);
+        texels = std::max(texels, 65536);
+    }
+    return static_cast<size_t>(texels);
+}
@@ -1,21 +1,45 @@
 #include "Renderer/Renderer.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Renderer/TextureStreamer.h"
+#include "Renderer/TextureUploader.h"
+#include "Core/Time.h"
 #include "Core/Window.h"
+#include "Utils/Profiler.h"
 #include "Utils/Scene.h"
 #include <glad/glad.h>
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <unordered_map>
 #include <glm/gtc/type_ptr.hpp>
 
+static const GLuint64 FENCE_TIMEOUT_NS = 100000000;     // 100 ms per wait, retried until signalled
+
 Renderer::Renderer(Window* target)
     : m_viewMatrix(glm::mat4(1.0f))
     , m_projectionMatrix(glm::mat4(1.0f))
 {
     attach(target);
-    m_defaultShader.LoadFromFile("assets/Shaders/main.vert", "assets/Shaders/main.frag");
+    m_defaultShaders.LoadFromFile("assets/Shaders/main.vert", "assets/Shaders/main.frag", ObjectBuffer::getShaderDefines());
+    m_depthShader.LoadFromFile("assets/Shaders/depth.vert", "assets/Shaders/depth.frag", ObjectBuffer::getShaderDefines());
 }
 
 Renderer::~Renderer()
 {
-    // Cleanup if needed
+    // Staging buffers belong to this context
+    if (m_initialized) {
+        TextureUploader::get().shutdown();
+        m_objects.release();
+        m_lightClusters.release();
+        m_prepassTimer.release();
+        m_shadingTimer.release();
+        m_occlusionQueries.release();
+        m_shadows.release();
+        m_dynamicResolution.release();
+        m_frameGraph.release();
+        setMaxFramesInFlight(0);
+    }
     m_target = nullptr;
 }
 
@@ -85,7 +109,16 @@ void Renderer::setClearColor(glm::vec4 color)
 
 void Renderer::setViewport(int width, int height)
 {
-    glViewport(0, 0, width, height);
+    m_windowWidth = width;
+    m_windowHeight = height;
+    m_dynamicResolution.resize(width, height);
+
+    // With dynamic resolution, beginFrame sets the scaled viewport
+    if (!m_useDynamicResolution) {
+        glViewport(0, 0, width, height);
+        m_viewportWidth = width;
+        m_viewportHeight = height;
+    }
 
     // Update projection matrix if it's an identity matrix (default)
     if (m_projectionMatrix == glm::mat4(1.0f) && width > 0 && height > 0) {
@@ -101,9 +134,45 @@ void Renderer::beginFrame()
     // Reset statistics
     resetStats();
 
-    // Clear buffers
-    glClearColor(m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Hold the CPU back until the GPU has finished the frame m_maxFramesInFlight back
+    if (m_maxFramesInFlight > 0 && m_frameFences.size() >= static_cast<size_t>(m_maxFramesInFlight)) {
+        PROFILE_SCOPE("Renderer::waitForFrames");
+        double start = Time::now();
+        while (m_frameFences.size() >= static_cast<size_t>(m_maxFramesInFlight)) {
+            GLsync sync = static_cast<GLsync>(m_frameFences.front());
+            if (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED) {
+                continue;
+            }
+            glDeleteSync(sync);
+            m_frameFences.pop_front();
+        }
+        m_stats.fenceWaitMs = (Time::now() - start) * 1000.0;
+    }
+    m_drawQueue.clear();
+    m_objects.clear();
+    m_lights.clear();
+    m_views.clear();
+    m_objectBounds.clear();
+    m_occlusionCuller.clear();
+
+    ResourceRegistry::get().beginFrame();
+
+    // Check the prepared variants the driver is done with, the rest wait for their first draw
+    m_defaultShaders.Poll();
+
+    // Fence last frame's staged uploads, then move streaming textures towards
+    // what last frame's draws asked for
+    TextureUploader::get().update();
+    TextureStreamer::get().update();
+
+    // The frame graph renders the scene at this scale and stretches it over the window
+    m_scaledFrame = m_useDynamicResolution && m_dynamicResolution.begin();
+    if (m_scaledFrame) {
+        m_viewportWidth = m_dynamicResolution.getWidth();
+        m_viewportHeight = m_dynamicResolution.getHeight();
+        m_stats.renderScale = m_dynamicResolution.getScale();
+        m_stats.frameGpuMs = m_dynamicResolution.getGpuMilliseconds();
+    }
 
     // Apply render settings
     if (m_depthTesting) {
@@ -132,9 +201,22 @@ void Renderer::endFrame()
 {
     if (!m_target || !m_initialized) return;
 
+    prepareDraws();
+    buildFrameGraph();
+    m_frameGraph.compile();
+    m_frameGraph.execute();
+    m_stats.passesCulled = static_cast<int>(m_frameGraph.getCulledCount());
+    m_stats.framebufferSwitches = m_frameGraph.getFramebufferSwitches();
+    m_stats.renderTargets = static_cast<int>(m_frameGraph.getPoolSize());
+    m_scaledFrame = false;
+
     // Swap buffers
     m_target->swapBuffers();
 
+    if (m_maxFramesInFlight > 0) {
+        m_frameFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    }
+
     // Optional: Print stats in debug mode
 #ifdef NDEBUG
     if (m_stats.drawCalls > 0) {
@@ -159,78 +241,692 @@ void Renderer::render()
 void Renderer::renderModel(const Model& model, const glm::mat4& transform)
 {
     if (!model.isValid()) return;
-    
+
+    // All meshes share the model's matrices
+    uint32_t object = m_objects.add(transform);
+    size_t triangles = 0;
+    for (const auto& mesh : model.getMeshes()) {
+        if (mesh) {
+            requestTextureDetail(*mesh, transform);
+            m_drawQueue.push_back({ mesh.get(), object });
+            triangles += mesh->getIndices().size() / 3;
+            if (model.isOccluder()) {
+                m_occlusionCuller.addOccluder(*mesh, transform);
+            }
+        }
+    }
+    m_objectBounds.push_back({ model.getMinBounds(), model.getMaxBounds(), model.isOccluder(), &model, triangles });
+}
+
+void Renderer::renderMesh(Mesh& mesh, const glm::mat4& transform)
+{
+    if (mesh.isEmpty()) return;
+
+    requestTextureDetail(mesh, transform);
+    m_drawQueue.push_back({ &mesh, m_objects.add(transform) });
+    m_objectBounds.push_back({ mesh.getMinBounds(), mesh.getMaxBounds(), false, &mesh, mesh.getIndices().size() / 3 });
+}
+
+void Renderer::addOccluder(const Mesh& mesh, const glm::mat4& transform)
+{
+    m_occlusionCuller.addOccluder(mesh, transform);
+}
+
+void Renderer::setOcclusionCulling(bool enable)
+{
+    m_occlusionCulling = enable;
+}
+
+void Renderer::setOcclusionQueries(bool enable)
+{
+    // Queries and their history are useless once off
+    if (!enable) {
+        m_occlusionQueries.release();
+    }
+    m_useQueries = enable;
+}
+
+void Renderer::classifyQueries()
+{
+    m_occlusionQueries.beginFrame(ResourceRegistry::get().getFrame());
+
+    glm::vec3 camera = glm::vec3(glm::inverse(m_viewMatrix)[3]);
+    size_t minTriangles = m_occlusionQueries.getSettings().minTriangles;
+
+    // Instances of one Model need queries of their own. The nth time a key is
+    // queued names the instance, stable as long as the queue order is.
+    std::unordered_map<const void*, uint32_t> occurrences;
+    m_queryModes.assign(m_objectBounds.size(), OcclusionQueries::Mode::Draw);
+    m_queryKeys.assign(m_objectBounds.size(), 0);
+    for (size_t i = 0; i < m_objectBounds.size(); i++) {
+        const ObjectBounds& bounds = m_objectBounds[i];
+        if (bounds.triangles < minTriangles) continue;
+
+        uint32_t occurrence = occurrences[bounds.key]++;
+        if (occurrence > 0xFFFF) continue;
+        m_queryKeys[i] = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(bounds.key)) << 16) | occurrence;
+
+        // The near plane cuts a box the camera is in, its query would say nothing useful
+        glm::vec3 local = glm::vec3(glm::inverse(m_objects.getModel(static_cast<uint32_t>(i))) * glm::vec4(camera, 1.0f));
+        bool inside = local.x >= bounds.min.x && local.y >= bounds.min.y && local.z >= bounds.min.z &&
+                      local.x <= bounds.max.x && local.y <= bounds.max.y && local.z <= bounds.max.z;
+
+        m_queryModes[i] = m_occlusionQueries.classify(m_queryKeys[i], inside);
+        if (isHidden(static_cast<uint32_t>(i))) {
+            m_stats.objectsHidden++;
+        }
+    }
+}
+
+bool Renderer::isHidden(uint32_t object) const
+{
+    if (!m_useQueries || object >= m_queryModes.size()) return false;
+    OcclusionQueries::Mode mode = m_queryModes[object];
+    return mode == OcclusionQueries::Mode::QueryBox || mode == OcclusionQueries::Mode::Conditional;
+}
+
+void Renderer::drawHidden(Shader*& current)
+{
+    PROFILE_SCOPE("Renderer::drawHidden");
+
+    // Every box first against the finished depth buffer, so the results have
+    // a head start before the conditional draws ask for them
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+
+    glm::mat4 viewProjection = m_projectionMatrix * m_viewMatrix;
+    bool anyHidden = false;
+    for (size_t i = 0; i < m_queryModes.size(); i++) {
+        if (!isHidden(static_cast<uint32_t>(i))) continue;
+        anyHidden = true;
+        if (m_queryModes[i] != OcclusionQueries::Mode::QueryBox) continue;
+
+        const ObjectBounds& bounds = m_objectBounds[i];
+        m_occlusionQueries.beginQuery(m_queryKeys[i]);
+        m_occlusionQueries.drawBox(viewProjection * m_objects.getModel(static_cast<uint32_t>(i)), bounds.min, bounds.max);
+        m_occlusionQueries.endQuery();
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    if (m_backfaceCulling) {
+        glEnable(GL_CULL_FACE);
+    }
+    current = nullptr;
+    m_stats.occlusionQueries = static_cast<int>(m_occlusionQueries.getQueriesIssued());
+    if (!anyHidden) return;
+
+    // The GPU skips these if the box query already came back empty
+    for (size_t i = 0; i < m_drawQueue.size();) {
+        uint32_t object = m_drawQueue[i].object;
+        size_t end = i + 1;
+        while (end < m_drawQueue.size() && m_drawQueue[end].object == object) end++;
+
+        if (isHidden(object)) {
+            bool conditional = m_occlusionQueries.beginConditional(m_queryKeys[object]);
+            for (size_t j = i; j < end; j++) {
+                shadeItem(m_drawQueue[j], current);
+            }
+            if (conditional) {
+                m_occlusionQueries.endConditional();
+            }
+        }
+        i = end;
+    }
+}
+
+void Renderer::addView(const View& view)
+{
+    // Bit 0 is the main view, the rest are left for these
+    if (m_views.size() < static_cast<size_t>(ViewCuller::MAX_VIEWS - 1)) {
+        m_views.push_back(view);
+    }
+}
+
+void Renderer::cullViews()
+{
+    PROFILE_SCOPE("Renderer::cullViews");
+
+    m_viewCuller.clear();
+    m_viewCuller.addView(m_projectionMatrix * m_viewMatrix);
+    for (const View& view : m_views) {
+        m_viewCuller.addView(view.projection * view.view);
+    }
+    for (size_t i = 0; i < m_objectBounds.size(); i++) {
+        const ObjectBounds& bounds = m_objectBounds[i];
+        m_viewCuller.addObject(bounds.min, bounds.max, m_objects.getModel(static_cast<uint32_t>(i)));
+    }
+    m_viewCuller.cull(m_framePool);
+
+    // Sorted once for all extra views, each walks the variants and meshes in the same order
+    if (!m_views.empty()) {
+        for (const DrawItem& item : m_drawQueue) {
+            if (m_viewCuller.getMask(item.object) & ~1u) {
+                m_viewItems.push_back(item);
+            }
+        }
+        std::stable_sort(m_viewItems.begin(), m_viewItems.end(), [](const DrawItem& a, const DrawItem& b) {
+            uint32_t featuresA = a.mesh->getShaderFeatures();
+            uint32_t featuresB = b.mesh->getShaderFeatures();
+            return featuresA != featuresB ? featuresA < featuresB : std::less<Mesh*>()(a.mesh, b.mesh);
+        });
+
+        m_viewDraws.resize(m_views.size());
+        for (uint32_t i = 0; i < m_viewItems.size(); i++) {
+            uint32_t mask = m_viewCuller.getMask(m_viewItems[i].object);
+            for (size_t view = 0; view < m_views.size(); view++) {
+                if (mask & (2u << view)) {
+                    m_viewDraws[view].push_back(i);
+                }
+            }
+        }
+    }
+
+    // The main view keeps what its frustum holds
+    for (size_t i = 0; i < m_objectBounds.size(); i++) {
+        if (!(m_viewCuller.getMask(static_cast<uint32_t>(i)) & 1u)) {
+            m_stats.objectsCulled++;
+        }
+    }
+    m_drawQueue.erase(std::remove_if(m_drawQueue.begin(), m_drawQueue.end(),
+        [&](const DrawItem& item) { return !(m_viewCuller.getMask(item.object) & 1u); }), m_drawQueue.end());
+}
+
+void Renderer::drawViews()
+{
+    m_stats.extraViews = static_cast<int>(m_views.size());
+
+    auto viewportOf = [&](const View& view) {
+        return glm::ivec4(static_cast<int>(view.viewport.x * m_viewportWidth), static_cast<int>(view.viewport.y * m_viewportHeight),
+            static_cast<int>(view.viewport.z * m_viewportWidth), static_cast<int>(view.viewport.w * m_viewportHeight));
+    };
+
+    // All rectangles first, the draws below go back and forth between views
+    glEnable(GL_SCISSOR_TEST);
+    for (const View& view : m_views) {
+        glm::ivec4 rect = viewportOf(view);
+        glScissor(rect.x, rect.y, rect.z, rect.w);
+        glClear(view.clearColor ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_DEPTH_BUFFER_BIT);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    if (m_viewItems.empty()) return;
+
+    m_shadows.bind();
+
+    // Per view state, worked out once
+    struct ViewState {
+        glm::ivec4 rect;
+        glm::mat4 viewProjection;
+        glm::vec3 position;
+        bool mirrored;          // reflections flip the winding
+    };
+    std::vector<ViewState> states;
+    for (const View& view : m_views) {
+        states.push_back({ viewportOf(view), view.projection * view.view, glm::vec3(glm::inverse(view.view)[3]),
+            glm::determinant(glm::mat3(view.view)) < 0.0f });
+    }
+
+    // The list is sorted by variant, then mesh. A variant's per-frame uniforms
+    // and a mesh's material are set once, then every view draws its instances
+    // of that mesh; a view only changes the viewport and its matrices.
+    std::vector<size_t> cursors(m_viewDraws.size(), 0);
+    Shader* current = nullptr;
+    int currentView = -1;
+    for (size_t run = 0; run < m_viewItems.size();) {
+        Mesh* mesh = m_viewItems[run].mesh;
+        size_t end = run + 1;
+        while (end < m_viewItems.size() && m_viewItems[end].mesh == mesh) end++;
+
+        Shader* previous = current;
+        Shader* shader = useDefaultShader(*mesh, current);
+        if (current != previous) {
+            currentView = -1;
+        }
+        if (shader) {
+            mesh->bindMaterial(*shader);
+        }
+
+        for (size_t v = 0; v < m_viewDraws.size(); v++) {
+            const std::vector<uint32_t>& draws = m_viewDraws[v];
+            size_t first = cursors[v];
+            size_t last = first;
+            while (last < draws.size() && draws[last] < end) last++;
+            cursors[v] = last;
+            if (!shader || first == last) continue;
+
+            if (currentView != static_cast<int>(v)) {
+                const ViewState& state = states[v];
+                glViewport(state.rect.x, state.rect.y, state.rect.z, state.rect.w);
+                glFrontFace(state.mirrored ? GL_CW : GL_CCW);
+                shader->SetInt("viewIndex", static_cast<int>(v + 1));
+                shader->SetMat4("viewProjection", state.viewProjection);
+                shader->SetVec3("viewPos", state.position);
+                currentView = static_cast<int>(v);
+            }
+
+            // Bit v + 1 of the culler's masks, bit 0 is the main view
+            for (size_t i = first; i < last; i++) {
+                const DrawItem& item = m_viewItems[draws[i]];
+                shader->SetInt("objectId", static_cast<int>(item.object));
+                cullSubMeshes(item, static_cast<int>(v + 1));
+                m_stats.trianglesDrawn += mesh->drawRanges(m_subMeshVisible);
+                m_stats.drawCalls++;
+                m_stats.viewDrawCalls++;
+                m_stats.verticesDrawn += mesh->getVertices().size();
+            }
+        }
+        run = end;
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glFrontFace(GL_CCW);
+}
+
+void Renderer::cullDraws()
+{
+    PROFILE_SCOPE("Renderer::cullDraws");
+
+    m_occlusionCuller.rasterize(m_projectionMatrix * m_viewMatrix, m_framePool);
+
+    std::vector<uint8_t> visible(m_objectBounds.size());
+    for (size_t i = 0; i < m_objectBounds.size(); i++) {
+        // Outside the main view's frustum, cullViews counted it already
+        if (!(m_viewCuller.getMask(static_cast<uint32_t>(i)) & 1u)) continue;
+
+        const ObjectBounds& bounds = m_objectBounds[i];
+        visible[i] = bounds.occluder ||
+            m_occlusionCuller.isVisible(bounds.min, bounds.max, m_objects.getModel(static_cast<uint32_t>(i)));
+        if (!visible[i]) {
+            m_stats.objectsCulled++;
+        }
+    }
+
+    m_drawQueue.erase(std::remove_if(m_drawQueue.begin(), m_drawQueue.end(),
+        [&](const DrawItem& item) { return !visible[item.object]; }), m_drawQueue.end());
+}
+
+void Renderer::prepareDraws()
+{
+    m_frameQueries = false;
+    m_viewItems.clear();
+    m_viewDraws.clear();
+    if (m_drawQueue.empty()) return;
+
+    PROFILE_SCOPE("Renderer::prepareDraws");
+
+    // Matrices for every object in one go, the shaders fetch them by index
+    m_objects.update(m_projectionMatrix * m_viewMatrix);
+    m_objects.bind();
+
+    // Before culling, objects out of view still cast into it
+    collectCasters();
+
+    cullViews();
+
+    // Culled objects keep their slot in the object buffer, only their draws go
+    if (m_occlusionCulling) {
+        cullDraws();
+    }
+
+    // Lights sorted into froxels, fragments only shade with their froxel's list
+    m_lightClusters.update(m_lights, m_viewMatrix, m_projectionMatrix, m_viewportWidth, m_viewportHeight, m_framePool);
+    m_lightClusters.bind();
+
+    // Hidden objects stay out of the main passes, they are drawn last behind their queries
+    m_frameQueries = m_useQueries && m_depthTesting && !m_wireframeMode;
+    if (m_frameQueries) {
+        classifyQueries();
+    }
+    else {
+        m_queryModes.clear();
+    }
+}
+
+void Renderer::buildFrameGraph()
+{
+    PROFILE_SCOPE("Renderer::buildFrameGraph");
+
+    m_frameGraph.reset();
+    RenderGraph::Resource backbuffer = m_frameGraph.importBackbuffer("backbuffer", m_windowWidth, m_windowHeight);
+    RenderGraph::Resource shadowMap = m_frameGraph.importExternal("shadow cascades");
+
+    // Scaled frames go through pooled targets, the others straight into the window.
+    // The first pass into them clears them, beginFrame can't know which that is.
+    RenderGraph::Resource sceneColor = backbuffer;
+    RenderGraph::Resource sceneDepth = backbuffer;
+    if (m_scaledFrame) {
+        RenderGraph::TextureDesc desc;
+        desc.width = m_dynamicResolution.getTargetWidth();
+        desc.height = m_dynamicResolution.getTargetHeight();
+        desc.format = RenderGraph::Format::RGBA8;
+        sceneColor = m_frameGraph.createTexture("scene colour", desc);
+        desc.format = RenderGraph::Format::Depth24Stencil8;
+        sceneDepth = m_frameGraph.createTexture("scene depth", desc);
+    }
+
+    // Without draws nothing samples the cascades and their pass is culled.
+    // A sun without shadows won't need them again soon, so they are freed.
+    bool draws = !m_drawQueue.empty();
+    bool sunShadows = m_sun.castShadows && m_sun.intensity > 0.0f && glm::length(m_sun.direction) > 0.0f;
+    if (!sunShadows) {
+        m_shadows.release();
+    }
+
+    m_frameGraph.addPass("shadows",
+        [&](RenderGraph::PassBuilder& pass) {
+            pass.write(shadowMap);
+        },
+        [this]() { renderShadows(); });
+
+    // Depth first, the shading pass then only passes the nearest fragment
+    bool prepass = draws && m_depthPrepass && m_depthTesting && !m_wireframeMode && m_depthShader.GetID() != 0;
+    if (prepass) {
+        m_frameGraph.addPass("depth prepass",
+            [&](RenderGraph::PassBuilder& pass) {
+                // Colour too, so both passes share one framebuffer
+                pass.attach(sceneColor);
+                pass.attach(sceneDepth);
+                pass.setViewport(m_viewportWidth, m_viewportHeight);
+            },
+            [this]() { drawDepth(); });
+    }
+
+    m_frameGraph.addPass("opaque",
+        [&](RenderGraph::PassBuilder& pass) {
+            if (draws && sunShadows) {
+                pass.read(shadowMap);
+            }
+            pass.attach(sceneColor);
+            pass.attach(sceneDepth);
+            pass.setViewport(m_viewportWidth, m_viewportHeight);
+        },
+        [this, prepass]() { drawScene(prepass); });
+
+    // Same targets as the opaque pass, the graph keeps them back to back
+    if (!m_views.empty()) {
+        m_frameGraph.addPass("views",
+            [&](RenderGraph::PassBuilder& pass) {
+                if (draws && sunShadows) {
+                    pass.read(shadowMap);
+                }
+                pass.attach(sceneColor);
+                pass.attach(sceneDepth);
+                pass.setViewport(m_viewportWidth, m_viewportHeight);
+            },
+            [this]() { drawViews(); });
+    }
+
+    if (m_scaledFrame) {
+        m_frameGraph.addPass("upscale",
+            [&](RenderGraph::PassBuilder& pass) {
+                pass.read(sceneColor);
+                pass.attach(backbuffer);
+            },
+            [this, sceneColor]() { m_dynamicResolution.upscale(m_frameGraph.getTexture(sceneColor)); });
+    }
+}
+
+void Renderer::drawDepth()
+{
+    m_prepassTimer.begin();
+
+    glClearColor(m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    m_depthShader.Use();
+    m_depthShader.SetInt("objectData", ObjectBuffer::TEXTURE_UNIT);
+    for (const DrawItem& item : m_drawQueue) {
+        if (isHidden(item.object)) continue;
+        m_depthShader.SetInt("objectId", static_cast<int>(item.object));
+        item.mesh->drawDepth();
+        m_stats.prepassDrawCalls++;
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // Both programs compute gl_Position the same invariant way, so equal is exact
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_EQUAL);
+
+    m_prepassTimer.end();
+    m_stats.prepassGpuMs = m_prepassTimer.getMilliseconds();
+}
+
+void Renderer::drawScene(bool prepass)
+{
+    // The prepass already cleared both
+    if (!prepass) {
+        glClearColor(m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    if (m_drawQueue.empty()) return;
+
+    m_shadows.bind();
+    m_shadingTimer.begin();
+
+    // Draw all meshes, each with the smallest shader variant its material needs.
+    // An object's meshes are queued together, a query wraps all of them.
+    Shader* current = nullptr;
+    for (size_t i = 0; i < m_drawQueue.size();) {
+        uint32_t object = m_drawQueue[i].object;
+        size_t end = i + 1;
+        while (end < m_drawQueue.size() && m_drawQueue[end].object == object) end++;
+
+        if (isHidden(object)) {
+            i = end;
+            continue;
+        }
+
+        bool query = m_frameQueries && m_queryModes[object] == OcclusionQueries::Mode::QueryDraw;
+        if (query) {
+            m_occlusionQueries.beginQuery(m_queryKeys[object]);
+        }
+        for (; i < end; i++) {
+            shadeItem(m_drawQueue[i], current);
+        }
+        if (query) {
+            m_occlusionQueries.endQuery();
+        }
+    }
+
+    // glClear skips the depth buffer while writes are off
+    if (prepass) {
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+
+    if (m_frameQueries) {
+        drawHidden(current);
+    }
+
+    m_shadingTimer.end();
+    m_stats.shadingGpuMs = m_shadingTimer.getMilliseconds();
+}
+
+void Renderer::shadeItem(const DrawItem& item, Shader*& current)
+{
+    Shader* shader = useDefaultShader(*item.mesh, current);
+    if (!shader) return;
+
+    shader->SetInt("objectId", static_cast<int>(item.object));
+    m_stats.drawCalls++;
+    m_stats.verticesDrawn += item.mesh->getVertices().size();
+
+    cullSubMeshes(item, 0);
+    m_stats.trianglesDrawn += item.mesh->drawSubMeshes(*shader, m_subMeshVisible);
+}
+
+void Renderer::cullSubMeshes(const DrawItem& item, int view)
+{
+    // Parts of a statically batched mesh are culled one by one, the rest go in one multi-draw
+    const std::vector<Mesh::SubMesh>& subMeshes = item.mesh->getSubMeshes();
+    m_subMeshVisible.assign(subMeshes.size(), false);
+    if (subMeshes.empty()) return;
+
+    const glm::mat4& model = m_objects.getModel(item.object);
+    for (size_t i = 0; i < subMeshes.size(); i++) {
+        m_subMeshVisible[i] = m_viewCuller.isVisible(view, subMeshes[i].minBounds, subMeshes[i].maxBounds, model);
+    }
+}
+
+void Renderer::addLight(const PointLight& light)
+{
+    m_lights.push_back(light);
+}
+
+void Renderer::setDynamicResolution(bool enable)
+{
+    m_useDynamicResolution = enable;
+    if (!enable) {
+        m_dynamicResolution.release();
+        glViewport(0, 0, m_windowWidth, m_windowHeight);
+        m_viewportWidth = m_windowWidth;
+        m_viewportHeight = m_windowHeight;
+    }
+}
+
+void Renderer::setMaxFramesInFlight(int frames)
+{
+    m_maxFramesInFlight = std::max(0, frames);
+    if (m_maxFramesInFlight == 0) {
+        for (void* fence : m_frameFences) {
+            glDeleteSync(static_cast<GLsync>(fence));
+        }
+        m_frameFences.clear();
+    }
+}
+
+void Renderer::setDirectionalLight(const DirectionalLight& light)
+{
+    m_sun = light;
+}
+
+void Renderer::collectCasters()
+{
+    // Everything queued casts, whether the camera sees it or not
+    m_casters.clear();
+    m_casterMeshes.clear();
+    for (size_t i = 0; i < m_drawQueue.size();) {
+        uint32_t object = m_drawQueue[i].object;
+        const ObjectBounds& bounds = m_objectBounds[object];
+
+        ShadowCascades::Caster caster;
+        caster.min = bounds.min;
+        caster.max = bounds.max;
+        caster.transform = m_objects.getModel(object);
+        caster.key = bounds.key;
+        caster.object = object;
+        caster.firstMesh = static_cast<uint32_t>(m_casterMeshes.size());
+        for (; i < m_drawQueue.size() && m_drawQueue[i].object == object; i++) {
+            m_casterMeshes.push_back(m_drawQueue[i].mesh);
+        }
+        caster.meshCount = static_cast<uint32_t>(m_casterMeshes.size()) - caster.firstMesh;
+        m_casters.push_back(caster);
+    }
+}
+
+void Renderer::renderShadows()
+{
+    m_shadows.render(m_sun, m_viewMatrix, m_projectionMatrix, m_casters, m_casterMeshes);
+    m_stats.shadowDrawCalls = m_shadows.getDrawCalls();
+    m_stats.shadowCascadesRendered = m_shadows.getCascadesRendered();
+    m_stats.shadowGpuMs = m_shadows.getGpuMilliseconds();
+    if (m_shadows.getCascadesRendered() == 0) return;
+
+    // The graph sets the viewport of the passes that follow
+    if (!m_depthTesting) {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if (m_wireframeMode) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    }
+}
+
+void Renderer::prepareShaders(const Model& model)
+{
+    std::vector<uint32_t> featureMasks;
+    for (const auto& mesh : model.getMeshes()) {
+        if (!mesh) continue;
+        uint32_t features = mesh->getShaderFeatures();
+        if (std::find(featureMasks.begin(), featureMasks.end(), features) == featureMasks.end()) {
+            featureMasks.push_back(features);
+        }
+    }
+    m_defaultShaders.Prepare(featureMasks);
+}
+
+Shader* Renderer::useDefaultShader(const Mesh& mesh, Shader*& current)
+{
+    Shader* shader = m_defaultShaders.Get(mesh.getShaderFeatures());
+    if (!shader || shader == current) {
+        return shader;
+    }
+    current = shader;
+
     // Use default shader
-    m_defaultShader.Use();
+    shader->Use();
     
-    // Set matrices
-    m_defaultShader.SetMat4("model", transform);
-    m_defaultShader.SetMat4("view", m_viewMatrix);
-    m_defaultShader.SetMat4("projection", m_projectionMatrix);
+    // Matrices come from the object buffer
+    shader->SetInt("objectData", ObjectBuffer::TEXTURE_UNIT);
+    Mesh::setArraySamplers(*shader);
     
-    // Set lighting uniforms (check if they exist first)
-    int lightPosLoc = glGetUniformLocation(m_defaultShader.GetID(), "lightPos");
-    if (lightPosLoc != -1) {
-        m_defaultShader.SetVec3("lightPos", glm::vec3(5.0f, 5.0f, 5.0f));
+    // Set lighting uniforms (check if they exist first, variants drop the ones they don't use)
+    m_lightClusters.setUniforms(*shader);
+    m_shadows.setUniforms(*shader);
+
+    int sunColorLoc = glGetUniformLocation(shader->GetID(), "sunColor");
+    if (sunColorLoc != -1) {
+        bool sunOn = m_sun.intensity > 0.0f && glm::length(m_sun.direction) > 0.0f;
+        shader->SetVec3("sunColor", sunOn ? m_sun.color * m_sun.intensity : glm::vec3(0.0f));
+        shader->SetVec3("sunDirection", sunOn ? -glm::normalize(m_sun.direction) : glm::vec3(0.0f, 1.0f, 0.0f));
     }
-    
-    int viewPosLoc = glGetUniformLocation(m_defaultShader.GetID(), "viewPos");
+
+    int viewPosLoc = glGetUniformLocation(shader->GetID(), "viewPos");
     if (viewPosLoc != -1) {
-        m_defaultShader.SetVec3("viewPos", glm::vec3(0.0f, 0.0f, 3.0f));
+        shader->SetVec3("viewPos", glm::vec3(glm::inverse(m_viewMatrix)[3]));
     }
-    
-    int lightColorLoc = glGetUniformLocation(m_defaultShader.GetID(), "lightColor");
-    if (lightColorLoc != -1) {
-        m_defaultShader.SetVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
+
+    // The main view, drawViews sets the extra ones
+    int viewIndexLoc = glGetUniformLocation(shader->GetID(), "viewIndex");
+    if (viewIndexLoc != -1) {
+        shader->SetInt("viewIndex", 0);
     }
     
-    int objectColorLoc = glGetUniformLocation(m_defaultShader.GetID(), "objectColor");
+    int objectColorLoc = glGetUniformLocation(shader->GetID(), "objectColor");
     if (objectColorLoc != -1) {
-        m_defaultShader.SetVec3("objectColor", glm::vec3(0.8f, 0.8f, 0.8f));
+        shader->SetVec3("objectColor", glm::vec3(0.8f, 0.8f, 0.8f));
     }
     
-    int ambientStrengthLoc = glGetUniformLocation(m_defaultShader.GetID(), "ambientStrength");
+    int ambientStrengthLoc = glGetUniformLocation(shader->GetID(), "ambientStrength");
     if (ambientStrengthLoc != -1) {
-        m_defaultShader.SetFloat("ambientStrength", 0.1f);
+        shader->SetFloat("ambientStrength", 0.1f);
     }
     
-    int specularStrengthLoc = glGetUniformLocation(m_defaultShader.GetID(), "specularStrength");
+    int specularStrengthLoc = glGetUniformLocation(shader->GetID(), "specularStrength");
     if (specularStrengthLoc != -1) {
-        m_defaultShader.SetFloat("specularStrength", 0.5f);
-    }
-    
-    // Draw all meshes
-    for (const auto& mesh : model.getMeshes()) {
-        if (mesh) {
-            mesh->draw(m_defaultShader);
-            m_stats.drawCalls++;
-            m_stats.trianglesDrawn += mesh->getIndices().size() / 3;
-            m_stats.verticesDrawn += mesh->getVertices().size();
-        }
+        shader->SetFloat("specularStrength", 0.5f);
     }
+    return shader;
 }
 
-void Renderer::renderMesh(Mesh& mesh, const glm::mat4& transform)
+void Renderer::requestTextureDetail(const Mesh& mesh, const glm::mat4& transform)
 {
-    if (mesh.isEmpty()) return;
+    if (TextureStreamer::get().getTextureCount() == 0) return;
 
-    m_defaultShader.Use();
+    // Projected diameter of the bounding sphere, the camera inside it asks for everything
+    glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.getCenter(), 1.0f));
+    float scale = std::max(glm::length(glm::vec3(transform[0])),
+        std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    float radius = mesh.getBoundingSphereRadius() * scale;
+    float distance = -(m_viewMatrix * glm::vec4(center, 1.0f)).z;
 
-    m_defaultShader.SetMat4("model", transform);
-    m_defaultShader.SetMat4("view", m_viewMatrix);
-    m_defaultShader.SetMat4("projection", m_projectionMatrix);
+    float screenSize = distance > radius
+        ? radius * m_projectionMatrix[1][1] * static_cast<float>(m_viewportHeight) / distance
+        : static_cast<float>(std::numeric_limits<int>::max());
 
-    m_defaultShader.SetVec3("lightPos", glm::vec3(5.0f, 5.0f, 5.0f));
-    m_defaultShader.SetVec3("viewPos", glm::vec3(0.0f, 0.0f, 3.0f));
-    m_defaultShader.SetVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
-    m_defaultShader.SetVec3("objectColor", glm::vec3(0.8f, 0.8f, 0.8f));
-    m_defaultShader.SetFloat("ambientStrength", 0.1f);
-    m_defaultShader.SetFloat("specularStrength", 0.5f);
-
-    mesh.draw(m_defaultShader);
-    m_stats.drawCalls++;
-    m_stats.trianglesDrawn += mesh.getIndices().size() / 3;
-    m_stats.verticesDrawn += mesh.getVertices().size();
+    for (const auto& texture : mesh.getTextures()) {
+        TextureStreamer::get().requestSize(texture.get(), screenSize);
+    }
 }
 
 //void Renderer::renderScene(const Scene& scene)
@@ -259,6 +955,11 @@ void Renderer::setDepthTesting(bool enable)
     m_depthTesting = enable;
 }
 
+void Renderer::setDepthPrepass(bool enable)
+{
+    m_depthPrepass = enable;
+}
+
 void Renderer::setBackfaceCulling(bool enable)
 {
     m_backfaceCulling = enable;
@@ -0,0 +1,248 @@
+#include "Renderer/ResourceRegistry.h"
+#include "Utils/Json.h"
+#include "Utils/Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+static const size_t CATEGORY_COUNT = static_cast<size_t>(ResourceCategory::Count);
+
+ResourceRegistry& ResourceRegistry::get()
+{
+    static ResourceRegistry registry;
+    return registry;
+}
+
+const char* ResourceRegistry::getCategoryName(ResourceCategory category)
+{
+    switch (category) {
+    case ResourceCategory::Texture:             return "Texture";
+    case ResourceCategory::StreamingTexture:    return "StreamingTexture";
+    case ResourceCategory::DefaultTexture:      return "DefaultTexture";
+    case ResourceCategory::TextureArray:        return "TextureArray";
+    case ResourceCategory::VertexBuffer:        return "VertexBuffer";
+    case ResourceCategory::IndexBuffer:         return "IndexBuffer";
+    case ResourceCategory::StagingBuffer:       return "StagingBuffer";
+    case ResourceCategory::FrameData:           return "FrameData";
+    case ResourceCategory::RenderTarget:        return "RenderTarget";
+    default:                                    return "Unknown";
+    }
+}
+
+const char* ResourceRegistry::getFormatName(BlockFormat format, int channels)
+{
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC4: return "BC4";
+    case BlockFormat::BC5: return "BC5";
+    case BlockFormat::BC7: return "BC7";
+    default: break;
+    }
+    switch (channels) {
+    case 1: return "R8";
+    case 2: return "RG8";
+    case 3: return "RGB8";
+    default: return "RGBA8";
+    }
+}
+
+void ResourceRegistry::add(Resource resource)
+{
+    if (resource.id == 0) return;
+
+    Resource& entry = m_resources[makeKey(resource.kind, resource.id)];
+    if (entry.id != 0) {
+        // Re-specified storage of a live object
+        if (resource.owner.empty()) {
+            resource.owner = std::move(entry.owner);
+        }
+        resource.createdFrame = entry.createdFrame;
+    }
+    else {
+        if (resource.owner.empty()) {
+            resource.owner = Profiler::getCurrentAsset();
+        }
+        resource.createdFrame = m_frame;
+    }
+    resource.lastUsedFrame = m_frame;
+    entry = std::move(resource);
+}
+
+void ResourceRegistry::remove(Kind kind, unsigned int id)
+{
+    m_resources.erase(makeKey(kind, id));
+}
+
+void ResourceRegistry::resize(Kind kind, unsigned int id, size_t gpuBytes, size_t cpuBytes, int levels)
+{
+    auto found = m_resources.find(makeKey(kind, id));
+    if (found == m_resources.end()) return;
+
+    found->second.gpuBytes = gpuBytes;
+    found->second.cpuBytes = cpuBytes;
+    if (levels >= 0) {
+        found->second.levels = levels;
+    }
+}
+
+void ResourceRegistry::setCategory(Kind kind, unsigned int id, ResourceCategory category)
+{
+    auto found = m_resources.find(makeKey(kind, id));
+    if (found != m_resources.end()) {
+        found->second.category = category;
+    }
+}
+
+std::vector<ResourceRegistry::Resource> ResourceRegistry::getResources() const
+{
+    std::vector<Resource> resources;
+    resources.reserve(m_resources.size());
+    for (const auto& entry : m_resources) {
+        resources.push_back(entry.second);
+    }
+
+    std::sort(resources.begin(), resources.end(), [](const Resource& a, const Resource& b) {
+        if (a.gpuBytes != b.gpuBytes) return a.gpuBytes > b.gpuBytes;
+        return a.cpuBytes > b.cpuBytes;
+    });
+    return resources;
+}
+
+ResourceRegistry::Summary ResourceRegistry::getSummary() const
+{
+    Summary summary;
+    for (const auto& entry : m_resources) {
+        const Resource& resource = entry.second;
+        CategoryStats& stats = summary[static_cast<size_t>(resource.category)];
+        stats.count++;
+        stats.gpuBytes += resource.gpuBytes;
+        stats.cpuBytes += resource.cpuBytes;
+    }
+    return summary;
+}
+
+size_t ResourceRegistry::getTotalGPUBytes() const
+{
+    size_t total = 0;
+    for (const auto& entry : m_resources) {
+        total += entry.second.gpuBytes;
+    }
+    return total;
+}
+
+size_t ResourceRegistry::getTotalCPUBytes() const
+{
+    size_t total = 0;
+    for (const auto& entry : m_resources) {
+        total += entry.second.cpuBytes;
+    }
+    return total;
+}
+
+static double toMB(size_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+void ResourceRegistry::printSummary(std::ostream& out, uint64_t unusedFrames) const
+{
+    Summary summary = getSummary();
+
+    out << std::fixed << std::setprecision(2);
+    out << "\nGPU resources (frame " << m_frame << ")\n";
+    out << "  " << std::left << std::setw(20) << "Category"
+        << std::right << std::setw(8) << "Count"
+        << std::setw(12) << "VRAM MB"
+        << std::setw(12) << "RAM MB" << "\n";
+
+    CategoryStats total;
+    for (size_t i = 0; i < CATEGORY_COUNT; i++) {
+        const CategoryStats& stats = summary[i];
+        if (stats.count == 0) continue;
+
+        out << "  " << std::left << std::setw(20) << getCategoryName(static_cast<ResourceCategory>(i))
+            << std::right << std::setw(8) << stats.count
+            << std::setw(12) << toMB(stats.gpuBytes)
+            << std::setw(12) << toMB(stats.cpuBytes) << "\n";
+        total.count += stats.count;
+        total.gpuBytes += stats.gpuBytes;
+        total.cpuBytes += stats.cpuBytes;
+    }
+    out << "  " << std::left << std::setw(20) << "Total"
+        << std::right << std::setw(8) << total.count
+        << std::setw(12) << toMB(total.gpuBytes)
+        << std::setw(12) << toMB(total.cpuBytes) << "\n";
+
+    // Candidates for leaks: alive but not bound for a while
+    if (unusedFrames > 0 && m_frame >= unusedFrames) {
+        bool header = false;
+        for (const Resource& resource : getResources()) {
+            if (m_frame - resource.lastUsedFrame < unusedFrames) continue;
+            if (!header) {
+                out << "Unused for " << unusedFrames << "+ frames:\n";
+                header = true;
+            }
+            out << "  " << getCategoryName(resource.category) << " " << resource.id
+                << " " << (resource.name.empty() ? "<unnamed>" : resource.name)
+                << " (" << toMB(resource.gpuBytes) << " MB, last used frame " << resource.lastUsedFrame
+                << ", owner " << (resource.owner.empty() ? "<none>" : resource.owner) << ")\n";
+        }
+    }
+    out << std::defaultfloat << std::flush;
+}
+
+bool ResourceRegistry::writeJson(const std::string& filepath) const
+{
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open resource dump: " << filepath << std::endl;
+        return false;
+    }
+
+    Summary summary = getSummary();
+
+    file << "{\"frame\":" << m_frame
+        << ",\"totalGpuBytes\":" << getTotalGPUBytes()
+        << ",\"totalCpuBytes\":" << getTotalCPUBytes()
+        << ",\"categories\":{";
+    for (size_t i = 0; i < CATEGORY_COUNT; i++) {
+        if (i > 0) file << ",";
+        file << "\n";
+        Json::writeString(file, getCategoryName(static_cast<ResourceCategory>(i)));
+        file << ":{\"count\":" << summary[i].count
+            << ",\"gpuBytes\":" << summary[i].gpuBytes
+            << ",\"cpuBytes\":" << summary[i].cpuBytes << "}";
+    }
+    file << "\n},\"resources\":[";
+
+    std::vector<Resource> resources = getResources();
+    for (size_t i = 0; i < resources.size(); i++) {
+        const Resource& resource = resources[i];
+        if (i > 0) file << ",";
+        file << "\n{\"kind\":\"" << (resource.kind == Kind::Texture ? "texture" : "buffer") << "\""
+            << ",\"id\":" << resource.id
+            << ",\"category\":\"" << getCategoryName(resource.category) << "\""
+            << ",\"name\":";
+        Json::writeString(file, resource.name);
+        file << ",\"owner\":";
+        Json::writeString(file, resource.owner);
+        if (resource.kind == Kind::Texture) {
+            file << ",\"format\":";
+            Json::writeString(file, resource.format);
+            file << ",\"width\":" << resource.width
+                << ",\"height\":" << resource.height
+                << ",\"levels\":" << resource.levels
+                << ",\"layers\":" << resource.layers;
+        }
+        file << ",\"gpuBytes\":" << resource.gpuBytes
+            << ",\"cpuBytes\":" << resource.cpuBytes
+            << ",\"createdFrame\":" << resource.createdFrame
+            << ",\"lastUsedFrame\":" << resource.lastUsedFrame << "}";
+    }
+    file << "\n]}\n";
+
+    return file.good();
+}
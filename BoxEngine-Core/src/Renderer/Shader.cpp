@@ -1,13 +1,74 @@
 #include "Renderer/Shader.h"
+#include "Utils/Hash.h"
+#include "Utils/Profiler.h"
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+// GL 4.1 / ARB_get_program_binary, not in the 3.3 core glad build
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT  0x8257
+#define GL_PROGRAM_BINARY_LENGTH            0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS       0x87FE
+
+// KHR_parallel_shader_compile, the ARB version uses the same enum
+#define GL_COMPLETION_STATUS_KHR            0x91B1
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+static GetProgramBinaryProc s_getProgramBinary = nullptr;
+static ProgramBinaryProc s_programBinary = nullptr;
+static ProgramParameteriProc s_programParameteri = nullptr;
+
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+static std::string s_binaryCacheDirectory = "cache/shaders";
+
+// Header of a cached program binary, the key is checked again on load so a
+// renamed or stale file is never fed to the driver
+struct ProgramBinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+};
+static const char PROGRAM_BINARY_MAGIC[4] = { 'B', 'X', 'P', 'B' };
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+// Strings are fed with their terminator so "ab"+"c" != "a"+"bc", data must have one
+static uint64_t hashString(uint64_t hash, const char* data, size_t size)
+{
+    return hashBytes(hash, data, size + 1);
+}
 
 Shader::Shader() : m_ID(0) {}
 
 Shader::~Shader() {
-    glDeleteProgram(m_ID);
+    Release();
+}
+
+void Shader::Release() {
+    if (m_pending) {
+        glDeleteShader(m_pendingVertex);
+        glDeleteShader(m_pendingFragment);
+        m_pending = false;
+        m_pendingVertex = 0;
+        m_pendingFragment = 0;
+    }
+    if (m_ID != 0) {
+        glDeleteProgram(m_ID);
+        m_ID = 0;
+    }
+    m_saveBinary = false;
+    m_UniformLocationCache.clear();
 }
 
 bool Shader::LoadFromFile(const std::string& vertexPath, const std::string& fragmentPath) {
@@ -22,21 +83,349 @@ bool Shader::LoadFromFile(const std::string& vertexPath, const std::string& frag
     return LoadFromSource(vertexSource, fragmentSource);
 }
 
+bool Shader::LoadFromFile(const std::string& vertexPath, const std::string& fragmentPath,
+    const std::vector<std::string>& defines) {
+    std::string vertexSource = ReadFile(vertexPath);
+    std::string fragmentSource = ReadFile(fragmentPath);
+
+    if (vertexSource.empty() || fragmentSource.empty()) {
+        std::cerr << "Failed to read shader files!" << std::endl;
+        return false;
+    }
+
+    return LoadFromSource(vertexSource, fragmentSource, defines);
+}
+
 bool Shader::LoadFromSource(const std::string& vertexSource, const std::string& fragmentSource) {
-    m_ID = CreateShader(vertexSource, fragmentSource);
+    PROFILE_SCOPE("Shader::LoadFromSource");
+    return Submit(vertexSource, fragmentSource) && Finish();
+}
+
+bool Shader::LoadFromSource(const std::string& vertexSource, const std::string& fragmentSource,
+    const std::vector<std::string>& defines) {
+    // The defines end up in the source text, so they are part of the binary cache key too
+    return LoadFromSource(InjectDefines(vertexSource, defines), InjectDefines(fragmentSource, defines));
+}
+
+bool Shader::Submit(const std::string& vertexSource, const std::string& fragmentSource) {
+    PROFILE_SCOPE("Shader::Submit");
+
+    Release();
+
+    // Try the cached binary first, a mismatch or a rejected binary falls back to compiling
+    bool useCache = !s_binaryCacheDirectory.empty() && HasProgramBinary();
+    if (useCache) {
+        m_cacheKey = ComputeCacheKey(vertexSource, fragmentSource);
+        m_ID = LoadProgramBinary(m_cacheKey);
+        if (m_ID != 0) {
+            return true;
+        }
+    }
+
+    // Make sure the driver was told it may use its own threads before the first compile
+    HasParallelCompile();
+
+    unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexSource);
+    unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    m_ID = CreateShader(vs, fs, useCache);
+
+    m_pending = true;
+    m_pendingVertex = vs;
+    m_pendingFragment = fs;
+    m_saveBinary = useCache;
     return m_ID != 0;
 }
 
-void Shader::Use() const {
+bool Shader::Submit(const std::string& vertexSource, const std::string& fragmentSource,
+    const std::vector<std::string>& defines) {
+    return Submit(InjectDefines(vertexSource, defines), InjectDefines(fragmentSource, defines));
+}
+
+bool Shader::IsReady() const {
+    if (!m_pending || !HasParallelCompile()) {
+        return true;
+    }
+
+    // A finished link means both stages are done compiling as well
+    int done = 0;
+    glGetProgramiv(m_ID, GL_COMPLETION_STATUS_KHR, &done);
+    return done != 0;
+}
+
+bool Shader::Finish() {
+    if (!m_pending) {
+        return m_ID != 0;
+    }
+    PROFILE_SCOPE("Shader::Finish");
+
+    unsigned int vs = m_pendingVertex;
+    unsigned int fs = m_pendingFragment;
+    m_pending = false;
+    m_pendingVertex = 0;
+    m_pendingFragment = 0;
+
+    // Only report the link when both stages compiled, its log just repeats theirs otherwise
+    bool compiled = CheckShader(vs, GL_VERTEX_SHADER);
+    compiled = CheckShader(fs, GL_FRAGMENT_SHADER) && compiled;
+
+    int success = 0;
+    if (compiled) {
+        char infoLog[512];
+        glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(m_ID, 512, nullptr, infoLog);
+            std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+    }
+
+    // The program keeps its own copy of the linked code
+    glDetachShader(m_ID, vs);
+    glDetachShader(m_ID, fs);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    if (!success) {
+        glDeleteProgram(m_ID);
+        m_ID = 0;
+        m_saveBinary = false;
+        return false;
+    }
+
+    if (m_saveBinary) {
+        SaveProgramBinary(m_cacheKey);
+        m_saveBinary = false;
+    }
+    return true;
+}
+
+bool Shader::HasParallelCompile() {
+    static bool queried = false;
+    static bool supported = false;
+    if (!queried) {
+        queried = true;
+
+        // Both versions take the thread count, 0xFFFFFFFF leaves it to the driver
+        MaxShaderCompilerThreadsProc maxThreads = nullptr;
+        if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+            maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        }
+        else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+            maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+        }
+
+        if (maxThreads) {
+            maxThreads(0xFFFFFFFFu);
+            supported = true;
+        }
+    }
+    return supported;
+}
+
+std::vector<std::string> Shader::GetFeatureDefines(uint32_t features) {
+    static const char* FEATURE_DEFINES[SHADER_FEATURE_COUNT] = {
+        "HAS_DIFFUSE",
+        "HAS_DIFFUSE2",
+        "HAS_PACKED",
+        "HAS_NORMAL_MAP",
+        "TEXTURE_ARRAYS"
+    };
+
+    std::vector<std::string> defines;
+    for (uint32_t bit = 0; bit < SHADER_FEATURE_COUNT; bit++) {
+        if (features & (1u << bit)) {
+            defines.push_back(FEATURE_DEFINES[bit]);
+        }
+    }
+    return defines;
+}
+
+std::string Shader::InjectDefines(const std::string& source, const std::vector<std::string>& defines) {
+    if (defines.empty()) {
+        return source;
+    }
+
+    // #version has to stay the first statement, the defines go right after it
+    size_t insertAt = 0;
+    int nextLine = 1;
+    size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        size_t lineEnd = source.find('\n', version);
+        insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+        nextLine = 1 + static_cast<int>(std::count(source.begin(), source.begin() + insertAt, '\n'));
+    }
+
+    std::string injected = source.substr(0, insertAt);
+    if (!injected.empty() && injected.back() != '\n') {
+        injected += '\n';
+    }
+    for (const std::string& define : defines) {
+        injected += "#define " + define + "\n";
+    }
+    injected += "#line " + std::to_string(nextLine) + "\n";
+    injected.append(source, insertAt, std::string::npos);
+    return injected;
+}
+
+void Shader::SetBinaryCacheDirectory(const std::string& directory) {
+    s_binaryCacheDirectory = directory;
+}
+
+const std::string& Shader::GetBinaryCacheDirectory() {
+    return s_binaryCacheDirectory;
+}
+
+bool Shader::HasProgramBinary() {
+    static bool queried = false;
+    static bool supported = false;
+    if (!queried) {
+        queried = true;
+
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major > 4 || (major == 4 && minor >= 1) || glfwExtensionSupported("GL_ARB_get_program_binary")) {
+            s_getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(glfwGetProcAddress("glGetProgramBinary"));
+            s_programBinary = reinterpret_cast<ProgramBinaryProc>(glfwGetProcAddress("glProgramBinary"));
+            s_programParameteri = reinterpret_cast<ProgramParameteriProc>(glfwGetProcAddress("glProgramParameteri"));
+        }
+
+        // Some drivers expose the entry points but no formats, nothing can be saved then
+        GLint formats = 0;
+        if (s_getProgramBinary && s_programBinary && s_programParameteri) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        supported = formats > 0;
+    }
+    return supported;
+}
+
+uint64_t Shader::ComputeCacheKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    // Binaries are only valid for the driver build that produced them
+    const char* driverStrings[] = {
+        reinterpret_cast<const char*>(glGetString(GL_VENDOR)),
+        reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+        reinterpret_cast<const char*>(glGetString(GL_VERSION)),
+    };
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (const char* driverString : driverStrings) {
+        hash = driverString ? hashString(hash, driverString, strlen(driverString)) : hashString(hash, "", 0);
+    }
+    hash = hashString(hash, vertexSource.data(), vertexSource.size());
+    hash = hashString(hash, fragmentSource.data(), fragmentSource.size());
+    return hash;
+}
+
+std::string Shader::GetCachePath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(s_binaryCacheDirectory) / name).string();
+}
+
+unsigned int Shader::LoadProgramBinary(uint64_t key) {
+    PROFILE_SCOPE("Shader::LoadProgramBinary");
+
+    std::string path = GetCachePath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    ProgramBinaryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PROGRAM_BINARY_VERSION || header.key != key || header.size == 0) {
+        return 0;
+    }
+
+    std::vector<char> binary(header.size);
+    if (!file.read(binary.data(), header.size)) {
+        return 0;
+    }
+    file.close();
+
+    unsigned int program = glCreateProgram();
+    s_programBinary(program, header.format, binary.data(), static_cast<GLsizei>(header.size));
+
+    // Drivers may reject binaries for reasons the key doesn't cover, drop the file then
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return 0;
+    }
+
+#ifndef NDEBUG
+    std::cout << "Loaded cached shader program: " << path << std::endl;
+#endif
+    return program;
+}
+
+void Shader::SaveProgramBinary(uint64_t key) const {
+    PROFILE_SCOPE("Shader::SaveProgramBinary");
+
+    GLint length = 0;
+    glGetProgramiv(m_ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    s_getProgramBinary(m_ID, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(s_binaryCacheDirectory, error);
+
+    ProgramBinaryHeader header;
+    memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_BINARY_VERSION;
+    header.key = key;
+    header.format = format;
+    header.size = static_cast<uint32_t>(written);
+
+    // Written next to the final name and renamed, so a crash never leaves half a binary
+    std::string path = GetCachePath(key);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write shader cache: " << tempPath << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        if (!file.good()) {
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+void Shader::Use() {
+    Finish();
     glUseProgram(m_ID);
 }
 
 unsigned int Shader::CompileShader(unsigned int type, const std::string& source) {
+    // No status query here, that would wait for the compile to end
     unsigned int id = glCreateShader(type);
     const char* src = source.c_str();
     glShaderSource(id, 1, &src, nullptr);
     glCompileShader(id);
+    return id;
+}
 
+bool Shader::CheckShader(unsigned int id, unsigned int type) {
     // Check for compilation errors
     int success;
     char infoLog[512];
@@ -45,42 +434,27 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
         glGetShaderInfoLog(id, 512, nullptr, infoLog);
         std::cerr << "ERROR::SHADER::" << (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT")
             << "::COMPILATION_FAILED\n" << infoLog << std::endl;
-        glDeleteShader(id);
-        return 0;
+        return false;
     }
-
-    return id;
+    return true;
 }
 
-unsigned int Shader::CreateShader(const std::string& vertexShader, const std::string& fragmentShader) {
+unsigned int Shader::CreateShader(unsigned int vs, unsigned int fs, bool retrievable) {
+    PROFILE_SCOPE("Shader::CreateShader");
+
     unsigned int program = glCreateProgram();
-    unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-    unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
 
-    if (vs == 0 || fs == 0) {
-        return 0;
+    // Must be set before linking for glGetProgramBinary to return anything
+    if (retrievable) {
+        s_programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     }
 
+    // Linking right behind the compiles is fine, a stage that failed just fails
+    // the link, and Finish reads the logs in order
     glAttachShader(program, vs);
     glAttachShader(program, fs);
     glLinkProgram(program);
 
-    // Check for linking errors
-    int success;
-    char infoLog[512];
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        glDeleteProgram(program);
-        return 0;
-    }
-
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-
     return program;
 }
 
@@ -98,6 +472,18 @@ int Shader::GetUniformLocation(const std::string& name) const {
     return location;
 }
 
+bool Shader::HasUniform(const std::string& name) const {
+    auto found = m_UniformLocationCache.find(name);
+    if (found != m_UniformLocationCache.end()) {
+        return found->second != -1;
+    }
+
+    // Missing is an answer here, not worth a warning
+    int location = glGetUniformLocation(m_ID, name.c_str());
+    m_UniformLocationCache[name] = location;
+    return location != -1;
+}
+
 std::string Shader::ReadFile(const std::string& filepath) {
     std::ifstream file(filepath);
     if (!file.is_open()) {
@@ -145,4 +531,81 @@ void Shader::SetMat3(const std::string& name, const glm::mat3& mat) const {
 
 void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const {
     glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat));
-}
\ No newline at end of file
+}
+
+bool ShaderVariants::LoadFromFile(const std::string& vertexPath, const std::string& fragmentPath,
+    const std::vector<std::string>& defines) {
+    m_variants.clear();
+    m_defines = defines;
+    m_vertexSource = Shader::ReadFile(vertexPath);
+    m_fragmentSource = Shader::ReadFile(fragmentPath);
+
+    if (m_vertexSource.empty() || m_fragmentSource.empty()) {
+        std::cerr << "Failed to read shader files!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ShaderVariants::Prepare(const std::vector<uint32_t>& featureMasks) {
+    if (m_vertexSource.empty()) return;
+
+    PROFILE_SCOPE("ShaderVariants::Prepare");
+
+    // Everything is submitted before anything is checked, checking waits
+    for (uint32_t features : featureMasks) {
+        if (m_variants.find(features) != m_variants.end()) continue;
+
+        auto shader = std::make_unique<Shader>();
+        shader->Submit(m_vertexSource, m_fragmentSource, GetDefines(features));
+        m_variants.emplace(features, std::move(shader));
+    }
+}
+
+size_t ShaderVariants::Poll() {
+    size_t pending = 0;
+    for (auto& variant : m_variants) {
+        if (!variant.second) continue;
+        if (!variant.second->IsReady()) {
+            pending++;
+            continue;
+        }
+        Finish(variant.second, variant.first);
+    }
+    return pending;
+}
+
+bool ShaderVariants::IsReady(uint32_t features) const {
+    auto found = m_variants.find(features);
+    return found != m_variants.end() && (!found->second || found->second->IsReady());
+}
+
+Shader* ShaderVariants::Get(uint32_t features) {
+    auto found = m_variants.find(features);
+    if (found == m_variants.end()) {
+        PROFILE_SCOPE("ShaderVariants::Get");
+
+        auto shader = std::make_unique<Shader>();
+        if (!m_vertexSource.empty()) {
+            shader->Submit(m_vertexSource, m_fragmentSource, GetDefines(features));
+        }
+        found = m_variants.emplace(features, std::move(shader)).first;
+    }
+    return Finish(found->second, features);
+}
+
+Shader* ShaderVariants::Finish(std::unique_ptr<Shader>& shader, uint32_t features) {
+    if (shader && !shader->Finish()) {
+        std::cerr << "ERROR::SHADER::VARIANT_FAILED features 0x" << std::hex << features << std::dec << std::endl;
+        shader.reset();
+    }
+    return shader.get();
+}
+
+std::vector<std::string> ShaderVariants::GetDefines(uint32_t features) const {
+    std::vector<std::string> defines = m_defines;
+    for (const std::string& define : Shader::GetFeatureDefines(features)) {
+        defines.push_back(define);
+    }
+    return defines;
+}
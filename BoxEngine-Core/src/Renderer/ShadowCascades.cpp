@@ -0,0 +1,374 @@
+#include "Renderer/ShadowCascades.h"
+#include "Renderer/Mesh.h"
+#include "Renderer/ObjectBuffer.h"
+#include "Renderer/RenderUtils.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Utils/Hash.h"
+#include "Utils/Profiler.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Extra room around a cached cascade's slice, as a fraction of its radius.
+// The centre snaps to a grid this coarse, so the camera can move this far
+// before the cascade has to be rendered again.
+static const float CACHE_MARGIN = 0.25f;
+
+static const char* MATRIX_NAMES[ShadowCascades::MAX_CASCADES] = {
+    "shadowMatrices[0]", "shadowMatrices[1]", "shadowMatrices[2]", "shadowMatrices[3]"
+};
+static const char* PARAM_NAMES[ShadowCascades::MAX_CASCADES] = {
+    "shadowParams[0]", "shadowParams[1]", "shadowParams[2]", "shadowParams[3]"
+};
+
+// Clip space [-1, 1] to texture space [0, 1]
+static const glm::mat4 TEXTURE_BIAS = glm::mat4(
+    0.5f, 0.0f, 0.0f, 0.0f,
+    0.0f, 0.5f, 0.0f, 0.0f,
+    0.0f, 0.0f, 0.5f, 0.0f,
+    0.5f, 0.5f, 0.5f, 1.0f);
+
+ShadowCascades::~ShadowCascades()
+{
+    release();
+}
+
+void ShadowCascades::setSettings(const Settings& settings)
+{
+    bool resize = settings.resolution != m_settings.resolution || settings.cascades != m_settings.cascades;
+    m_settings = settings;
+
+    // Placement depends on every setting, let all cascades start over
+    for (Cascade& cascade : m_cascades) {
+        cascade.dirty = true;
+    }
+    if (resize) {
+        release();
+    }
+}
+
+void ShadowCascades::invalidate()
+{
+    for (Cascade& cascade : m_cascades) {
+        cascade.dirty = true;
+    }
+}
+
+void ShadowCascades::createTargets()
+{
+    m_cascadeCount = std::max(1, std::min(m_settings.cascades, MAX_CASCADES));
+    const int size = m_settings.resolution;
+
+    // On its own unit, TextureArray caches what its units have bound
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, m_cascadeCount, 0,
+        GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+
+    // Compare in the sampler, linear filtering gives 2x2 PCF for free
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Shadow cascade framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    ResourceRegistry::Resource resource;
+    resource.kind = ResourceRegistry::Kind::Texture;
+    resource.id = m_texture;
+    resource.category = ResourceCategory::RenderTarget;
+    resource.name = "shadow cascades";
+    resource.owner = "engine";
+    resource.format = "D24";
+    resource.width = size;
+    resource.height = size;
+    resource.levels = 1;
+    resource.layers = m_cascadeCount;
+    resource.gpuBytes = static_cast<size_t>(size) * size * 4 * m_cascadeCount;
+    ResourceRegistry::get().add(std::move(resource));
+
+    for (Cascade& cascade : m_cascades) {
+        cascade = Cascade();
+    }
+
+    if (m_shader.GetID() == 0) {
+        m_shader.LoadFromFile("assets/Shaders/shadow.vert", "assets/Shaders/depth.frag", ObjectBuffer::getShaderDefines());
+    }
+}
+
+void ShadowCascades::computeSplits(float nearPlane, float farPlane)
+{
+    m_splits[0] = nearPlane;
+    for (int i = 1; i < m_cascadeCount; i++) {
+        float t = static_cast<float>(i) / m_cascadeCount;
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        m_splits[i] = m_settings.splitLambda * logSplit + (1.0f - m_settings.splitLambda) * uniformSplit;
+    }
+    m_splits[m_cascadeCount] = farPlane;
+}
+
+ShadowCascades::Fit ShadowCascades::fitCascade(int cascade, const glm::mat4& lightView, const glm::vec3* frustumCorners,
+    float nearPlane, float farPlane) const
+{
+    // Corners of the slice, along the frustum edges from the near to the far plane
+    float t0 = (m_splits[cascade] - nearPlane) / (farPlane - nearPlane);
+    float t1 = (m_splits[cascade + 1] - nearPlane) / (farPlane - nearPlane);
+    glm::vec3 corners[8];
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < 4; i++) {
+        glm::vec3 edge = frustumCorners[i + 4] - frustumCorners[i];
+        corners[i] = frustumCorners[i] + edge * t0;
+        corners[i + 4] = frustumCorners[i] + edge * t1;
+        center += corners[i] + corners[i + 4];
+    }
+    center /= 8.0f;
+
+    // The sphere around the slice is the same whichever way the camera
+    // looks; rounding keeps float noise from changing its size
+    float radius = 0.0f;
+    for (const glm::vec3& corner : corners) {
+        radius = std::max(radius, glm::length(corner - center));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    bool cached = cascade >= m_settings.liveCascades;
+    float margin = cached ? radius * CACHE_MARGIN : 0.0f;
+
+    Fit fit;
+    fit.halfSize = radius + margin;
+    fit.texelSize = 2.0f * fit.halfSize / m_settings.resolution;
+
+    // Whole texels keep the map from crawling, a coarser grid keeps cached ones still
+    float grid = fit.texelSize * std::max(1.0f, std::floor(margin / fit.texelSize));
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    fit.center = glm::vec2(std::round(lightCenter.x / grid) * grid, std::round(lightCenter.y / grid) * grid);
+    float depth = std::round(-lightCenter.z / grid) * grid;
+
+    fit.nearDepth = depth - fit.halfSize - m_settings.casterDistance;
+    fit.farDepth = depth + fit.halfSize;
+    glm::mat4 projection = glm::ortho(fit.center.x - fit.halfSize, fit.center.x + fit.halfSize,
+        fit.center.y - fit.halfSize, fit.center.y + fit.halfSize, fit.nearDepth, fit.farDepth);
+    fit.viewProjection = projection * lightView;
+    return fit;
+}
+
+bool ShadowCascades::castsInto(const LightBounds& bounds, const Fit& fit) const
+{
+    // Too small to cover a texel
+    if (std::max(bounds.extents.x, bounds.extents.y) * 2.0f < m_settings.minCasterTexels * fit.texelSize) {
+        return false;
+    }
+
+    // Anything over the cascade's rectangle and not wholly behind it, what is in
+    // front gets clamped onto the near plane
+    return std::abs(bounds.center.x - fit.center.x) <= bounds.extents.x + fit.halfSize &&
+           std::abs(bounds.center.y - fit.center.y) <= bounds.extents.y + fit.halfSize &&
+           -bounds.center.z - bounds.extents.z <= fit.farDepth;
+}
+
+uint64_t ShadowCascades::computeSignature(const Fit& fit, const std::vector<Caster>& casters) const
+{
+    // Summed so the order the objects were queued in doesn't matter
+    uint64_t signature = 0;
+    for (size_t i = 0; i < casters.size(); i++) {
+        if (!castsInto(m_lightBounds[i], fit)) continue;
+
+        const Caster& caster = casters[i];
+        uint64_t hash = FNV_OFFSET_BASIS;
+        hash = hashBytes(hash, &caster.key, sizeof(caster.key));
+        hash = hashBytes(hash, &caster.transform[0][0], sizeof(float) * 16);
+        hash = hashBytes(hash, &caster.meshCount, sizeof(caster.meshCount));
+        signature += hash;
+    }
+    return signature;
+}
+
+void ShadowCascades::render(const DirectionalLight& light, const glm::mat4& view, const glm::mat4& projection,
+    const std::vector<Caster>& casters, const std::vector<Mesh*>& meshes)
+{
+    m_cascadesRendered = 0;
+    m_drawCalls = 0;
+    m_active = light.castShadows && light.intensity > 0.0f && glm::length(light.direction) > 0.0f;
+    if (!m_active) return;
+
+    PROFILE_SCOPE("ShadowCascades::render");
+
+    if (m_texture == 0) {
+        createTargets();
+    }
+    m_frame++;
+
+    float nearPlane;
+    float farPlane;
+    getPerspectiveClip(projection, nearPlane, farPlane);
+    float shadowFar = std::min(farPlane, m_settings.maxDistance);
+    computeSplits(nearPlane, shadowFar);
+
+    // The light view has no translation, only the direction decides it
+    glm::vec3 direction = glm::normalize(light.direction);
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+    // Frustum corners, near plane first, the slices are cut out of their edges
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+    glm::vec3 frustumCorners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner = inverseViewProjection * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f,
+            (i & 4) ? 1.0f : -1.0f, 1.0f);
+        frustumCorners[i] = glm::vec3(corner) / corner.w;
+    }
+
+    // Caster bounds in light space once, every cascade tests against them
+    glm::mat3 lightRotation = glm::mat3(lightView);
+    m_lightBounds.resize(casters.size());
+    for (size_t i = 0; i < casters.size(); i++) {
+        const Caster& caster = casters[i];
+        glm::vec3 localCenter = (caster.min + caster.max) * 0.5f;
+        glm::vec3 localExtents = (caster.max - caster.min) * 0.5f;
+        glm::mat3 toLight = lightRotation * glm::mat3(caster.transform);
+
+        LightBounds& bounds = m_lightBounds[i];
+        bounds.center = glm::vec3(lightView * (caster.transform * glm::vec4(localCenter, 1.0f)));
+        bounds.extents = glm::vec3(0.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            bounds.extents += glm::vec3(std::abs(toLight[axis].x), std::abs(toLight[axis].y), std::abs(toLight[axis].z)) * localExtents[axis];
+        }
+    }
+
+    // Live cascades always, cached ones when they changed and the budget allows
+    Fit fits[MAX_CASCADES];
+    uint64_t signatures[MAX_CASCADES] = {};
+    int due[MAX_CASCADES];
+    int dueCount = 0;
+    std::vector<int> waiting;
+    for (int i = 0; i < m_cascadeCount; i++) {
+        fits[i] = fitCascade(i, lightView, frustumCorners, nearPlane, shadowFar);
+        if (i < m_settings.liveCascades) {
+            due[dueCount++] = i;
+            continue;
+        }
+
+        const Cascade& cascade = m_cascades[i];
+        signatures[i] = computeSignature(fits[i], casters);
+        bool moved = std::memcmp(&fits[i].viewProjection, &cascade.rendered.viewProjection, sizeof(glm::mat4)) != 0;
+        if (!cascade.valid || cascade.dirty || moved || signatures[i] != cascade.signature) {
+            waiting.push_back(i);
+        }
+    }
+    std::sort(waiting.begin(), waiting.end(), [&](int a, int b) {
+        return m_cascades[a].renderedFrame < m_cascades[b].renderedFrame;
+    });
+    for (size_t i = 0; i < waiting.size() && static_cast<int>(i) < m_settings.cachedUpdatesPerFrame; i++) {
+        due[dueCount++] = waiting[i];
+    }
+    if (dueCount == 0) return;
+
+    m_timer.begin();
+
+    // The scene may be going to an offscreen target
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_settings.resolution, m_settings.resolution);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(m_settings.slopeBias, m_settings.constantBias);
+
+    m_shader.Use();
+    m_shader.SetInt("objectData", ObjectBuffer::TEXTURE_UNIT);
+    for (int i = 0; i < dueCount; i++) {
+        int index = due[i];
+        renderCascade(index, fits[index], casters, meshes);
+
+        Cascade& cascade = m_cascades[index];
+        cascade.rendered = fits[index];
+        cascade.signature = signatures[index];
+        cascade.renderedFrame = m_frame;
+        cascade.valid = true;
+        cascade.dirty = false;
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+
+    m_timer.end();
+    m_cascadesRendered = dueCount;
+}
+
+void ShadowCascades::renderCascade(int cascade, const Fit& fit, const std::vector<Caster>& casters, const std::vector<Mesh*>& meshes)
+{
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_texture, 0, cascade);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    m_shader.SetMat4("lightViewProjection", fit.viewProjection);
+    for (size_t i = 0; i < casters.size(); i++) {
+        if (!castsInto(m_lightBounds[i], fit)) continue;
+
+        const Caster& caster = casters[i];
+        m_shader.SetInt("objectId", static_cast<int>(caster.object));
+        for (uint32_t m = 0; m < caster.meshCount; m++) {
+            meshes[caster.firstMesh + m]->drawDepth();
+            m_drawCalls++;
+        }
+    }
+}
+
+void ShadowCascades::bind() const
+{
+    if (m_texture == 0) return;
+
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+    ResourceRegistry::get().touch(ResourceRegistry::Kind::Texture, m_texture);
+}
+
+void ShadowCascades::setUniforms(const Shader& shader) const
+{
+    if (glGetUniformLocation(shader.GetID(), "shadowMap") == -1) return;
+
+    // The sampler always gets its unit, left on 0 it would clash with the diffuse sampler
+    shader.SetInt("shadowMap", TEXTURE_UNIT);
+    int count = m_active ? m_cascadeCount : 0;
+    shader.SetInt("shadowCascadeCount", count);
+    for (int i = 0; i < count; i++) {
+        const Cascade& cascade = m_cascades[i];
+        shader.SetMat4(MATRIX_NAMES[i], TEXTURE_BIAS * cascade.rendered.viewProjection);
+        shader.SetVec2(PARAM_NAMES[i], glm::vec2(cascade.valid ? 1.0f : 0.0f,
+            cascade.rendered.texelSize * m_settings.normalOffset));
+    }
+}
+
+void ShadowCascades::release()
+{
+    if (m_texture != 0) {
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Texture, m_texture);
+        glDeleteTextures(1, &m_texture);
+        glDeleteFramebuffers(1, &m_framebuffer);
+        m_texture = 0;
+        m_framebuffer = 0;
+    }
+    m_timer.release();
+    m_active = false;
+}
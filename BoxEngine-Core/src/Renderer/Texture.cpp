@@ -1,11 +1,37 @@
 #include "Renderer/Texture.h"
+#include "Renderer/BoxTexFile.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Renderer/TextureArray.h"
+#include "Renderer/TextureStreamer.h"
+#include "Renderer/TextureUploader.h"
+#include "Utils/Profiler.h"
 #include <iostream>
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
 
 // Define STB_IMAGE_IMPLEMENTATION before including stb_image.h
 #include "stb_image.h"
 
+// Extension formats, glad only carries the GL 3.3 core enums (RGTC is core)
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT     0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT    0x83F3
+#define GL_COMPRESSED_RGBA_BPTC_UNORM       0x8E8C
+
+unsigned int Texture::getGLFormat(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: return 0;
+    }
+}
+
 Texture::Texture()
     : m_id(0)
     , m_type(DIFFUSE)
@@ -16,89 +42,372 @@ Texture::Texture()
 
 Texture::~Texture()
 {
-    if (m_id != 0) {
-        glDeleteTextures(1, &m_id);
-    }
+    releaseStreaming();
+    deleteTexture();
 }
 
 bool Texture::loadFromFile(const std::string& filepath, TextureType type)
 {
+    PROFILE_ASSET(filepath);
+    PROFILE_SCOPE("Texture::loadFromFile");
+
     // Make sure file actually exists
     if (!fileExists(filepath)) {
         std::cerr << "ERROR: Texture file does not exist: " << filepath << std::endl;
         return false;
     }
 
-    // Clean up any existing texture
-    if (m_id != 0) {
-        glDeleteTextures(1, &m_id);
-        m_id = 0;
+    // Cached textures carry their mips, nothing to decode
+    if (BoxTexFile::canLoad(filepath)) {
+        BoxTexFile file;
+        return file.open(filepath) && loadFromBoxTex(file, filepath, type);
     }
 
-    // Reset dimensions and number color_channels
-    m_width = 0;
-    m_height = 0;
-    m_channels = 0;
-
-    // Set flip option based on texture type
-    stbi_set_flip_vertically_on_load(type == DIFFUSE); // Only flip diffuse textures typically
-
     // Load image data
-    unsigned char* data = stbi_load(filepath.c_str(), &m_width, &m_height, &m_channels, 0);
-
-    if (!data) {
+    Image image;
+    if (!decodeFile(filepath, type, image)) {
         std::cerr << "ERROR: Failed to load texture: " << filepath << std::endl;
         std::cerr << "STB Reason: " << stbi_failure_reason() << std::endl;
         return false;
     }
 
+    loadFromImage(image, filepath, type);
+#ifndef NDEBUG
+    std::cout << "Loaded texture: " << filepath
+        << " (" << m_width << "x" << m_height
+        << ", channels: " << m_channels << ")" << std::endl;
+#endif
+    return true;
+}
+
+bool Texture::loadFromMemory(const unsigned char* encoded, size_t size, const std::string& name, TextureType type)
+{
+    Image image;
+    if (!decodeMemory(encoded, size, type, image)) {
+        std::cerr << "ERROR: Failed to decode texture: " << name << std::endl;
+        std::cerr << "STB Reason: " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    return loadFromImage(image, name, type);
+}
+
+bool Texture::loadFromImage(const Image& image, const std::string& name, TextureType type)
+{
+    if (!image.isValid()) {
+        return false;
+    }
+
+    // Clean up any existing texture
+    deleteTexture();
+    m_array.reset();
+    m_layer = -1;
+    releaseStreaming();
+
+    m_width = image.width;
+    m_height = image.height;
+    m_channels = image.channels;
+    m_blockFormat = BlockFormat::None;
     m_type = type;
-    m_path = filepath;
+    m_path = name;
+
+    uploadPixels(image);
+    return true;
+}
+
+bool Texture::isFormatSupported(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC3:
+        return glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+    case BlockFormat::BC4:
+    case BlockFormat::BC5:
+        return true;    // core since GL 3.0
+    case BlockFormat::BC7: {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        return major > 4 || (major == 4 && minor >= 2) ||
+            glfwExtensionSupported("GL_ARB_texture_compression_bptc");
+    }
+    default:
+        return false;
+    }
+}
+
+bool Texture::loadFromCompressed(const CompressedImage& image, const std::string& name, TextureType type)
+{
+    if (!image.isValid()) {
+        return false;
+    }
+
+    // Clean up any existing texture
+    deleteTexture();
+    m_array.reset();
+    m_layer = -1;
+    releaseStreaming();
+
+    m_width = image.width;
+    m_height = image.height;
+    m_channels = CompressedImage::getChannelCount(image.format);
+    m_blockFormat = image.format;
+    m_levelCount = static_cast<int>(image.levels.size());
+    m_type = type;
+    m_path = name;
 
-    // Generate and bind texture
     glGenTextures(1, &m_id);
     glBindTexture(GL_TEXTURE_2D, m_id);
 
-    // Set texture parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Determine format based on number of channels
-    GLenum format = GL_RGB;
-    GLenum internalFormat = GL_RGB;
-
-    if (m_channels == 1) {
-        format = GL_RED;
-        internalFormat = GL_RED;
+    // Compressed mips can't be generated by the driver, use what the file has
+    GLint levelCount = static_cast<GLint>(image.levels.size());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    {
+        PROFILE_SCOPE("Texture::uploadCompressed");
+        TextureUploader& uploader = TextureUploader::get();
+        uploader.allocate(image.format, m_channels, m_width, m_height, 0, levelCount, true);
+        for (GLint i = 0; i < levelCount; i++) {
+            const CompressedImage::Level& level = image.levels[i];
+            m_uploadSerial = uploader.upload(image.format, m_channels, i, level.width, level.height,
+                image.data.data() + level.offset);
+        }
     }
-    else if (m_channels == 3) {
-        format = GL_RGB;
-        internalFormat = GL_RGB;
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    track();
+    return true;
+}
+
+void Texture::setArrayLayer(const std::shared_ptr<TextureArray>& array, int layer,
+    int width, int height, const std::string& name, TextureType type)
+{
+    deleteTexture();
+
+    releaseStreaming();
+
+    m_array = array;
+    m_layer = layer;
+    m_width = width;
+    m_height = height;
+    m_blockFormat = array->getFormat().block;
+    m_channels = m_blockFormat != BlockFormat::None
+        ? CompressedImage::getChannelCount(m_blockFormat)
+        : array->getFormat().channels;
+    m_levelCount = array->getFormat().levels;
+    m_type = type;
+    m_path = name;
+}
+
+bool Texture::loadFromBoxTex(const BoxTexFile& file, const std::string& name, TextureType type)
+{
+    if (!file.isOpen()) {
+        return false;
     }
-    else if (m_channels == 4) {
-        format = GL_RGBA;
-        internalFormat = GL_RGBA;
+
+    BlockFormat blockFormat = file.getBlockFormat();
+    if (blockFormat != BlockFormat::None && !isFormatSupported(blockFormat)) {
+        std::cerr << "ERROR: Block format not supported by this GPU: " << name << std::endl;
+        return false;
     }
 
-    // Upload texture data
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_width, m_height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // Clean up any existing texture
+    deleteTexture();
+    m_array.reset();
+    m_layer = -1;
+    releaseStreaming();
+
+    const auto& levels = file.getLevels();
+    m_width = file.getWidth();
+    m_height = file.getHeight();
+    m_blockFormat = blockFormat;
+    m_channels = blockFormat != BlockFormat::None ? CompressedImage::getChannelCount(blockFormat) : file.getChannels();
+    m_levelCount = static_cast<int>(levels.size());
+    m_type = type;
+    m_path = name;
 
-    // Free image data
-    stbi_image_free(data);
+    glGenTextures(1, &m_id);
+    glBindTexture(GL_TEXTURE_2D, m_id);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1);
+
+    {
+        PROFILE_SCOPE("BoxTex upload");
+        TextureUploader& uploader = TextureUploader::get();
+        uploader.allocate(blockFormat, m_channels, m_width, m_height, 0, m_levelCount, true);
+        for (int i = 0; i < m_levelCount; i++) {
+            const BoxTexFile::Level& level = levels[i];
+            m_uploadSerial = uploader.upload(blockFormat, m_channels, i, level.width, level.height, level.data);
+        }
+    }
 
-    // Unbind texture
     glBindTexture(GL_TEXTURE_2D, 0);
-#ifndef NDEBUG
-    std::cout << "Loaded texture: " << filepath
-        << " (" << m_width << "x" << m_height
-        << ", channels: " << m_channels << ")" << std::endl;
-#endif
+    track();
+    return true;
+}
+
+// Copy out of stb's buffer, flipping rows on the way. stb's own flip switch is
+// a global (this stb version has no per-thread one), so setting it per load
+// would race with decodes on other threads. RGB is widened to RGBA here, on
+// the decoding thread, instead of by the driver during the upload.
+static bool takePixels(unsigned char* data, int width, int height, int channels, bool flip, Texture::Image& out)
+{
+    if (!data) {
+        return false;
+    }
+
+    int outChannels = channels == 3 ? 4 : channels;
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    size_t outRowSize = static_cast<size_t>(width) * outChannels;
+    out.pixels.resize(outRowSize * height);
+
+    for (int y = 0; y < height; y++) {
+        int source = flip ? height - 1 - y : y;
+        const unsigned char* src = data + rowSize * source;
+        unsigned char* dest = out.pixels.data() + outRowSize * y;
+
+        if (outChannels == channels) {
+            memcpy(dest, src, rowSize);
+            continue;
+        }
+        for (int x = 0; x < width; x++) {
+            dest[0] = src[0];
+            dest[1] = src[1];
+            dest[2] = src[2];
+            dest[3] = 255;
+            src += 3;
+            dest += 4;
+        }
+    }
+    out.width = width;
+    out.height = height;
+    out.channels = outChannels;
+    out.mips.clear();
+
+    stbi_image_free(data);
     return true;
 }
 
+bool Texture::decodeFile(const std::string& filepath, TextureType type, Image& out)
+{
+    PROFILE_SCOPE("stbi_load");
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char* data = stbi_load(filepath.c_str(), &width, &height, &channels, 0);
+
+    // Only flip diffuse textures typically
+    return takePixels(data, width, height, channels, type == DIFFUSE, out);
+}
+
+bool Texture::decodeMemory(const unsigned char* encoded, size_t size, TextureType type, Image& out)
+{
+    if (!encoded || size == 0) {
+        return false;
+    }
+
+    PROFILE_SCOPE("stbi_load_from_memory");
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char* data = stbi_load_from_memory(encoded, static_cast<int>(size), &width, &height, &channels, 0);
+
+    // Same flip rule as decodeFile
+    return takePixels(data, width, height, channels, type == DIFFUSE, out);
+}
+
+Texture::Image Texture::downsample(const Image& image, int maxSize)
+{
+    int largest = std::max(image.width, image.height);
+    if (!image.isValid() || maxSize <= 0 || largest <= maxSize) {
+        return image;
+    }
+
+    // Integer box filter, each output texel averages a factor x factor block
+    int factor = (largest + maxSize - 1) / maxSize;
+
+    Image out;
+    out.width = std::max(1, image.width / factor);
+    out.height = std::max(1, image.height / factor);
+    out.channels = image.channels;
+    out.pixels.resize(static_cast<size_t>(out.width) * out.height * out.channels);
+
+    std::vector<unsigned int> sums(out.channels);
+    for (int y = 0; y < out.height; y++) {
+        for (int x = 0; x < out.width; x++) {
+            std::fill(sums.begin(), sums.end(), 0u);
+
+            int y1 = std::min(image.height, (y + 1) * factor);
+            int x1 = std::min(image.width, (x + 1) * factor);
+            for (int sy = y * factor; sy < y1; sy++) {
+                const unsigned char* row = image.pixels.data() + (static_cast<size_t>(sy) * image.width) * image.channels;
+                for (int sx = x * factor; sx < x1; sx++) {
+                    for (int c = 0; c < image.channels; c++) {
+                        sums[c] += row[sx * image.channels + c];
+                    }
+                }
+            }
+
+            unsigned int count = static_cast<unsigned int>((y1 - y * factor) * (x1 - x * factor));
+            unsigned char* dest = out.pixels.data() + (static_cast<size_t>(y) * out.width + x) * out.channels;
+            for (int c = 0; c < out.channels; c++) {
+                dest[c] = static_cast<unsigned char>((sums[c] + count / 2) / count);
+            }
+        }
+    }
+    return out;
+}
+
+void Texture::generateMips(Image& image)
+{
+    PROFILE_SCOPE("Texture::generateMips");
+
+    image.mips.clear();
+    if (!image.isValid()) return;
+
+    const int channels = image.channels;
+    const unsigned char* source = image.pixels.data();
+    int width = image.width;
+    int height = image.height;
+
+    while (width > 1 || height > 1) {
+        Image::MipLevel level;
+        level.width = std::max(1, width / 2);
+        level.height = std::max(1, height / 2);
+        level.pixels.resize(static_cast<size_t>(level.width) * level.height * channels);
+
+        // Odd edges clamp, so the last row/column is averaged with itself
+        for (int y = 0; y < level.height; y++) {
+            int y0 = std::min(y * 2, height - 1);
+            int y1 = std::min(y * 2 + 1, height - 1);
+            const unsigned char* row0 = source + static_cast<size_t>(y0) * width * channels;
+            const unsigned char* row1 = source + static_cast<size_t>(y1) * width * channels;
+            unsigned char* dest = level.pixels.data() + static_cast<size_t>(y) * level.width * channels;
+
+            for (int x = 0; x < level.width; x++) {
+                int x0 = std::min(x * 2, width - 1) * channels;
+                int x1 = std::min(x * 2 + 1, width - 1) * channels;
+                for (int c = 0; c < channels; c++) {
+                    unsigned int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                    dest[x * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+
+        image.mips.push_back(std::move(level));
+        source = image.mips.back().pixels.data();
+        width = image.mips.back().width;
+        height = image.mips.back().height;
+    }
+}
+
 bool Texture::loadFromData(unsigned char* data, int width, int height, TextureType type)
 {
     if (!data || width <= 0 || height <= 0) {
@@ -106,13 +415,16 @@ bool Texture::loadFromData(unsigned char* data, int width, int height, TextureTy
     }
 
     // Clean up any existing texture
-    if (m_id != 0) {
-        glDeleteTextures(1, &m_id);
-        m_id = 0;
-    }
+    deleteTexture();
+    m_array.reset();
+    m_layer = -1;
+    releaseStreaming();
 
     m_width = width;
     m_height = height;
+    m_channels = 3;
+    m_blockFormat = BlockFormat::None;
+    m_levelCount = 1;
     m_type = type;
     m_path = "procedural";
 
@@ -131,6 +443,7 @@ bool Texture::loadFromData(unsigned char* data, int width, int height, TextureTy
 
     // Unbind texture
     glBindTexture(GL_TEXTURE_2D, 0);
+    track();
 
     return true;
 }
@@ -142,13 +455,16 @@ bool Texture::create(int width, int height, TextureType type)
     }
 
     // Clean up any existing texture
-    if (m_id != 0) {
-        glDeleteTextures(1, &m_id);
-        m_id = 0;
-    }
+    deleteTexture();
+    m_array.reset();
+    m_layer = -1;
+    releaseStreaming();
 
     m_width = width;
     m_height = height;
+    m_channels = 3;
+    m_blockFormat = BlockFormat::None;
+    m_levelCount = 1;
     m_type = type;
     m_path = "created";
 
@@ -167,6 +483,7 @@ bool Texture::create(int width, int height, TextureType type)
 
     // Unbind texture
     glBindTexture(GL_TEXTURE_2D, 0);
+    track();
 
     return true;
 }
@@ -177,6 +494,7 @@ void Texture::bind(unsigned int unit) const
 
     glActiveTexture(GL_TEXTURE0 + unit);
     glBindTexture(GL_TEXTURE_2D, m_id);
+    ResourceRegistry::get().touch(ResourceRegistry::Kind::Texture, m_id);
 }
 
 void Texture::unbind() const
@@ -189,3 +507,285 @@ bool Texture::fileExists(const std::string& filepath)
     std::ifstream file(filepath);
     return file.good();
 }
+
+void Texture::uploadPixels(const Image& image)
+{
+    // Generate and bind texture
+    glGenTextures(1, &m_id);
+    glBindTexture(GL_TEXTURE_2D, m_id);
+
+    // Set texture parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    m_levelCount = 1;
+    for (int size = std::max(m_width, m_height); size > 1; size /= 2) {
+        m_levelCount++;
+    }
+
+    // Every level is allocated up front (immutable when supported), the
+    // pixels then go through the staging ring
+    {
+        PROFILE_SCOPE("Texture::uploadPixels");
+        TextureUploader& uploader = TextureUploader::get();
+        uploader.allocate(BlockFormat::None, m_channels, m_width, m_height, 0, m_levelCount, true);
+        m_uploadSerial = uploader.upload(BlockFormat::None, m_channels, 0, m_width, m_height, image.pixels.data());
+        for (size_t i = 0; i < image.mips.size(); i++) {
+            const Image::MipLevel& level = image.mips[i];
+            m_uploadSerial = uploader.upload(BlockFormat::None, m_channels, static_cast<int>(i + 1),
+                level.width, level.height, level.pixels.data());
+        }
+    }
+    if (image.mips.empty()) {
+        PROFILE_SCOPE("glGenerateMipmap");
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    // Unbind texture
+    glBindTexture(GL_TEXTURE_2D, 0);
+    track();
+}
+
+size_t Texture::getLevelSize(int level) const
+{
+    int width = std::max(1, m_width >> level);
+    int height = std::max(1, m_height >> level);
+    if (m_blockFormat != BlockFormat::None) {
+        return CompressedImage::getLevelSize(m_blockFormat, width, height);
+    }
+    return static_cast<size_t>(width) * height * m_channels;
+}
+
+size_t Texture::getResidentSize() const
+{
+    size_t total = 0;
+    for (int level = m_baseLevel; level < m_levelCount; level++) {
+        total += getLevelSize(level);
+    }
+    return total;
+}
+
+size_t Texture::getSourceSize() const
+{
+    if (m_streamCompressed) {
+        return m_streamCompressed->data.size();
+    }
+    if (!m_streamImage) {
+        return 0;
+    }
+    size_t total = m_streamImage->pixels.size();
+    for (const Image::MipLevel& level : m_streamImage->mips) {
+        total += level.pixels.size();
+    }
+    return total;
+}
+
+void Texture::track()
+{
+    ResourceRegistry::Resource resource;
+    resource.kind = ResourceRegistry::Kind::Texture;
+    resource.id = m_id;
+    resource.category = m_streaming ? ResourceCategory::StreamingTexture : ResourceCategory::Texture;
+    resource.name = m_path;
+    resource.format = ResourceRegistry::getFormatName(m_blockFormat, m_channels);
+    resource.width = m_width;
+    resource.height = m_height;
+    resource.levels = m_levelCount - m_baseLevel;
+    resource.layers = 1;
+    resource.gpuBytes = getResidentSize();
+    resource.cpuBytes = getSourceSize();
+    ResourceRegistry::get().add(std::move(resource));
+}
+
+void Texture::deleteTexture()
+{
+    if (m_id != 0) {
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Texture, m_id);
+        glDeleteTextures(1, &m_id);
+        m_id = 0;
+    }
+}
+
+bool Texture::loadStreaming(Image&& image, const std::string& name, TextureType type, int residentSize)
+{
+    if (!image.isValid()) {
+        return false;
+    }
+    if (image.mips.empty()) {
+        return loadFromImage(image, name, type);
+    }
+
+    // Clean up any existing texture
+    deleteTexture();
+    m_array.reset();
+    m_layer = -1;
+    releaseStreaming();
+
+    m_width = image.width;
+    m_height = image.height;
+    m_channels = image.channels;
+    m_blockFormat = BlockFormat::None;
+    m_levelCount = 1 + static_cast<int>(image.mips.size());
+    m_type = type;
+    m_path = name;
+
+    m_streamImage = std::make_unique<Image>(std::move(image));
+    beginStreaming(residentSize);
+    return true;
+}
+
+bool Texture::loadStreaming(CompressedImage&& image, const std::string& name, TextureType type, int residentSize)
+{
+    if (!image.isValid()) {
+        return false;
+    }
+    if (image.levels.size() < 2) {
+        return loadFromCompressed(image, name, type);
+    }
+
+    // Clean up any existing texture
+    deleteTexture();
+    m_array.reset();
+    m_layer = -1;
+    releaseStreaming();
+
+    m_width = image.width;
+    m_height = image.height;
+    m_channels = CompressedImage::getChannelCount(image.format);
+    m_blockFormat = image.format;
+    m_levelCount = static_cast<int>(image.levels.size());
+    m_type = type;
+    m_path = name;
+
+    m_streamCompressed = std::make_unique<CompressedImage>(std::move(image));
+    beginStreaming(residentSize);
+    return true;
+}
+
+void Texture::beginStreaming(int residentSize)
+{
+    PROFILE_SCOPE("Texture::beginStreaming");
+
+    // The tail is every level no larger than residentSize
+    m_tailLevel = 0;
+    while (m_tailLevel < m_levelCount - 1 && std::max(m_width >> m_tailLevel, m_height >> m_tailLevel) > residentSize) {
+        m_tailLevel++;
+    }
+    m_baseLevel = m_tailLevel;
+    m_minLod = 0.0f;
+
+    glGenTextures(1, &m_id);
+    glBindTexture(GL_TEXTURE_2D, m_id);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Levels below the base are never defined, completeness only looks at base..max
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, m_baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1);
+
+    for (int level = m_baseLevel; level < m_levelCount; level++) {
+        uploadStreamLevel(level);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_streaming = true;
+    TextureStreamer::get().add(this);
+    track();
+}
+
+void Texture::uploadStreamLevel(int level)
+{
+    // Mutable storage, streamOut releases levels again
+    TextureUploader& uploader = TextureUploader::get();
+    if (m_streamCompressed) {
+        const CompressedImage::Level& source = m_streamCompressed->levels[level];
+        uploader.allocate(m_blockFormat, m_channels, m_width, m_height, level, 1, false);
+        m_uploadSerial = uploader.upload(m_blockFormat, m_channels, level, source.width, source.height,
+            m_streamCompressed->data.data() + source.offset);
+    }
+    else if (m_streamImage) {
+        const Image& image = *m_streamImage;
+        const unsigned char* pixels = level == 0 ? image.pixels.data() : image.mips[level - 1].pixels.data();
+        int width = level == 0 ? image.width : image.mips[level - 1].width;
+        int height = level == 0 ? image.height : image.mips[level - 1].height;
+        uploader.allocate(BlockFormat::None, m_channels, m_width, m_height, level, 1, false);
+        m_uploadSerial = uploader.upload(BlockFormat::None, m_channels, level, width, height, pixels);
+    }
+}
+
+bool Texture::isUploadComplete() const
+{
+    return TextureUploader::get().isComplete(m_uploadSerial);
+}
+
+bool Texture::streamIn()
+{
+    if (!m_streaming || m_baseLevel == 0) {
+        return false;
+    }
+
+    PROFILE_SCOPE("Texture::streamIn");
+    glBindTexture(GL_TEXTURE_2D, m_id);
+    uploadStreamLevel(m_baseLevel - 1);
+    m_baseLevel--;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, m_baseLevel);
+
+    // MIN_LOD is relative to the base level, one more keeps sampling what was
+    // there before and the streamer fades the new level in
+    m_minLod += 1.0f;
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, m_minLod);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    ResourceRegistry::get().resize(ResourceRegistry::Kind::Texture, m_id, getResidentSize(),
+        getSourceSize(), m_levelCount - m_baseLevel);
+    return true;
+}
+
+bool Texture::streamOut()
+{
+    if (!m_streaming || m_baseLevel >= m_tailLevel) {
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_id);
+    m_baseLevel++;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, m_baseLevel);
+
+    // A 0x0 image releases the level's storage
+    glTexImage2D(GL_TEXTURE_2D, m_baseLevel - 1, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    m_minLod = std::max(0.0f, m_minLod - 1.0f);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, m_minLod);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    ResourceRegistry::get().resize(ResourceRegistry::Kind::Texture, m_id, getResidentSize(),
+        getSourceSize(), m_levelCount - m_baseLevel);
+    return true;
+}
+
+void Texture::setMinLod(float lod)
+{
+    m_minLod = lod;
+    glBindTexture(GL_TEXTURE_2D, m_id);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, m_minLod);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture::releaseStreaming()
+{
+    if (m_streaming) {
+        TextureStreamer::get().remove(this);
+        m_streaming = false;
+    }
+    m_streamImage.reset();
+    m_streamCompressed.reset();
+    m_baseLevel = 0;
+    m_tailLevel = 0;
+    m_minLod = 0.0f;
+}
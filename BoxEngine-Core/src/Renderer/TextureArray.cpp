@@ -0,0 +1,195 @@
+#include "Renderer/TextureArray.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Utils/Profiler.h"
+#include <glad/glad.h>
+#include <tuple>
+
+// Last array bound per unit. The only other GL_TEXTURE_2D_ARRAY user,
+// ShadowCascades, keeps to its own unit, so this stays accurate and lets runs
+// of meshes sharing arrays skip the rebinds.
+static const unsigned int MAX_CACHED_UNITS = 32;
+static unsigned int s_boundArrays[MAX_CACHED_UNITS] = {};
+
+// Uploads bind and unbind on whatever unit is active, so forget everything
+static void forgetBindings()
+{
+    for (auto& bound : s_boundArrays) {
+        bound = 0;
+    }
+}
+
+static GLenum toPixelFormat(int channels)
+{
+    switch (channels) {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 3: return GL_RGB;
+    default: return GL_RGBA;
+    }
+}
+
+bool TextureArray::Format::operator==(const Format& other) const
+{
+    return width == other.width && height == other.height && channels == other.channels &&
+        block == other.block && levels == other.levels;
+}
+
+bool TextureArray::Format::operator<(const Format& other) const
+{
+    return std::tie(width, height, channels, block, levels) <
+        std::tie(other.width, other.height, other.channels, other.block, other.levels);
+}
+
+TextureArray::Format TextureArray::getFormat(const Texture::Image& image)
+{
+    Format format;
+    format.width = image.width;
+    format.height = image.height;
+    format.channels = image.channels;
+    format.levels = 1 + static_cast<int>(image.mips.size());
+    return format;
+}
+
+TextureArray::Format TextureArray::getFormat(const CompressedImage& image)
+{
+    Format format;
+    format.width = image.width;
+    format.height = image.height;
+    format.block = image.format;
+    format.levels = static_cast<int>(image.levels.size());
+    return format;
+}
+
+int TextureArray::getMaxLayers()
+{
+    GLint layers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layers);
+    return layers;
+}
+
+TextureArray::TextureArray(const Format& format, int layerCount)
+    : m_format(format)
+    , m_layerCount(layerCount)
+{
+    PROFILE_SCOPE("TextureArray::allocate");
+
+    glGenTextures(1, &m_id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, format.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, format.levels - 1);
+
+    // Every level is allocated for all layers, addLayer only fills them in
+    int width = format.width;
+    int height = format.height;
+    size_t totalSize = 0;
+    for (int level = 0; level < format.levels; level++) {
+        if (format.block != BlockFormat::None) {
+            GLsizei size = static_cast<GLsizei>(CompressedImage::getLevelSize(format.block, width, height) * layerCount);
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, Texture::getGLFormat(format.block),
+                width, height, layerCount, 0, size, nullptr);
+            totalSize += static_cast<size_t>(size);
+        }
+        else {
+            GLenum pixelFormat = toPixelFormat(format.channels);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, pixelFormat, width, height, layerCount, 0,
+                pixelFormat, GL_UNSIGNED_BYTE, nullptr);
+            totalSize += static_cast<size_t>(width) * height * format.channels * layerCount;
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    forgetBindings();
+
+    // Every layer is allocated up front, so unused layers count too
+    ResourceRegistry::Resource resource;
+    resource.kind = ResourceRegistry::Kind::Texture;
+    resource.id = m_id;
+    resource.category = ResourceCategory::TextureArray;
+    resource.name = "array " + std::to_string(format.width) + "x" + std::to_string(format.height);
+    resource.format = ResourceRegistry::getFormatName(format.block, format.channels);
+    resource.width = format.width;
+    resource.height = format.height;
+    resource.levels = format.levels;
+    resource.layers = layerCount;
+    resource.gpuBytes = totalSize;
+    ResourceRegistry::get().add(std::move(resource));
+}
+
+TextureArray::~TextureArray()
+{
+    if (m_id != 0) {
+        forgetBindings();
+        ResourceRegistry::get().remove(ResourceRegistry::Kind::Texture, m_id);
+        glDeleteTextures(1, &m_id);
+    }
+}
+
+int TextureArray::addLayer(const Texture::Image& image)
+{
+    if (m_usedLayers >= m_layerCount || !(getFormat(image) == m_format)) {
+        return -1;
+    }
+
+    int layer = m_usedLayers++;
+    GLenum pixelFormat = toPixelFormat(image.channels);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    {
+        PROFILE_SCOPE("glTexSubImage3D");
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, image.width, image.height, 1,
+            pixelFormat, GL_UNSIGNED_BYTE, image.pixels.data());
+        for (size_t i = 0; i < image.mips.size(); i++) {
+            const Texture::Image::MipLevel& level = image.mips[i];
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(i + 1), 0, 0, layer, level.width, level.height, 1,
+                pixelFormat, GL_UNSIGNED_BYTE, level.pixels.data());
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    forgetBindings();
+    return layer;
+}
+
+int TextureArray::addLayer(const CompressedImage& image)
+{
+    if (m_usedLayers >= m_layerCount || !(getFormat(image) == m_format)) {
+        return -1;
+    }
+
+    int layer = m_usedLayers++;
+    GLenum format = Texture::getGLFormat(image.format);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    {
+        PROFILE_SCOPE("glCompressedTexSubImage3D");
+        for (size_t i = 0; i < image.levels.size(); i++) {
+            const CompressedImage::Level& level = image.levels[i];
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(i), 0, 0, layer,
+                level.width, level.height, 1, format, static_cast<GLsizei>(level.size), image.data.data() + level.offset);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    forgetBindings();
+    return layer;
+}
+
+void TextureArray::bind(unsigned int unit) const
+{
+    if (m_id == 0) return;
+    ResourceRegistry::get().touch(ResourceRegistry::Kind::Texture, m_id);
+    if (unit < MAX_CACHED_UNITS && s_boundArrays[unit] == m_id) return;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    if (unit < MAX_CACHED_UNITS) {
+        s_boundArrays[unit] = m_id;
+    }
+}
@@ -0,0 +1,136 @@
+#include "Renderer/TextureStreamer.h"
+#include "Renderer/Texture.h"
+#include "Utils/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+TextureStreamer& TextureStreamer::get()
+{
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+void TextureStreamer::add(Texture* texture)
+{
+    Entry entry;
+    entry.texture = texture;
+    entry.targetLevel = texture->getBaseLevel();
+    m_entries[texture] = entry;
+}
+
+void TextureStreamer::remove(Texture* texture)
+{
+    m_entries.erase(texture);
+}
+
+void TextureStreamer::requestSize(const Texture* texture, float screenSize)
+{
+    if (!texture || !texture->isStreaming()) return;
+
+    auto it = m_entries.find(texture);
+    if (it != m_entries.end()) {
+        it->second.requestedSize = std::max(it->second.requestedSize, screenSize);
+    }
+}
+
+int TextureStreamer::levelForSize(const Texture& texture, float screenSize) const
+{
+    if (screenSize <= 0.0f) {
+        return texture.m_tailLevel;
+    }
+
+    // One texel per pixel across the mesh, assuming its UVs span the texture once
+    float texels = static_cast<float>(std::max(texture.getWidth(), texture.getHeight()));
+    float level = std::log2(texels / screenSize) + m_settings.lodBias;
+    return std::max(0, std::min(texture.m_tailLevel, static_cast<int>(std::floor(level))));
+}
+
+size_t TextureStreamer::getResidentBytes() const
+{
+    size_t total = 0;
+    for (const auto& pair : m_entries) {
+        total += pair.second.texture->getResidentSize();
+    }
+    return total;
+}
+
+void TextureStreamer::update()
+{
+    if (m_entries.empty()) return;
+    PROFILE_SCOPE("TextureStreamer::update");
+
+    // Settle this update's requests, textures nobody drew for a while fall
+    // back to their tail
+    std::vector<Entry*> order;
+    order.reserve(m_entries.size());
+    size_t used = 0;
+
+    for (auto& pair : m_entries) {
+        Entry& entry = pair.second;
+        if (entry.requestedSize > 0.0f) {
+            entry.lastSize = entry.requestedSize;
+            entry.idleUpdates = 0;
+        }
+        else if (++entry.idleUpdates > m_settings.idleUpdates) {
+            entry.lastSize = 0.0f;
+        }
+        entry.requestedSize = 0.0f;
+
+        // The tail is always paid for
+        entry.targetLevel = entry.texture->m_tailLevel;
+        for (int level = entry.targetLevel; level < entry.texture->getLevelCount(); level++) {
+            used += entry.texture->getLevelSize(level);
+        }
+        order.push_back(&entry);
+    }
+
+    // Largest on screen first, one level per texture per round so a single
+    // close-up texture can't take the whole budget from everything else
+    std::sort(order.begin(), order.end(), [](const Entry* a, const Entry* b) {
+        return a->lastSize > b->lastSize;
+    });
+
+    bool granted = true;
+    while (granted) {
+        granted = false;
+        for (Entry* entry : order) {
+            if (entry->targetLevel <= levelForSize(*entry->texture, entry->lastSize)) continue;
+
+            size_t cost = entry->texture->getLevelSize(entry->targetLevel - 1);
+            if (used + cost > m_settings.budgetBytes) continue;
+
+            used += cost;
+            entry->targetLevel--;
+            granted = true;
+        }
+    }
+
+    // Drops first so the uploads below fit
+    for (Entry* entry : order) {
+        while (entry->texture->getBaseLevel() < entry->targetLevel && entry->texture->streamOut()) {
+        }
+    }
+
+    // Coarser levels come first per texture, so an interrupted texture is
+    // still sharper than before
+    size_t uploaded = 0;
+    for (Entry* entry : order) {
+        Texture* texture = entry->texture;
+        while (texture->getBaseLevel() > entry->targetLevel) {
+            size_t size = texture->getLevelSize(texture->getBaseLevel() - 1);
+            if (uploaded > 0 && uploaded + size > m_settings.uploadBytesPerUpdate) break;
+            if (!texture->streamIn()) break;
+            uploaded += size;
+        }
+    }
+
+    // Fade newly arrived levels in, once the staged upload has landed so the
+    // fade isn't spent waiting on the copy
+    for (Entry* entry : order) {
+        Texture* texture = entry->texture;
+        if (texture->m_minLod > 0.0f && texture->isUploadComplete()) {
+            texture->setMinLod(std::max(0.0f, texture->m_minLod - m_settings.fadeRate));
+        }
+    }
+}
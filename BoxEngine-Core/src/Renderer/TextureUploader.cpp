@@ -0,0 +1,254 @@
+#include "Renderer/TextureUploader.h"
+#include "Renderer/ResourceRegistry.h"
+#include "Renderer/Texture.h"
+#include "Utils/Profiler.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstring>
+
+static const size_t STAGING_ALIGNMENT = 16;
+static const GLuint64 WAIT_TIMEOUT_NS = 100000000;     // 100 ms per wait, retried until signalled
+
+// GL 4.2 / ARB_texture_storage, not in the 3.3 core glad build
+typedef void (APIENTRYP TexStorage2DProc)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+static TexStorage2DProc s_texStorage2D = nullptr;
+
+TextureUploader& TextureUploader::get()
+{
+    static TextureUploader uploader;
+    return uploader;
+}
+
+bool TextureUploader::hasTextureStorage()
+{
+    static bool queried = false;
+    if (!queried) {
+        queried = true;
+
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major > 4 || (major == 4 && minor >= 2) || glfwExtensionSupported("GL_ARB_texture_storage")) {
+            s_texStorage2D = reinterpret_cast<TexStorage2DProc>(glfwGetProcAddress("glTexStorage2D"));
+        }
+    }
+    return s_texStorage2D != nullptr;
+}
+
+// Sized formats, immutable storage doesn't accept GL_RED and friends
+static GLenum internalFormat(BlockFormat format, int channels)
+{
+    if (format != BlockFormat::None) {
+        return Texture::getGLFormat(format);
+    }
+    switch (channels) {
+    case 1: return GL_R8;
+    case 2: return GL_RG8;
+    case 3: return GL_RGB8;
+    default: return GL_RGBA8;
+    }
+}
+
+static GLenum pixelFormat(int channels)
+{
+    switch (channels) {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 3: return GL_RGB;
+    default: return GL_RGBA;
+    }
+}
+
+void TextureUploader::allocate(BlockFormat format, int channels, int width, int height, int firstLevel, int levelCount, bool immutable)
+{
+    GLenum internal = internalFormat(format, channels);
+
+    if (immutable && firstLevel == 0 && hasTextureStorage()) {
+        s_texStorage2D(GL_TEXTURE_2D, levelCount, internal, width, height);
+        return;
+    }
+
+    for (int level = firstLevel; level < firstLevel + levelCount; level++) {
+        int levelWidth = std::max(1, width >> level);
+        int levelHeight = std::max(1, height >> level);
+        if (format != BlockFormat::None) {
+            GLsizei size = static_cast<GLsizei>(CompressedImage::getLevelSize(format, levelWidth, levelHeight));
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internal, levelWidth, levelHeight, 0, size, nullptr);
+        }
+        else {
+            GLenum pixels = pixelFormat(channels);
+            glTexImage2D(GL_TEXTURE_2D, level, internal, levelWidth, levelHeight, 0, pixels, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+}
+
+// Sub-image of rows [y, y + rows) of a level, from client memory or the bound unpack buffer
+static void subImage(BlockFormat format, int channels, int level, int width, int y, int rows, size_t size, const void* data)
+{
+    if (format != BlockFormat::None) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, Texture::getGLFormat(format),
+            static_cast<GLsizei>(size), data);
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, pixelFormat(channels), GL_UNSIGNED_BYTE, data);
+    }
+}
+
+uint64_t TextureUploader::upload(BlockFormat format, int channels, int level, int width, int height, const unsigned char* data)
+{
+    PROFILE_SCOPE("TextureUploader::upload");
+
+    // Chunks are whole pixel rows, or whole block rows for compressed data
+    int rowHeight = format != BlockFormat::None ? 4 : 1;
+    int rows = (height + rowHeight - 1) / rowHeight;
+    size_t rowBytes = format != BlockFormat::None
+        ? CompressedImage::getLevelSize(format, width, std::min(height, 4))
+        : static_cast<size_t>(width) * channels;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (!m_settings.enabled || m_settings.bufferCount <= 0 || rowBytes > m_settings.bufferBytes) {
+        subImage(format, channels, level, width, 0, height, rowBytes * rows, data);
+        return 0;
+    }
+
+    size_t rowsPerChunk = m_settings.bufferBytes / rowBytes;
+    for (int row = 0; row < rows; ) {
+        int count = static_cast<int>(std::min(static_cast<size_t>(rows - row), rowsPerChunk));
+        size_t bytes = rowBytes * count;
+        int y = row * rowHeight;
+        int chunkHeight = std::min(height - y, count * rowHeight);
+        const unsigned char* source = data + rowBytes * row;
+
+        size_t offset = 0;
+        void* mapped = nullptr;
+        if (reserve(bytes, offset)) {
+            // The fence check in reserve already made this range free
+            mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        }
+
+        if (mapped) {
+            memcpy(mapped, source, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            subImage(format, channels, level, width, y, chunkHeight, bytes, reinterpret_cast<const void*>(offset));
+            m_uploadedBytes += bytes;
+            m_pending = true;
+        }
+        else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            subImage(format, channels, level, width, y, chunkHeight, bytes, source);
+        }
+        row += count;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return m_serial;
+}
+
+bool TextureUploader::reserve(size_t size, size_t& offset)
+{
+    if (m_buffers.empty()) {
+        m_buffers.resize(static_cast<size_t>(m_settings.bufferCount));
+        for (Buffer& buffer : m_buffers) {
+            glGenBuffers(1, &buffer.id);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, m_settings.bufferBytes, nullptr, GL_STREAM_DRAW);
+
+            ResourceRegistry::Resource resource;
+            resource.kind = ResourceRegistry::Kind::Buffer;
+            resource.id = buffer.id;
+            resource.category = ResourceCategory::StagingBuffer;
+            resource.name = "TextureUploader";
+            resource.owner = "engine";
+            resource.gpuBytes = m_settings.bufferBytes;
+            ResourceRegistry::get().add(std::move(resource));
+        }
+        m_current = 0;
+        m_offset = 0;
+    }
+
+    size_t start = (m_offset + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    if (start + size > m_settings.bufferBytes) {
+        // Next buffer in the ring, its previous contents must have been consumed
+        m_current = (m_current + 1) % m_buffers.size();
+        waitFor(m_buffers[m_current].lastSerial);
+        start = 0;
+    }
+
+    Buffer& buffer = m_buffers[m_current];
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+    buffer.lastSerial = m_serial;
+    offset = start;
+    m_offset = start + size;
+    return buffer.id != 0;
+}
+
+void TextureUploader::fence()
+{
+    if (!m_pending) return;
+
+    Fence fence;
+    fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence.serial = m_serial;
+    m_fences.push_back(fence);
+
+    m_serial++;
+    m_pending = false;
+}
+
+void TextureUploader::waitFor(uint64_t serial)
+{
+    if (serial <= m_completed) return;
+
+    PROFILE_SCOPE("TextureUploader::waitFor");
+    if (serial >= m_serial) {
+        fence();
+    }
+    while (m_completed < serial && !m_fences.empty()) {
+        retireFront(true);
+    }
+}
+
+bool TextureUploader::retireFront(bool wait)
+{
+    Fence& fence = m_fences.front();
+    GLsync sync = static_cast<GLsync>(fence.sync);
+
+    GLenum result = glClientWaitSync(sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? WAIT_TIMEOUT_NS : 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+
+    // GL_WAIT_FAILED only happens for a broken sync object, don't keep retrying it
+    glDeleteSync(sync);
+    m_completed = std::max(m_completed, fence.serial);
+    m_fences.pop_front();
+    return true;
+}
+
+void TextureUploader::update()
+{
+    fence();
+    while (!m_fences.empty() && retireFront(false)) {
+    }
+}
+
+void TextureUploader::shutdown()
+{
+    fence();
+    while (!m_fences.empty()) {
+        retireFront(true);
+    }
+
+    for (Buffer& buffer : m_buffers) {
+        if (buffer.id != 0) {
+            ResourceRegistry::get().remove(ResourceRegistry::Kind::Buffer, buffer.id);
+            glDeleteBuffers(1, &buffer.id);
+        }
+    }
+    m_buffers.clear();
+    m_current = 0;
+    m_offset = 0;
+}
@@ -0,0 +1,179 @@
+#include "Renderer/ViewCuller.h"
+#include "Utils/Profiler.h"
+#include "Utils/Simd.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+// Objects per job, below twice this the pass runs on the calling thread
+static const size_t JOB_OBJECTS = 4096;
+
+void ViewCuller::clear()
+{
+    m_planes.clear();
+    m_objectCount = 0;
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+    m_masks.clear();
+}
+
+int ViewCuller::addView(const glm::mat4& viewProjection)
+{
+    int view = static_cast<int>(getViewCount());
+    if (view >= MAX_VIEWS) return -1;
+
+    // Rows of the matrix combined into the six clip planes, near and far last
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+    const glm::vec4 equations[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[3] + rows[2], rows[3] - rows[2]
+    };
+
+    // Unnormalized is fine, distance and radius scale alike
+    for (const glm::vec4& equation : equations) {
+        Plane plane;
+        plane.equation = equation;
+        plane.absNormal = glm::vec3(std::abs(equation.x), std::abs(equation.y), std::abs(equation.z));
+        m_planes.push_back(plane);
+    }
+    return view;
+}
+
+// World box around a transformed local one, as centre and half extent
+static void worldBox(const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::mat4& transform,
+    glm::vec3& center, glm::vec3& worldExtent)
+{
+    center = glm::vec3(transform * glm::vec4((minBounds + maxBounds) * 0.5f, 1.0f));
+    glm::vec3 extent = (maxBounds - minBounds) * 0.5f;
+    for (int axis = 0; axis < 3; axis++) {
+        worldExtent[axis] = std::abs(transform[0][axis]) * extent.x +
+            std::abs(transform[1][axis]) * extent.y +
+            std::abs(transform[2][axis]) * extent.z;
+    }
+}
+
+void ViewCuller::addObject(const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::mat4& transform)
+{
+    glm::vec3 center;
+    glm::vec3 worldExtent;
+    worldBox(minBounds, maxBounds, transform, center, worldExtent);
+
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_extentX.push_back(worldExtent.x);
+    m_extentY.push_back(worldExtent.y);
+    m_extentZ.push_back(worldExtent.z);
+    m_objectCount++;
+}
+
+bool ViewCuller::isVisible(int view, const glm::vec3& minBounds, const glm::vec3& maxBounds, const glm::mat4& transform) const
+{
+    if (view < 0 || static_cast<size_t>(view) >= getViewCount()) return true;
+
+    glm::vec3 center;
+    glm::vec3 extent;
+    worldBox(minBounds, maxBounds, transform, center, extent);
+    for (int p = 0; p < 6; p++) {
+        const Plane& plane = m_planes[view * 6 + p];
+        float distance = glm::dot(glm::vec3(plane.equation), center) + plane.equation.w;
+        if (distance + glm::dot(plane.absNormal, extent) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ViewCuller::cull(ThreadPool& pool)
+{
+    PROFILE_SCOPE("ViewCuller::cull");
+
+    // Whole groups of four, the padding's masks are never read
+    size_t padded = (m_objectCount + 3) & ~size_t(3);
+    for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ }) {
+        values->resize(padded, 0.0f);
+    }
+    m_masks.assign(padded, 0);
+
+    if (padded < JOB_OBJECTS * 2 || pool.getThreadCount() == 0) {
+        cullRange(0, padded);
+        return;
+    }
+
+    // Ranges are disjoint, the jobs share nothing they write
+    for (size_t begin = 0; begin < padded; begin += JOB_OBJECTS) {
+        size_t end = std::min(padded, begin + JOB_OBJECTS);
+        pool.enqueue([this, begin, end]() {
+            cullRange(begin, end);
+        });
+    }
+    pool.waitIdle();
+}
+
+void ViewCuller::cullRange(size_t begin, size_t end)
+{
+    const size_t views = getViewCount();
+
+#ifdef BOX_SSE
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = begin; i < end; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&m_centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&m_centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&m_extentX[i]);
+        const __m128 ey = _mm_loadu_ps(&m_extentY[i]);
+        const __m128 ez = _mm_loadu_ps(&m_extentZ[i]);
+
+        uint32_t masks[4] = { 0, 0, 0, 0 };
+        for (size_t view = 0; view < views; view++) {
+            // Outside once the box is wholly behind any one plane
+            __m128 outside = zero;
+            for (int p = 0; p < 6; p++) {
+                const Plane& plane = m_planes[view * 6 + p];
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.equation.x), cx), _mm_mul_ps(_mm_set1_ps(plane.equation.y), cy)),
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.equation.z), cz), _mm_set1_ps(plane.equation.w)));
+                __m128 radius = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.absNormal.x), ex), _mm_mul_ps(_mm_set1_ps(plane.absNormal.y), ey)),
+                    _mm_mul_ps(_mm_set1_ps(plane.absNormal.z), ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+            }
+
+            int visible = ~_mm_movemask_ps(outside) & 0xF;
+            for (int lane = 0; lane < 4; lane++) {
+                if (visible & (1 << lane)) {
+                    masks[lane] |= 1u << view;
+                }
+            }
+        }
+        std::copy(masks, masks + 4, m_masks.begin() + i);
+    }
+#else
+    for (size_t i = begin; i < end; i++) {
+        glm::vec3 center(m_centerX[i], m_centerY[i], m_centerZ[i]);
+        glm::vec3 extent(m_extentX[i], m_extentY[i], m_extentZ[i]);
+
+        uint32_t mask = 0;
+        for (size_t view = 0; view < views; view++) {
+            bool outside = false;
+            for (int p = 0; p < 6 && !outside; p++) {
+                const Plane& plane = m_planes[view * 6 + p];
+                float distance = glm::dot(glm::vec3(plane.equation), center) + plane.equation.w;
+                outside = distance + glm::dot(plane.absNormal, extent) < 0.0f;
+            }
+            if (!outside) {
+                mask |= 1u << view;
+            }
+        }
+        m_masks[i] = mask;
+    }
+#endif
+}
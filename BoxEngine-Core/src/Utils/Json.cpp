@@ -0,0 +1,313 @@
+#include "Utils/Json.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+// Recursive descent parser, keeps the position and the first error
+class JsonParser
+{
+public:
+	JsonParser(const char* begin, const char* end) : m_pos(begin), m_end(end) {}
+
+	bool parseDocument(Json& out)
+	{
+		skipWhitespace();
+		if (!parseValue(out, 0)) return false;
+		skipWhitespace();
+		if (m_pos != m_end) return fail("trailing characters after document");
+		return true;
+	}
+
+	const std::string& getError() const { return m_error; }
+
+private:
+	static const int MAX_DEPTH = 256;
+
+	const char* m_pos;
+	const char* m_end;
+	std::string m_error;
+
+	bool fail(const char* message)
+	{
+		if (m_error.empty()) m_error = message;
+		return false;
+	}
+
+	void skipWhitespace()
+	{
+		while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r')) {
+			++m_pos;
+		}
+	}
+
+	bool match(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if (static_cast<size_t>(m_end - m_pos) < length || strncmp(m_pos, literal, length) != 0) {
+			return false;
+		}
+		m_pos += length;
+		return true;
+	}
+
+	bool parseValue(Json& out, int depth)
+	{
+		if (depth > MAX_DEPTH) return fail("document nested too deeply");
+		if (m_pos >= m_end) return fail("unexpected end of document");
+
+		switch (*m_pos) {
+		case '{': return parseObject(out, depth);
+		case '[': return parseArray(out, depth);
+		case '"':
+			out.m_type = Json::Type::String;
+			return parseString(out.m_string);
+		case 't':
+			if (!match("true")) return fail("invalid literal");
+			out.m_type = Json::Type::Bool;
+			out.m_bool = true;
+			return true;
+		case 'f':
+			if (!match("false")) return fail("invalid literal");
+			out.m_type = Json::Type::Bool;
+			out.m_bool = false;
+			return true;
+		case 'n':
+			if (!match("null")) return fail("invalid literal");
+			out.m_type = Json::Type::Null;
+			return true;
+		default:
+			return parseNumber(out);
+		}
+	}
+
+	bool parseNumber(Json& out)
+	{
+		// strtod needs a terminated string, numbers are short so copy them out
+		char buffer[64];
+		size_t length = 0;
+		while (m_pos < m_end && length < sizeof(buffer) - 1 &&
+			(isdigit(static_cast<unsigned char>(*m_pos)) || *m_pos == '-' || *m_pos == '+' ||
+				*m_pos == '.' || *m_pos == 'e' || *m_pos == 'E')) {
+			buffer[length++] = *m_pos++;
+		}
+		buffer[length] = '\0';
+
+		char* parsedEnd = nullptr;
+		out.m_number = strtod(buffer, &parsedEnd);
+		if (length == 0 || parsedEnd != buffer + length) return fail("invalid number");
+
+		out.m_type = Json::Type::Number;
+		return true;
+	}
+
+	static void appendUtf8(std::string& out, unsigned int codepoint)
+	{
+		if (codepoint < 0x80) {
+			out += static_cast<char>(codepoint);
+		}
+		else if (codepoint < 0x800) {
+			out += static_cast<char>(0xC0 | (codepoint >> 6));
+			out += static_cast<char>(0x80 | (codepoint & 0x3F));
+		}
+		else if (codepoint < 0x10000) {
+			out += static_cast<char>(0xE0 | (codepoint >> 12));
+			out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codepoint & 0x3F));
+		}
+		else {
+			out += static_cast<char>(0xF0 | (codepoint >> 18));
+			out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codepoint & 0x3F));
+		}
+	}
+
+	bool parseHex4(unsigned int& out)
+	{
+		if (m_end - m_pos < 4) return fail("truncated unicode escape");
+		out = 0;
+		for (int i = 0; i < 4; ++i) {
+			char c = *m_pos++;
+			out <<= 4;
+			if (c >= '0' && c <= '9') out |= c - '0';
+			else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+			else return fail("invalid unicode escape");
+		}
+		return true;
+	}
+
+	bool parseString(std::string& out)
+	{
+		++m_pos; // opening quote
+		out.clear();
+
+		while (m_pos < m_end) {
+			char c = *m_pos++;
+			if (c == '"') return true;
+			if (c != '\\') {
+				out += c;
+				continue;
+			}
+
+			if (m_pos >= m_end) break;
+			char escape = *m_pos++;
+			switch (escape) {
+			case '"':  out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/':  out += '/'; break;
+			case 'b':  out += '\b'; break;
+			case 'f':  out += '\f'; break;
+			case 'n':  out += '\n'; break;
+			case 'r':  out += '\r'; break;
+			case 't':  out += '\t'; break;
+			case 'u': {
+				unsigned int codepoint;
+				if (!parseHex4(codepoint)) return false;
+				// Surrogate pair
+				if (codepoint >= 0xD800 && codepoint <= 0xDBFF && match("\\u")) {
+					unsigned int low;
+					if (!parseHex4(low)) return false;
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(out, codepoint);
+				break;
+			}
+			default:
+				return fail("invalid escape sequence");
+			}
+		}
+		return fail("unterminated string");
+	}
+
+	bool parseArray(Json& out, int depth)
+	{
+		++m_pos; // [
+		out.m_type = Json::Type::Array;
+
+		skipWhitespace();
+		if (m_pos < m_end && *m_pos == ']') {
+			++m_pos;
+			return true;
+		}
+
+		while (true) {
+			out.m_elements.emplace_back();
+			skipWhitespace();
+			if (!parseValue(out.m_elements.back(), depth + 1)) return false;
+			skipWhitespace();
+
+			if (m_pos >= m_end) return fail("unterminated array");
+			if (*m_pos == ',') { ++m_pos; continue; }
+			if (*m_pos == ']') { ++m_pos; return true; }
+			return fail("expected ',' or ']' in array");
+		}
+	}
+
+	bool parseObject(Json& out, int depth)
+	{
+		++m_pos; // {
+		out.m_type = Json::Type::Object;
+
+		skipWhitespace();
+		if (m_pos < m_end && *m_pos == '}') {
+			++m_pos;
+			return true;
+		}
+
+		while (true) {
+			skipWhitespace();
+			if (m_pos >= m_end || *m_pos != '"') return fail("expected member name");
+
+			out.m_members.emplace_back();
+			auto& member = out.m_members.back();
+			if (!parseString(member.first)) return false;
+
+			skipWhitespace();
+			if (m_pos >= m_end || *m_pos != ':') return fail("expected ':' after member name");
+			++m_pos;
+
+			skipWhitespace();
+			if (!parseValue(member.second, depth + 1)) return false;
+			skipWhitespace();
+
+			if (m_pos >= m_end) return fail("unterminated object");
+			if (*m_pos == ',') { ++m_pos; continue; }
+			if (*m_pos == '}') { ++m_pos; return true; }
+			return fail("expected ',' or '}' in object");
+		}
+	}
+};
+
+bool Json::parse(const char* begin, const char* end, Json& out, std::string* error)
+{
+	out = Json();
+
+	JsonParser parser(begin, end);
+	if (!parser.parseDocument(out)) {
+		if (error) *error = parser.getError();
+		out = Json();
+		return false;
+	}
+	return true;
+}
+
+void Json::writeString(std::ostream& out, const std::string& value)
+{
+	out << '"';
+	for (char c : value) {
+		switch (c) {
+		case '"':  out << "\\\""; break;
+		case '\\': out << "\\\\"; break;
+		case '\n': out << "\\n"; break;
+		case '\r': out << "\\r"; break;
+		case '\t': out << "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+					<< std::dec << std::setfill(' ');
+			}
+			else {
+				out << c;
+			}
+		}
+	}
+	out << '"';
+}
+
+const Json& Json::operator[](const char* key) const
+{
+	static const Json null;
+	if (m_type != Type::Object) return null;
+
+	for (const auto& member : m_members) {
+		if (member.first == key) return member.second;
+	}
+	return null;
+}
+
+const Json& Json::operator[](size_t index) const
+{
+	static const Json null;
+	if (m_type != Type::Array || index >= m_elements.size()) return null;
+	return m_elements[index];
+}
+
+size_t Json::size() const
+{
+	if (m_type == Type::Array) return m_elements.size();
+	if (m_type == Type::Object) return m_members.size();
+	return 0;
+}
+
+bool Json::asBool(bool fallback) const
+{
+	return m_type == Type::Bool ? m_bool : fallback;
+}
+
+double Json::asNumber(double fallback) const
+{
+	return m_type == Type::Number ? m_number : fallback;
+}
@@ -0,0 +1,126 @@
+#include "Utils/MappedFile.h"
+
+#include <iostream>
+#include <utility>
+
+#ifdef GLCORE_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& filepath)
+{
+	close();
+
+#ifdef GLCORE_PLATFORM_WINDOWS
+	HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		std::cerr << "Failed to open file for mapping: " << filepath << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		CloseHandle(file);
+		std::cerr << "Failed to map file: " << filepath << std::endl;
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		std::cerr << "Failed to map file: " << filepath << std::endl;
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const unsigned char*>(view);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int fd = ::open(filepath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		std::cerr << "Failed to open file for mapping: " << filepath << std::endl;
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file
+	::close(fd);
+
+	if (view == MAP_FAILED) {
+		std::cerr << "Failed to map file: " << filepath << std::endl;
+		return false;
+	}
+
+	madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+	m_data = static_cast<const unsigned char*>(view);
+	m_size = static_cast<size_t>(info.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (!m_data) return;
+
+#ifdef GLCORE_PLATFORM_WINDOWS
+	UnmapViewOfFile(m_data);
+	CloseHandle(static_cast<HANDLE>(m_mapping));
+	CloseHandle(static_cast<HANDLE>(m_file));
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_data(other.m_data), m_size(other.m_size),
+	m_file(other.m_file), m_mapping(other.m_mapping)
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_file = nullptr;
+	other.m_mapping = nullptr;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		close();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,188 @@
+#include "Utils/Profiler.h"
+#include "Utils/Json.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+static thread_local std::string t_currentAsset;
+static thread_local uint32_t t_threadId = 0;
+static std::atomic<uint32_t> s_nextThreadId{ 1 };
+
+static uint32_t currentThreadId()
+{
+	if (t_threadId == 0) {
+		t_threadId = s_nextThreadId++;
+	}
+	return t_threadId;
+}
+
+Profiler::Profiler() : m_epoch(Clock::now())
+{
+}
+
+Profiler& Profiler::get()
+{
+	static Profiler instance;
+	return instance;
+}
+
+const std::string& Profiler::getCurrentAsset()
+{
+	return t_currentAsset;
+}
+
+void Profiler::record(const char* name, Clock::time_point start, Clock::time_point end)
+{
+	Event event;
+	event.name = name;
+	event.asset = t_currentAsset;
+	event.startUs = std::chrono::duration<double, std::micro>(start - m_epoch).count();
+	event.durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+	event.threadId = currentThreadId();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events.push_back(std::move(event));
+}
+
+void Profiler::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events.clear();
+}
+
+std::vector<Profiler::Event> Profiler::getEvents() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_events;
+}
+
+bool Profiler::writeChromeTrace(const std::string& filepath) const
+{
+	std::ofstream file(filepath);
+	if (!file.is_open()) {
+		std::cerr << "Failed to open trace file: " << filepath << std::endl;
+		return false;
+	}
+
+	std::vector<Event> events = getEvents();
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	file << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < events.size(); ++i) {
+		const Event& event = events[i];
+		if (i > 0) file << ",";
+		file << "\n{\"name\":";
+		Json::writeString(file, event.name);
+		file << ",\"cat\":\"import\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+			<< ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+			<< ",\"args\":{\"asset\":";
+		Json::writeString(file, event.asset);
+		file << "}}";
+	}
+	file << "\n]}\n";
+
+	return file.good();
+}
+
+void Profiler::printSummary(std::ostream& out) const
+{
+	struct StageStats
+	{
+		const char* name;
+		size_t calls = 0;
+		double totalUs = 0.0;
+		double maxUs = 0.0;
+	};
+
+	struct AssetStats
+	{
+		std::string asset;
+		double firstUs = 0.0;
+		double lastUs = 0.0;
+		std::vector<StageStats> stages;
+	};
+
+	std::vector<Event> events = getEvents();
+	std::vector<AssetStats> assets;
+
+	// Group by asset then stage, both in first-seen order
+	for (const Event& event : events) {
+		auto asset = std::find_if(assets.begin(), assets.end(),
+			[&](const AssetStats& a) { return a.asset == event.asset; });
+		if (asset == assets.end()) {
+			assets.push_back({ event.asset, event.startUs, event.startUs + event.durationUs, {} });
+			asset = assets.end() - 1;
+		}
+		asset->firstUs = std::min(asset->firstUs, event.startUs);
+		asset->lastUs = std::max(asset->lastUs, event.startUs + event.durationUs);
+
+		auto stage = std::find_if(asset->stages.begin(), asset->stages.end(),
+			[&](const StageStats& s) { return std::string(s.name) == event.name; });
+		if (stage == asset->stages.end()) {
+			asset->stages.push_back({ event.name });
+			stage = asset->stages.end() - 1;
+		}
+		stage->calls++;
+		stage->totalUs += event.durationUs;
+		stage->maxUs = std::max(stage->maxUs, event.durationUs);
+	}
+
+	out << std::fixed << std::setprecision(3);
+	for (const AssetStats& asset : assets) {
+		out << "\nAsset: " << (asset.asset.empty() ? "<none>" : asset.asset)
+			<< " (wall " << (asset.lastUs - asset.firstUs) / 1000.0 << " ms)\n";
+		out << "  " << std::left << std::setw(32) << "Stage"
+			<< std::right << std::setw(8) << "Calls"
+			<< std::setw(12) << "Total ms"
+			<< std::setw(12) << "Avg ms"
+			<< std::setw(12) << "Max ms" << "\n";
+
+		for (const StageStats& stage : asset.stages) {
+			out << "  " << std::left << std::setw(32) << stage.name
+				<< std::right << std::setw(8) << stage.calls
+				<< std::setw(12) << stage.totalUs / 1000.0
+				<< std::setw(12) << stage.totalUs / 1000.0 / stage.calls
+				<< std::setw(12) << stage.maxUs / 1000.0 << "\n";
+		}
+	}
+	out << std::defaultfloat << std::flush;
+}
+
+Profiler::AssetScope::AssetScope(const std::string& asset)
+	: m_owner(t_currentAsset.empty())
+{
+	if (m_owner) {
+		t_currentAsset = asset;
+	}
+}
+
+Profiler::AssetScope::~AssetScope()
+{
+	if (m_owner) {
+		t_currentAsset.clear();
+	}
+}
+
+Profiler::ScopedTimer::ScopedTimer(const char* name)
+	: m_name(name), m_active(Profiler::get().isEnabled())
+{
+	if (m_active) {
+		m_start = Clock::now();
+	}
+}
+
+Profiler::ScopedTimer::~ScopedTimer()
+{
+	stop();
+}
+
+void Profiler::ScopedTimer::stop()
+{
+	if (m_active) {
+		Profiler::get().record(m_name, m_start, Clock::now());
+		m_active = false;
+	}
+}
@@ -0,0 +1,85 @@
+#include "Utils/ThreadPool.h"
+
+#include <exception>
+#include <iostream>
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+	if (threadCount == 0) {
+		// Leave a core for the render thread
+		unsigned int hardware = std::thread::hardware_concurrency();
+		threadCount = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	m_workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; i++) {
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool& ThreadPool::get()
+{
+	static ThreadPool instance;
+	return instance;
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobAvailable.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_jobAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_jobs.empty() && m_running == 0; });
+}
+
+void ThreadPool::workerLoop()
+{
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+			// Drain the queue before stopping so no job is silently dropped
+			if (m_jobs.empty()) return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			m_running++;
+		}
+
+		try {
+			job();
+		}
+		catch (const std::exception& e) {
+			std::cerr << "ThreadPool job threw: " << e.what() << std::endl;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_running--;
+			if (m_jobs.empty() && m_running == 0) {
+				m_idle.notify_all();
+			}
+		}
+	}
+}
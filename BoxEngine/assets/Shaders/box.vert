@@ -0,0 +1,10 @@
+#version 330 core
+// Bounding box for occlusion queries, a unit cube stretched over the bounds
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 mvp;
+
+void main()
+{
+    gl_Position = mvp * vec4(aPos, 1.0);
+}
@@ -0,0 +1,6 @@
+#version 330 core
+// Depth only, for the prepass, shadow cascades and occlusion boxes
+
+void main()
+{
+}
@@ -0,0 +1,19 @@
+#version 330 core
+// Depth prepass, position only. gl_Position has to match main.vert bit for
+// bit so the shading pass can test with GL_EQUAL.
+layout (location = 0) in vec3 aPos;
+
+invariant gl_Position;
+
+// Same per-object matrices as main.vert, only the model-view-projection is needed.
+// OBJECT_* come from ObjectBuffer::getShaderDefines.
+uniform samplerBuffer objectData;
+uniform int objectId;
+
+void main()
+{
+    int base = objectId * OBJECT_TEXELS + OBJECT_MVP_TEXEL;
+    mat4 mvp = mat4(texelFetch(objectData, base), texelFetch(objectData, base + 1),
+                    texelFetch(objectData, base + 2), texelFetch(objectData, base + 3));
+    gl_Position = mvp * vec4(aPos, 1.0);
+}
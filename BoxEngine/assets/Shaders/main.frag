@@ -1,90 +1,221 @@
 #version 330 core
+// Variants: HAS_DIFFUSE, HAS_DIFFUSE2, HAS_PACKED, HAS_NORMAL_MAP and
+// TEXTURE_ARRAYS are defined per material, see ShaderFeature
 out vec4 FragColor;
 
 struct Material {
+#ifdef HAS_DIFFUSE
     sampler2D texture_diffuse1;
+#endif
+#ifdef HAS_DIFFUSE2
     sampler2D texture_diffuse2;
-    sampler2D texture_diffuse3;
-    sampler2D texture_specular1;
-    sampler2D texture_specular2;
+#endif
+#ifdef HAS_NORMAL_MAP
     sampler2D texture_normal1;
-    sampler2D texture_normal2;
-    sampler2D texture_height1;
-    sampler2D texture_height2;
+#endif
+#ifdef HAS_PACKED
+    sampler2D texture_packed;
+#endif
+#ifdef TEXTURE_ARRAYS
+    sampler2DArray array_diffuse;
+    sampler2DArray array_packed;
+    sampler2DArray array_normal;
+#endif
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
     float shininess;
-    bool useTextures;
+
+#ifdef HAS_PACKED
+    // One-hot channel of each scalar map in the packed texture, zero when absent
+    vec4 occlusionMask;
+    vec4 roughnessMask;
+    vec4 metallicMask;
+    vec4 specularMask;
+    vec4 heightMask;
+#endif
 };
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
-in vec3 TangentLightPos;
-in vec3 TangentViewPos;
-in vec3 TangentFragPos;
+#ifdef HAS_NORMAL_MAP
+in mat3 TBN;
+#endif
+#ifdef TEXTURE_ARRAYS
+flat in ivec4 Layers;
+#endif
 
 uniform Material material;
-uniform vec3 lightPos;
 uniform vec3 viewPos;
-uniform vec3 lightColor;
 uniform vec3 objectColor;
 uniform float ambientStrength;
 uniform float specularStrength;
 
+// Clustered lights, see LightClusters
+uniform samplerBuffer lightData;        // 2 texels per light: position + radius, colour * intensity
+uniform usamplerBuffer clusterGrid;     // per froxel: offset into lightIndices, count
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterCount;             // tiles x, tiles y, depth slices
+uniform vec2 clusterTileSize;           // pixels per tile
+uniform vec2 clusterSlice;              // slice = log(depth) * x + y
+uniform vec2 depthRange;                // near, far
+uniform int viewIndex;                  // the froxels are only built for view 0, the main one
+
+// Directional light with cascaded shadows, see ShadowCascades
+uniform vec3 sunDirection;              // towards the light, normalized
+uniform vec3 sunColor;                  // colour * intensity, black when there is none
+uniform sampler2DArrayShadow shadowMap; // one layer per cascade
+uniform int shadowCascadeCount;         // 0 without shadows
+uniform mat4 shadowMatrices[4];         // world to shadow texture space
+uniform vec2 shadowParams[4];           // 1 once rendered, normal offset in world units
+
+// Offset and count of the light list for this fragment's froxel
+uvec2 clusterLights()
+{
+    if (viewIndex != 0) return uvec2(0u);
+
+    float ndcDepth = gl_FragCoord.z * 2.0 - 1.0;
+    float depth = 2.0 * depthRange.x * depthRange.y /
+        (depthRange.y + depthRange.x - ndcDepth * (depthRange.y - depthRange.x));
+    int slice = clamp(int(log(depth) * clusterSlice.x + clusterSlice.y), 0, clusterCount.z - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), clusterCount.xy - 1);
+    return texelFetch(clusterGrid, (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x).xy;
+}
+
+// Sun visibility from the first cascade that covers the fragment, lit beyond the last
+float sunShadow(vec3 position, vec3 normal)
+{
+    for (int i = 0; i < shadowCascadeCount; i++) {
+        if (shadowParams[i].x == 0.0) continue;
+
+        vec4 coord = shadowMatrices[i] * vec4(position + normal * shadowParams[i].y, 1.0);
+        if (any(lessThan(coord.xy, vec2(0.0))) || any(greaterThan(coord.xy, vec2(1.0))) || coord.z > 1.0) continue;
+
+        // Four bilinear compares half a texel apart, 3x3 texels of PCF
+        vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+        float lit = 0.0;
+        lit += texture(shadowMap, vec4(coord.xy + vec2(-0.5, -0.5) * texel, float(i), coord.z));
+        lit += texture(shadowMap, vec4(coord.xy + vec2( 0.5, -0.5) * texel, float(i), coord.z));
+        lit += texture(shadowMap, vec4(coord.xy + vec2(-0.5,  0.5) * texel, float(i), coord.z));
+        lit += texture(shadowMap, vec4(coord.xy + vec2( 0.5,  0.5) * texel, float(i), coord.z));
+        return lit * 0.25;
+    }
+    return 1.0;
+}
+
+float packedValue(vec4 texel, vec4 mask, float fallback)
+{
+    return dot(mask, vec4(1.0)) > 0.0 ? dot(texel, mask) : fallback;
+}
+
 void main()
 {
-    vec3 result;
-    
-    if (material.useTextures) {
-        // Use textures
-        vec4 texColor = texture(material.texture_diffuse1, TexCoords);
-        
-        // If we have multiple diffuse textures, blend them
-        if (textureSize(material.texture_diffuse2, 0).x > 1) {
-            vec4 texColor2 = texture(material.texture_diffuse2, TexCoords);
-            texColor = mix(texColor, texColor2, 0.5);
-        }
-        
-        // Ambient lighting
-        vec3 ambient = ambientStrength * lightColor;
-        
-        // Diffuse lighting
-        vec3 norm = normalize(Normal);
-        vec3 lightDir = normalize(lightPos - FragPos);
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse = diff * lightColor;
-        
-        // Specular lighting
-        vec3 viewDir = normalize(viewPos - FragPos);
-        vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-        vec3 specular = specularStrength * spec * lightColor;
-        
-        // Combine
-        vec3 lighting = (ambient + diffuse + specular);
-        result = lighting * texColor.rgb;
-    } else {
-        // Use material colors
-        // Ambient lighting
-        vec3 ambient = ambientStrength * lightColor * material.ambient;
-        
-        // Diffuse lighting
-        vec3 norm = normalize(Normal);
-        vec3 lightDir = normalize(lightPos - FragPos);
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse = diff * lightColor * material.diffuse;
-        
-        // Specular lighting
-        vec3 viewDir = normalize(viewPos - FragPos);
+    // Surface colours, from the diffuse texture or the material
+#ifdef HAS_DIFFUSE
+    vec4 texColor;
+#ifdef TEXTURE_ARRAYS
+    if (Layers.x >= 0) {
+        // Diffuse lives in a shared texture array
+        texColor = texture(material.array_diffuse, vec3(TexCoords, Layers.x));
+    } else
+#endif
+    {
+        texColor = texture(material.texture_diffuse1, TexCoords);
+#ifdef HAS_DIFFUSE2
+        texColor = mix(texColor, texture(material.texture_diffuse2, TexCoords), 0.5);
+#endif
+    }
+    vec3 ambientColor = texColor.rgb;
+    vec3 diffuseColor = texColor.rgb;
+    vec3 specularColor = texColor.rgb;
+    float shininess = 32.0;
+#else
+    vec3 ambientColor = material.ambient * objectColor;
+    vec3 diffuseColor = material.diffuse * objectColor;
+    vec3 specularColor = material.specular * objectColor;
+    float shininess = material.shininess;
+#endif
+
+    // Scalar material maps, all read from one packed texel
+    float occlusion = 1.0;
+    float metallic = 0.0;
+    float specularMap = 1.0;
+#ifdef HAS_PACKED
+    vec4 packedTexel;
+#ifdef TEXTURE_ARRAYS
+    if (Layers.y >= 0) {
+        packedTexel = texture(material.array_packed, vec3(TexCoords, Layers.y));
+    } else
+#endif
+    {
+        packedTexel = texture(material.texture_packed, TexCoords);
+    }
+    occlusion = packedValue(packedTexel, material.occlusionMask, 1.0);
+    metallic = packedValue(packedTexel, material.metallicMask, 0.0);
+    specularMap = packedValue(packedTexel, material.specularMask, 1.0);
+
+    // Mid roughness gives the old exponent of 32
+    if (dot(material.roughnessMask, vec4(1.0)) > 0.0) {
+        shininess = exp2(8.0 * (1.0 - dot(packedTexel, material.roughnessMask)) + 1.0);
+    }
+#endif
+
+    // World space normal, bent by the normal map when there is one
+#ifdef HAS_NORMAL_MAP
+    vec4 normalTexel;
+#ifdef TEXTURE_ARRAYS
+    if (Layers.z >= 0) {
+        normalTexel = texture(material.array_normal, vec3(TexCoords, Layers.z));
+    } else
+#endif
+    {
+        normalTexel = texture(material.texture_normal1, TexCoords);
+    }
+    // z is rebuilt so two-channel (BC5) normal maps work too
+    vec2 normalXY = normalTexel.xy * 2.0 - 1.0;
+    vec3 norm = normalize(TBN * vec3(normalXY, sqrt(max(0.0, 1.0 - dot(normalXY, normalXY)))));
+#else
+    vec3 norm = normalize(Normal);
+#endif
+    vec3 viewDir = normalize(viewPos - FragPos);
+
+    // Ambient lighting
+    vec3 ambient = ambientStrength * occlusion * ambientColor;
+
+    // Phong from every light listed in this fragment's froxel
+    vec3 diffuseLight = vec3(0.0);
+    vec3 specularLight = vec3(0.0);
+    uvec2 lights = clusterLights();
+    for (uint i = 0u; i < lights.y; i++) {
+        int light = int(texelFetch(lightIndices, int(lights.x + i)).x);
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float lightDistance = length(toLight);
+        vec3 lightDir = toLight / max(lightDistance, 1e-4);
+
+        // Smooth fade that reaches zero at the radius the light was binned with
+        float fade = clamp(1.0 - (lightDistance * lightDistance) / (positionRadius.w * positionRadius.w), 0.0, 1.0);
+        lightColor *= fade * fade;
+
+        diffuseLight += max(dot(norm, lightDir), 0.0) * lightColor;
         vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-        vec3 specular = specularStrength * spec * lightColor * material.specular;
-        
-        // Combine
-        result = (ambient + diffuse + specular) * objectColor;
+        specularLight += pow(max(dot(viewDir, reflectDir), 0.0), shininess) * lightColor;
     }
-    
-    FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+
+    // Sun, the shadow lookup only where it faces the light
+    float sunFacing = dot(norm, sunDirection);
+    if (sunFacing > 0.0 && dot(sunColor, sunColor) > 0.0) {
+        vec3 sunLight = sunColor * sunShadow(FragPos, normalize(Normal));
+        diffuseLight += sunFacing * sunLight;
+        vec3 reflectDir = reflect(-sunDirection, norm);
+        specularLight += pow(max(dot(viewDir, reflectDir), 0.0), shininess) * sunLight;
+    }
+
+    vec3 diffuse = diffuseLight * (1.0 - metallic) * diffuseColor;
+    vec3 specular = specularStrength * specularMap * specularLight * specularColor;
+
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+}
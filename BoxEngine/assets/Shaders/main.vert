@@ -1,39 +1,68 @@
 #version 330 core
+// Same feature defines as main.frag
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
+layout (location = 5) in ivec4 aLayers;   // texture array layers (diffuse, packed, normal, height), -1 if unused
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
-out vec3 TangentLightPos;
-out vec3 TangentViewPos;
-out vec3 TangentFragPos;
+#ifdef HAS_NORMAL_MAP
+out mat3 TBN;   // tangent to world, lighting stays in world space for any number of lights
+#endif
+#ifdef TEXTURE_ARRAYS
+flat out ivec4 Layers;
+#endif
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+// Matches depth.vert so the depth prepass and this pass agree exactly
+invariant gl_Position;
+
+// Per-object matrices worked out on the CPU, see ObjectBuffer: model,
+// model-view-projection and normal matrix. The stride and texel offsets are
+// the OBJECT_* defines ObjectBuffer::getShaderDefines adds.
+uniform samplerBuffer objectData;
+uniform int objectId;
+
+// Extra views (Renderer::addView) project with their own matrix, the
+// object buffer only holds the main view's model-view-projection
+uniform int viewIndex;                  // 0 the main view
+uniform mat4 viewProjection;
+
+mat4 fetchMat4(int texel)
+{
+    return mat4(texelFetch(objectData, texel), texelFetch(objectData, texel + 1),
+                texelFetch(objectData, texel + 2), texelFetch(objectData, texel + 3));
+}
 
 void main()
 {
+    int base = objectId * OBJECT_TEXELS;
+    mat4 model = fetchMat4(base + OBJECT_MODEL_TEXEL);
+    mat4 mvp = fetchMat4(base + OBJECT_MVP_TEXEL);
+    mat3 normalMatrix = mat3(texelFetch(objectData, base + OBJECT_NORMAL_TEXEL).xyz,
+                             texelFetch(objectData, base + OBJECT_NORMAL_TEXEL + 1).xyz,
+                             texelFetch(objectData, base + OBJECT_NORMAL_TEXEL + 2).xyz);
+
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
     TexCoords = aTexCoords;
-    
-    // For normal mapping
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
+#ifdef TEXTURE_ARRAYS
+    Layers = aLayers;
+#endif
+
+#ifdef HAS_NORMAL_MAP
     vec3 T = normalize(normalMatrix * aTangent);
     vec3 B = normalize(normalMatrix * aBitangent);
     vec3 N = normalize(normalMatrix * aNormal);
-    mat3 TBN = transpose(mat3(T, B, N));
-    
-    TangentLightPos = TBN * lightPos;
-    TangentViewPos = TBN * viewPos;
-    TangentFragPos = TBN * FragPos;
-    
-    gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+    TBN = mat3(T, B, N);
+#endif
+
+    if (viewIndex == 0) {
+        gl_Position = mvp * vec4(aPos, 1.0);
+    } else {
+        gl_Position = viewProjection * vec4(FragPos, 1.0);
+    }
+}
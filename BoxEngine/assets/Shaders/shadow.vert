@@ -0,0 +1,17 @@
+#version 330 core
+// Shadow cascade depth, position only. Model matrices come from the object
+// buffer like main.vert (OBJECT_* from ObjectBuffer::getShaderDefines), the
+// cascade's light matrix is a uniform.
+layout (location = 0) in vec3 aPos;
+
+uniform samplerBuffer objectData;
+uniform int objectId;
+uniform mat4 lightViewProjection;
+
+void main()
+{
+    int base = objectId * OBJECT_TEXELS + OBJECT_MODEL_TEXEL;
+    mat4 model = mat4(texelFetch(objectData, base), texelFetch(objectData, base + 1),
+                      texelFetch(objectData, base + 2), texelFetch(objectData, base + 3));
+    gl_Position = lightViewProjection * (model * vec4(aPos, 1.0));
+}
@@ -0,0 +1,40 @@
+#version 330 core
+// Stretches the scaled scene over the window, see DynamicResolution. A
+// contrast adaptive sharpen brings back some of the detail the bilinear
+// filter smears, and backs off where the neighbourhood already has contrast
+// so edges don't ring.
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D sceneColor;
+uniform vec2 uvScale;       // part of the target rendered this frame
+uniform vec2 texelSize;     // one texel of the target
+uniform float sharpness;    // 0 plain bilinear
+
+void main()
+{
+    // Taps stay inside the rendered corner of the target
+    vec2 maxUV = uvScale - 0.5 * texelSize;
+    vec2 uv = min(TexCoords * uvScale, maxUV);
+
+    vec3 center = texture(sceneColor, uv).rgb;
+    if (sharpness <= 0.0) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec3 north = texture(sceneColor, min(uv + vec2(0.0, texelSize.y), maxUV)).rgb;
+    vec3 south = texture(sceneColor, max(uv - vec2(0.0, texelSize.y), vec2(0.0))).rgb;
+    vec3 east = texture(sceneColor, min(uv + vec2(texelSize.x, 0.0), maxUV)).rgb;
+    vec3 west = texture(sceneColor, max(uv - vec2(texelSize.x, 0.0), vec2(0.0))).rgb;
+
+    // Headroom to black and to white over the local range, small where contrast is high
+    vec3 low = min(center, min(min(north, south), min(east, west)));
+    vec3 high = max(center, max(max(north, south), max(east, west)));
+    vec3 amount = sqrt(clamp(min(low, 1.0 - high) / max(high, vec3(1e-4)), 0.0, 1.0));
+
+    // Negative lobe on the cross, normalized so flat areas stay put
+    vec3 weight = -amount * (0.2 * sharpness);
+    vec3 color = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+    FragColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
@@ -69,6 +69,18 @@ int main() {
         model.addMesh(mesh);
     }
 
+    // Compile the shader variants the model needs side by side before the first frame
+    renderer.prepareShaders(model);
+
+    // Soft sun for shadows, the point light below still does most of the lighting
+    DirectionalLight sun;
+    sun.direction = glm::vec3(-0.4f, -1.0f, -0.3f);
+    sun.intensity = 0.6f;
+    renderer.setDirectionalLight(sun);
+
+    // Trade resolution for a steady frame rate on slower GPUs
+    renderer.setDynamicResolution(true);
+
     // Set up camera matrices this should be done in a camera class
     glm::mat4 view = glm::lookAt(
         glm::vec3(dist, 2.0f, dist),
@@ -107,6 +119,12 @@ int main() {
         // Begin frame
         renderer.beginFrame();
 
+        // Same light the renderer used to hardcode
+        PointLight light;
+        light.position = glm::vec3(5.0f, 5.0f, 5.0f);
+        light.radius = 50.0f;
+        renderer.addLight(light);
+
         // Render the model
         renderer.renderModel(model, modelTransform);
 
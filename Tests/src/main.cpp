@@ -0,0 +1,96 @@
+#include "Renderer/CompressedImage.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Checks for loaders that read untrusted files. Returns non-zero when any
+// check fails so it can run as a build step.
+
+static int s_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            s_failures++; \
+        } \
+    } while (0)
+
+static void writeU32(std::vector<unsigned char>& data, size_t offset, uint32_t value)
+{
+    memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+static void writeU64(std::vector<unsigned char>& data, size_t offset, uint64_t value)
+{
+    memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+// A 4x4 BC1 KTX2 file with room for levelEntries entries in its level index
+// and one 8 byte block after it
+static std::vector<unsigned char> makeKTX2(uint32_t levelCount, uint32_t levelEntries)
+{
+    static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> data(80 + levelEntries * 24 + 8, 0);
+    memcpy(data.data(), identifier, sizeof(identifier));
+    writeU32(data, 12, 131);    // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    writeU32(data, 20, 4);
+    writeU32(data, 24, 4);
+    writeU32(data, 36, 1);
+    writeU32(data, 40, levelCount);
+    for (uint32_t i = 0; i < levelEntries; i++) {
+        writeU64(data, 80 + i * 24, data.size() - 8);
+        writeU64(data, 80 + i * 24 + 8, 8);
+    }
+    return data;
+}
+
+static bool loadBytes(const std::vector<unsigned char>& bytes, CompressedImage& image)
+{
+    std::string path = (std::filesystem::temp_directory_path() / "boxengine_test.ktx2").string();
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    bool loaded = CompressedImage::load(path, image);
+    std::remove(path.c_str());
+    return loaded;
+}
+
+static void testKTX2()
+{
+    CompressedImage image;
+
+    CHECK(loadBytes(makeKTX2(1, 1), image));
+    CHECK(image.levels.size() == 1);
+
+    // Index claims more levels than the file holds
+    std::vector<unsigned char> truncated = makeKTX2(2, 1);
+    CHECK(!loadBytes(truncated, image));
+
+    // levelCount * 24 wraps to 8 in 32 bits
+    CHECK(!loadBytes(makeKTX2(0x0AAAAAABu, 1), image));
+
+    // offset + length wraps to a small value
+    std::vector<unsigned char> wrapping = makeKTX2(1, 1);
+    writeU64(wrapping, 80, ~uint64_t(0) - 7);
+    writeU64(wrapping, 88, 16);
+    CHECK(!loadBytes(wrapping, image));
+}
+
+int main()
+{
+    testKTX2();
+
+    if (s_failures > 0) {
+        std::cerr << s_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,473 @@
+#include "BlockEncoder.h"
+#include "Utils/Simd.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Block texels split by channel, the layout the SIMD search wants
+struct BlockChannels {
+	alignas(16) float c[4][16];
+};
+
+static void loadBlock(const uint8_t pixels[64], BlockChannels& block)
+{
+	for (int i = 0; i < 16; i++) {
+		for (int ch = 0; ch < 4; ch++) {
+			block.c[ch][i] = pixels[i * 4 + ch];
+		}
+	}
+}
+
+// For each texel pick the closest palette entry over the first `channels`
+// channels, returns the summed squared error
+static float selectIndices(const BlockChannels& block, const float palette[][4], int count, int channels, uint8_t indices[16])
+{
+#ifdef BOX_SSE
+	__m128 total = _mm_setzero_ps();
+	for (int group = 0; group < 16; group += 4) {
+		__m128 best = _mm_set1_ps(1e30f);
+		__m128 bestIndex = _mm_setzero_ps();
+
+		for (int p = 0; p < count; p++) {
+			__m128 distance = _mm_setzero_ps();
+			for (int ch = 0; ch < channels; ch++) {
+				__m128 d = _mm_sub_ps(_mm_load_ps(&block.c[ch][group]), _mm_set1_ps(palette[p][ch]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+			}
+
+			// SSE2 has no blend, select with and/andnot/or
+			__m128 closer = _mm_cmplt_ps(distance, best);
+			best = _mm_or_ps(_mm_and_ps(closer, distance), _mm_andnot_ps(closer, best));
+			bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(p))), _mm_andnot_ps(closer, bestIndex));
+		}
+
+		alignas(16) int lanes[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_cvttps_epi32(bestIndex));
+		for (int lane = 0; lane < 4; lane++) {
+			indices[group + lane] = static_cast<uint8_t>(lanes[lane]);
+		}
+		total = _mm_add_ps(total, best);
+	}
+
+	alignas(16) float sums[4];
+	_mm_store_ps(sums, total);
+	return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+	float total = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float best = 1e30f;
+		for (int p = 0; p < count; p++) {
+			float distance = 0.0f;
+			for (int ch = 0; ch < channels; ch++) {
+				float d = block.c[ch][i] - palette[p][ch];
+				distance += d * d;
+			}
+			if (distance < best) {
+				best = distance;
+				indices[i] = static_cast<uint8_t>(p);
+			}
+		}
+		total += best;
+	}
+	return total;
+#endif
+}
+
+// Principal axis of the block by power iteration, endpoints are the extreme
+// projections pulled in slightly (the ends of a range are rarely hit exactly)
+static void findEndpoints(const BlockChannels& block, int channels, float low[4], float high[4])
+{
+	float mean[4] = {};
+	for (int ch = 0; ch < channels; ch++) {
+		for (int i = 0; i < 16; i++) mean[ch] += block.c[ch][i];
+		mean[ch] /= 16.0f;
+	}
+
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int a = 0; a < channels; a++) {
+			for (int b = a; b < channels; b++) {
+				covariance[a][b] += (block.c[a][i] - mean[a]) * (block.c[b][i] - mean[b]);
+			}
+		}
+	}
+	for (int a = 0; a < channels; a++) {
+		for (int b = 0; b < a; b++) covariance[a][b] = covariance[b][a];
+	}
+
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = {};
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+		}
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++) length += next[a] * next[a];
+		if (length < 1e-12f) break;
+
+		length = std::sqrt(length);
+		for (int a = 0; a < channels; a++) axis[a] = next[a] / length;
+	}
+
+	float minT = 1e30f, maxT = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int ch = 0; ch < channels; ch++) t += (block.c[ch][i] - mean[ch]) * axis[ch];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	float inset = (maxT - minT) / 32.0f;
+	minT += inset;
+	maxT -= inset;
+	for (int ch = 0; ch < channels; ch++) {
+		low[ch] = std::min(255.0f, std::max(0.0f, mean[ch] + axis[ch] * minT));
+		high[ch] = std::min(255.0f, std::max(0.0f, mean[ch] + axis[ch] * maxT));
+	}
+	for (int ch = channels; ch < 4; ch++) {
+		low[ch] = high[ch] = 255.0f;
+	}
+}
+
+// Least squares endpoints for fixed interpolation weights, one refinement step
+static bool refineEndpoints(const BlockChannels& block, int channels, const float weights[], const uint8_t indices[16],
+	float low[4], float high[4])
+{
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+	for (int i = 0; i < 16; i++) {
+		float b = weights[indices[i]];
+		float a = 1.0f - b;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int ch = 0; ch < channels; ch++) {
+			ax[ch] += a * block.c[ch][i];
+			bx[ch] += b * block.c[ch][i];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if (std::fabs(det) < 1e-6f) return false;
+
+	for (int ch = 0; ch < channels; ch++) {
+		low[ch] = std::min(255.0f, std::max(0.0f, (ax[ch] * bb - bx[ch] * ab) / det));
+		high[ch] = std::min(255.0f, std::max(0.0f, (bx[ch] * aa - ax[ch] * ab) / det));
+	}
+	return true;
+}
+
+// --- BC1 -------------------------------------------------------------------
+
+static uint16_t packRGB565(const float color[4])
+{
+	int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+	int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+	int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, float color[4])
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = static_cast<float>((r << 3) | (r >> 2));
+	color[1] = static_cast<float>((g << 2) | (g >> 4));
+	color[2] = static_cast<float>((b << 3) | (b >> 2));
+	color[3] = 255.0f;
+}
+
+// Four colour mode (color0 > color1), which is also what BC3 always uses
+static float encodeColorEndpoints(const BlockChannels& block, uint16_t c0, uint16_t c1, uint8_t out[8])
+{
+	if (c0 < c1) std::swap(c0, c1);
+
+	float palette[4][4];
+	unpackRGB565(c0, palette[0]);
+	unpackRGB565(c1, palette[1]);
+	for (int ch = 0; ch < 3; ch++) {
+		palette[2][ch] = (2.0f * palette[0][ch] + palette[1][ch]) / 3.0f;
+		palette[3][ch] = (palette[0][ch] + 2.0f * palette[1][ch]) / 3.0f;
+	}
+
+	uint8_t indices[16];
+	float error = selectIndices(block, palette, c0 == c1 ? 1 : 4, 3, indices);
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++) bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+
+	out[0] = static_cast<uint8_t>(c0);
+	out[1] = static_cast<uint8_t>(c0 >> 8);
+	out[2] = static_cast<uint8_t>(c1);
+	out[3] = static_cast<uint8_t>(c1 >> 8);
+	memcpy(out + 4, &bits, 4);
+	return error;
+}
+
+static void encodeColorBlock(const BlockChannels& block, uint8_t out[8])
+{
+	float low[4], high[4];
+	findEndpoints(block, 3, low, high);
+	float error = encodeColorEndpoints(block, packRGB565(high), packRGB565(low), out);
+
+	// One refinement pass with the indices we got, kept only if it helps
+	static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	uint32_t bits;
+	memcpy(&bits, out + 4, 4);
+	uint8_t indices[16];
+	for (int i = 0; i < 16; i++) indices[i] = (bits >> (i * 2)) & 3;
+
+	if (refineEndpoints(block, 3, weights, indices, high, low)) {
+		uint8_t candidate[8];
+		if (encodeColorEndpoints(block, packRGB565(high), packRGB565(low), candidate) < error) {
+			memcpy(out, candidate, 8);
+		}
+	}
+}
+
+void BlockEncoder::encodeBC1(const uint8_t pixels[64], uint8_t out[8])
+{
+	BlockChannels block;
+	loadBlock(pixels, block);
+	encodeColorBlock(block, out);
+}
+
+// --- BC4 / BC5 / BC3 alpha ------------------------------------------------
+
+void BlockEncoder::encodeBC4(const uint8_t pixels[64], int channel, uint8_t out[8])
+{
+	int minValue = 255, maxValue = 0;
+	for (int i = 0; i < 16; i++) {
+		minValue = std::min<int>(minValue, pixels[i * 4 + channel]);
+		maxValue = std::max<int>(maxValue, pixels[i * 4 + channel]);
+	}
+
+	// Eight value mode: endpoint 0 > endpoint 1, six interpolated values between
+	out[0] = static_cast<uint8_t>(maxValue);
+	out[1] = static_cast<uint8_t>(minValue);
+
+	uint64_t bits = 0;
+	if (maxValue > minValue) {
+		float scale = 7.0f / static_cast<float>(maxValue - minValue);
+		for (int i = 0; i < 16; i++) {
+			// Position 0 is endpoint 1, 7 is endpoint 0, k in between is index 8 - k
+			int position = static_cast<int>((pixels[i * 4 + channel] - minValue) * scale + 0.5f);
+			uint64_t index = position == 7 ? 0 : position == 0 ? 1 : static_cast<uint64_t>(8 - position);
+			bits |= index << (i * 3);
+		}
+	}
+	for (int i = 0; i < 6; i++) {
+		out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+	}
+}
+
+void BlockEncoder::encodeBC5(const uint8_t pixels[64], uint8_t out[16])
+{
+	encodeBC4(pixels, 0, out);
+	encodeBC4(pixels, 1, out + 8);
+}
+
+void BlockEncoder::encodeBC3(const uint8_t pixels[64], uint8_t out[16])
+{
+	encodeBC4(pixels, 3, out);
+
+	BlockChannels block;
+	loadBlock(pixels, block);
+	encodeColorBlock(block, out + 8);
+}
+
+// --- BC7 mode 6 ------------------------------------------------------------
+
+static const float BC7_WEIGHTS[16] = {
+	0.0f / 64, 4.0f / 64, 9.0f / 64, 13.0f / 64, 17.0f / 64, 21.0f / 64, 26.0f / 64, 30.0f / 64,
+	34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64, 51.0f / 64, 55.0f / 64, 60.0f / 64, 64.0f / 64
+};
+
+struct BC7Mode6 {
+	uint8_t endpoints[2][4];    // 7-bit values
+	uint8_t pbits[2];
+	uint8_t indices[16];
+	float error = 1e30f;
+};
+
+// Quantize endpoints with the given p-bits, build the palette and pick indices
+static void tryBC7Mode6(const BlockChannels& block, const float low[4], const float high[4], int p0, int p1, BC7Mode6& best)
+{
+	BC7Mode6 candidate;
+	candidate.pbits[0] = static_cast<uint8_t>(p0);
+	candidate.pbits[1] = static_cast<uint8_t>(p1);
+
+	int expanded[2][4];
+	for (int ch = 0; ch < 4; ch++) {
+		const float* source[2] = { low, high };
+		for (int e = 0; e < 2; e++) {
+			int p = candidate.pbits[e];
+			int value = static_cast<int>((source[e][ch] - p) / 2.0f + 0.5f);
+			value = std::min(127, std::max(0, value));
+			candidate.endpoints[e][ch] = static_cast<uint8_t>(value);
+			expanded[e][ch] = (value << 1) | p;
+		}
+	}
+
+	// Same integer interpolation the hardware does
+	static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	float palette[16][4];
+	for (int i = 0; i < 16; i++) {
+		for (int ch = 0; ch < 4; ch++) {
+			palette[i][ch] = static_cast<float>(((64 - weights[i]) * expanded[0][ch] + weights[i] * expanded[1][ch] + 32) >> 6);
+		}
+	}
+
+	candidate.error = selectIndices(block, palette, 16, 4, candidate.indices);
+	if (candidate.error < best.error) {
+		best = candidate;
+	}
+}
+
+static void searchBC7Mode6(const BlockChannels& block, const float low[4], const float high[4], BC7Mode6& best)
+{
+	for (int p0 = 0; p0 < 2; p0++) {
+		for (int p1 = 0; p1 < 2; p1++) {
+			tryBC7Mode6(block, low, high, p0, p1, best);
+		}
+	}
+}
+
+// Little endian bit writer over the 128-bit block
+static void writeBits(uint8_t out[16], int& position, uint32_t value, int count)
+{
+	for (int i = 0; i < count; i++, position++) {
+		if (value & (1u << i)) {
+			out[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+		}
+	}
+}
+
+void BlockEncoder::encodeBC7(const uint8_t pixels[64], uint8_t out[16])
+{
+	BlockChannels block;
+	loadBlock(pixels, block);
+
+	float low[4], high[4];
+	findEndpoints(block, 4, low, high);
+
+	BC7Mode6 best;
+	searchBC7Mode6(block, low, high, best);
+
+	if (refineEndpoints(block, 4, BC7_WEIGHTS, best.indices, low, high)) {
+		searchBC7Mode6(block, low, high, best);
+	}
+
+	// The first index is stored with an implied zero top bit, swap the
+	// endpoints if it would need one
+	if (best.indices[0] & 8) {
+		for (int ch = 0; ch < 4; ch++) std::swap(best.endpoints[0][ch], best.endpoints[1][ch]);
+		std::swap(best.pbits[0], best.pbits[1]);
+		for (int i = 0; i < 16; i++) best.indices[i] = static_cast<uint8_t>(15 - best.indices[i]);
+	}
+
+	memset(out, 0, 16);
+	int position = 0;
+	writeBits(out, position, 1u << 6, 7);  // mode 6
+	for (int ch = 0; ch < 4; ch++) {
+		writeBits(out, position, best.endpoints[0][ch], 7);
+		writeBits(out, position, best.endpoints[1][ch], 7);
+	}
+	writeBits(out, position, best.pbits[0], 1);
+	writeBits(out, position, best.pbits[1], 1);
+	for (int i = 0; i < 16; i++) {
+		writeBits(out, position, best.indices[i], i == 0 ? 3 : 4);
+	}
+}
+
+// --- Images ----------------------------------------------------------------
+
+// Gather a 4x4 block as RGBA, clamping at the edges of small or odd sized levels
+static void gatherBlock(const unsigned char* pixels, int width, int height, int channels, int blockX, int blockY, uint8_t out[64])
+{
+	for (int y = 0; y < 4; y++) {
+		int sy = std::min(blockY * 4 + y, height - 1);
+		for (int x = 0; x < 4; x++) {
+			int sx = std::min(blockX * 4 + x, width - 1);
+			const unsigned char* texel = pixels + (static_cast<size_t>(sy) * width + sx) * channels;
+			uint8_t* dest = out + (y * 4 + x) * 4;
+
+			switch (channels) {
+			case 1: dest[0] = dest[1] = dest[2] = texel[0]; dest[3] = 255; break;
+			case 2: dest[0] = dest[1] = dest[2] = texel[0]; dest[3] = texel[1]; break;
+			case 3: dest[0] = texel[0]; dest[1] = texel[1]; dest[2] = texel[2]; dest[3] = 255; break;
+			default: memcpy(dest, texel, 4); break;
+			}
+		}
+	}
+}
+
+static void encodeBlock(BlockFormat format, const uint8_t pixels[64], uint8_t* out)
+{
+	switch (format) {
+	case BlockFormat::BC1: BlockEncoder::encodeBC1(pixels, out); break;
+	case BlockFormat::BC3: BlockEncoder::encodeBC3(pixels, out); break;
+	case BlockFormat::BC4: BlockEncoder::encodeBC4(pixels, 0, out); break;
+	case BlockFormat::BC5: BlockEncoder::encodeBC5(pixels, out); break;
+	case BlockFormat::BC7: BlockEncoder::encodeBC7(pixels, out); break;
+	default: break;
+	}
+}
+
+bool BlockEncoder::encode(const Texture::Image& image, BlockFormat format, ThreadPool& pool, CompressedImage& out)
+{
+	size_t blockSize = CompressedImage::getBlockSize(format);
+	if (!image.isValid() || blockSize == 0) return false;
+
+	Texture::Image withMips = image;
+	if (withMips.mips.empty()) {
+		Texture::generateMips(withMips);
+	}
+
+	out = CompressedImage();
+	out.format = format;
+	out.width = image.width;
+	out.height = image.height;
+
+	// Lay out every level first so the jobs write straight into the final buffer
+	struct Source { const unsigned char* pixels; int width; int height; };
+	std::vector<Source> sources;
+	sources.push_back({ withMips.pixels.data(), withMips.width, withMips.height });
+	for (const auto& mip : withMips.mips) {
+		sources.push_back({ mip.pixels.data(), mip.width, mip.height });
+	}
+
+	size_t offset = 0;
+	for (const auto& source : sources) {
+		size_t size = CompressedImage::getLevelSize(format, source.width, source.height);
+		out.levels.push_back({ offset, size, source.width, source.height });
+		offset += size;
+	}
+	out.data.resize(offset);
+
+	// A few block rows per job keeps the queue short on big levels
+	const int rowsPerJob = 4;
+	const int channels = image.channels;
+	for (size_t level = 0; level < sources.size(); level++) {
+		const Source source = sources[level];
+		unsigned char* levelData = out.data.data() + out.levels[level].offset;
+		int blocksX = (source.width + 3) / 4;
+		int blocksY = (source.height + 3) / 4;
+
+		for (int firstRow = 0; firstRow < blocksY; firstRow += rowsPerJob) {
+			int lastRow = std::min(blocksY, firstRow + rowsPerJob);
+			pool.enqueue([=]() {
+				uint8_t pixels[64];
+				for (int by = firstRow; by < lastRow; by++) {
+					for (int bx = 0; bx < blocksX; bx++) {
+						gatherBlock(source.pixels, source.width, source.height, channels, bx, by, pixels);
+						encodeBlock(format, pixels, levelData + (static_cast<size_t>(by) * blocksX + bx) * blockSize);
+					}
+				}
+			});
+		}
+	}
+
+	pool.waitIdle();
+	return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Renderer/CompressedImage.h"
+#include "Renderer/Texture.h"
+#include <cstdint>
+
+class ThreadPool;
+
+// CPU block compressor. Blocks are independent, so every mip level is split
+// into rows of blocks that run on the pool, and the palette searches inside a
+// block use SSE2 (4 pixels per instruction) when the compiler targets it.
+class BlockEncoder
+{
+public:
+	/// <summary>
+	/// Encode an image and its mip chain (built with Texture::generateMips if missing)
+	/// </summary>
+	/// <param name="image">Decoded image, 1, 2 or 4 channels</param>
+	/// <param name="format">Target block format</param>
+	/// <param name="pool">Workers to spread block rows over, waited on before returning</param>
+	/// <param name="out">Compressed levels</param>
+	/// <returns>false for an empty image or unknown format</returns>
+	static bool encode(const Texture::Image& image, BlockFormat format, ThreadPool& pool, CompressedImage& out);
+
+	// Single 4x4 blocks, pixels are 16 RGBA texels in row order
+	static void encodeBC1(const uint8_t pixels[64], uint8_t out[8]);
+	static void encodeBC3(const uint8_t pixels[64], uint8_t out[16]);
+	static void encodeBC4(const uint8_t pixels[64], int channel, uint8_t out[8]);
+	static void encodeBC5(const uint8_t pixels[64], uint8_t out[16]);
+
+	// BC7 mode 6 only (one RGBA subset, 4-bit indices). The other modes would
+	// help blocks with two distinct colours but cost far more search time.
+	static void encodeBC7(const uint8_t pixels[64], uint8_t out[16]);
+};
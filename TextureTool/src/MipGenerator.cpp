@@ -0,0 +1,213 @@
+#include "MipGenerator.h"
+#include "Utils/Simd.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+static const float KAISER_ALPHA = 4.0f;
+static const float KAISER_RADIUS = 1.5f;    // in destination pixels
+static const int ROWS_PER_JOB = 16;
+
+// Per destination pixel: the source pixels it reads and their weights, edges
+// are clamped into the index list so the passes never branch
+struct Kernel {
+	std::vector<int> start;     // destination count + 1 offsets into index/weight
+	std::vector<int> index;
+	std::vector<float> weight;
+};
+
+// Zeroth order modified Bessel function, the series converges quickly for alpha ~4
+static float besselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (int k = 1; k < 20; k++) {
+		float factor = x / (2.0f * k);
+		term *= factor * factor;
+		sum += term;
+	}
+	return sum;
+}
+
+static float sinc(float x)
+{
+	if (std::fabs(x) < 1e-5f) return 1.0f;
+	const float pi = 3.14159265358979f;
+	return std::sin(pi * x) / (pi * x);
+}
+
+static Kernel buildKernel(int sourceSize, int destSize, MipGenerator::Filter filter)
+{
+	Kernel kernel;
+	kernel.start.push_back(0);
+
+	const float scale = static_cast<float>(sourceSize) / static_cast<float>(destSize);
+	const float normalizer = besselI0(KAISER_ALPHA);
+
+	for (int x = 0; x < destSize; x++) {
+		size_t first = kernel.weight.size();
+		float total = 0.0f;
+
+		if (filter == MipGenerator::Filter::Box) {
+			// Coverage of [x * scale, (x + 1) * scale] by each source pixel
+			float left = x * scale;
+			float right = left + scale;
+			for (int i = static_cast<int>(std::floor(left)); i < right; i++) {
+				float w = std::min(right, i + 1.0f) - std::max(left, static_cast<float>(i));
+				if (w <= 0.0f) continue;
+				kernel.index.push_back(std::min(i, sourceSize - 1));
+				kernel.weight.push_back(w);
+				total += w;
+			}
+		}
+		else {
+			float center = (x + 0.5f) * scale;
+			float radius = KAISER_RADIUS * scale;
+			int begin = static_cast<int>(std::floor(center - radius));
+			int end = static_cast<int>(std::ceil(center + radius));
+			for (int i = begin; i <= end; i++) {
+				float distance = (i + 0.5f - center) / scale;
+				float t = distance / KAISER_RADIUS;
+				if (std::fabs(t) >= 1.0f) continue;
+
+				float w = sinc(distance) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / normalizer;
+				if (w == 0.0f) continue;
+				kernel.index.push_back(std::max(0, std::min(i, sourceSize - 1)));
+				kernel.weight.push_back(w);
+				total += w;
+			}
+		}
+
+		for (size_t i = first; i < kernel.weight.size(); i++) {
+			kernel.weight[i] /= total;
+		}
+		kernel.start.push_back(static_cast<int>(kernel.weight.size()));
+	}
+	return kernel;
+}
+
+// Weighted sum of float4 pixels, `stride` floats between consecutive taps
+static inline void accumulate(const float* source, size_t stride, const Kernel& kernel, int x, float* out)
+{
+#ifdef BOX_SSE
+	__m128 sum = _mm_setzero_ps();
+	for (int i = kernel.start[x]; i < kernel.start[x + 1]; i++) {
+		__m128 pixel = _mm_loadu_ps(source + kernel.index[i] * stride);
+		sum = _mm_add_ps(sum, _mm_mul_ps(pixel, _mm_set1_ps(kernel.weight[i])));
+	}
+	_mm_storeu_ps(out, sum);
+#else
+	float sum[4] = {};
+	for (int i = kernel.start[x]; i < kernel.start[x + 1]; i++) {
+		const float* pixel = source + kernel.index[i] * stride;
+		for (int c = 0; c < 4; c++) {
+			sum[c] += pixel[c] * kernel.weight[i];
+		}
+	}
+	std::copy(sum, sum + 4, out);
+#endif
+}
+
+static float linearToSRGB(float value)
+{
+	value = std::max(0.0f, std::min(1.0f, value));
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Rows [0, rows) split into jobs on the pool
+template <typename Job>
+static void parallelRows(ThreadPool& pool, int rows, Job job)
+{
+	for (int first = 0; first < rows; first += ROWS_PER_JOB) {
+		int last = std::min(rows, first + ROWS_PER_JOB);
+		pool.enqueue([=]() {
+			for (int y = first; y < last; y++) {
+				job(y);
+			}
+		});
+	}
+	pool.waitIdle();
+}
+
+void MipGenerator::generate(Texture::Image& image, const Options& options, ThreadPool& pool)
+{
+	image.mips.clear();
+	if (!image.isValid()) return;
+
+	const int channels = image.channels;
+	const int colourChannels = options.srgb ? (channels >= 3 ? 3 : 1) : 0;
+
+	float decode[256];
+	for (int i = 0; i < 256; i++) {
+		float value = i / 255.0f;
+		decode[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	// Working copy is always 4 floats per pixel so every tap is one SIMD load
+	int width = image.width;
+	int height = image.height;
+	std::vector<float> source(static_cast<size_t>(width) * height * 4, 0.0f);
+	for (size_t p = 0; p < static_cast<size_t>(width) * height; p++) {
+		for (int c = 0; c < channels; c++) {
+			unsigned char value = image.pixels[p * channels + c];
+			source[p * 4 + c] = c < colourChannels ? decode[value] : value / 255.0f;
+		}
+	}
+
+	std::vector<float> temp;
+	std::vector<float> dest;
+	while (width > 1 || height > 1) {
+		int destWidth = std::max(1, width / 2);
+		int destHeight = std::max(1, height / 2);
+		Kernel horizontal = buildKernel(width, destWidth, options.filter);
+		Kernel vertical = buildKernel(height, destHeight, options.filter);
+
+		// Horizontal pass keeps every source row, the vertical one then reduces rows
+		temp.assign(static_cast<size_t>(destWidth) * height * 4, 0.0f);
+		parallelRows(pool, height, [&](int y) {
+			const float* row = source.data() + static_cast<size_t>(y) * width * 4;
+			float* out = temp.data() + static_cast<size_t>(y) * destWidth * 4;
+			for (int x = 0; x < destWidth; x++) {
+				accumulate(row, 4, horizontal, x, out + x * 4);
+			}
+		});
+
+		dest.assign(static_cast<size_t>(destWidth) * destHeight * 4, 0.0f);
+		Texture::Image::MipLevel level;
+		level.width = destWidth;
+		level.height = destHeight;
+		level.pixels.resize(static_cast<size_t>(destWidth) * destHeight * channels);
+
+		parallelRows(pool, destHeight, [&](int y) {
+			float* out = dest.data() + static_cast<size_t>(y) * destWidth * 4;
+			unsigned char* pixels = level.pixels.data() + static_cast<size_t>(y) * destWidth * channels;
+
+			for (int x = 0; x < destWidth; x++) {
+				float* pixel = out + x * 4;
+				accumulate(temp.data() + x * 4, static_cast<size_t>(destWidth) * 4, vertical, y, pixel);
+
+				if (options.normalMap && channels >= 3) {
+					float nx = pixel[0] * 2.0f - 1.0f;
+					float ny = pixel[1] * 2.0f - 1.0f;
+					float nz = pixel[2] * 2.0f - 1.0f;
+					float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+					if (length > 1e-5f) {
+						pixel[0] = (nx / length) * 0.5f + 0.5f;
+						pixel[1] = (ny / length) * 0.5f + 0.5f;
+						pixel[2] = (nz / length) * 0.5f + 0.5f;
+					}
+				}
+
+				for (int c = 0; c < channels; c++) {
+					float value = c < colourChannels ? linearToSRGB(pixel[c]) : std::max(0.0f, std::min(1.0f, pixel[c]));
+					pixels[x * channels + c] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+				}
+			}
+		});
+
+		image.mips.push_back(std::move(level));
+		source.swap(dest);
+		width = destWidth;
+		height = destHeight;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Renderer/Texture.h"
+
+class ThreadPool;
+
+// Offline mip chain builder. Unlike Texture::generateMips (a 2x2 box on 8-bit
+// data, cheap enough for load time) every level is filtered from the previous
+// one in float, colour textures in linear light, with a windowed sinc that
+// keeps small details from turning to mush a few levels down.
+class MipGenerator
+{
+public:
+	enum class Filter {
+		Box,        // exact area average, also handles odd sizes
+		Kaiser      // Kaiser windowed sinc, sharper, can ring slightly on hard edges
+	};
+
+	struct Options {
+		Filter filter = Filter::Kaiser;
+		bool srgb = false;          // decode to linear before filtering, encode after
+		bool normalMap = false;     // renormalize xyz after filtering
+	};
+
+	/// <summary>
+	/// Replace image.mips with a full chain down to 1x1
+	/// </summary>
+	/// <param name="image">Decoded image, 1, 2 or 4 channels</param>
+	/// <param name="options">Filter and colour space</param>
+	/// <param name="pool">Workers to spread rows over, waited on before returning</param>
+	static void generate(Texture::Image& image, const Options& options, ThreadPool& pool);
+};
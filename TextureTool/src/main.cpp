@@ -0,0 +1,238 @@
+#include "BlockEncoder.h"
+#include "MipGenerator.h"
+#include "Renderer/BoxTexFile.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Offline texture compressor. Builds a filtered mip chain and writes a .boxtex
+// (or .dds) next to each input that Model picks up instead of the source image
+// (see findCompressedVariant in Model.cpp).
+
+static void printUsage()
+{
+    std::cout << "Usage: TextureTool [options] <image>...\n"
+              << "  -o <file>     output path (single input only), default: input with .boxtex\n"
+              << "  -c <format>   boxtex | dds container, default: from -o, else boxtex\n"
+              << "  -f <format>   bc1 | bc3 | bc4 | bc5 | bc7 | none, default picked from the texture type\n"
+              << "  -m <filter>   box | kaiser mip filter, default: kaiser\n"
+              << "  -t <type>     diffuse | specular | normal | height, default guessed from the name\n"
+              << "  -j <threads>  worker threads, default: all hardware threads\n";
+}
+
+static std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+static bool parseType(const std::string& name, TextureType& type)
+{
+    if (name == "diffuse") type = DIFFUSE;
+    else if (name == "specular") type = SPECULAR;
+    else if (name == "normal") type = NORMAL;
+    else if (name == "height") type = HEIGHT;
+    else return false;
+    return true;
+}
+
+static bool parseFormat(const std::string& name, BlockFormat& format)
+{
+    if (name == "none") format = BlockFormat::None;
+    else if (name == "bc1") format = BlockFormat::BC1;
+    else if (name == "bc3") format = BlockFormat::BC3;
+    else if (name == "bc4") format = BlockFormat::BC4;
+    else if (name == "bc5") format = BlockFormat::BC5;
+    else if (name == "bc7") format = BlockFormat::BC7;
+    else return false;
+    return true;
+}
+
+// Same naming conventions the sample assets and most exporters use
+static TextureType guessType(const std::string& path)
+{
+    std::string name = toLower(path.substr(path.find_last_of("/\\") + 1));
+    if (name.find("normal") != std::string::npos || name.find("_nrm") != std::string::npos) return NORMAL;
+    if (name.find("height") != std::string::npos || name.find("disp") != std::string::npos ||
+        name.find("bump") != std::string::npos) return HEIGHT;
+    if (name.find("specular") != std::string::npos || name.find("roughness") != std::string::npos ||
+        name.find("metallic") != std::string::npos) return SPECULAR;
+    return DIFFUSE;
+}
+
+// Normal maps keep two full precision channels, grey specular/height data
+// goes to BC4 (only red is sampled), colour gets BC7
+static BlockFormat defaultFormat(TextureType type, const Texture::Image& image)
+{
+    switch (type) {
+    case NORMAL: return BlockFormat::BC5;
+    case SPECULAR:
+    case HEIGHT: return image.channels <= 2 ? BlockFormat::BC4 : BlockFormat::BC1;
+    default: return BlockFormat::BC7;
+    }
+}
+
+static std::string replaceExtension(const std::string& path, const std::string& extension)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + extension;
+    return path.substr(0, dot) + extension;
+}
+
+static const char* formatName(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC4: return "BC4";
+    case BlockFormat::BC5: return "BC5";
+    case BlockFormat::BC7: return "BC7";
+    default: return "uncompressed";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string output;
+    std::string typeName;
+    BlockFormat format = BlockFormat::None;
+    bool formatGiven = false;
+    std::string container;
+    MipGenerator::Filter filter = MipGenerator::Filter::Kaiser;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        }
+        else if (arg == "-o" && hasValue) {
+            output = argv[++i];
+        }
+        else if (arg == "-f" && hasValue) {
+            if (!parseFormat(toLower(argv[++i]), format)) {
+                std::cerr << "Unknown format: " << argv[i] << std::endl;
+                return 1;
+            }
+            formatGiven = true;
+        }
+        else if (arg == "-c" && hasValue) {
+            container = toLower(argv[++i]);
+            if (container != "boxtex" && container != "dds") {
+                std::cerr << "Unknown container: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "-m" && hasValue) {
+            std::string name = toLower(argv[++i]);
+            if (name == "box") filter = MipGenerator::Filter::Box;
+            else if (name == "kaiser") filter = MipGenerator::Filter::Kaiser;
+            else {
+                std::cerr << "Unknown mip filter: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "-t" && hasValue) {
+            typeName = toLower(argv[++i]);
+            TextureType unused;
+            if (!parseType(typeName, unused)) {
+                std::cerr << "Unknown texture type: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "-j" && hasValue) {
+            threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty() || (!output.empty() && inputs.size() > 1)) {
+        printUsage();
+        return 1;
+    }
+
+    if (container.empty()) {
+        container = (!output.empty() && toLower(output).size() >= 4 &&
+            toLower(output).compare(output.size() - 4, 4, ".dds") == 0) ? "dds" : "boxtex";
+    }
+    if (container == "dds" && formatGiven && format == BlockFormat::None) {
+        std::cerr << "Uncompressed output needs the boxtex container" << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    int failures = 0;
+
+    for (const auto& input : inputs) {
+        auto start = std::chrono::steady_clock::now();
+
+        TextureType type = guessType(input);
+        if (!typeName.empty()) parseType(typeName, type);
+
+        // Decoded exactly like the engine would, so rows end up in the order
+        // loadFromCompressed uploads them
+        Texture::Image image;
+        if (!Texture::decodeFile(input, type, image)) {
+            std::cerr << "Failed to load " << input << std::endl;
+            failures++;
+            continue;
+        }
+
+        // Colour is filtered in linear light, data maps as stored
+        MipGenerator::Options mipOptions;
+        mipOptions.filter = filter;
+        mipOptions.srgb = type == DIFFUSE;
+        mipOptions.normalMap = type == NORMAL;
+        MipGenerator::generate(image, mipOptions, pool);
+
+        BlockFormat target = formatGiven ? format : defaultFormat(type, image);
+        std::string path = output.empty() ? replaceExtension(input, "." + container) : output;
+
+        bool written = false;
+        size_t levels = image.mips.size() + 1;
+        size_t bytes = 0;
+        if (target == BlockFormat::None) {
+            written = BoxTexFile::write(path, image, mipOptions.srgb);
+            bytes = image.pixels.size();
+            for (const auto& mip : image.mips) bytes += mip.pixels.size();
+        }
+        else {
+            CompressedImage compressed;
+            written = BlockEncoder::encode(image, target, pool, compressed) &&
+                (container == "dds" ? compressed.saveDDS(path) : BoxTexFile::write(path, compressed, mipOptions.srgb));
+            levels = compressed.levels.size();
+            bytes = compressed.data.size();
+        }
+
+        if (!written) {
+            std::cerr << "Failed to write " << path << std::endl;
+            failures++;
+            continue;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << input << " -> " << path << " (" << formatName(target) << ", "
+                  << image.width << "x" << image.height << ", " << levels << " levels, "
+                  << bytes / 1024 << " KiB, " << seconds << " s)" << std::endl;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -33,4 +33,12 @@ workspace "BoxEngine"
     group ""
 
     include "BoxEngine-Core"
-    include "BoxEngine"
\ No newline at end of file
+    include "BoxEngine"
+
+    group "Tools"
+        include "TextureTool"
+    group ""
+
+    group "Tests"
+        include "Tests"
+    group ""
\ No newline at end of file